@@ -27,6 +27,22 @@ RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemDataKey;
 RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey;
 
 
+///The key that corresponds to a mock cache manager item's partial data.
+///
+///Items with partial data must also provide `kRKMockURLRequestPromiseCacheManagerItemValidatorKey`.
+RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemPartialDataKey;
+
+///The key that corresponds to the validator of a mock cache manager item's partial data.
+RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemValidatorKey;
+
+///The key that corresponds to the error reported when a mock cache manager item's partial data is removed.
+///
+///If this item-key is provided, removing the item's partial data fails and leaves it in place.
+RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemPartialDataRemovalErrorKey;
+
+///The key that corresponds to a mock cache manager item's expiration date.
+RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey;
+
 ///The RKMockURLRequestPromiseCacheManager class encapsulates an in-memory cache manager
 ///that includes a mechanism to allow for deterministic cache failure for testing.
 ///
@@ -86,4 +102,10 @@ RK_EXTERN NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey;
 ///Whether or not the method was called.
 @property (readonly) BOOL removeCacheForIdentifierErrorWasCalled;
 
+///Whether or not the method was called.
+@property (readonly) BOOL removePartialDataForIdentifierErrorWasCalled;
+
+///Whether or not the method was called.
+@property (readonly) BOOL noteRevalidationForIdentifierWasCalled;
+
 @end
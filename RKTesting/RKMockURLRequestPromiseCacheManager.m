@@ -11,6 +11,10 @@
 NSString *const kRKMockURLRequestPromiseCacheManagerItemRevisionKey = @"revision";
 NSString *const kRKMockURLRequestPromiseCacheManagerItemDataKey = @"data";
 NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey = @"error";
+NSString *const kRKMockURLRequestPromiseCacheManagerItemPartialDataKey = @"partialData";
+NSString *const kRKMockURLRequestPromiseCacheManagerItemValidatorKey = @"validator";
+NSString *const kRKMockURLRequestPromiseCacheManagerItemPartialDataRemovalErrorKey = @"partialDataRemovalError";
+NSString *const kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey = @"expirationDate";
 
 @interface RKMockURLRequestPromiseCacheManager ()
 
@@ -19,6 +23,8 @@ NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey = @"error";
 @property (readwrite) BOOL cacheDataForIdentifierWithRevisionErrorWasCalled;
 @property (readwrite) BOOL cachedDataForIdentifierErrorWasCalled;
 @property (readwrite) BOOL removeCacheForIdentifierErrorWasCalled;
+@property (readwrite) BOOL removePartialDataForIdentifierErrorWasCalled;
+@property (readwrite) BOOL noteRevalidationForIdentifierWasCalled;
 
 @end
 
@@ -55,6 +61,11 @@ NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey = @"error";
 }
 
 - (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)error
+{
+    return [self cacheData:data forIdentifier:identifier withRevision:revision expirationDate:nil error:error];
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate error:(NSError **)error
 {
     if([NSThread isMainThread])
         self.wasCalledFromMainThread = YES;
@@ -68,8 +79,12 @@ NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey = @"error";
             return NO;
         }
         
-        _cachedData[identifier] = @{kRKMockURLRequestPromiseCacheManagerItemRevisionKey: revision,
-                                    kRKMockURLRequestPromiseCacheManagerItemDataKey: data};
+        NSMutableDictionary *item = [@{kRKMockURLRequestPromiseCacheManagerItemRevisionKey: revision,
+                                       kRKMockURLRequestPromiseCacheManagerItemDataKey: data} mutableCopy];
+        if(expirationDate)
+            item[kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey] = expirationDate;
+        
+        _cachedData[identifier] = item;
         return YES;
     }
 }
@@ -115,6 +130,80 @@ NSString *const kRKMockURLRequestPromiseCacheManagerItemErrorKey = @"error";
     return YES;
 }
 
+#pragma mark - Partial Data
+
+- (BOOL)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator error:(NSError **)error
+{
+    if([NSThread isMainThread])
+        self.wasCalledFromMainThread = YES;
+    
+    @synchronized(_cachedData) {
+        NSMutableDictionary *item = [_cachedData[identifier] mutableCopy] ?: [NSMutableDictionary dictionary];
+        item[kRKMockURLRequestPromiseCacheManagerItemPartialDataKey] = data;
+        item[kRKMockURLRequestPromiseCacheManagerItemValidatorKey] = validator;
+        _cachedData[identifier] = item;
+        return YES;
+    }
+}
+
+- (NSData *)partialDataForIdentifier:(NSString *)identifier validator:(NSString **)outValidator
+{
+    if([NSThread isMainThread])
+        self.wasCalledFromMainThread = YES;
+    
+    @synchronized(_cachedData) {
+        NSDictionary *item = _cachedData[identifier];
+        *outValidator = item[kRKMockURLRequestPromiseCacheManagerItemValidatorKey];
+        return item[kRKMockURLRequestPromiseCacheManagerItemPartialDataKey];
+    }
+}
+
+- (BOOL)removePartialDataForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    if([NSThread isMainThread])
+        self.wasCalledFromMainThread = YES;
+    
+    self.removePartialDataForIdentifierErrorWasCalled = YES;
+    
+    @synchronized(_cachedData) {
+        NSMutableDictionary *item = [_cachedData[identifier] mutableCopy];
+        if(item[kRKMockURLRequestPromiseCacheManagerItemPartialDataRemovalErrorKey]) {
+            if(outError) *outError = item[kRKMockURLRequestPromiseCacheManagerItemPartialDataRemovalErrorKey];
+            return NO;
+        }
+        
+        [item removeObjectForKey:kRKMockURLRequestPromiseCacheManagerItemPartialDataKey];
+        [item removeObjectForKey:kRKMockURLRequestPromiseCacheManagerItemValidatorKey];
+        if(item)
+            _cachedData[identifier] = item;
+    }
+    
+    return YES;
+}
+
+#pragma mark - Expiration
+
+- (NSDate *)expirationDateForIdentifier:(NSString *)identifier
+{
+    if([NSThread isMainThread])
+        self.wasCalledFromMainThread = YES;
+    
+    @synchronized(_cachedData) {
+        NSDictionary *item = _cachedData[identifier];
+        return item[kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey];
+    }
+}
+
+#pragma mark - Statistics
+
+- (void)noteRevalidationForIdentifier:(NSString *)identifier
+{
+    if([NSThread isMainThread])
+        self.wasCalledFromMainThread = YES;
+    
+    self.noteRevalidationForIdentifierWasCalled = YES;
+}
+
 #pragma mark - Deterministic Failure
 
 - (void)setError:(NSError *)error forIdentifier:(NSString *)identifier
@@ -0,0 +1,46 @@
+//
+//  RKAsyncCacheManagerAdapter.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKAsyncCacheManagerAdapter_h
+#define RKAsyncCacheManagerAdapter_h 1
+
+#import "RKURLRequestPromise.h"
+
+///The RKAsyncCacheManagerAdapter class allows cache managers that only conform to
+///`<RKURLRequestPromiseCacheManager>` to be used as `<RKAsyncURLRequestPromiseCacheManager>`s.
+///
+///The asynchronous methods of the adapter, including the optional partial data methods, invoke
+///the synchronous methods of the cache manager it wraps on a shared operation queue. All other
+///methods are forwarded directly to the wrapped cache manager.
+@interface RKAsyncCacheManagerAdapter : NSObject <RKAsyncURLRequestPromiseCacheManager>
+
+///Initialize the receiver with the cache manager it should wrap.
+///
+/// \param  cacheManager    The synchronous cache manager to wrap. Required.
+///
+/// \result A fully initialized adapter.
+///
+///This is the designated initializer.
+- (instancetype)initWithCacheManager:(id <RKURLRequestPromiseCacheManager>)cacheManager;
+
+///The cache manager wrapped by the receiver.
+@property (readonly) id <RKURLRequestPromiseCacheManager> cacheManager;
+
+@end
+
+#pragma mark -
+
+///Returns an asynchronous cache manager for a given cache manager.
+///
+/// \param  cacheManager    The cache manager. Required.
+///
+/// \result `cacheManager` if it conforms to `<RKAsyncURLRequestPromiseCacheManager>`,
+///         otherwise an `RKAsyncCacheManagerAdapter` wrapping it.
+RK_EXTERN id <RKAsyncURLRequestPromiseCacheManager> RKAsyncCacheManagerForCacheManager(id <RKURLRequestPromiseCacheManager> cacheManager);
+
+#endif /* RKAsyncCacheManagerAdapter_h */
@@ -0,0 +1,216 @@
+//
+//  RKAsyncCacheManagerAdapter.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKAsyncCacheManagerAdapter.h"
+
+///The maximum number of synchronous cache manager calls the adapters may have in flight at once.
+static NSInteger const kMaximumConcurrentOperationCount = 4;
+
+@implementation RKAsyncCacheManagerAdapter
+
++ (NSOperationQueue *)sharedOperationQueue
+{
+    static NSOperationQueue *sharedOperationQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedOperationQueue = [NSOperationQueue new];
+        sharedOperationQueue.name = @"com.roundabout.rk.RKAsyncCacheManagerAdapter.sharedOperationQueue";
+        sharedOperationQueue.maxConcurrentOperationCount = kMaximumConcurrentOperationCount;
+    });
+    
+    return sharedOperationQueue;
+}
+
+- (instancetype)init
+{
+    NSAssert(0, @"RKAsyncCacheManagerAdapter requires a cache manager. Use -initWithCacheManager:.");
+    return nil;
+}
+
+- (instancetype)initWithCacheManager:(id <RKURLRequestPromiseCacheManager>)cacheManager
+{
+    NSParameterAssert(cacheManager);
+    
+    if((self = [super init])) {
+        _cacheManager = cacheManager;
+    }
+    
+    return self;
+}
+
+#pragma mark - Forwarding
+
+- (BOOL)respondsToSelector:(SEL)selector
+{
+    if(selector == @selector(cachePartialData:forIdentifier:withValidator:error:) ||
+       selector == @selector(partialDataForIdentifier:validator:) ||
+       selector == @selector(removePartialDataForIdentifier:error:) ||
+       selector == @selector(cacheData:forIdentifier:withRevision:expirationDate:error:) ||
+       selector == @selector(expirationDateForIdentifier:) ||
+       selector == @selector(noteRevalidationForIdentifier:))
+        return [_cacheManager respondsToSelector:selector];
+    
+    //The asynchronous partial data methods are only available when their synchronous counterparts are.
+    if(selector == @selector(cachePartialData:forIdentifier:withValidator:completionHandler:))
+        return [_cacheManager respondsToSelector:@selector(cachePartialData:forIdentifier:withValidator:error:)];
+    else if(selector == @selector(loadPartialDataForIdentifier:completionHandler:))
+        return [_cacheManager respondsToSelector:@selector(partialDataForIdentifier:validator:)];
+    else if(selector == @selector(removePartialDataForIdentifier:completionHandler:))
+        return [_cacheManager respondsToSelector:@selector(removePartialDataForIdentifier:error:)];
+    
+    return [super respondsToSelector:selector];
+}
+
+- (id)forwardingTargetForSelector:(SEL)selector
+{
+    if([_cacheManager respondsToSelector:selector])
+        return _cacheManager;
+    
+    return [super forwardingTargetForSelector:selector];
+}
+
+#pragma mark - <RKURLRequestPromiseCacheManager>
+
+- (NSString *)revisionForIdentifier:(NSString *)identifier
+{
+    return [_cacheManager revisionForIdentifier:identifier];
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)outError
+{
+    return [_cacheManager cacheData:data forIdentifier:identifier withRevision:revision error:outError];
+}
+
+- (NSData *)cachedDataForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    return [_cacheManager cachedDataForIdentifier:identifier error:outError];
+}
+
+- (BOOL)removeCacheForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    return [_cacheManager removeCacheForIdentifier:identifier error:outError];
+}
+
+- (BOOL)removeAllCache:(NSError **)outError
+{
+    return [_cacheManager removeAllCache:outError];
+}
+
+#pragma mark - <RKAsyncURLRequestPromiseCacheManager>
+
+- (void)loadRevisionForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerRevisionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        handler([cacheManager revisionForIdentifier:identifier]);
+    }];
+}
+
+- (void)loadCachedDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerDataHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSError *error = nil;
+        NSData *data = [cacheManager cachedDataForIdentifier:identifier error:&error];
+        handler(data, error);
+    }];
+}
+
+- (void)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = NO;
+        if([cacheManager respondsToSelector:@selector(cacheData:forIdentifier:withRevision:expirationDate:error:)])
+            success = [cacheManager cacheData:data forIdentifier:identifier withRevision:revision expirationDate:expirationDate error:&error];
+        else
+            success = [cacheManager cacheData:data forIdentifier:identifier withRevision:revision error:&error];
+        handler(success, error);
+    }];
+}
+
+- (void)removeCacheForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [cacheManager removeCacheForIdentifier:identifier error:&error];
+        handler(success, error);
+    }];
+}
+
+#pragma mark - Partial Data
+
+- (void)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(data);
+    NSParameterAssert(identifier);
+    NSParameterAssert(validator);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [cacheManager cachePartialData:data forIdentifier:identifier withValidator:validator error:&error];
+        handler(success, error);
+    }];
+}
+
+- (void)loadPartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerPartialDataHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSString *validator = nil;
+        NSData *partialData = [cacheManager partialDataForIdentifier:identifier validator:&validator];
+        handler(partialData, validator);
+    }];
+}
+
+- (void)removePartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    
+    id <RKURLRequestPromiseCacheManager> cacheManager = _cacheManager;
+    [[self.class sharedOperationQueue] addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [cacheManager removePartialDataForIdentifier:identifier error:&error];
+        if(handler)
+            handler(success, error);
+    }];
+}
+
+@end
+
+#pragma mark -
+
+id <RKAsyncURLRequestPromiseCacheManager> RKAsyncCacheManagerForCacheManager(id <RKURLRequestPromiseCacheManager> cacheManager)
+{
+    NSCParameterAssert(cacheManager);
+    
+    if([cacheManager conformsToProtocol:@protocol(RKAsyncURLRequestPromiseCacheManager)])
+        return (id <RKAsyncURLRequestPromiseCacheManager>)cacheManager;
+    
+    return [[RKAsyncCacheManagerAdapter alloc] initWithCacheManager:cacheManager];
+}
@@ -64,6 +64,13 @@
     }
 }
 
+#pragma mark - Identity
+
+- (NSString *)processingIdentifier
+{
+    return NSStringFromClass(self.class);
+}
+
 @end
 
 #pragma mark -
@@ -116,6 +123,13 @@
     }
 }
 
+#pragma mark - Identity
+
+- (NSString *)processingIdentifier
+{
+    return NSStringFromClass(self.class);
+}
+
 @end
 
 #pragma mark -
@@ -160,6 +174,13 @@
     }
 }
 
+#pragma mark - Identity
+
+- (NSString *)processingIdentifier
+{
+    return NSStringFromClass(self.class);
+}
+
 @end
 
 #pragma mark -
@@ -0,0 +1,33 @@
+//
+//  RKFileSystemCacheCompression.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKFileSystemCacheCompression_h
+#define RKFileSystemCacheCompression_h 1
+
+#import <Foundation/Foundation.h>
+
+///Returns whether or not data begins with the signature of a format that is already
+///compressed, such as PNG, JPEG, GIF and WebP images, gzip and zip archives, and MPEG-4
+///media. Such data gains next to nothing from being compressed again.
+RK_EXTERN BOOL RKFileSystemCacheDataIsCompressed(NSData *data);
+
+///Compresses data with zlib, returning nil if doing so would not save at least an eighth of its size.
+///
+///The compressed data is prefixed with the length of the original data, so that it can
+///be decompressed into a buffer of exactly the right size in a single pass.
+RK_EXTERN NSData *RKFileSystemCacheCompressData(NSData *data);
+
+///Decompresses data returned by `RKFileSystemCacheCompressData`.
+///
+/// \param  data        The compressed data. Required.
+/// \param  outError    On return, an error describing why the data could not be decompressed.
+///
+/// \result The original data, or nil if the compressed data is malformed.
+RK_EXTERN NSData *RKFileSystemCacheDecompressData(NSData *data, NSError **outError);
+
+#endif /* RKFileSystemCacheCompression_h */
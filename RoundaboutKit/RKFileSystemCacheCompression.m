@@ -0,0 +1,90 @@
+//
+//  RKFileSystemCacheCompression.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKFileSystemCacheCompression.h"
+#import <zlib.h>
+
+///The fraction of its size data must shrink by for its compressed form to be kept.
+static double const kMinimumCompressionSavings = 0.125;
+
+///The header that precedes every compressed payload.
+typedef struct RKFileSystemCacheCompressionHeader {
+    uint64_t uncompressedLength;
+} RKFileSystemCacheCompressionHeader;
+
+///Returns whether or not data contains a given signature at a given offset.
+RK_INLINE BOOL data_has_signature(NSData *data, NSUInteger offset, const char *signature, NSUInteger length)
+{
+    return (data.length >= offset + length && memcmp((const uint8_t *)data.bytes + offset, signature, length) == 0);
+}
+
+BOOL RKFileSystemCacheDataIsCompressed(NSData *data)
+{
+    return (data_has_signature(data, 0, "\x89PNG", 4) ||
+            data_has_signature(data, 0, "\xFF\xD8\xFF", 3) ||
+            data_has_signature(data, 0, "GIF8", 4) ||
+            (data_has_signature(data, 0, "RIFF", 4) && data_has_signature(data, 8, "WEBP", 4)) ||
+            data_has_signature(data, 0, "\x1F\x8B", 2) ||
+            data_has_signature(data, 0, "PK\x03\x04", 4) ||
+            data_has_signature(data, 4, "ftyp", 4));
+}
+
+NSData *RKFileSystemCacheCompressData(NSData *data)
+{
+    NSCParameterAssert(data);
+    
+    RKFileSystemCacheCompressionHeader header = { .uncompressedLength = data.length };
+    uLongf compressedLength = compressBound((uLong)data.length);
+    NSMutableData *compressedData = [NSMutableData dataWithLength:sizeof(header) + compressedLength];
+    if(!compressedData)
+        return nil;
+    
+    memcpy(compressedData.mutableBytes, &header, sizeof(header));
+    int result = compress2((Bytef *)compressedData.mutableBytes + sizeof(header), &compressedLength,
+                           data.bytes, (uLong)data.length,
+                           Z_DEFAULT_COMPRESSION);
+    if(result != Z_OK)
+        return nil;
+    
+    NSUInteger length = sizeof(header) + compressedLength;
+    if(length > data.length * (1.0 - kMinimumCompressionSavings))
+        return nil;
+    
+    [compressedData setLength:length];
+    return compressedData;
+}
+
+NSData *RKFileSystemCacheDecompressData(NSData *data, NSError **outError)
+{
+    NSCParameterAssert(data);
+    
+    RKFileSystemCacheCompressionHeader header;
+    if(data.length < sizeof(header)) {
+        if(outError) *outError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:nil];
+        return nil;
+    }
+    
+    memcpy(&header, data.bytes, sizeof(header));
+    
+    //Nothing compresses by more than zlib's maximum ratio, so a larger length can only be corruption.
+    if(header.uncompressedLength > (data.length - sizeof(header)) * 1032ULL + 1024) {
+        if(outError) *outError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:nil];
+        return nil;
+    }
+    
+    NSMutableData *uncompressedData = [NSMutableData dataWithLength:(NSUInteger)header.uncompressedLength];
+    uLongf uncompressedLength = (uLongf)header.uncompressedLength;
+    int result = uncompress(uncompressedData.mutableBytes, &uncompressedLength,
+                            (const Bytef *)data.bytes + sizeof(header), (uLong)(data.length - sizeof(header)));
+    if(!uncompressedData || result != Z_OK || uncompressedLength != header.uncompressedLength) {
+        if(outError) *outError = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:nil];
+        return nil;
+    }
+    
+    return uncompressedData;
+}
@@ -0,0 +1,250 @@
+//
+//  RKFileSystemCacheIndex.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKFileSystemCacheIndex_h
+#define RKFileSystemCacheIndex_h 1
+
+#import <Foundation/Foundation.h>
+
+///The RKFileSystemCacheEntry class describes a single item stored by an `RKFileSystemCacheManager`.
+@interface RKFileSystemCacheEntry : NSObject <NSCopying>
+
+///The sanitized identifier of the entry.
+@property (copy) NSString *key;
+
+///The revision the entry was stored with.
+@property (copy) NSString *revision;
+
+///The time the entry was last accessed, relative to the reference date.
+@property NSTimeInterval lastAccessTime;
+
+///The number of bytes the entry occupies.
+@property unsigned long long dataSize;
+
+///The segment file the entry's data is packed into, or zero if the entry is stored in its own file.
+@property uint32_t segment;
+
+///The offset of the entry's data within its segment file. Zero if the entry is stored in its own file.
+@property unsigned long long offset;
+
+///The hash of the entry's data, or nil if the entry's data is not shared with other entries.
+///
+///Every entry with the same content hash references the same data.
+@property (copy) NSString *contentHash;
+
+///The time after which the entry should be removed, relative to the reference date.
+///Zero if the entry has no expiration time of its own.
+@property NSTimeInterval expirationTime;
+
+///Whether or not the entry's data is compressed. The entry's data size is always its compressed size.
+@property (getter=isCompressed) BOOL compressed;
+
+@end
+
+#pragma mark -
+
+///The RKFileSystemCacheIndex class maintains the entries of a file system cache.
+///
+///Changes to the index are persisted as an append-only journal of fixed-layout binary
+///records, so that a single change costs a single small write regardless of how many
+///entries the index contains. Once the journal grows larger than the index itself, it is
+///compacted into a snapshot of every entry, and truncated. Records describe the resulting
+///state of an entry rather than a delta, so replaying a journal over a snapshot that
+///already includes some of its records is harmless.
+///
+///Snapshots are open addressing hash tables of fixed-size slots that are memory-mapped
+///rather than parsed, so opening an index costs the same regardless of how many entries
+///it contains. Until its entries are loaded, an index answers lookups by probing the
+///mapped snapshot, and keeps the changes made since it was written in an overlay that
+///takes precedence over it. Entries are loaded the first time a method that needs every
+///entry is called, or when `-loadEntriesIfNeeded` is called.
+///
+///When an index is first opened in a directory containing the `__Metadata.plist`
+///file used by earlier versions of `RKFileSystemCacheManager`, or a property list
+///snapshot, its contents are migrated into a mapped snapshot and the file is removed.
+///
+///Entries are kept in a list ordered by how recently they were used, so that finding
+///the entries to evict never requires sorting. New entries may additionally be subject to
+///a TinyLFU admission policy: an estimate of how often each key has been accessed recently
+///is maintained, and a new entry is turned away if admitting it would require evicting an
+///entry that is used more often than it is. This keeps one-off responses from flushing out
+///entries that are in regular use.
+///
+///A Bloom filter over the keys of the entries is kept in memory, so that looking up a key
+///without an entry usually costs nothing more than a few bit tests, even before the entries
+///are loaded.
+///
+///Entries with a content hash share their data with every other entry with the same
+///content hash, and that data only counts towards the total size of the index once.
+///
+///Entries with an expiration time are kept in a min-heap ordered by expiration time,
+///so that finding the expired entries only costs as much as there are expired entries.
+///
+///RKFileSystemCacheIndex is not thread safe, access to it must be synchronized by its owner.
+///Methods that do not change the index may be called concurrently with one another, loading
+///the entries on behalf of one of them is synchronized by the index.
+///
+///An index may be shared by several processes, each with an index of its own opened on the
+///same directory. The processes coordinate through an advisory lock on the `__Index.lock`
+///file: changes are only made while holding it exclusively, and the index catches up with
+///the journal records and compactions of the other processes whenever it is locked.
+@interface RKFileSystemCacheIndex : NSObject
+
+///Initialize the receiver with the directory of a cache, loading any existing entries.
+///
+/// \param  directory   The directory the cache is stored in. Required.
+/// \param  shared      Whether or not other processes may use the directory at the same time.
+///
+/// \result A fully initialized cache index.
+///
+///This is the designated initializer.
+- (instancetype)initWithDirectory:(NSURL *)directory shared:(BOOL)shared;
+
+///Initialize the receiver with the directory of a cache that is not shared with any other process.
+- (instancetype)initWithDirectory:(NSURL *)directory;
+
+///The names of the files an index keeps in its directory.
++ (NSSet *)fileNames;
+
+#pragma mark - Properties
+
+///The directory of the cache.
+@property (readonly) NSURL *directory;
+
+///Whether or not the index is shared with other processes.
+@property (readonly, getter=isShared) BOOL shared;
+
+///The number of entries in the index.
+@property (readonly) NSUInteger count;
+
+///The sum of the sizes of the entries in the index.
+@property (readonly) unsigned long long totalSize;
+
+///Whether or not the index contains entries stored before the current key scheme was adopted.
+///
+///Every entry loaded from a `__Metadata.plist` file or an earlier version of the index is
+///considered a legacy entry until it is removed. Legacy entries remain accessible under
+///their original keys, migrating them is the responsibility of the index's owner.
+@property (readonly) BOOL hasLegacyEntries;
+
+///The maximum size of the cache, persisted alongside the entries. Zero if it has never been set.
+@property (nonatomic) unsigned long long maxCacheSize;
+
+#pragma mark - Entries
+
+///Returns the entry for a given key, or nil if there is none.
+///
+///The returned object is owned by the receiver and must not be mutated directly.
+- (RKFileSystemCacheEntry *)entryForKey:(NSString *)key;
+
+///Returns an entry that references the content with a given hash, or nil if there is none.
+///
+///The returned object is owned by the receiver and must not be mutated directly.
+- (RKFileSystemCacheEntry *)entryForContentHash:(NSString *)contentHash;
+
+///Returns the number of entries that reference the content with a given hash.
+- (NSUInteger)referenceCountForContentHash:(NSString *)contentHash;
+
+///Returns whether or not the entry for a given key was stored before the current key scheme was adopted.
+- (BOOL)isLegacyEntryForKey:(NSString *)key;
+
+///Returns copies of every entry in the index.
+- (NSArray *)allEntries;
+
+///Inserts an entry into the index, replacing any existing entry with the same key.
+- (void)setEntry:(RKFileSystemCacheEntry *)entry;
+
+///Updates the location of the data of the entry for a given key, without changing how recently it was used.
+- (void)moveEntryForKey:(NSString *)key toSegment:(uint32_t)segment offset:(unsigned long long)offset;
+
+///Updates the location of the data of every entry that references the content with a given hash.
+- (void)moveContentWithHash:(NSString *)contentHash toSegment:(uint32_t)segment offset:(unsigned long long)offset;
+
+///Updates the last access time of the entry for a given key, and marks it as the most recently used entry.
+///
+///Access times are always updated in memory, but are only journaled when the
+///previously recorded time is more than an hour old, so reads rarely cause writes.
+- (void)touchEntryForKey:(NSString *)key atTime:(NSTimeInterval)accessTime;
+
+///Removes the entry for a given key.
+- (void)removeEntryForKey:(NSString *)key;
+
+///Removes every entry, keeping the maximum cache size.
+- (void)removeAllEntries;
+
+#pragma mark - Eviction
+
+///Records an access to a key that is about to be stored, and determines what must be evicted to store it.
+///
+/// \param  key             The key of the entry that is about to be stored. Required.
+/// \param  contentHash     The content hash of the entry that is about to be stored. Optional.
+/// \param  dataSize        The size of the entry that is about to be stored.
+/// \param  maxCacheSize    The size the cache must be kept within.
+/// \param  byFrequency     Whether a new entry must be used at least as often as the entries it would
+///                         displace, or only the least recently used entries are considered.
+///
+/// \result Copies of the entries that must be removed to store the new entry, least recently
+///         used first; or nil if the new entry should not be stored. The index is not changed.
+///
+///Content that is already referenced by another entry costs nothing to store.
+- (NSArray *)admitEntryWithKey:(NSString *)key contentHash:(NSString *)contentHash dataSize:(unsigned long long)dataSize maxCacheSize:(unsigned long long)maxCacheSize byFrequency:(BOOL)byFrequency;
+
+///Returns copies of the least recently used entries that must be removed for the index to fit within a given size.
+- (NSArray *)entriesToEvictForMaxCacheSize:(unsigned long long)maxCacheSize;
+
+///Returns copies of the entries without an expiration time that have not been
+///used since a given time, least recently used first.
+- (NSArray *)entriesLastAccessedBefore:(NSTimeInterval)accessTime;
+
+///Returns copies of the entries whose expiration times are before a given time, soonest first.
+///
+///Each expired entry is only returned once, the caller is expected to remove them. An
+///expired entry that is not removed remains subject to least recently used eviction.
+- (NSArray *)entriesExpiringBefore:(NSTimeInterval)time;
+
+#pragma mark - Persistence
+
+///Loads every entry from the mapped snapshot, if they have not already been loaded.
+///
+///This may be called concurrently with the other methods that do not change the
+///index, so that loading can happen in the background after an index is opened.
+- (void)loadEntriesIfNeeded;
+
+///Writes a snapshot of the receiver's entries and truncates its journal.
+- (BOOL)compact:(NSError **)outError;
+
+///Defers writing the journal records of changes until the matching `-endBatch`, so that
+///a series of changes is persisted with a single write. Batches may be nested.
+- (void)beginBatch;
+
+///Writes the journal records of every change made since the outermost `-beginBatch`.
+- (void)endBatch;
+
+#pragma mark - Sharing
+
+///Returns whether or not another process has changed the index since the receiver last
+///caught up with it. Always NO for an index that is not shared.
+///
+///This may be called concurrently with the other methods that do not change the index.
+- (BOOL)hasChangesFromOtherProcesses;
+
+///Locks the receiver's directory against other processes, and applies the changes they have
+///made since the receiver last caught up with them. Does nothing for an index that is not shared.
+///
+/// \param  exclusive   Whether the lock should exclude every other process, as required to make
+///                     changes, or only processes making changes, as is sufficient to catch up.
+///
+///Locks are not reentrant, every call must be balanced by a call to `-unlock`.
+- (void)lockExclusively:(BOOL)exclusive;
+
+///Unlocks the receiver's directory. Does nothing for an index that is not shared.
+- (void)unlock;
+
+@end
+
+#endif /* RKFileSystemCacheIndex_h */
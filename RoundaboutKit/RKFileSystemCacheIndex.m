@@ -0,0 +1,1805 @@
+//
+//  RKFileSystemCacheIndex.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKFileSystemCacheIndex.h"
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import <sys/file.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+static NSString *const kSnapshotFileName = @"__Index.snapshot";
+static NSString *const kJournalFileName = @"__Index.journal";
+static NSString *const kLegacyMetadataFileName = @"__Metadata.plist";
+static NSString *const kLockFileName = @"__Index.lock";
+
+static NSString *const kSnapshotVersionKey = @"version";
+static NSString *const kSnapshotMaxCacheSizeKey = @"maxCacheSize";
+static NSString *const kSnapshotEntriesKey = @"entries";
+static NSString *const kSnapshotLegacyKeysKey = @"legacyKeys";
+static NSString *const kSnapshotExpirationTimesKey = @"expirationTimes";
+
+///Version 2 snapshots distinguish entries with keys derived by the current scheme from legacy entries.
+static NSInteger const kLegacyKeySnapshotVersion = 2;
+
+///Version 3 snapshots are memory-mapped hash tables rather than property lists.
+static NSInteger const kMappedSnapshotVersion = 3;
+
+///The version of the snapshots written by the index.
+static NSInteger const kSnapshotVersion = kMappedSnapshotVersion;
+
+static NSString *const kLegacyMaxCacheSizeKey = @"__maxCacheSize";
+static NSString *const kLegacyRevisionKey = @"revision";
+static NSString *const kLegacyLastAccessedDateKey = @"lastAccessDate";
+static NSString *const kLegacyDataSizeKey = @"dataSize";
+
+///The smallest number of journal records that will trigger a compaction.
+static NSUInteger const kMinimumCompactionRecordCount = 512;
+
+///How old a journaled access time must be before a new one is journaled.
+static NSTimeInterval const kTouchJournalInterval = RK_TIME_HOUR;
+
+///The number of stale items the expiration heap may accumulate before it is rebuilt.
+static NSUInteger const kMinimumExpirationHeapRebuildCount = 64;
+
+///The number of counters in each row of the frequency sketch. Must be a power of two.
+static NSUInteger const kFrequencySketchWidth = (1 << 14);
+
+///The number of rows in the frequency sketch.
+static NSUInteger const kFrequencySketchDepth = 4;
+
+///The number of accesses recorded by the frequency sketch before its counters are halved.
+static NSUInteger const kFrequencySketchSampleSize = (kFrequencySketchWidth * 8);
+
+///The number of bits of the key filter per key it is sized for, giving a false positive rate of about 1%.
+static NSUInteger const kKeyFilterBitsPerKey = 10;
+
+///The number of bits of the key filter set for each key.
+static NSUInteger const kKeyFilterHashCount = 7;
+
+///The smallest number of keys the key filter is sized for.
+static NSUInteger const kMinimumKeyFilterCapacity = 1024;
+
+#pragma mark - Journal Records
+
+///The types of records that may appear in a journal.
+typedef NS_ENUM(uint8_t, RKFileSystemCacheJournalRecordType) {
+    ///The payload is the access time (double), the data size (uint64_t), and the revision (UTF8).
+    kRKFileSystemCacheJournalRecordTypePut = 1,
+    
+    ///The payload is the access time (double).
+    kRKFileSystemCacheJournalRecordTypeTouch = 2,
+    
+    ///There is no payload.
+    kRKFileSystemCacheJournalRecordTypeRemove = 3,
+    
+    ///The key is empty, the payload is the maximum cache size (uint64_t).
+    kRKFileSystemCacheJournalRecordTypeSetMaxCacheSize = 4,
+    
+    ///The payload is the access time (double), the data size (uint64_t), the
+    ///segment offset (uint64_t), the segment (uint32_t), and the revision (UTF8).
+    kRKFileSystemCacheJournalRecordTypePutPacked = 5,
+    
+    ///The payload is the access time (double), the data size (uint64_t), the segment
+    ///offset (uint64_t), the segment (uint32_t), the content hash (32 ASCII characters),
+    ///and the revision (UTF8). The segment and offset are zero for standalone content.
+    kRKFileSystemCacheJournalRecordTypePutContent = 6,
+    
+    ///The payload is the expiration time (double). Follows the put record of every entry with an expiration time.
+    kRKFileSystemCacheJournalRecordTypeSetExpiration = 7,
+    
+    ///There is no payload. Follows the put record of every entry whose data is compressed.
+    kRKFileSystemCacheJournalRecordTypeSetCompressed = 8,
+};
+
+///The length of the content hashes of entries.
+static NSUInteger const kContentHashLength = 32;
+
+///The header that precedes every journal record.
+typedef struct RKFileSystemCacheJournalRecordHeader {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t keyLength;
+    uint32_t payloadLength;
+} RKFileSystemCacheJournalRecordHeader;
+
+#pragma mark - Mapped Snapshots
+
+///The number at the start of every mapped snapshot, distinguishing them from property list snapshots.
+static uint32_t const kMappedSnapshotMagic = 0x49434B52;
+
+///The smallest number of slots in a mapped snapshot. Must be a power of two.
+static uint64_t const kMinimumMappedSnapshotSlotCount = 16;
+
+///The string offset of a slot that does not have the corresponding string.
+static uint32_t const kMappedSnapshotNoString = UINT32_MAX;
+
+///The flags of a slot in a mapped snapshot.
+typedef NS_OPTIONS(uint8_t, RKFileSystemCacheSnapshotSlotFlags) {
+    ///The slot contains an entry.
+    kRKFileSystemCacheSnapshotSlotFlagOccupied = (1 << 0),
+    
+    ///The entry was stored before the current key scheme was adopted.
+    kRKFileSystemCacheSnapshotSlotFlagLegacy = (1 << 1),
+    
+    ///The entry's data is compressed.
+    kRKFileSystemCacheSnapshotSlotFlagCompressed = (1 << 2),
+};
+
+///The header at the start of a mapped snapshot. It is followed by `slotCount` slots,
+///and then by `stringsLength` bytes of the strings the slots reference.
+typedef struct RKFileSystemCacheSnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t legacyEntryCount;
+    uint64_t slotCount;
+    uint64_t maxCacheSize;
+    uint64_t stringsLength;
+} RKFileSystemCacheSnapshotHeader;
+
+///A slot of the open addressing hash table of a mapped snapshot. Entries are placed
+///by the hash of their keys, and collisions are resolved by linear probing.
+typedef struct RKFileSystemCacheSnapshotSlot {
+    uint64_t keyHash;
+    double lastAccessTime;
+    double expirationTime;
+    uint64_t dataSize;
+    uint64_t offset;
+    uint32_t segment;
+    uint32_t keyOffset;
+    uint32_t revisionOffset;
+    uint32_t revisionLength;
+    uint32_t contentHashOffset;
+    uint16_t keyLength;
+    uint8_t flags;
+    uint8_t reserved;
+} RKFileSystemCacheSnapshotSlot;
+
+///Returns the hash used to place a key in a mapped snapshot (64-bit FNV-1a.)
+///
+///Unlike `-[NSString hash]`, this is guaranteed to be stable across launches and releases.
+RK_INLINE uint64_t RKMappedSnapshotKeyHash(const uint8_t *bytes, NSUInteger length)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (NSUInteger index = 0; index < length; index++) {
+        hash ^= bytes[index];
+        hash *= 0x100000001B3ULL;
+    }
+    
+    return hash;
+}
+
+///Returns the hash used to place a key in a mapped snapshot.
+RK_INLINE uint64_t RKMappedSnapshotKeyHashForKey(NSString *key)
+{
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    return RKMappedSnapshotKeyHash(keyData.bytes, keyData.length);
+}
+
+///Returns whether or not a string referenced by a slot lies within the strings of a mapped snapshot.
+RK_INLINE BOOL RKMappedSnapshotStringIsValid(uint32_t offset, uint64_t length, uint64_t stringsLength)
+{
+    return (offset != kMappedSnapshotNoString && (uint64_t)offset + length <= stringsLength);
+}
+
+#pragma mark -
+
+///The RKFileSystemCacheFrequencySketch class estimates how often keys have been accessed
+///recently using a count-min sketch whose counters are halved periodically, so that keys
+///which were popular a long time ago gradually lose their standing.
+@interface RKFileSystemCacheFrequencySketch : NSObject {
+    uint8_t _counters[kFrequencySketchDepth][kFrequencySketchWidth];
+    NSUInteger _numberOfSamples;
+}
+
+///Records an access to a given key.
+- (void)recordAccessForKey:(NSString *)key;
+
+///Returns the estimated number of recent accesses to a given key.
+- (NSUInteger)frequencyForKey:(NSString *)key;
+
+@end
+
+@implementation RKFileSystemCacheFrequencySketch
+
+///Returns the index of the counter for a given key hash in a given row.
+RK_INLINE NSUInteger RKFrequencySketchCounterIndex(uint64_t hash, NSUInteger row)
+{
+    uint64_t mixed = hash + (row + 1) * 0x9E3779B97F4A7C15ULL;
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+    mixed = mixed ^ (mixed >> 31);
+    return (NSUInteger)(mixed & (kFrequencySketchWidth - 1));
+}
+
+- (void)recordAccessForKey:(NSString *)key
+{
+    uint64_t hash = [key hash];
+    for (NSUInteger row = 0; row < kFrequencySketchDepth; row++) {
+        uint8_t *counter = &_counters[row][RKFrequencySketchCounterIndex(hash, row)];
+        if(*counter < UINT8_MAX)
+            (*counter)++;
+    }
+    
+    if(++_numberOfSamples >= kFrequencySketchSampleSize) {
+        for (NSUInteger row = 0; row < kFrequencySketchDepth; row++) {
+            for (NSUInteger column = 0; column < kFrequencySketchWidth; column++)
+                _counters[row][column] >>= 1;
+        }
+        
+        _numberOfSamples /= 2;
+    }
+}
+
+- (NSUInteger)frequencyForKey:(NSString *)key
+{
+    uint64_t hash = [key hash];
+    NSUInteger frequency = UINT8_MAX;
+    for (NSUInteger row = 0; row < kFrequencySketchDepth; row++)
+        frequency = MIN(frequency, _counters[row][RKFrequencySketchCounterIndex(hash, row)]);
+    
+    return frequency;
+}
+
+@end
+
+#pragma mark -
+
+///The RKFileSystemCacheKeyFilter class is a Bloom filter over the keys of an index, so that
+///looking up a key without an entry usually costs a few bit tests rather than a probe of the
+///mapped snapshot. Keys cannot be removed, the filter is rebuilt when the index is compacted.
+@interface RKFileSystemCacheKeyFilter : NSObject {
+    uint64_t *_bits;
+    uint64_t _bitCount;
+}
+
+///Initialize the receiver with the number of keys it should be able to hold before its false positive rate rises.
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+///The number of keys the receiver was sized for.
+@property (readonly) NSUInteger capacity;
+
+///The number of keys added to the receiver.
+@property (readonly) NSUInteger count;
+
+///Adds a key, given by its mapped snapshot hash.
+- (void)addKeyHash:(uint64_t)keyHash;
+
+///Returns NO if a key, given by its mapped snapshot hash, was definitely never added.
+- (BOOL)mayContainKeyHash:(uint64_t)keyHash;
+
+@end
+
+@implementation RKFileSystemCacheKeyFilter
+
+- (void)dealloc
+{
+    free(_bits);
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    if((self = [super init])) {
+        _capacity = MAX(capacity, kMinimumKeyFilterCapacity);
+        _bitCount = (uint64_t)_capacity * kKeyFilterBitsPerKey;
+        _bits = calloc((size_t)((_bitCount + 63) / 64), sizeof(uint64_t));
+    }
+    
+    return self;
+}
+
+///Returns the second hash of a key used for double hashing. Always odd.
+RK_INLINE uint64_t RKKeyFilterSecondHash(uint64_t keyHash)
+{
+    uint64_t mixed = (keyHash ^ (keyHash >> 33)) * 0xFF51AFD7ED558CCDULL;
+    mixed = (mixed ^ (mixed >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+    return (mixed ^ (mixed >> 33)) | 1;
+}
+
+- (void)addKeyHash:(uint64_t)keyHash
+{
+    uint64_t secondHash = RKKeyFilterSecondHash(keyHash);
+    for (NSUInteger index = 0; index < kKeyFilterHashCount; index++) {
+        uint64_t bit = (keyHash + index * secondHash) % _bitCount;
+        _bits[bit / 64] |= (1ULL << (bit % 64));
+    }
+    
+    _count++;
+}
+
+- (BOOL)mayContainKeyHash:(uint64_t)keyHash
+{
+    uint64_t secondHash = RKKeyFilterSecondHash(keyHash);
+    for (NSUInteger index = 0; index < kKeyFilterHashCount; index++) {
+        uint64_t bit = (keyHash + index * secondHash) % _bitCount;
+        if(!(_bits[bit / 64] & (1ULL << (bit % 64))))
+            return NO;
+    }
+    
+    return YES;
+}
+
+@end
+
+#pragma mark -
+
+@interface RKFileSystemCacheEntry () {
+@package
+    ///The entry that was used less recently than this entry. Owned by the index.
+    __unsafe_unretained RKFileSystemCacheEntry *_lessRecentlyUsed;
+    
+    ///The entry that was used more recently than this entry. Owned by the index.
+    __unsafe_unretained RKFileSystemCacheEntry *_moreRecentlyUsed;
+}
+
+@end
+
+@implementation RKFileSystemCacheEntry
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    RKFileSystemCacheEntry *copy = [[[self class] allocWithZone:zone] init];
+    copy.key = self.key;
+    copy.revision = self.revision;
+    copy.lastAccessTime = self.lastAccessTime;
+    copy.dataSize = self.dataSize;
+    copy.segment = self.segment;
+    copy.offset = self.offset;
+    copy.contentHash = self.contentHash;
+    copy.expirationTime = self.expirationTime;
+    copy.compressed = self.compressed;
+    return copy;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %@ revision => %@, size => %llu>", NSStringFromClass([self class]), self, self.key, self.revision, self.dataSize];
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKFileSystemCacheIndex {
+    ///The entries of the index.
+    ///
+    ///NSString => RKFileSystemCacheEntry.
+    NSMutableDictionary *_entries;
+    
+    ///The number of records in the journal since the last compaction.
+    NSUInteger _journalRecordCount;
+    
+    ///The descriptor of the journal, opened for appending. -1 if it could not be opened.
+    int _journalDescriptor;
+    
+    ///The number of batches that have begun and not yet ended.
+    NSUInteger _batchDepth;
+    
+    ///The journal records appended during the current batch, written when the outermost batch ends.
+    NSMutableData *_pendingRecords;
+    
+    ///The least recently used entry, the head of the list of entries ordered by recency.
+    __unsafe_unretained RKFileSystemCacheEntry *_leastRecentlyUsed;
+    
+    ///The most recently used entry, the tail of the list of entries ordered by recency.
+    __unsafe_unretained RKFileSystemCacheEntry *_mostRecentlyUsed;
+    
+    ///The estimated access frequencies of keys, used to decide whether new entries are admitted.
+    RKFileSystemCacheFrequencySketch *_frequencySketch;
+    
+    ///The keys of the entries that were stored before the current key scheme was adopted.
+    NSMutableSet *_legacyKeys;
+    
+    ///The keys of the entries that reference each content hash.
+    ///
+    ///NSString => NSMutableSet(NSString).
+    NSMutableDictionary *_contentReferences;
+    
+    ///The expiration times of the binary min-heap of entries with expiration times.
+    ///Items are not removed when their entries are, they are skipped when they surface.
+    ///
+    ///Array of double.
+    NSMutableData *_expirationHeapTimes;
+    
+    ///The keys of the binary min-heap of entries with expiration times, parallel to `_expirationHeapTimes`.
+    NSMutableArray *_expirationHeapKeys;
+    
+    ///The number of entries that have an expiration time.
+    NSUInteger _expiringEntryCount;
+    
+    ///The sum of the sizes of the entries in the index, once they have been loaded.
+    unsigned long long _totalSize;
+    
+    ///The mapped snapshot the entries are read from until they are loaded, or nil if there is none.
+    NSData *_mappedSnapshot;
+    
+    ///The number of entries in the mapped snapshot.
+    NSUInteger _mappedEntryCount;
+    
+    ///The number of legacy entries in the mapped snapshot.
+    NSUInteger _mappedLegacyEntryCount;
+    
+    ///Whether or not changes are being kept in `_overlay` because the entries have not been loaded.
+    ///Only read and written while the receiver is being changed.
+    BOOL _deferringChanges;
+    
+    ///Whether or not every entry has been loaded into `_entries`.
+    volatile BOOL _loaded;
+    
+    ///Serializes loading the entries, which may be triggered by concurrent lookups.
+    pthread_mutex_t _loadLock;
+    
+    ///The entries that were changed since the mapped snapshot was written, until the entries are loaded.
+    ///
+    ///NSString => RKFileSystemCacheEntry, or NSNull if the entry was removed.
+    NSMutableDictionary *_overlay;
+    
+    ///The keys of the legacy entries in the mapped snapshot that were changed since it was written.
+    NSMutableSet *_changedLegacyKeys;
+    
+    ///The descriptor of the file whose lock coordinates the processes sharing the index. -1 if the index is not shared.
+    int _lockDescriptor;
+    
+    ///The number of bytes of the journal that have been applied to the entries.
+    unsigned long long _journalLength;
+    
+    ///The inode of the snapshot the entries were loaded from, or zero if there was none.
+    ino_t _snapshotInode;
+    
+    ///The keys of every entry, and of entries that have since been removed. Rebuilt when the
+    ///entries are reloaded or compacted, and only ever changed while the receiver is being changed.
+    RKFileSystemCacheKeyFilter *_keyFilter;
+}
+
+- (void)dealloc
+{
+    if(_journalDescriptor != -1)
+        close(_journalDescriptor);
+    
+    if(_lockDescriptor != -1)
+        close(_lockDescriptor);
+    
+    pthread_mutex_destroy(&_loadLock);
+}
+
+- (instancetype)initWithDirectory:(NSURL *)directory shared:(BOOL)shared
+{
+    NSParameterAssert(directory);
+    
+    if((self = [super init])) {
+        _directory = directory;
+        _shared = shared;
+        _journalDescriptor = -1;
+        _lockDescriptor = -1;
+        _frequencySketch = [RKFileSystemCacheFrequencySketch new];
+        pthread_mutex_init(&_loadLock, NULL);
+        
+        if(shared) {
+            _lockDescriptor = open([[self lockLocation] fileSystemRepresentation], O_RDWR | O_CREAT, 0644);
+            if(_lockDescriptor == -1)
+                RKLogError(@"Could not open cache index lock at %@. %s", [self lockLocation], strerror(errno));
+            
+            flock(_lockDescriptor, LOCK_EX);
+        }
+        
+        BOOL needsCompaction = [self loadEntries];
+        
+        _journalDescriptor = open([[self journalLocation] fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if(_journalDescriptor == -1)
+            RKLogError(@"Could not open cache journal at %@. %s", [self journalLocation], strerror(errno));
+        
+        if(needsCompaction) {
+            NSError *error = nil;
+            if(![self compact:&error])
+                RKLogError(@"Could not compact cache index. %@", error);
+        }
+        
+        if(shared)
+            flock(_lockDescriptor, LOCK_UN);
+    }
+    
+    return self;
+}
+
+- (instancetype)initWithDirectory:(NSURL *)directory
+{
+    return [self initWithDirectory:directory shared:NO];
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+#pragma mark - Locations
+
+- (NSURL *)snapshotLocation
+{
+    return [self.directory URLByAppendingPathComponent:kSnapshotFileName];
+}
+
+- (NSURL *)journalLocation
+{
+    return [self.directory URLByAppendingPathComponent:kJournalFileName];
+}
+
+- (NSURL *)legacyMetadataLocation
+{
+    return [self.directory URLByAppendingPathComponent:kLegacyMetadataFileName];
+}
+
+- (NSURL *)lockLocation
+{
+    return [self.directory URLByAppendingPathComponent:kLockFileName];
+}
+
++ (NSSet *)fileNames
+{
+    return [NSSet setWithObjects:kSnapshotFileName, kJournalFileName, kLockFileName, nil];
+}
+
+#pragma mark - Loading
+
+///Discards the receiver's entries and loads them from its directory again, returning whether or not a snapshot should be written.
+- (BOOL)loadEntries
+{
+    _entries = [NSMutableDictionary dictionary];
+    _legacyKeys = [NSMutableSet set];
+    _contentReferences = [NSMutableDictionary dictionary];
+    _expirationHeapTimes = [NSMutableData data];
+    _expirationHeapKeys = [NSMutableArray array];
+    _expiringEntryCount = 0;
+    _totalSize = 0;
+    _maxCacheSize = 0;
+    _leastRecentlyUsed = nil;
+    _mostRecentlyUsed = nil;
+    _mappedSnapshot = nil;
+    _overlay = nil;
+    _changedLegacyKeys = nil;
+    _deferringChanges = NO;
+    _loaded = NO;
+    _journalRecordCount = 0;
+    _journalLength = 0;
+    _keyFilter = nil;
+    
+    struct stat snapshotStatus;
+    _snapshotInode = (stat([[self snapshotLocation] fileSystemRepresentation], &snapshotStatus) == 0)? snapshotStatus.st_ino : 0;
+    
+    BOOL needsCompaction = NO;
+    NSInteger snapshotVersion = [self mapSnapshot];
+    if(snapshotVersion == 0) {
+        snapshotVersion = [self loadSnapshot];
+        if(snapshotVersion == 0)
+            needsCompaction = [self migrateLegacyMetadata];
+    }
+    
+    BOOL journalHadRecords = [self replayJournal];
+    
+    //A mapped snapshot is left as is, the journal's changes stay in the overlay until
+    //the entries are loaded or the journal outgrows them, whichever comes first.
+    if(!_deferringChanges) {
+        //Everything that predates a version 2 snapshot was stored under a legacy key. A
+        //current snapshot is written immediately so the distinction is never lost, and
+        //so that subsequent launches no longer have to parse every entry.
+        if(snapshotVersion < kLegacyKeySnapshotVersion)
+            [_legacyKeys addObjectsFromArray:[_entries allKeys]];
+        
+        if(snapshotVersion < kSnapshotVersion || journalHadRecords)
+            needsCompaction = YES;
+        
+        [self sortRecencyList];
+        _loaded = YES;
+    }
+    
+    [self rebuildKeyFilter];
+    
+    return needsCompaction;
+}
+
+///Maps a snapshot in the mapped format, returning its version, or zero if there is no such snapshot.
+///
+///Nothing is parsed beyond the header, entries are read from the snapshot as they are looked up.
+- (NSInteger)mapSnapshot
+{
+    NSData *snapshot = [NSData dataWithContentsOfURL:[self snapshotLocation] options:NSDataReadingMappedAlways error:NULL];
+    if(snapshot.length < sizeof(RKFileSystemCacheSnapshotHeader))
+        return 0;
+    
+    RKFileSystemCacheSnapshotHeader header;
+    memcpy(&header, snapshot.bytes, sizeof(header));
+    if(header.magic != kMappedSnapshotMagic || header.version != kMappedSnapshotVersion)
+        return 0;
+    
+    uint64_t maximumSlotCount = (snapshot.length - sizeof(header)) / sizeof(RKFileSystemCacheSnapshotSlot);
+    BOOL isSlotCountValid = (header.slotCount > 0 && (header.slotCount & (header.slotCount - 1)) == 0 && header.slotCount <= maximumSlotCount);
+    if(!isSlotCountValid || header.entryCount > header.slotCount ||
+       sizeof(header) + header.slotCount * sizeof(RKFileSystemCacheSnapshotSlot) + header.stringsLength != snapshot.length) {
+        RKLogWarning(@"Discarding malformed cache index snapshot.");
+        return 0;
+    }
+    
+    _mappedSnapshot = snapshot;
+    _mappedEntryCount = (NSUInteger)header.entryCount;
+    _mappedLegacyEntryCount = (NSUInteger)header.legacyEntryCount;
+    _maxCacheSize = header.maxCacheSize;
+    _overlay = [NSMutableDictionary dictionary];
+    _changedLegacyKeys = [NSMutableSet set];
+    _deferringChanges = YES;
+    
+    return header.version;
+}
+
+///Returns the slot of the mapped snapshot that contains the entry for a given key, or NULL if there is none.
+- (const RKFileSystemCacheSnapshotSlot *)mappedSlotForKey:(NSString *)key
+{
+    const RKFileSystemCacheSnapshotHeader *header = _mappedSnapshot.bytes;
+    const RKFileSystemCacheSnapshotSlot *slots = (const RKFileSystemCacheSnapshotSlot *)(header + 1);
+    const uint8_t *strings = (const uint8_t *)(slots + header->slotCount);
+    
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    uint64_t hash = RKMappedSnapshotKeyHash(keyData.bytes, keyData.length);
+    uint64_t mask = header->slotCount - 1;
+    for (uint64_t probe = 0; probe < header->slotCount; probe++) {
+        const RKFileSystemCacheSnapshotSlot *slot = &slots[(hash + probe) & mask];
+        if(!(slot->flags & kRKFileSystemCacheSnapshotSlotFlagOccupied))
+            return NULL;
+        
+        if(slot->keyHash == hash && slot->keyLength == keyData.length &&
+           RKMappedSnapshotStringIsValid(slot->keyOffset, slot->keyLength, header->stringsLength) &&
+           memcmp(strings + slot->keyOffset, keyData.bytes, keyData.length) == 0)
+            return slot;
+    }
+    
+    return NULL;
+}
+
+///Returns a new entry with the contents of a slot of the mapped snapshot, or nil if the slot is malformed.
+- (RKFileSystemCacheEntry *)entryForMappedSlot:(const RKFileSystemCacheSnapshotSlot *)slot
+{
+    const RKFileSystemCacheSnapshotHeader *header = _mappedSnapshot.bytes;
+    const uint8_t *strings = (const uint8_t *)((const RKFileSystemCacheSnapshotSlot *)(header + 1) + header->slotCount);
+    if(!RKMappedSnapshotStringIsValid(slot->keyOffset, slot->keyLength, header->stringsLength) ||
+       !RKMappedSnapshotStringIsValid(slot->revisionOffset, slot->revisionLength, header->stringsLength))
+        return nil;
+    
+    RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+    entry.key = [[NSString alloc] initWithBytes:strings + slot->keyOffset length:slot->keyLength encoding:NSUTF8StringEncoding];
+    entry.revision = [[NSString alloc] initWithBytes:strings + slot->revisionOffset length:slot->revisionLength encoding:NSUTF8StringEncoding];
+    entry.lastAccessTime = slot->lastAccessTime;
+    entry.expirationTime = slot->expirationTime;
+    entry.dataSize = slot->dataSize;
+    entry.segment = slot->segment;
+    entry.offset = slot->offset;
+    entry.compressed = ((slot->flags & kRKFileSystemCacheSnapshotSlotFlagCompressed) != 0);
+    if(RKMappedSnapshotStringIsValid(slot->contentHashOffset, kContentHashLength, header->stringsLength))
+        entry.contentHash = [[NSString alloc] initWithBytes:strings + slot->contentHashOffset length:kContentHashLength encoding:NSASCIIStringEncoding];
+    
+    if(!entry.key || !entry.revision)
+        return nil;
+    
+    return entry;
+}
+
+- (void)loadEntriesIfNeeded
+{
+    if(_loaded) {
+        OSMemoryBarrier();
+        return;
+    }
+    
+    pthread_mutex_lock(&_loadLock);
+    if(!_loaded) {
+        _deferringChanges = NO;
+        
+        //The overlay and mapped snapshot are left untouched, lookups
+        //running concurrently with loading continue to read them.
+        const RKFileSystemCacheSnapshotHeader *header = _mappedSnapshot.bytes;
+        const RKFileSystemCacheSnapshotSlot *slots = (const RKFileSystemCacheSnapshotSlot *)(header + 1);
+        for (uint64_t index = 0; index < header->slotCount; index++) {
+            const RKFileSystemCacheSnapshotSlot *slot = &slots[index];
+            if(!(slot->flags & kRKFileSystemCacheSnapshotSlotFlagOccupied))
+                continue;
+            
+            RKFileSystemCacheEntry *entry = [self entryForMappedSlot:slot];
+            if(!entry)
+                continue;
+            
+            id changedEntry = _overlay[entry.key];
+            if(changedEntry == [NSNull null])
+                continue;
+            
+            [self insertEntry:changedEntry ?: entry];
+            
+            if((slot->flags & kRKFileSystemCacheSnapshotSlotFlagLegacy) && ![_changedLegacyKeys containsObject:entry.key])
+                [_legacyKeys addObject:entry.key];
+        }
+        
+        [_overlay enumerateKeysAndObjectsUsingBlock:^(NSString *key, id entry, BOOL *stop) {
+            if(entry != [NSNull null] && !_entries[key])
+                [self insertEntry:entry];
+        }];
+        
+        [self sortRecencyList];
+        
+        OSMemoryBarrier();
+        _loaded = YES;
+    }
+    pthread_mutex_unlock(&_loadLock);
+}
+
+///Loads the entries in a property list snapshot, returning the version of the snapshot, or zero if no snapshot was found.
+- (NSInteger)loadSnapshot
+{
+    NSData *snapshotData = [NSData dataWithContentsOfURL:[self snapshotLocation] options:0 error:NULL];
+    if(!snapshotData)
+        return 0;
+    
+    NSError *error = nil;
+    NSDictionary *snapshot = [NSPropertyListSerialization propertyListWithData:snapshotData options:NSPropertyListImmutable format:NULL error:&error];
+    NSInteger version = [snapshot isKindOfClass:[NSDictionary class]]? [snapshot[kSnapshotVersionKey] integerValue] : 0;
+    if(version < 1 || version >= kMappedSnapshotVersion) {
+        RKLogWarning(@"Discarding unreadable cache index snapshot. %@", error);
+        return 0;
+    }
+    
+    _maxCacheSize = [snapshot[kSnapshotMaxCacheSizeKey] unsignedLongLongValue];
+    
+    [snapshot[kSnapshotEntriesKey] enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray *fields, BOOL *stop) {
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = key;
+        entry.revision = fields[0];
+        entry.lastAccessTime = [fields[1] doubleValue];
+        entry.dataSize = [fields[2] unsignedLongLongValue];
+        if(fields.count >= 5) {
+            entry.segment = (uint32_t)[fields[3] unsignedIntValue];
+            entry.offset = [fields[4] unsignedLongLongValue];
+        }
+        if(fields.count >= 6)
+            entry.contentHash = fields[5];
+        [self insertEntry:entry];
+    }];
+    
+    [snapshot[kSnapshotExpirationTimesKey] enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSNumber *expirationTime, BOOL *stop) {
+        [self setExpirationTime:[expirationTime doubleValue] ofEntry:_entries[key]];
+    }];
+    
+    for (NSString *legacyKey in snapshot[kSnapshotLegacyKeysKey]) {
+        if(_entries[legacyKey])
+            [_legacyKeys addObject:legacyKey];
+    }
+    
+    return version;
+}
+
+///Imports the contents of a legacy metadata plist, returning whether or not one was found.
+- (BOOL)migrateLegacyMetadata
+{
+    NSDictionary *legacyMetadata = [NSDictionary dictionaryWithContentsOfURL:[self legacyMetadataLocation]];
+    if(!legacyMetadata)
+        return NO;
+    
+    _maxCacheSize = [legacyMetadata[kLegacyMaxCacheSizeKey] unsignedLongLongValue];
+    
+    [legacyMetadata enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSDictionary *itemMetadata, BOOL *stop) {
+        if([key hasPrefix:@"__"] || ![itemMetadata isKindOfClass:[NSDictionary class]])
+            return;
+        
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = key;
+        entry.revision = itemMetadata[kLegacyRevisionKey];
+        entry.lastAccessTime = [itemMetadata[kLegacyLastAccessedDateKey] timeIntervalSinceReferenceDate];
+        entry.dataSize = [itemMetadata[kLegacyDataSizeKey] unsignedLongLongValue];
+        if(entry.revision)
+            [self insertEntry:entry];
+    }];
+    
+    return YES;
+}
+
+///Applies the records in the journal that have not already been applied to the receiver's
+///entries, returning whether or not any were found.
+///
+///A record cut short by a crash ends the journal, the incomplete bytes are discarded.
+- (BOOL)replayJournal
+{
+    NSData *journal = [NSData dataWithContentsOfURL:[self journalLocation] options:NSDataReadingMappedIfSafe error:NULL];
+    if(journal.length <= _journalLength)
+        return NO;
+    
+    const uint8_t *bytes = journal.bytes;
+    NSUInteger length = journal.length;
+    NSUInteger offset = (NSUInteger)_journalLength;
+    while (offset + sizeof(RKFileSystemCacheJournalRecordHeader) <= length) {
+        RKFileSystemCacheJournalRecordHeader header;
+        memcpy(&header, bytes + offset, sizeof(header));
+        
+        NSUInteger recordLength = sizeof(header) + header.keyLength + header.payloadLength;
+        if(offset + recordLength > length)
+            break;
+        
+        const uint8_t *keyBytes = bytes + offset + sizeof(header);
+        const uint8_t *payload = keyBytes + header.keyLength;
+        NSString *key = [[NSString alloc] initWithBytes:keyBytes length:header.keyLength encoding:NSUTF8StringEncoding];
+        [self applyRecordOfType:header.type key:key payload:payload length:header.payloadLength];
+        
+        offset += recordLength;
+    }
+    
+    if(offset < length) {
+        RKLogWarning(@"Discarding %lu bytes of incomplete cache journal records.", (unsigned long)(length - offset));
+        truncate([[self journalLocation] fileSystemRepresentation], (off_t)offset);
+    }
+    
+    _journalLength = offset;
+    
+    return YES;
+}
+
+///Applies a single journal record to the receiver's entries.
+- (void)applyRecordOfType:(RKFileSystemCacheJournalRecordType)type key:(NSString *)key payload:(const uint8_t *)payload length:(NSUInteger)payloadLength
+{
+    switch (type) {
+        case kRKFileSystemCacheJournalRecordTypePut:
+        case kRKFileSystemCacheJournalRecordTypePutPacked:
+        case kRKFileSystemCacheJournalRecordTypePutContent: {
+            BOOL hasContentHash = (type == kRKFileSystemCacheJournalRecordTypePutContent);
+            BOOL isPacked = (type == kRKFileSystemCacheJournalRecordTypePutPacked || hasContentHash);
+            NSUInteger contentHashOffset = sizeof(double) + sizeof(uint64_t) + (isPacked? sizeof(uint64_t) + sizeof(uint32_t) : 0);
+            NSUInteger revisionOffset = contentHashOffset + (hasContentHash? kContentHashLength : 0);
+            if(payloadLength < revisionOffset)
+                break;
+            
+            double accessTime = 0.0;
+            uint64_t dataSize = 0;
+            memcpy(&accessTime, payload, sizeof(accessTime));
+            memcpy(&dataSize, payload + sizeof(accessTime), sizeof(dataSize));
+            
+            RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+            entry.key = key;
+            entry.revision = [[NSString alloc] initWithBytes:payload + revisionOffset length:payloadLength - revisionOffset encoding:NSUTF8StringEncoding];
+            entry.lastAccessTime = accessTime;
+            entry.dataSize = dataSize;
+            
+            if(isPacked) {
+                uint64_t segmentOffset = 0;
+                uint32_t segment = 0;
+                memcpy(&segmentOffset, payload + sizeof(accessTime) + sizeof(dataSize), sizeof(segmentOffset));
+                memcpy(&segment, payload + sizeof(accessTime) + sizeof(dataSize) + sizeof(segmentOffset), sizeof(segment));
+                entry.offset = segmentOffset;
+                entry.segment = segment;
+            }
+            
+            if(hasContentHash)
+                entry.contentHash = [[NSString alloc] initWithBytes:payload + contentHashOffset length:kContentHashLength encoding:NSASCIIStringEncoding];
+            
+            [self insertEntry:entry];
+            [self addKeyToFilter:key];
+            
+            break;
+        }
+        
+        case kRKFileSystemCacheJournalRecordTypeTouch: {
+            if(payloadLength < sizeof(double))
+                break;
+            
+            double accessTime = 0.0;
+            memcpy(&accessTime, payload, sizeof(accessTime));
+            
+            RKFileSystemCacheEntry *entry = [self mutableEntryForKey:key];
+            if(entry) {
+                entry.lastAccessTime = accessTime;
+                [self markEntryMostRecentlyUsed:entry];
+            }
+            
+            break;
+        }
+        
+        case kRKFileSystemCacheJournalRecordTypeRemove: {
+            [self deleteEntryForKey:key];
+            break;
+        }
+        
+        case kRKFileSystemCacheJournalRecordTypeSetExpiration: {
+            if(payloadLength < sizeof(double))
+                break;
+            
+            double expirationTime = 0.0;
+            memcpy(&expirationTime, payload, sizeof(expirationTime));
+            [self setExpirationTime:expirationTime ofEntry:[self mutableEntryForKey:key]];
+            
+            break;
+        }
+        
+        case kRKFileSystemCacheJournalRecordTypeSetCompressed: {
+            [self mutableEntryForKey:key].compressed = YES;
+            break;
+        }
+        
+        case kRKFileSystemCacheJournalRecordTypeSetMaxCacheSize: {
+            if(payloadLength < sizeof(uint64_t))
+                break;
+            
+            uint64_t maxCacheSize = 0;
+            memcpy(&maxCacheSize, payload, sizeof(maxCacheSize));
+            _maxCacheSize = maxCacheSize;
+            
+            break;
+        }
+    }
+    
+    _journalRecordCount++;
+}
+
+#pragma mark - Journaling
+
+///Appends a record to the journal, compacting the journal if it has outgrown the index.
+- (void)appendRecordOfType:(RKFileSystemCacheJournalRecordType)type key:(NSString *)key payload:(NSData *)payload
+{
+    NSData *keyData = [key ?: @"" dataUsingEncoding:NSUTF8StringEncoding];
+    
+    RKFileSystemCacheJournalRecordHeader header = {
+        .type = type,
+        .reserved = 0,
+        .keyLength = (uint16_t)keyData.length,
+        .payloadLength = (uint32_t)payload.length,
+    };
+    
+    NSMutableData *record = [NSMutableData dataWithCapacity:sizeof(header) + keyData.length + payload.length];
+    [record appendBytes:&header length:sizeof(header)];
+    [record appendData:keyData];
+    [record appendData:payload];
+    
+    _journalRecordCount++;
+    
+    if(_batchDepth > 0) {
+        [_pendingRecords appendData:record];
+    } else {
+        [self writeRecords:record];
+    }
+}
+
+///Writes journal records, compacting the journal if it has outgrown the index.
+- (void)writeRecords:(NSData *)records
+{
+    //Records are written in a single call so a crash leaves at most one incomplete record behind.
+    if(_journalDescriptor == -1 || write(_journalDescriptor, records.bytes, records.length) != (ssize_t)records.length)
+        RKLogError(@"Could not append to cache journal. %s", strerror(errno));
+    
+    struct stat journalStatus;
+    if(_journalDescriptor != -1 && fstat(_journalDescriptor, &journalStatus) == 0)
+        _journalLength = journalStatus.st_size;
+    
+    NSUInteger entryCount = _deferringChanges? _mappedEntryCount : _entries.count;
+    if(_journalRecordCount > MAX(kMinimumCompactionRecordCount, entryCount)) {
+        NSError *error = nil;
+        if(![self compact:&error])
+            RKLogError(@"Could not compact cache index. %@", error);
+    }
+}
+
+- (void)beginBatch
+{
+    if(_batchDepth == 0)
+        _pendingRecords = [NSMutableData data];
+    
+    _batchDepth++;
+}
+
+- (void)endBatch
+{
+    NSAssert(_batchDepth > 0, @"-[RKFileSystemCacheIndex endBatch] called without a matching -beginBatch");
+    
+    _batchDepth--;
+    if(_batchDepth > 0)
+        return;
+    
+    NSData *records = _pendingRecords;
+    _pendingRecords = nil;
+    if(records.length > 0)
+        [self writeRecords:records];
+}
+
+///Returns the receiver's entries in the mapped snapshot format.
+- (NSData *)mappedSnapshotData
+{
+    uint64_t slotCount = kMinimumMappedSnapshotSlotCount;
+    while (slotCount < (uint64_t)_entries.count * 2)
+        slotCount <<= 1;
+    
+    NSMutableData *slotData = [NSMutableData dataWithLength:slotCount * sizeof(RKFileSystemCacheSnapshotSlot)];
+    RKFileSystemCacheSnapshotSlot *slots = slotData.mutableBytes;
+    NSMutableData *strings = [NSMutableData data];
+    uint64_t mask = slotCount - 1;
+    for (RKFileSystemCacheEntry *entry in [_entries objectEnumerator]) {
+        NSData *keyData = [entry.key dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *revisionData = [entry.revision dataUsingEncoding:NSUTF8StringEncoding];
+        
+        uint64_t hash = RKMappedSnapshotKeyHash(keyData.bytes, keyData.length);
+        uint64_t index = hash & mask;
+        while (slots[index].flags & kRKFileSystemCacheSnapshotSlotFlagOccupied)
+            index = (index + 1) & mask;
+        
+        RKFileSystemCacheSnapshotSlot *slot = &slots[index];
+        slot->keyHash = hash;
+        slot->lastAccessTime = entry.lastAccessTime;
+        slot->expirationTime = entry.expirationTime;
+        slot->dataSize = entry.dataSize;
+        slot->offset = entry.offset;
+        slot->segment = entry.segment;
+        slot->flags = kRKFileSystemCacheSnapshotSlotFlagOccupied;
+        if([_legacyKeys containsObject:entry.key])
+            slot->flags |= kRKFileSystemCacheSnapshotSlotFlagLegacy;
+        
+        if(entry.compressed)
+            slot->flags |= kRKFileSystemCacheSnapshotSlotFlagCompressed;
+        
+        slot->keyOffset = (uint32_t)strings.length;
+        slot->keyLength = (uint16_t)keyData.length;
+        [strings appendData:keyData];
+        
+        slot->revisionOffset = (uint32_t)strings.length;
+        slot->revisionLength = (uint32_t)revisionData.length;
+        [strings appendData:revisionData];
+        
+        if(entry.contentHash) {
+            slot->contentHashOffset = (uint32_t)strings.length;
+            [strings appendData:[entry.contentHash dataUsingEncoding:NSASCIIStringEncoding]];
+        } else {
+            slot->contentHashOffset = kMappedSnapshotNoString;
+        }
+    }
+    
+    RKFileSystemCacheSnapshotHeader header = {
+        .magic = kMappedSnapshotMagic,
+        .version = kMappedSnapshotVersion,
+        .entryCount = _entries.count,
+        .legacyEntryCount = _legacyKeys.count,
+        .slotCount = slotCount,
+        .maxCacheSize = _maxCacheSize,
+        .stringsLength = strings.length,
+    };
+    
+    NSMutableData *snapshotData = [NSMutableData dataWithCapacity:sizeof(header) + slotData.length + strings.length];
+    [snapshotData appendBytes:&header length:sizeof(header)];
+    [snapshotData appendData:slotData];
+    [snapshotData appendData:strings];
+    
+    return snapshotData;
+}
+
+- (BOOL)compact:(NSError **)outError
+{
+    [self loadEntriesIfNeeded];
+    
+    NSData *snapshotData = [self mappedSnapshotData];
+    if(![snapshotData writeToURL:[self snapshotLocation] options:NSDataWritingAtomic error:outError])
+        return NO;
+    
+    //The snapshot is in place before the journal is truncated, so a crash in
+    //between only leaves behind records the snapshot already reflects.
+    if(_journalDescriptor != -1)
+        ftruncate(_journalDescriptor, 0);
+    
+    struct stat snapshotStatus;
+    _snapshotInode = (stat([[self snapshotLocation] fileSystemRepresentation], &snapshotStatus) == 0)? snapshotStatus.st_ino : 0;
+    _journalLength = 0;
+    _journalRecordCount = 0;
+    [_pendingRecords setLength:0];
+    
+    [[NSFileManager defaultManager] removeItemAtURL:[self legacyMetadataLocation] error:NULL];
+    
+    //Compaction only happens while the receiver is being changed, so no lookup can still be reading these.
+    _mappedSnapshot = nil;
+    _overlay = nil;
+    _changedLegacyKeys = nil;
+    
+    //The keys of removed entries are only dropped from the filter when it is rebuilt.
+    [self rebuildKeyFilter];
+    
+    return YES;
+}
+
+#pragma mark - Sharing
+
+- (BOOL)hasChangesFromOtherProcesses
+{
+    if(!_shared)
+        return NO;
+    
+    struct stat status;
+    if(fstat(_journalDescriptor, &status) == 0 && (unsigned long long)status.st_size != _journalLength)
+        return YES;
+    
+    ino_t snapshotInode = (stat([[self snapshotLocation] fileSystemRepresentation], &status) == 0)? status.st_ino : 0;
+    return (snapshotInode != _snapshotInode);
+}
+
+- (void)lockExclusively:(BOOL)exclusive
+{
+    if(!_shared)
+        return;
+    
+    if(flock(_lockDescriptor, exclusive? LOCK_EX : LOCK_SH) != 0)
+        RKLogError(@"Could not lock cache index. %s", strerror(errno));
+    
+    //Another process compacting the journal replaces the snapshot and then truncates the
+    //journal, either of which means the records applied so far can no longer be found.
+    struct stat status;
+    ino_t snapshotInode = (stat([[self snapshotLocation] fileSystemRepresentation], &status) == 0)? status.st_ino : 0;
+    BOOL isJournalTruncated = (fstat(_journalDescriptor, &status) == 0 && (unsigned long long)status.st_size < _journalLength);
+    if(snapshotInode != _snapshotInode || isJournalTruncated)
+        [self loadEntries];
+    else
+        [self replayJournal];
+}
+
+- (void)unlock
+{
+    if(!_shared)
+        return;
+    
+    flock(_lockDescriptor, LOCK_UN);
+}
+
+#pragma mark - Internal
+
+///Adds an entry to the receiver's entries as the most recently used entry without journaling it.
+- (void)insertEntry:(RKFileSystemCacheEntry *)entry
+{
+    if(_deferringChanges) {
+        [self noteChangeToMappedEntryForKey:entry.key];
+        _overlay[entry.key] = entry;
+        return;
+    }
+    
+    [self deleteEntryForKey:entry.key];
+    
+    _entries[entry.key] = entry;
+    [self linkMostRecentlyUsedEntry:entry];
+    
+    if(entry.expirationTime != 0.0) {
+        _expiringEntryCount++;
+        [self pushExpirationTime:entry.expirationTime forKey:entry.key];
+    }
+    
+    //Content shared by several entries only counts towards the total size once.
+    if(entry.contentHash) {
+        NSMutableSet *references = _contentReferences[entry.contentHash];
+        if(!references) {
+            references = [NSMutableSet set];
+            _contentReferences[entry.contentHash] = references;
+            _totalSize += entry.dataSize;
+        }
+        
+        [references addObject:entry.key];
+    } else {
+        _totalSize += entry.dataSize;
+    }
+}
+
+///Removes an entry from the receiver's entries without journaling it.
+- (void)deleteEntryForKey:(NSString *)key
+{
+    if(_deferringChanges) {
+        [self noteChangeToMappedEntryForKey:key];
+        _overlay[key] = [NSNull null];
+        return;
+    }
+    
+    RKFileSystemCacheEntry *existingEntry = _entries[key];
+    if(existingEntry) {
+        if(existingEntry.contentHash) {
+            NSMutableSet *references = _contentReferences[existingEntry.contentHash];
+            [references removeObject:key];
+            if(references.count == 0) {
+                [_contentReferences removeObjectForKey:existingEntry.contentHash];
+                _totalSize -= existingEntry.dataSize;
+            }
+        } else {
+            _totalSize -= existingEntry.dataSize;
+        }
+        
+        if(existingEntry.expirationTime != 0.0)
+            _expiringEntryCount--;
+        
+        [self unlinkEntry:existingEntry];
+        [_entries removeObjectForKey:key];
+        [_legacyKeys removeObject:key];
+    }
+}
+
+///Records that the entry for a given key has been changed since the mapped snapshot was written.
+- (void)noteChangeToMappedEntryForKey:(NSString *)key
+{
+    const RKFileSystemCacheSnapshotSlot *slot = [self mappedSlotForKey:key];
+    if(slot && (slot->flags & kRKFileSystemCacheSnapshotSlotFlagLegacy))
+        [_changedLegacyKeys addObject:key];
+}
+
+///Returns the entry for a given key that changes should be made to, or nil if there is none.
+///
+///Until the entries are loaded, entries read from the mapped snapshot are added to the
+///overlay so that the changes made to them are kept. This does not change their legacy status.
+- (RKFileSystemCacheEntry *)mutableEntryForKey:(NSString *)key
+{
+    if(!_deferringChanges)
+        return _entries[key];
+    
+    id entry = _overlay[key];
+    if(!entry) {
+        const RKFileSystemCacheSnapshotSlot *slot = [self mappedSlotForKey:key];
+        entry = slot? [self entryForMappedSlot:slot] : nil;
+        if(entry)
+            _overlay[key] = entry;
+    }
+    
+    return (entry != [NSNull null])? entry : nil;
+}
+
+#pragma mark - Key Filter
+
+///Replaces the key filter with one holding the keys of every current entry, sized for twice as many.
+///
+///Until the entries are loaded, the keys are read from the hashes stored in the slots of the
+///mapped snapshot and from the overlay, so that building the filter parses nothing.
+- (void)rebuildKeyFilter
+{
+    if(_deferringChanges) {
+        const RKFileSystemCacheSnapshotHeader *header = _mappedSnapshot.bytes;
+        const RKFileSystemCacheSnapshotSlot *slots = (const RKFileSystemCacheSnapshotSlot *)(header + 1);
+        _keyFilter = [[RKFileSystemCacheKeyFilter alloc] initWithCapacity:(_mappedEntryCount + _overlay.count) * 2];
+        for (uint64_t index = 0; index < header->slotCount; index++) {
+            if(slots[index].flags & kRKFileSystemCacheSnapshotSlotFlagOccupied)
+                [_keyFilter addKeyHash:slots[index].keyHash];
+        }
+        
+        [_overlay enumerateKeysAndObjectsUsingBlock:^(NSString *key, id entry, BOOL *stop) {
+            if(entry != [NSNull null])
+                [_keyFilter addKeyHash:RKMappedSnapshotKeyHashForKey(key)];
+        }];
+    } else {
+        _keyFilter = [[RKFileSystemCacheKeyFilter alloc] initWithCapacity:_entries.count * 2];
+        for (NSString *key in _entries)
+            [_keyFilter addKeyHash:RKMappedSnapshotKeyHashForKey(key)];
+    }
+}
+
+///Adds a key to the key filter, rebuilding the filter if it has outgrown the number of keys it was sized for.
+///
+///Does nothing while the entries are being read from the directory, the filter is built once they have been.
+- (void)addKeyToFilter:(NSString *)key
+{
+    if(!_keyFilter)
+        return;
+    
+    if(_keyFilter.count >= _keyFilter.capacity)
+        [self rebuildKeyFilter];
+    
+    [_keyFilter addKeyHash:RKMappedSnapshotKeyHashForKey(key)];
+}
+
+#pragma mark - Recency
+
+///Appends an entry that is not currently in the recency list to the end of the list.
+- (void)linkMostRecentlyUsedEntry:(RKFileSystemCacheEntry *)entry
+{
+    entry->_lessRecentlyUsed = _mostRecentlyUsed;
+    entry->_moreRecentlyUsed = nil;
+    
+    if(_mostRecentlyUsed)
+        _mostRecentlyUsed->_moreRecentlyUsed = entry;
+    else
+        _leastRecentlyUsed = entry;
+    
+    _mostRecentlyUsed = entry;
+}
+
+///Removes an entry from the recency list.
+- (void)unlinkEntry:(RKFileSystemCacheEntry *)entry
+{
+    if(entry->_lessRecentlyUsed)
+        entry->_lessRecentlyUsed->_moreRecentlyUsed = entry->_moreRecentlyUsed;
+    else
+        _leastRecentlyUsed = entry->_moreRecentlyUsed;
+    
+    if(entry->_moreRecentlyUsed)
+        entry->_moreRecentlyUsed->_lessRecentlyUsed = entry->_lessRecentlyUsed;
+    else
+        _mostRecentlyUsed = entry->_lessRecentlyUsed;
+    
+    entry->_lessRecentlyUsed = nil;
+    entry->_moreRecentlyUsed = nil;
+}
+
+///Moves an entry to the end of the recency list.
+- (void)markEntryMostRecentlyUsed:(RKFileSystemCacheEntry *)entry
+{
+    //The recency list is built when the entries are loaded.
+    if(_deferringChanges || entry == _mostRecentlyUsed)
+        return;
+    
+    [self unlinkEntry:entry];
+    [self linkMostRecentlyUsedEntry:entry];
+}
+
+///Rebuilds the recency list from the last access times of the receiver's entries.
+///
+///Neither snapshots nor journals preserve the order of entries exactly, so this is done once after loading.
+- (void)sortRecencyList
+{
+    NSArray *sortedEntries = [[_entries allValues] sortedArrayUsingComparator:^NSComparisonResult(RKFileSystemCacheEntry *left, RKFileSystemCacheEntry *right) {
+        if(left.lastAccessTime < right.lastAccessTime)
+            return NSOrderedAscending;
+        else if(left.lastAccessTime > right.lastAccessTime)
+            return NSOrderedDescending;
+        else
+            return NSOrderedSame;
+    }];
+    
+    _leastRecentlyUsed = nil;
+    _mostRecentlyUsed = nil;
+    for (RKFileSystemCacheEntry *entry in sortedEntries)
+        [self linkMostRecentlyUsedEntry:entry];
+}
+
+#pragma mark - Expiration
+
+///Sets the expiration time of an entry without journaling it.
+- (void)setExpirationTime:(NSTimeInterval)expirationTime ofEntry:(RKFileSystemCacheEntry *)entry
+{
+    if(!entry || entry.expirationTime == expirationTime)
+        return;
+    
+    //The expiration heap is built when the entries are loaded.
+    if(_deferringChanges) {
+        entry.expirationTime = expirationTime;
+        return;
+    }
+    
+    if(entry.expirationTime == 0.0)
+        _expiringEntryCount++;
+    else if(expirationTime == 0.0)
+        _expiringEntryCount--;
+    
+    entry.expirationTime = expirationTime;
+    if(expirationTime != 0.0)
+        [self pushExpirationTime:expirationTime forKey:entry.key];
+}
+
+///Exchanges two items of the expiration heap.
+- (void)swapExpirationHeapItemAtIndex:(NSUInteger)index withItemAtIndex:(NSUInteger)otherIndex
+{
+    double *times = _expirationHeapTimes.mutableBytes;
+    double time = times[index];
+    times[index] = times[otherIndex];
+    times[otherIndex] = time;
+    
+    [_expirationHeapKeys exchangeObjectAtIndex:index withObjectAtIndex:otherIndex];
+}
+
+///Moves the item at a given index of the expiration heap down until neither of its children expires before it.
+- (void)siftDownExpirationHeapItemAtIndex:(NSUInteger)index
+{
+    const double *times = _expirationHeapTimes.bytes;
+    NSUInteger count = _expirationHeapKeys.count;
+    for (;;) {
+        NSUInteger smallest = index;
+        NSUInteger left = (index * 2) + 1, right = left + 1;
+        if(left < count && times[left] < times[smallest])
+            smallest = left;
+        if(right < count && times[right] < times[smallest])
+            smallest = right;
+        
+        if(smallest == index)
+            break;
+        
+        [self swapExpirationHeapItemAtIndex:index withItemAtIndex:smallest];
+        index = smallest;
+    }
+}
+
+///Adds an item to the expiration heap.
+- (void)pushExpirationTime:(NSTimeInterval)expirationTime forKey:(NSString *)key
+{
+    //Items left behind by entries that have since been removed or changed are
+    //discarded whenever they come to outnumber the items that are still current.
+    if(_expirationHeapKeys.count >= MAX(kMinimumExpirationHeapRebuildCount, _expiringEntryCount * 2)) {
+        [self rebuildExpirationHeap];
+        if([_entries[key] expirationTime] == expirationTime)
+            return;
+    }
+    
+    double time = expirationTime;
+    [_expirationHeapTimes appendBytes:&time length:sizeof(time)];
+    [_expirationHeapKeys addObject:key];
+    
+    const double *times = _expirationHeapTimes.bytes;
+    for (NSUInteger index = _expirationHeapKeys.count - 1; index > 0; ) {
+        NSUInteger parent = (index - 1) / 2;
+        if(times[parent] <= times[index])
+            break;
+        
+        [self swapExpirationHeapItemAtIndex:index withItemAtIndex:parent];
+        index = parent;
+    }
+}
+
+///Removes the item that expires first from the expiration heap.
+- (void)popExpirationHeap
+{
+    NSUInteger lastIndex = _expirationHeapKeys.count - 1;
+    [self swapExpirationHeapItemAtIndex:0 withItemAtIndex:lastIndex];
+    [_expirationHeapKeys removeLastObject];
+    [_expirationHeapTimes setLength:lastIndex * sizeof(double)];
+    
+    [self siftDownExpirationHeapItemAtIndex:0];
+}
+
+///Rebuilds the expiration heap from the expiration times of the receiver's entries.
+- (void)rebuildExpirationHeap
+{
+    [_expirationHeapKeys removeAllObjects];
+    [_expirationHeapTimes setLength:0];
+    
+    [_entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, RKFileSystemCacheEntry *entry, BOOL *stop) {
+        if(entry.expirationTime == 0.0)
+            return;
+        
+        double time = entry.expirationTime;
+        [_expirationHeapTimes appendBytes:&time length:sizeof(time)];
+        [_expirationHeapKeys addObject:key];
+    }];
+    
+    for (NSUInteger index = _expirationHeapKeys.count / 2; index > 0; index--)
+        [self siftDownExpirationHeapItemAtIndex:index - 1];
+}
+
+- (NSArray *)entriesExpiringBefore:(NSTimeInterval)time
+{
+    [self loadEntriesIfNeeded];
+    
+    NSMutableArray *entries = [NSMutableArray array];
+    while (_expirationHeapKeys.count > 0) {
+        double expirationTime = ((const double *)_expirationHeapTimes.bytes)[0];
+        if(expirationTime >= time)
+            break;
+        
+        RKFileSystemCacheEntry *entry = _entries[_expirationHeapKeys[0]];
+        [self popExpirationHeap];
+        
+        if(entry.expirationTime == expirationTime)
+            [entries addObject:[entry copy]];
+    }
+    
+    return entries;
+}
+
+#pragma mark - Properties
+
+- (NSUInteger)count
+{
+    [self loadEntriesIfNeeded];
+    
+    return _entries.count;
+}
+
+- (unsigned long long)totalSize
+{
+    [self loadEntriesIfNeeded];
+    
+    return _totalSize;
+}
+
+- (BOOL)hasLegacyEntries
+{
+    if(!_loaded)
+        return (_mappedLegacyEntryCount > _changedLegacyKeys.count);
+    
+    OSMemoryBarrier();
+    return (_legacyKeys.count > 0);
+}
+
+- (void)setMaxCacheSize:(unsigned long long)maxCacheSize
+{
+    _maxCacheSize = maxCacheSize;
+    
+    uint64_t payload = maxCacheSize;
+    [self appendRecordOfType:kRKFileSystemCacheJournalRecordTypeSetMaxCacheSize key:nil payload:[NSData dataWithBytes:&payload length:sizeof(payload)]];
+}
+
+#pragma mark - Entries
+
+- (RKFileSystemCacheEntry *)entryForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+    
+    if(_loaded) {
+        OSMemoryBarrier();
+        return _entries[key];
+    }
+    
+    //Until the entries are loaded, the changes made since the mapped snapshot was
+    //written take precedence over it. Nothing is changed, so lookups remain safe
+    //to perform concurrently with one another. Keys without entries usually never
+    //reach the mapped snapshot, so misses do not fault in any of its pages.
+    if(![_keyFilter mayContainKeyHash:RKMappedSnapshotKeyHashForKey(key)])
+        return nil;
+    
+    id entry = _overlay[key];
+    if(entry)
+        return (entry != [NSNull null])? entry : nil;
+    
+    const RKFileSystemCacheSnapshotSlot *slot = [self mappedSlotForKey:key];
+    return slot? [self entryForMappedSlot:slot] : nil;
+}
+
+- (RKFileSystemCacheEntry *)entryForContentHash:(NSString *)contentHash
+{
+    NSParameterAssert(contentHash);
+    
+    [self loadEntriesIfNeeded];
+    
+    NSString *key = [_contentReferences[contentHash] anyObject];
+    return key? _entries[key] : nil;
+}
+
+- (NSUInteger)referenceCountForContentHash:(NSString *)contentHash
+{
+    NSParameterAssert(contentHash);
+    
+    [self loadEntriesIfNeeded];
+    
+    return [_contentReferences[contentHash] count];
+}
+
+- (BOOL)isLegacyEntryForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+    
+    if(!_loaded) {
+        if(![_keyFilter mayContainKeyHash:RKMappedSnapshotKeyHashForKey(key)])
+            return NO;
+        
+        if(_overlay[key] == [NSNull null] || [_changedLegacyKeys containsObject:key])
+            return NO;
+        
+        const RKFileSystemCacheSnapshotSlot *slot = [self mappedSlotForKey:key];
+        return (slot && (slot->flags & kRKFileSystemCacheSnapshotSlotFlagLegacy));
+    }
+    
+    OSMemoryBarrier();
+    return [_legacyKeys containsObject:key];
+}
+
+- (NSArray *)allEntries
+{
+    [self loadEntriesIfNeeded];
+    
+    NSMutableArray *allEntries = [NSMutableArray arrayWithCapacity:_entries.count];
+    for (RKFileSystemCacheEntry *entry in [_entries objectEnumerator])
+        [allEntries addObject:[entry copy]];
+    
+    return allEntries;
+}
+
+- (void)setEntry:(RKFileSystemCacheEntry *)entry
+{
+    NSParameterAssert(entry.key);
+    NSParameterAssert(entry.revision);
+    NSParameterAssert(!entry.contentHash || entry.contentHash.length == kContentHashLength);
+    
+    [self loadEntriesIfNeeded];
+    
+    RKFileSystemCacheEntry *entryCopy = [entry copy];
+    [self insertEntry:entryCopy];
+    [self addKeyToFilter:entryCopy.key];
+    [self journalEntry:entryCopy];
+}
+
+- (void)moveEntryForKey:(NSString *)key toSegment:(uint32_t)segment offset:(unsigned long long)offset
+{
+    NSParameterAssert(key);
+    
+    [self loadEntriesIfNeeded];
+    
+    RKFileSystemCacheEntry *entry = _entries[key];
+    if(!entry)
+        return;
+    
+    entry.segment = segment;
+    entry.offset = offset;
+    [self journalEntry:entry];
+}
+
+- (void)moveContentWithHash:(NSString *)contentHash toSegment:(uint32_t)segment offset:(unsigned long long)offset
+{
+    NSParameterAssert(contentHash);
+    
+    [self loadEntriesIfNeeded];
+    
+    for (NSString *key in [_contentReferences[contentHash] copy])
+        [self moveEntryForKey:key toSegment:segment offset:offset];
+}
+
+///Appends a record describing the complete state of an entry to the journal.
+- (void)journalEntry:(RKFileSystemCacheEntry *)entry
+{
+    double accessTime = entry.lastAccessTime;
+    uint64_t dataSize = entry.dataSize;
+    NSMutableData *payload = [NSMutableData dataWithBytes:&accessTime length:sizeof(accessTime)];
+    [payload appendBytes:&dataSize length:sizeof(dataSize)];
+    
+    RKFileSystemCacheJournalRecordType type = kRKFileSystemCacheJournalRecordTypePut;
+    if(entry.segment != 0 || entry.contentHash) {
+        uint64_t segmentOffset = entry.offset;
+        uint32_t segment = entry.segment;
+        [payload appendBytes:&segmentOffset length:sizeof(segmentOffset)];
+        [payload appendBytes:&segment length:sizeof(segment)];
+        type = kRKFileSystemCacheJournalRecordTypePutPacked;
+    }
+    
+    if(entry.contentHash) {
+        [payload appendData:[entry.contentHash dataUsingEncoding:NSASCIIStringEncoding]];
+        type = kRKFileSystemCacheJournalRecordTypePutContent;
+    }
+    
+    [payload appendData:[entry.revision dataUsingEncoding:NSUTF8StringEncoding]];
+    
+    [self beginBatch];
+    [self appendRecordOfType:type key:entry.key payload:payload];
+    if(entry.expirationTime != 0.0) {
+        double expirationTime = entry.expirationTime;
+        [self appendRecordOfType:kRKFileSystemCacheJournalRecordTypeSetExpiration key:entry.key payload:[NSData dataWithBytes:&expirationTime length:sizeof(expirationTime)]];
+    }
+    if(entry.compressed)
+        [self appendRecordOfType:kRKFileSystemCacheJournalRecordTypeSetCompressed key:entry.key payload:nil];
+    [self endBatch];
+}
+
+- (void)touchEntryForKey:(NSString *)key atTime:(NSTimeInterval)accessTime
+{
+    NSParameterAssert(key);
+    
+    RKFileSystemCacheEntry *entry = [self mutableEntryForKey:key];
+    if(!entry)
+        return;
+    
+    [_frequencySketch recordAccessForKey:key];
+    [self markEntryMostRecentlyUsed:entry];
+    
+    NSTimeInterval previousAccessTime = entry.lastAccessTime;
+    entry.lastAccessTime = accessTime;
+    
+    if(accessTime - previousAccessTime >= kTouchJournalInterval) {
+        double payload = accessTime;
+        [self appendRecordOfType:kRKFileSystemCacheJournalRecordTypeTouch key:key payload:[NSData dataWithBytes:&payload length:sizeof(payload)]];
+    }
+}
+
+- (void)removeEntryForKey:(NSString *)key
+{
+    NSParameterAssert(key);
+    
+    if(![self mutableEntryForKey:key])
+        return;
+    
+    [self deleteEntryForKey:key];
+    [self appendRecordOfType:kRKFileSystemCacheJournalRecordTypeRemove key:key payload:nil];
+}
+
+- (void)removeAllEntries
+{
+    [self loadEntriesIfNeeded];
+    
+    [_entries removeAllObjects];
+    [_legacyKeys removeAllObjects];
+    [_contentReferences removeAllObjects];
+    [_expirationHeapKeys removeAllObjects];
+    [_expirationHeapTimes setLength:0];
+    _expiringEntryCount = 0;
+    _totalSize = 0;
+    _leastRecentlyUsed = nil;
+    _mostRecentlyUsed = nil;
+    
+    NSError *error = nil;
+    if(![self compact:&error])
+        RKLogError(@"Could not compact cache index. %@", error);
+}
+
+#pragma mark - Eviction
+
+///Returns the number of bytes that would be freed by removing an entry, given the other
+///references to its content that are also being removed.
+///
+/// \param  entry               The entry being removed.
+/// \param  releasedReferences  The number of references to each content hash being removed,
+///                             updated to include the entry's own reference.
+- (unsigned long long)sizeFreedByRemovingEntry:(RKFileSystemCacheEntry *)entry releasedReferences:(NSMutableDictionary *)releasedReferences
+{
+    if(!entry.contentHash)
+        return entry.dataSize;
+    
+    NSUInteger releasedReferenceCount = [releasedReferences[entry.contentHash] unsignedIntegerValue] + 1;
+    releasedReferences[entry.contentHash] = @(releasedReferenceCount);
+    
+    return (releasedReferenceCount == [_contentReferences[entry.contentHash] count])? entry.dataSize : 0;
+}
+
+- (NSArray *)admitEntryWithKey:(NSString *)key contentHash:(NSString *)contentHash dataSize:(unsigned long long)dataSize maxCacheSize:(unsigned long long)maxCacheSize byFrequency:(BOOL)byFrequency
+{
+    NSParameterAssert(key);
+    
+    [self loadEntriesIfNeeded];
+    
+    [_frequencySketch recordAccessForKey:key];
+    
+    if(dataSize > maxCacheSize)
+        return nil;
+    
+    NSMutableDictionary *releasedReferences = [NSMutableDictionary dictionary];
+    RKFileSystemCacheEntry *existingEntry = _entries[key];
+    unsigned long long projectedSize = _totalSize;
+    if(existingEntry)
+        projectedSize -= [self sizeFreedByRemovingEntry:existingEntry releasedReferences:releasedReferences];
+    
+    //Content that is already stored costs nothing more to reference.
+    NSUInteger remainingReferenceCount = contentHash? [_contentReferences[contentHash] count] - [releasedReferences[contentHash] unsignedIntegerValue] : 0;
+    if(remainingReferenceCount == 0)
+        projectedSize += dataSize;
+    
+    NSMutableArray *victims = [NSMutableArray array];
+    NSUInteger candidateFrequency = [_frequencySketch frequencyForKey:key];
+    for (RKFileSystemCacheEntry *victim = _leastRecentlyUsed; victim && projectedSize > maxCacheSize; victim = victim->_moreRecentlyUsed) {
+        //Evicting entries that share the new entry's content would not free anything.
+        if(victim == existingEntry || (contentHash && [victim.contentHash isEqualToString:contentHash]))
+            continue;
+        
+        //Replacing an entry that is already in the cache is always allowed, but a
+        //new entry must be used at least as often as everything it would displace.
+        if(byFrequency && !existingEntry && [_frequencySketch frequencyForKey:victim.key] > candidateFrequency)
+            return nil;
+        
+        [victims addObject:[victim copy]];
+        projectedSize -= [self sizeFreedByRemovingEntry:victim releasedReferences:releasedReferences];
+    }
+    
+    return victims;
+}
+
+- (NSArray *)entriesToEvictForMaxCacheSize:(unsigned long long)maxCacheSize
+{
+    [self loadEntriesIfNeeded];
+    
+    NSMutableDictionary *releasedReferences = [NSMutableDictionary dictionary];
+    NSMutableArray *victims = [NSMutableArray array];
+    unsigned long long projectedSize = _totalSize;
+    for (RKFileSystemCacheEntry *victim = _leastRecentlyUsed; victim && projectedSize > maxCacheSize; victim = victim->_moreRecentlyUsed) {
+        [victims addObject:[victim copy]];
+        projectedSize -= [self sizeFreedByRemovingEntry:victim releasedReferences:releasedReferences];
+    }
+    
+    return victims;
+}
+
+- (NSArray *)entriesLastAccessedBefore:(NSTimeInterval)accessTime
+{
+    [self loadEntriesIfNeeded];
+    
+    NSMutableArray *entries = [NSMutableArray array];
+    for (RKFileSystemCacheEntry *entry = _leastRecentlyUsed; entry && entry.lastAccessTime < accessTime; entry = entry->_moreRecentlyUsed) {
+        if(entry.expirationTime == 0.0)
+            [entries addObject:[entry copy]];
+    }
+    
+    return entries;
+}
+
+@end
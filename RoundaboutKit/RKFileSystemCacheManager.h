@@ -7,34 +7,251 @@
 //
 
 #import "RKURLRequestPromise.h"
+#import "RKFileSystemCacheStatistics.h"
+
+///How an RKFileSystemCacheManager chooses what to evict to make room for new items.
+typedef NS_ENUM(NSInteger, RKFileSystemCacheEvictionPolicy) {
+    ///The least recently used items are evicted, but a new item is only stored if it
+    ///has been requested at least as often as every item it would displace.
+    kRKFileSystemCacheEvictionPolicyFrequencyFiltered = 0,
+    
+    ///The least recently used items are evicted, and new items are always stored.
+    ///Suited to caches whose items are rarely requested more than once.
+    kRKFileSystemCacheEvictionPolicyLeastRecentlyUsed = 1,
+};
 
 ///The RKFileSystemCacheManager class encapsulates a persistent data-agnostic cache manager.
 ///
 ///RKFileSystemCacheManager is asynchronously initialize to reduce the cost of calling
-///`+[self sharedCacheManagerForBucket]` as the cache manager must perform file system IO
+///`+[self cacheManagerForBucket:]` as the cache manager must perform file system IO
 ///when it is initialized. This means that any method calls before the initialization
 ///process has been completed may block longer than is otherwise typical.
 ///
-///The methods on this class should always be called from a background thread.
+///The methods on this class should always be called from a background thread. Lookups
+///may be performed concurrently from any number of threads, and file IO is never performed
+///while holding the lock that guards the cache's metadata, so a slow read or write of one
+///item does not block lookups of any other item.
+///
+///Small items are packed into large append-only segment files rather than being stored
+///in files of their own, and segments that are mostly unused are compacted during
+///maintenance. Larger items are stored in files of their own.
+///
+///Items are stored by the hash of their contents, and items with identical contents
+///share a single copy of them that only counts towards `cacheSize` once. A shared
+///copy is removed once the last item that references it is removed.
+///
+///Cached data is returned memory-mapped where the file system allows it, so large
+///items do not have to be copied into memory before they are post-processed.
+///
+///Items stored with an expiration date are removed by maintenance once that date has
+///passed, items stored without one are removed once they have not been accessed for
+///`defaultExpirationInterval`. Expired items are found without examining any others.
+///
+///Partial bodies persisted through the optional partial data methods of
+///`<RKURLRequestPromiseCacheManager>` are stored alongside cached data,
+///and are expunged after a week without being resumed.
+///
+///Cache metadata is persisted as an append-only journal that is periodically compacted
+///into a snapshot, so storing or removing an item costs a single small write rather than
+///rewriting the metadata of every item. Snapshots are memory-mapped rather than parsed,
+///so opening a cache costs the same however many items it contains, and lookups are
+///answered straight away while the metadata is loaded in the background. Metadata from
+///earlier versions is migrated the first time a cache directory is opened.
+///
+///Items are stored under a fast non-cryptographic 128-bit hash of their identifiers.
+///Items stored by earlier versions under the MD5 hash of their identifiers are moved
+///the first time their identifiers are used.
+///
+///A cache directory may be shared by cache managers in several processes, so that an item
+///stored by one process is a hit for all of them. Shared cache managers coordinate through
+///an advisory lock on a file in the directory, catch up with each other's metadata changes
+///before every operation, and write every item to a file of its own with an atomic rename.
+///
+///Hits, misses, revalidations, bytes read and written, evictions by reason, and the
+///latencies of reads and writes are counted as the cache is used, see `statistics`.
+///
+///The asynchronous methods of `<RKAsyncURLRequestPromiseCacheManager>` are performed
+///on an operation queue owned by each cache manager, so the file system IO of one cache
+///manager never waits behind that of another.
 ///
 ///This class was formerly known as RKURLRequestPromiseCacheManager.
-@interface RKFileSystemCacheManager : NSObject <RKURLRequestPromiseCacheManager>
+@interface RKFileSystemCacheManager : NSObject <RKAsyncURLRequestPromiseCacheManager>
 
 ///Returns the shared cache manager, creating it if it does not already exist.
 + (instancetype)sharedCacheManager;
 
+///Returns the cache manager of a named bucket, creating it if it does not already exist.
+///
+/// \param  bucketName  The name of the bucket. Required. May only contain letters, digits,
+///                     "-", "_" and ".", and may not begin with a ".".
+///
+/// \result The cache manager of the bucket. Every call with the same name returns the same cache manager.
+///
+///Each bucket is stored in a directory of its own next to the shared cache manager's, and has
+///its own maximum size, eviction policy and maintenance schedule, so that items of one kind
+///never displace items of another. Buckets are maintained every five minutes by default.
++ (instancetype)cacheManagerForBucket:(NSString *)bucketName;
+
+#pragma mark - Global Limits
+
+///Sets the maximum combined size of the shared cache manager and every bucket. Zero, the default, for no limit.
+///
+///While the maximum sizes of the shared cache manager and the buckets created so far add up to
+///more than this value, each of them is kept within the same fraction of its own maximum size.
+///Lowering the value will not evict existing items until each cache's next maintenance cycle.
++ (void)setMaxTotalCacheSize:(NSUInteger)maxTotalCacheSize;
+
+///Returns the maximum combined size of the shared cache manager and every bucket, or zero if there is no limit.
++ (NSUInteger)maxTotalCacheSize;
+
+///Initialize the receiver with the directory it should store its contents in.
+///
+/// \param  location    The location of the directory. Required. The directory
+///                     is created if it does not already exist.
+/// \param  shared      Whether or not cache managers in other processes may use
+///                     the directory at the same time.
+///
+/// \result A fully initialized cache manager.
+///
+///Every cache manager using a shared directory must be initialized as shared.
+///Lookups in a shared cache cost an additional two `stat` calls, and small
+///items are not packed into segments.
+///
+///This is the designated initializer.
+- (instancetype)initWithLocation:(NSURL *)location shared:(BOOL)shared;
+
+///Initialize the receiver with a directory that is not shared with any other process.
+///
+///Each directory should only be used by a single unshared cache manager at a time.
+- (instancetype)initWithLocation:(NSURL *)location;
+
 #pragma mark - Properties
 
-///The name of the bucket associated with this cache manager.
-@property (readonly, copy) NSString *bucketName RK_DEPRECATED_SINCE_2_1;
+///The directory the cache manager stores its contents in.
+@property (readonly) NSURL *location;
+
+///Whether or not the cache manager's directory may be used by other processes at the same time.
+@property (readonly, getter=isShared) BOOL shared;
+
+///The name of the bucket of the cache manager, or nil if it was not returned by `+cacheManagerForBucket:`.
+@property (readonly, copy) NSString *bucketName;
 
 ///The maximum size of the cache. Defaults to 30 MB.
 ///
-///Changing the value of this property will not affect
-///the cache until its next maintenance cycle.
+///The cache is kept within this size as items are stored, evicting the least recently
+///used items to make room. Items that have been requested less often than the items they
+///would displace are not stored at all. Lowering the value of this property will not
+///evict existing items until the cache's next maintenance cycle.
 @property NSUInteger maxCacheSize;
 
 ///The estimated size of the cache.
 @property (readonly) NSUInteger cacheSize;
 
+///How long items stored without an expiration date are kept without
+///being accessed before they are removed. Defaults to one week.
+@property NSTimeInterval defaultExpirationInterval;
+
+///How the cache manager chooses what to evict to make room for new items. Defaults to frequency filtered.
+@property RKFileSystemCacheEvictionPolicy evictionPolicy;
+
+///Whether or not the cache manager compresses the data of the items it stores. Defaults to NO.
+///
+///Items are compressed with zlib, and decompressed when they are read, so compression is
+///invisible to clients of the cache manager. Items smaller than `compressionThreshold`, items
+///whose data is in an already compressed format such as an image or an archive, and items
+///that do not shrink by at least an eighth are stored as they are. The sizes of compressed
+///items count towards `cacheSize` and `maxCacheSize` as they are stored.
+///
+///Changing the value of this property only affects items stored afterwards.
+@property BOOL compressesData;
+
+///The size of the smallest item the cache manager compresses. Defaults to 1 KB.
+@property NSUInteger compressionThreshold;
+
+///How often the cache manager removes expired and excess items and compacts its segments,
+///or zero if it is never done automatically. Defaults to five minutes for the shared cache
+///manager and buckets, and to zero for every other cache manager.
+///
+///Maintenance works in short slices, each of which commits the removal of its items to
+///the cache's metadata with a single write. Between slices, maintenance pauses for as
+///long as the cache is being read from and written to, so that it does not compete with
+///the cache's clients for the file system.
+@property NSTimeInterval maintenanceInterval;
+
+#pragma mark - Statistics
+
+///A snapshot of the receiver's activity since it was created, or its statistics were last reset.
+///
+///Statistics are recorded without taking any locks, so they may be read as often as is
+///useful. Only the reads and writes of single items contribute to latency histograms,
+///batch operations count towards every other statistic.
+@property (readonly) RKFileSystemCacheStatistics *statistics;
+
+///Resets the receiver's statistics to zero.
+- (void)resetStatistics;
+
+#pragma mark - Batch Operations
+
+///Reads the cached data for a number of identifiers at once.
+///
+/// \param  identifiers The identifiers to read the cached data for. Required.
+/// \param  outError    On return, an error describing why the data of an identifier could not be read.
+///
+/// \result A dictionary of the identifiers that have cached data, and their data.
+///
+///The items are looked up together and read concurrently. Identifiers
+///without any cached data are not included in the result.
+- (NSDictionary *)cachedDataForIdentifiers:(NSArray *)identifiers error:(NSError **)outError;
+
+///Persists a number of data objects at once.
+///
+/// \param  dataByIdentifier        The data objects to persist, keyed by their identifiers. Required.
+/// \param  revisionsByIdentifier   The revisions to associate with the data objects, keyed by their
+///                                 identifiers. Required. Must contain every identifier in `dataByIdentifier`.
+/// \param  outError                On return, an error describing why a data object could not be persisted.
+///
+/// \result YES if every data object was persisted; NO otherwise.
+///
+///The items are written concurrently, and the cache's metadata is updated with a single write.
+- (BOOL)cacheDataForIdentifiers:(NSDictionary *)dataByIdentifier withRevisions:(NSDictionary *)revisionsByIdentifier error:(NSError **)outError;
+
+///Deletes all cache manager state related to a number of identifiers at once.
+///
+/// \param  identifiers The identifiers to delete. Required.
+/// \param  outError    On return, an error describing why an identifier could not be deleted.
+///
+/// \result YES if every identifier was deleted; NO otherwise.
+///
+///The items are removed concurrently, and the cache's metadata is updated with a single write.
+- (BOOL)removeCacheForIdentifiers:(NSArray *)identifiers error:(NSError **)outError;
+
+#pragma mark - Archives
+
+///Writes the cached data of a number of identifiers, along with their revisions and
+///expiration dates, to a single archive that another cache manager can import.
+///
+/// \param  identifiers     The identifiers to export, or nil to export every item in the cache.
+/// \param  archiveLocation The location to write the archive to. Any existing file is replaced. Required.
+/// \param  outError        On return, an error describing why the archive could not be written.
+///
+/// \result YES if the archive was written; NO otherwise.
+///
+///Identifiers without any cached data are skipped. Archives are suited to shipping with
+///an application, or to being downloaded in one transfer, so that a cache that has just
+///been created or cleared does not have to fetch every item it needs individually.
+- (BOOL)exportCacheForIdentifiers:(NSArray *)identifiers toArchiveAtURL:(NSURL *)archiveLocation error:(NSError **)outError;
+
+///Stores the items in an archive written by `-exportCacheForIdentifiers:toArchiveAtURL:error:`.
+///
+/// \param  archiveLocation The location of the archive. Required.
+/// \param  outError        On return, an error describing why the archive could not be imported.
+///
+/// \result YES if the archive was read and every item in it was stored, skipped or declined; NO otherwise.
+///
+///Items the cache already has are skipped, so that an archive never replaces fresher data,
+///as are items whose expiration dates have passed. The remaining items are stored as they
+///are by `-cacheDataForIdentifiers:withRevisions:error:`: concurrently, subject to the
+///cache's maximum size, and with a single write of the cache's metadata.
+- (BOOL)importCacheFromArchiveAtURL:(NSURL *)archiveLocation error:(NSError **)outError;
+
 @end
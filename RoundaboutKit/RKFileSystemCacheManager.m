@@ -8,93 +8,436 @@
 
 #import "RKFileSystemCacheManager.h"
 #import <CommonCrypto/CommonDigest.h>
+#import <fcntl.h>
+#import <limits.h>
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import "RKFileSystemCacheCompression.h"
+#import "RKFileSystemCacheIndex.h"
+#import "RKFileSystemCacheSegmentStore.h"
+#import "RKFileSystemCacheStatistics.h"
 
-static NSString *const kMaxCacheSize = @"__maxCacheSize";
-static NSString *const kCacheSize = @"__cacheSize";
+static NSString *const kPartialDataExtension = @"partial";
+static NSString *const kPartialValidatorExtension = @"partial-validator";
+static NSString *const kContentExtension = @"content";
 
-static NSString *const kRevisionKey = @"revision";
-static NSString *const kLastAccessedDateKey = @"lastAccessDate";
-static NSString *const kDataSizeKey = @"dataSize";
+static NSTimeInterval const kDefaultExpirationInterval = (RK_TIME_DAY * 7.0);
+static NSTimeInterval const kPartialDataExpirationInterval = (RK_TIME_DAY * 7.0);
+static NSUInteger kDefaultMaxCacheSize = (1024 * 1024 * 30) /* 30 MB */;
+static NSUInteger const kDefaultCompressionThreshold = 1024;
 
-static NSTimeInterval const kExpirationInterval = (RK_TIME_DAY * 7.0);
-static NSUInteger kDefaultMaxCacheSize = (1024 * 30) /* 30 MB */;
+///The number of locks the files of the cache are striped across.
+static NSUInteger const kFileGuardCount = 16;
+
+///The fraction of a segment that must still be in use for it to be left alone by maintenance.
+static double const kSegmentCompactionThreshold = 0.5;
+
+///The largest number of items a single slice of maintenance may remove or move.
+static NSUInteger const kMaintenanceSliceItemLimit = 32;
+
+///How long a single slice of maintenance may run before it yields.
+static NSTimeInterval const kMaintenanceSliceDuration = 0.01;
+
+///How long maintenance first pauses between slices when the cache is in use. The pause
+///doubles for as long as the cache remains in use, up to `kMaximumMaintenancePause`.
+static NSTimeInterval const kMinimumMaintenancePause = 0.05;
+
+///The longest maintenance pauses between slices before it continues regardless of how busy the cache is.
+static NSTimeInterval const kMaximumMaintenancePause = 1.0;
+
+///The number of sanitized identifiers remembered by a cache manager.
+static NSUInteger const kSanitizedIdentifierCacheLimit = 512;
+
+///How long after a cache manager is created its index loads every entry in the background.
+static NSTimeInterval const kIndexLoadDelay = 2.0;
+
+///The name of the directory buckets are stored in, next to the shared cache manager's directory.
+static NSString *const kBucketsDirectoryName = @"RKFileSystemCacheBuckets";
+
+///The reason given for removing an item that is being replaced or superseded rather than
+///evicted. Removals for this reason are not recorded in the statistics of a cache manager.
+static RKFileSystemCacheEvictionReason const kEvictionReasonReplacement = -1;
+
+#pragma mark - Archives
+
+///The number at the start of every cache archive.
+static uint32_t const kArchiveMagic = 0x41434B52;
+
+///The version of the archive format written by this version of RKFileSystemCacheManager.
+static uint32_t const kArchiveVersion = 1;
+
+///The header at the start of a cache archive. It is followed by `entryCount` records.
+typedef struct RKFileSystemCacheArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+} RKFileSystemCacheArchiveHeader;
+
+///The header of a record of a cache archive. It is followed by
+///the item's sanitized identifier, its revision, and its data.
+typedef struct RKFileSystemCacheArchiveRecordHeader {
+    double expirationTime;
+    uint64_t dataLength;
+    uint32_t revisionLength;
+    uint16_t keyLength;
+    uint16_t reserved;
+} RKFileSystemCacheArchiveRecordHeader;
+
+///Writes the whole of a buffer to a file descriptor, returning whether or not it
+///succeeded. On failure, `errno` describes why the buffer could not be written.
+static BOOL write_fully(int descriptor, const void *bytes, size_t length)
+{
+    while (length > 0) {
+        ssize_t amountWritten = write(descriptor, bytes, length);
+        if(amountWritten == -1) {
+            if(errno == EINTR)
+                continue;
+            
+            return NO;
+        }
+        
+        bytes = (const uint8_t *)bytes + amountWritten;
+        length -= (size_t)amountWritten;
+    }
+    
+    return YES;
+}
+
+///Locks a given pthread mutex and applies a block, wrapped in a @try...@finally
+///statement so that the mutex is always unlocked, regardless of exceptions being thrown.
+RK_INLINE void with_locked_file(pthread_mutex_t *mutex, dispatch_block_t block)
+{
+    @try {
+        pthread_mutex_lock(mutex);
+        
+        block();
+    } @finally {
+        pthread_mutex_unlock(mutex);
+    }
+}
+
+///Locks a number of pthread mutexes from an array in ascending order and applies a block,
+///wrapped in a @try...@finally statement so that the mutexes are always unlocked.
+///
+///Mutexes are always locked in ascending order, so that any number of callers
+///locking overlapping sets of mutexes from the same array can never deadlock.
+RK_INLINE void with_locked_files(pthread_mutex_t *mutexes, NSIndexSet *indexes, dispatch_block_t block)
+{
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        pthread_mutex_lock(&mutexes[index]);
+    }];
+    
+    @try {
+        block();
+    } @finally {
+        [indexes enumerateIndexesWithOptions:NSEnumerationReverse usingBlock:^(NSUInteger index, BOOL *stop) {
+            pthread_mutex_unlock(&mutexes[index]);
+        }];
+    }
+}
+
+///Returns whether two entries of an item describe the same stored data, however recently either was used.
+RK_INLINE BOOL entries_describe_same_data(RKFileSystemCacheEntry *entry, RKFileSystemCacheEntry *otherEntry)
+{
+    return ((entry.revision == otherEntry.revision || [entry.revision isEqualToString:otherEntry.revision]) &&
+            entry.expirationTime == otherEntry.expirationTime &&
+            entry.segment == otherEntry.segment &&
+            entry.offset == otherEntry.offset);
+}
 
 @implementation RKFileSystemCacheManager {
     NSURL *_cacheLocation;
-    NSURL *_cacheMetadataLocation;
     
+    ///The concurrent queue that regulates access to `_index`. Lookups are performed
+    ///concurrently, and changes are performed with barriers. No file IO other than
+    ///the index's own journal is ever performed on this queue, except that a shared
+    ///cache removes unreferenced content while holding a barrier.
+    ///
+    ///Always accessed through `-readIndexUsingBlock:` and `-changeIndexUsingBlock:`,
+    ///so that a shared cache takes the directory's lock as needed.
     dispatch_queue_t _accessControlQueue;
-    NSMutableDictionary *_cacheMetadata;
+    RKFileSystemCacheIndex *_index;
+    
+    ///The segment files small items are packed into. Replaced while holding every
+    ///file guard and a barrier on `_accessControlQueue`, so it may be read while
+    ///holding either a file guard or `_accessControlQueue`.
+    RKFileSystemCacheSegmentStore *_segments;
+    
+    ///The locks that serialize changes to the files of a single item, so that the
+    ///index always describes the most recently written file for an item. Items are
+    ///assigned to a lock by the hash of their sanitized identifier.
+    pthread_mutex_t _fileGuards[kFileGuardCount];
+    
+    ///The locks that serialize storing and releasing content shared between items, so
+    ///that content is never removed while a new item is being pointed at it. Content is
+    ///assigned to a lock by the hash of its content hash. A content guard may be taken
+    ///while holding a file guard, but never the other way around.
+    pthread_mutex_t _contentGuards[kFileGuardCount];
+    
+    ///The sanitized identifiers of recently used identifiers, so that the identifier
+    ///of a promise is hashed once rather than on every call it makes.
+    ///
+    ///NSString => NSString.
+    NSCache *_sanitizedIdentifiers;
+    
+    ///The queue the asynchronous methods of the cache manager perform their IO on.
+    NSOperationQueue *_ioQueue;
+    
+    ///The counters of the cache manager's activity. Updated without any locks.
+    RKFileSystemCacheStatisticsRecorder *_statisticsRecorder;
+    
+    ///The timer that performs maintenance every `maintenanceInterval`. Guarded by `self`.
+    dispatch_source_t _maintenanceTimer;
+    
+    ///The fraction of `maxCacheSize` the cache is kept within, so that the shared cache
+    ///manager and every bucket stay within the maximum total cache size together.
+    ///Written by `+updateBudgetShares`, read without synchronization.
+    volatile double _budgetShare;
+    
+    ///The number of reads and writes the cache manager's clients have made, so that
+    ///maintenance can tell whether the cache has been in use since its last slice.
+    volatile int64_t _foregroundOperationCount;
+    
+    ///The value of `_foregroundOperationCount` when maintenance last began a slice.
+    ///Only accessed by the maintenance pass in progress.
+    int64_t _maintenanceOperationCount;
+    
+    ///Non-zero while a maintenance pass is in progress, so that passes never overlap.
+    volatile int32_t _isPerformingMaintenance;
 }
 
 #pragma mark - Lifecycle
 
-static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
+static NSTimeInterval const kDefaultMaintenanceInterval = (RK_TIME_MINUTE * 5.0);
+
+///How long after maintenance is scheduled it is first performed, at most.
+static NSTimeInterval const kInitialMaintenanceDelay = (RK_TIME_MINUTE * 1.0);
+
+///The maximum number of asynchronous operations a cache manager may have in flight at once.
+static NSInteger const kMaximumConcurrentIOOperationCount = 4;
+
+///The maximum combined size of the shared cache manager and every bucket, or zero
+///if there is none. Guarded by `+budgetedCacheManagers`.
+static NSUInteger sMaxTotalCacheSize = 0;
 
-+ (dispatch_source_t)maintenanceTimer
++ (instancetype)sharedCacheManager
 {
-    static dispatch_source_t maintenanceTimer = NULL;
+    static RKFileSystemCacheManager *sharedCacheManager = nil;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
-        maintenanceTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
-        
-        dispatch_source_set_timer(maintenanceTimer,
-                                  dispatch_time(DISPATCH_TIME_NOW, 60.0 * NSEC_PER_SEC),
-                                  kMaintenanceTimerInterval * NSEC_PER_SEC,
-                                  kMaintenanceTimerInterval / 2);
+        sharedCacheManager = [self new];
+        sharedCacheManager.maintenanceInterval = kDefaultMaintenanceInterval;
         
-        dispatch_source_set_event_handler(maintenanceTimer, ^{
-            [[RKFileSystemCacheManager sharedCacheManager] preformMaintenance];
-        });
+        [self addBudgetedCacheManager:sharedCacheManager];
     });
     
-    return maintenanceTimer;
+    return sharedCacheManager;
 }
 
-+ (instancetype)sharedCacheManager
+#pragma mark - Buckets
+
+///Returns whether or not a bucket name can only ever name a directory of its own.
+///
+///Names are limited to letters, digits, "-", "_" and ".", and may not begin with a "."
+///so that "." and ".." can never place a bucket in another bucket's directory.
+RK_INLINE BOOL is_valid_bucket_name(NSString *bucketName)
 {
-    static RKFileSystemCacheManager *sharedCacheManager = nil;
+    if(bucketName.length == 0 || bucketName.length > NAME_MAX || [bucketName hasPrefix:@"."])
+        return NO;
+    
+    static NSCharacterSet *invalidCharacters = nil;
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        sharedCacheManager = [self new];
-        
-        dispatch_resume([self maintenanceTimer]);
+        invalidCharacters = [[NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_."] invertedSet];
     });
     
-    return sharedCacheManager;
+    return ([bucketName rangeOfCharacterFromSet:invalidCharacters].location == NSNotFound);
+}
+
+///Returns the cache managers of every bucket created so far.
+///
+///NSString => RKFileSystemCacheManager.
++ (NSMutableDictionary *)buckets
+{
+    static NSMutableDictionary *buckets = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        buckets = [NSMutableDictionary dictionary];
+    });
+    
+    return buckets;
+}
+
++ (instancetype)cacheManagerForBucket:(NSString *)bucketName
+{
+    NSParameterAssert(bucketName);
+    
+    if(!is_valid_bucket_name(bucketName))
+        [NSException raise:NSInvalidArgumentException format:@"%@ is not a valid bucket name.", bucketName];
+    
+    NSMutableDictionary *buckets = [self buckets];
+    RKFileSystemCacheManager *cacheManager = nil;
+    BOOL isNewBucket = NO;
+    @synchronized(buckets) {
+        cacheManager = buckets[bucketName];
+        if(!cacheManager) {
+            NSURL *bucketsLocation = [[[self defaultCacheLocation] URLByDeletingLastPathComponent] URLByAppendingPathComponent:kBucketsDirectoryName];
+            cacheManager = [[self alloc] initWithLocation:[bucketsLocation URLByAppendingPathComponent:bucketName isDirectory:YES]];
+            cacheManager->_bucketName = [bucketName copy];
+            cacheManager.maintenanceInterval = kDefaultMaintenanceInterval;
+            
+            buckets[bucketName] = cacheManager;
+            isNewBucket = YES;
+        }
+    }
+    
+    if(isNewBucket)
+        [self addBudgetedCacheManager:cacheManager];
+    
+    return cacheManager;
+}
+
+#pragma mark - Global Limits
+
+///Returns the cache managers that are kept within the maximum total cache size together.
++ (NSMutableArray *)budgetedCacheManagers
+{
+    static NSMutableArray *budgetedCacheManagers = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        budgetedCacheManagers = [NSMutableArray array];
+    });
+    
+    return budgetedCacheManagers;
+}
+
+///Adds a cache manager to those kept within the maximum total cache size.
++ (void)addBudgetedCacheManager:(RKFileSystemCacheManager *)cacheManager
+{
+    NSMutableArray *budgetedCacheManagers = [self budgetedCacheManagers];
+    @synchronized(budgetedCacheManagers) {
+        [budgetedCacheManagers addObject:cacheManager];
+    }
+    
+    [self updateBudgetShares];
+}
+
+///Recalculates the fraction of its maximum size each budgeted cache manager is kept within.
+///
+///When the maximum sizes of the budgeted cache managers add up to more than the maximum
+///total cache size, each of them is given the same fraction of its own maximum size.
++ (void)updateBudgetShares
+{
+    NSMutableArray *budgetedCacheManagers = [self budgetedCacheManagers];
+    @synchronized(budgetedCacheManagers) {
+        unsigned long long totalMaxCacheSize = 0;
+        for (RKFileSystemCacheManager *cacheManager in budgetedCacheManagers)
+            totalMaxCacheSize += cacheManager.maxCacheSize;
+        
+        double budgetShare = 1.0;
+        if(sMaxTotalCacheSize != 0 && totalMaxCacheSize > sMaxTotalCacheSize)
+            budgetShare = (double)sMaxTotalCacheSize / (double)totalMaxCacheSize;
+        
+        for (RKFileSystemCacheManager *cacheManager in budgetedCacheManagers)
+            cacheManager->_budgetShare = budgetShare;
+    }
+}
+
++ (void)setMaxTotalCacheSize:(NSUInteger)maxTotalCacheSize
+{
+    @synchronized([self budgetedCacheManagers]) {
+        sMaxTotalCacheSize = maxTotalCacheSize;
+    }
+    
+    [self updateBudgetShares];
+}
+
++ (NSUInteger)maxTotalCacheSize
+{
+    @synchronized([self budgetedCacheManagers]) {
+        return sMaxTotalCacheSize;
+    }
 }
 
 #pragma mark -
 
-- (id)init
+- (void)dealloc
+{
+    if(_maintenanceTimer)
+        dispatch_source_cancel(_maintenanceTimer);
+    
+    for (NSUInteger index = 0; index < kFileGuardCount; index++) {
+        pthread_mutex_destroy(&_fileGuards[index]);
+        pthread_mutex_destroy(&_contentGuards[index]);
+    }
+}
+
+- (instancetype)initWithLocation:(NSURL *)location shared:(BOOL)shared
 {
+    NSParameterAssert(location);
+    
     if((self = [super init])) {
-        _accessControlQueue = dispatch_queue_create("com.roundabout.RoundaboutKit.RKURLRequestPromiseCacheManager.accessQueue", 0);
-        dispatch_barrier_async(_accessControlQueue, ^{
-            _cacheLocation = [self cacheLocation];
-            if(![_cacheLocation checkResourceIsReachableAndReturnError:nil]) {
-                NSError *error = nil;
-                if(![[NSFileManager defaultManager] createDirectoryAtURL:_cacheLocation
-                                             withIntermediateDirectories:YES
-                                                              attributes:nil
-                                                                   error:&error]) {
-                    [NSException raise:NSInternalInconsistencyException format:@"Could not create bucket location %@. %@", _cacheLocation, error];
-                }
+        _cacheLocation = location;
+        _shared = shared;
+        
+        for (NSUInteger index = 0; index < kFileGuardCount; index++) {
+            int mutexInitStatus = pthread_mutex_init(&_fileGuards[index], NULL);
+            if(mutexInitStatus != noErr) {
+                [NSException raise:NSInternalInconsistencyException
+                            format:@"Could not create file guard for cache manager. %d", mutexInitStatus];
             }
             
-            _cacheMetadataLocation = [self locationForMetadata];
-            _cacheMetadata = [NSMutableDictionary dictionaryWithContentsOfURL:_cacheMetadataLocation] ?: [NSMutableDictionary dictionary];
+            mutexInitStatus = pthread_mutex_init(&_contentGuards[index], NULL);
+            if(mutexInitStatus != noErr) {
+                [NSException raise:NSInternalInconsistencyException
+                            format:@"Could not create content guard for cache manager. %d", mutexInitStatus];
+            }
+        }
+        
+        _defaultExpirationInterval = kDefaultExpirationInterval;
+        _evictionPolicy = kRKFileSystemCacheEvictionPolicyFrequencyFiltered;
+        _compressionThreshold = kDefaultCompressionThreshold;
+        _budgetShare = 1.0;
+        _statisticsRecorder = [RKFileSystemCacheStatisticsRecorder new];
+        
+        _sanitizedIdentifiers = [NSCache new];
+        _sanitizedIdentifiers.countLimit = kSanitizedIdentifierCacheLimit;
+        
+        _ioQueue = [NSOperationQueue new];
+        _ioQueue.name = @"com.roundabout.RoundaboutKit.RKURLRequestPromiseCacheManager.ioQueue";
+        _ioQueue.maxConcurrentOperationCount = kMaximumConcurrentIOOperationCount;
+        
+        _accessControlQueue = dispatch_queue_create("com.roundabout.RoundaboutKit.RKURLRequestPromiseCacheManager.accessQueue", DISPATCH_QUEUE_CONCURRENT);
+        dispatch_barrier_async(_accessControlQueue, ^{
+            [self createCacheDirectory];
+            
+            _index = [[RKFileSystemCacheIndex alloc] initWithDirectory:_cacheLocation shared:shared];
+            _segments = [[RKFileSystemCacheSegmentStore alloc] initWithDirectory:_cacheLocation];
+        });
+        
+        //Loading is not a barrier, so lookups continue to be answered from the mapped snapshot in the meantime.
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kIndexLoadDelay * NSEC_PER_SEC)), _accessControlQueue, ^{
+            [_index loadEntriesIfNeeded];
         });
     }
     
     return self;
 }
 
+- (instancetype)initWithLocation:(NSURL *)location
+{
+    return [self initWithLocation:location shared:NO];
+}
+
+- (id)init
+{
+    return [self initWithLocation:[[self class] defaultCacheLocation]];
+}
+
 #pragma mark - Locations
 
-///Returns the location of the cache manager's directory.
-- (NSURL *)cacheLocation
+///Returns the location of the shared cache manager's directory.
++ (NSURL *)defaultCacheLocation
 {
     NSError *error = nil;
     NSURL *cachesLocation = [[NSFileManager defaultManager] URLForDirectory:NSCachesDirectory
@@ -106,27 +449,44 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
     return [[cachesLocation URLByAppendingPathComponent:[[NSBundle bundleForClass:[self class]] bundleIdentifier]] URLByAppendingPathComponent:@"RKFileSystemCache"];
 }
 
-///Returns the location of a bucket's metadata file.
-- (NSURL *)locationForMetadata
+///Creates the cache manager's directory if it does not already exist.
+///
+///This method assumes it has been surrounded by a queue barrier.
+- (void)createCacheDirectory
 {
-    return [[self cacheLocation] URLByAppendingPathComponent:@"__Metadata.plist"];
+    if(![_cacheLocation checkResourceIsReachableAndReturnError:nil]) {
+        NSError *error = nil;
+        if(![[NSFileManager defaultManager] createDirectoryAtURL:_cacheLocation
+                                     withIntermediateDirectories:YES
+                                                      attributes:nil
+                                                           error:&error]) {
+            [NSException raise:NSInternalInconsistencyException format:@"Could not create bucket location %@. %@", _cacheLocation, error];
+        }
+    }
 }
 
 #pragma mark - Properties
 
+- (NSURL *)location
+{
+    return _cacheLocation;
+}
+
 - (void)setMaxCacheSize:(NSUInteger)maxCacheSize
 {
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        _cacheMetadata[kCacheSize] = @(maxCacheSize);
-    });
+    [self changeIndexUsingBlock:^{
+        _index.maxCacheSize = maxCacheSize;
+    }];
+    
+    [[self class] updateBudgetShares];
 }
 
 - (NSUInteger)maxCacheSize
 {
     __block NSUInteger maxCacheSize = 0;
-    dispatch_sync(_accessControlQueue, ^{
-        maxCacheSize = [_cacheMetadata[kMaxCacheSize] unsignedIntegerValue] ?: kDefaultMaxCacheSize;
-    });
+    [self readIndexUsingBlock:^{
+        maxCacheSize = (NSUInteger)_index.maxCacheSize ?: kDefaultMaxCacheSize;
+    }];
     
     return maxCacheSize;
 }
@@ -134,13 +494,71 @@ static NSTimeInterval const kMaintenanceTimerInterval = (RK_TIME_MINUTE * 5.0);
 - (NSUInteger)cacheSize
 {
     __block NSUInteger cacheSize = 0;
-    dispatch_sync(_accessControlQueue, ^{
-        cacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue];
-    });
+    [self readIndexUsingBlock:^{
+        cacheSize = (NSUInteger)_index.totalSize;
+    }];
     
     return cacheSize;
 }
 
+- (void)setMaintenanceInterval:(NSTimeInterval)maintenanceInterval
+{
+    NSParameterAssert(maintenanceInterval >= 0.0);
+    
+    @synchronized(self) {
+        _maintenanceInterval = maintenanceInterval;
+        
+        if(_maintenanceTimer) {
+            dispatch_source_cancel(_maintenanceTimer);
+            _maintenanceTimer = nil;
+        }
+        
+        if(maintenanceInterval > 0.0) {
+            dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+            _maintenanceTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+            
+            dispatch_source_set_timer(_maintenanceTimer,
+                                      dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MIN(kInitialMaintenanceDelay, maintenanceInterval) * NSEC_PER_SEC)),
+                                      (uint64_t)(maintenanceInterval * NSEC_PER_SEC),
+                                      (uint64_t)(maintenanceInterval / 2.0 * NSEC_PER_SEC));
+            
+            __weak RKFileSystemCacheManager *weakSelf = self;
+            dispatch_source_set_event_handler(_maintenanceTimer, ^{
+                [weakSelf preformMaintenance];
+            });
+            
+            dispatch_resume(_maintenanceTimer);
+        }
+    }
+}
+
+- (NSTimeInterval)maintenanceInterval
+{
+    @synchronized(self) {
+        return _maintenanceInterval;
+    }
+}
+
+///Returns the size the cache must be kept within, taking the maximum total cache size into account.
+///
+///This method assumes it is called from a block that reads or changes the index.
+- (unsigned long long)budgetedMaxCacheSize
+{
+    return (unsigned long long)((_index.maxCacheSize ?: kDefaultMaxCacheSize) * _budgetShare);
+}
+
+#pragma mark - Statistics
+
+- (RKFileSystemCacheStatistics *)statistics
+{
+    return [_statisticsRecorder statistics];
+}
+
+- (void)resetStatistics
+{
+    [_statisticsRecorder reset];
+}
+
 #pragma mark - Maintenance
 
 void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
@@ -150,145 +568,836 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 #endif /* RoundaboutKit_EmitWarnings */
 }
 
-///Enumerates a given metadata hash and expunges any cache which has not been recently accessed.
-///
-/// \param  metadata    A copy of the cache metadata with the special keys removed.
-///
-- (void)removeExpiredCacheWithMetadata:(NSDictionary *)metadata
+///Records that a client of the cache manager has read from or written to it.
+- (void)noteForegroundOperation
 {
-    [metadata enumerateKeysAndObjectsUsingBlock:^(NSString *sanitizedIdentifier, NSDictionary *itemMetadata, BOOL *stop) {
-        NSDate *dateLastAccessed = itemMetadata[kLastAccessedDateKey];
-        if(!dateLastAccessed || -[dateLastAccessed timeIntervalSinceNow] > kExpirationInterval) {
-            NSError *error = nil;
-            if(![self removeCacheForSanitizedIdentifier:sanitizedIdentifier error:&error]) {
-                RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
-            }
-        }
-    }];
+    OSAtomicIncrement64Barrier(&_foregroundOperationCount);
 }
 
-///Checks if the cache has exceeded the limits set for it, subsequently
-///enumerating and expunging data until the cache is within acceptable limits.
-///
-/// \param  metadata    A copy of the cache metadata with the special keys removed.
+///Begins a slice of maintenance, first pausing for as long as the cache has been in use
+///since the last slice began, up to a limit, so that maintenance yields to clients.
 ///
-- (void)removeExcessCacheWithMetadata:(NSDictionary *)metadata
+/// \result The absolute time by which the slice should yield.
+- (CFAbsoluteTime)beginMaintenanceSlice
 {
-    //The accessors for these properties can deadlock.
-    NSUInteger maxCacheSize = [metadata[kMaxCacheSize] unsignedIntegerValue] ?: kDefaultMaxCacheSize;
-    NSUInteger cacheSize = [metadata[kCacheSize] unsignedIntegerValue];
-    
-    if(cacheSize > maxCacheSize) {
-        NSArray *weightedSanitizedIdentifiers = [metadata keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary *left, NSDictionary *right) {
-            return [left[kLastAccessedDateKey] compare:right[kLastAccessedDateKey]];
-        }];
+    NSTimeInterval pause = kMinimumMaintenancePause;
+    int64_t operationCount = OSAtomicAdd64Barrier(0, &_foregroundOperationCount);
+    while (operationCount != _maintenanceOperationCount && pause <= kMaximumMaintenancePause) {
+        _maintenanceOperationCount = operationCount;
         
-        for (NSString *sanitizedIdentifier in weightedSanitizedIdentifiers) {
-            NSDictionary *itemMetadata = metadata[sanitizedIdentifier];
-            
-            NSError *error = nil;
-            if(![self removeCacheForSanitizedIdentifier:sanitizedIdentifier error:&error]) {
-                RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
-            }
-            
-            cacheSize -= [itemMetadata[kDataSizeKey] unsignedIntegerValue];
-            
-            if(cacheSize <= maxCacheSize)
-                break;
-        }
+        [NSThread sleepForTimeInterval:pause];
+        
+        pause *= 2.0;
+        operationCount = OSAtomicAdd64Barrier(0, &_foregroundOperationCount);
     }
-}
-
-- (void)preformMaintenance
-{
-    __block NSMutableDictionary *metadataCopy = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        metadataCopy = [_cacheMetadata mutableCopy];
-    });
     
-    [metadataCopy removeObjectForKey:kMaxCacheSize];
-    [metadataCopy removeObjectForKey:kCacheSize];
+    _maintenanceOperationCount = operationCount;
     
-    [self removeExpiredCacheWithMetadata:metadataCopy];
-    [self removeExcessCacheWithMetadata:metadataCopy];
+    return CFAbsoluteTimeGetCurrent() + kMaintenanceSliceDuration;
 }
 
-#pragma mark - Internal
-
-///Writes the metadata dictionary to the file system.
-///
-///This method assumes it has been surrounded by a queue barrier.
-- (void)synchronizeMetadata
+///Removes the items described by a list of entries in slices, pausing between them as needed.
+- (void)removeEntriesInSlices:(NSArray *)entries reason:(RKFileSystemCacheEvictionReason)reason
 {
-    [_cacheMetadata writeToURL:_cacheMetadataLocation atomically:YES];
+    NSUInteger start = 0;
+    while (start < entries.count) {
+        CFAbsoluteTime deadline = [self beginMaintenanceSlice];
+        start += [self removeSliceOfEntries:entries startingAtIndex:start deadline:deadline reason:reason];
+    }
 }
 
-- (BOOL)removeCacheForSanitizedIdentifier:(NSString *)sanitizedIdentifier error:(NSError **)outError
+///Removes a slice of the items described by a list of entries, committing the
+///removal of every item in the slice to the index with a single write.
+///
+/// \param  entries     The entries of the items to remove, as they were when they were listed. Required.
+/// \param  start       The index of the first entry of the slice.
+/// \param  deadline    The absolute time after which the slice should cover no more entries.
+/// \param  reason      Why the items are being removed.
+///
+/// \result The number of entries the slice covered, at least one.
+///
+///A slice covers at most `kMaintenanceSliceItemLimit` entries. Items that have
+///been stored again since their entries were listed are skipped.
+- (NSUInteger)removeSliceOfEntries:(NSArray *)entries startingAtIndex:(NSUInteger)start deadline:(CFAbsoluteTime)deadline reason:(RKFileSystemCacheEvictionReason)reason
 {
-    NSParameterAssert(sanitizedIdentifier);
+    NSArray *slice = [entries subarrayWithRange:NSMakeRange(start, MIN(kMaintenanceSliceItemLimit, entries.count - start))];
+    NSMutableIndexSet *fileGuardIndexes = [NSMutableIndexSet indexSet];
+    for (RKFileSystemCacheEntry *entry in slice)
+        [fileGuardIndexes addIndex:[self fileGuardIndexForSanitizedIdentifier:entry.key]];
     
-    __block BOOL success = YES;
-    __block NSError *error = nil;
-    dispatch_barrier_sync(_accessControlQueue, ^{
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
+    __block NSUInteger coveredCount = 0;
+    with_locked_files(_fileGuards, fileGuardIndexes, ^{
+        NSMutableArray *currentEntries = [NSMutableArray arrayWithCapacity:slice.count];
+        [self readIndexUsingBlock:^{
+            for (RKFileSystemCacheEntry *entry in slice)
+                [currentEntries addObject:[[_index entryForKey:entry.key] copy] ?: [NSNull null]];
+        }];
         
-        if([[NSFileManager defaultManager] removeItemAtURL:dataLocation error:&error] || error.code == NSFileNoSuchFileError) {
-            NSUInteger newCacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue] - [_cacheMetadata[sanitizedIdentifier][kDataSizeKey] unsignedIntegerValue];
-            _cacheMetadata[kCacheSize] = @(newCacheSize);
+        //The data of shared and packed items is released after their entries are
+        //removed, the files of every other item are removed before their entries are.
+        NSMutableArray *removedKeys = [NSMutableArray arrayWithCapacity:slice.count];
+        NSMutableSet *releasedContentHashes = [NSMutableSet set];
+        for (; coveredCount < slice.count; coveredCount++) {
+            if(coveredCount > 0 && CFAbsoluteTimeGetCurrent() >= deadline)
+                break;
             
-            [_cacheMetadata removeObjectForKey:sanitizedIdentifier];
-            [self synchronizeMetadata];
+            RKFileSystemCacheEntry *entry = (currentEntries[coveredCount] != [NSNull null])? currentEntries[coveredCount] : nil;
+            if(!entry || !entries_describe_same_data(entry, slice[coveredCount]))
+                continue;
             
-            error = nil;
-        } else {
-            success = NO;
+            if(entry.contentHash) {
+                [releasedContentHashes addObject:entry.contentHash];
+            } else if(entry.segment == 0) {
+                NSError *error = nil;
+                if(![[NSFileManager defaultManager] removeItemAtURL:[self dataLocationForEntry:entry] error:&error] && error.code != NSFileNoSuchFileError) {
+                    RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
+                    continue;
+                }
+            }
+            
+            [removedKeys addObject:entry.key];
         }
+        
+        if(removedKeys.count == 0)
+            return;
+        
+        [self changeIndexUsingBlock:^{
+            [_index beginBatch];
+            for (NSString *key in removedKeys)
+                [_index removeEntryForKey:key];
+            [_index endBatch];
+        }];
+        
+        [_statisticsRecorder recordEvictionCount:removedKeys.count reason:reason];
+        
+        for (NSString *contentHash in releasedContentHashes)
+            [self releaseContentWithHash:contentHash];
     });
     
-    if(outError) *outError = error;
-    
-    return success;
+    return coveredCount;
 }
 
-#pragma mark - <RKURLRequestPromiseCacheManager>
-
-- (NSString *)revisionForIdentifier:(NSString *)identifier
+///Expunges any cache which has passed its expiration date, or which has
+///no expiration date and has not been accessed for the default interval.
+- (void)removeExpiredCache
 {
-    NSParameterAssert(identifier);
-    
-    __block NSString *revision = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        revision = _cacheMetadata[sanitizedIdentifier][kRevisionKey];
-    });
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval defaultExpirationInterval = self.defaultExpirationInterval;
+    __block NSArray *expiredEntries = nil;
+    [self changeIndexUsingBlock:^{
+        expiredEntries = [[_index entriesExpiringBefore:now] arrayByAddingObjectsFromArray:[_index entriesLastAccessedBefore:now - defaultExpirationInterval]];
+    }];
     
-    return revision;
+    [self removeEntriesInSlices:expiredEntries reason:kRKFileSystemCacheEvictionReasonExpiration];
 }
 
-- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)error
+///Checks if the cache has exceeded the limits set for it, subsequently
+///expunging the least recently used data until the cache is within acceptable limits.
+///
+///Writes keep the cache within its limits on their own, this is only
+///necessary after the maximum size of the cache has been lowered.
+- (void)removeExcessCache
 {
-    NSParameterAssert(identifier);
-    NSParameterAssert(revision);
+    __block NSArray *excessEntries = nil;
+    [self readIndexUsingBlock:^{
+        excessEntries = [_index entriesToEvictForMaxCacheSize:[self budgetedMaxCacheSize]];
+    }];
+    
+    [self removeEntriesInSlices:excessEntries reason:kRKFileSystemCacheEvictionReasonSize];
+}
+
+///Moves the items still in use out of segments that are mostly unused, and removes those segments.
+- (void)compactSegments
+{
+    __block RKFileSystemCacheSegmentStore *segments = nil;
+    [self readIndexUsingBlock:^{
+        segments = _segments;
+    }];
+    
+    //Segments never receive data once they are no longer active, so collecting their
+    //sizes before the entries guarantees every item in an inactive segment is seen.
+    //A shared cache never packs items, so none of its segments receive data.
+    uint32_t activeSegment = _shared? UINT32_MAX : segments.activeSegment;
+    NSDictionary *segmentSizes = [segments segmentSizes];
+    
+    __block NSArray *entries = nil;
+    [self readIndexUsingBlock:^{
+        entries = [_index allEntries];
+    }];
+    
+    //Content shared between items is counted and moved once.
+    NSMutableSet *seenContentHashes = [NSMutableSet set];
+    NSMutableDictionary *liveSizes = [NSMutableDictionary dictionary];
+    NSMutableDictionary *liveEntries = [NSMutableDictionary dictionary];
+    for (RKFileSystemCacheEntry *entry in entries) {
+        if(entry.segment == 0 || (entry.contentHash && [seenContentHashes containsObject:entry.contentHash]))
+            continue;
+        
+        if(entry.contentHash)
+            [seenContentHashes addObject:entry.contentHash];
+        
+        liveSizes[@(entry.segment)] = @([liveSizes[@(entry.segment)] unsignedLongLongValue] + entry.dataSize);
+        
+        NSMutableArray *entriesInSegment = liveEntries[@(entry.segment)] ?: (liveEntries[@(entry.segment)] = [NSMutableArray array]);
+        [entriesInSegment addObject:entry];
+    }
+    
+    __block CFAbsoluteTime deadline = 0.0;
+    __block NSUInteger sliceItemCount = kMaintenanceSliceItemLimit;
+    [segmentSizes enumerateKeysAndObjectsUsingBlock:^(NSNumber *segment, NSNumber *segmentSize, BOOL *stop) {
+        if(segment.unsignedIntValue >= activeSegment)
+            return;
+        
+        unsigned long long liveSize = [liveSizes[segment] unsignedLongLongValue];
+        if(liveSize > segmentSize.unsignedLongLongValue * kSegmentCompactionThreshold)
+            return;
+        
+        for (RKFileSystemCacheEntry *entry in liveEntries[segment]) {
+            if(sliceItemCount >= kMaintenanceSliceItemLimit || CFAbsoluteTimeGetCurrent() >= deadline) {
+                deadline = [self beginMaintenanceSlice];
+                sliceItemCount = 0;
+            }
+            
+            sliceItemCount++;
+            if(![self moveEntryOutOfSegment:entry])
+                return;
+        }
+        
+        //The cache may have been cleared, and its segments replaced, in the meantime.
+        __block BOOL isCurrent = NO;
+        [self readIndexUsingBlock:^{
+            isCurrent = (segments == _segments);
+        }];
+        
+        if(isCurrent)
+            [segments removeSegment:segment.unsignedIntValue];
+    }];
+}
+
+///Appends the data of an item to the active segment, returning whether or not the item no longer
+///references its original segment. Items that were changed after `entry` was copied are skipped.
+///
+///Every item that shares the item's content is moved along with it. A shared cache moves
+///items into files of their own instead, as it never appends to segments.
+- (BOOL)moveEntryOutOfSegment:(RKFileSystemCacheEntry *)entry
+{
+    pthread_mutex_t *guard = entry.contentHash? [self contentGuardForContentHash:entry.contentHash] : [self fileGuardForSanitizedIdentifier:entry.key];
     
     __block BOOL success = YES;
+    with_locked_file(guard, ^{
+        __block RKFileSystemCacheEntry *currentEntry = nil;
+        [self readIndexUsingBlock:^{
+            if(entry.contentHash)
+                currentEntry = [[_index entryForContentHash:entry.contentHash] copy];
+            else
+                currentEntry = [[_index entryForKey:entry.key] copy];
+        }];
+        
+        if(!currentEntry || currentEntry.segment != entry.segment || currentEntry.offset != entry.offset)
+            return;
+        
+        NSData *data = [_segments dataInSegment:entry.segment offset:entry.offset length:(NSUInteger)entry.dataSize];
+        uint32_t segment = 0;
+        unsigned long long offset = 0;
+        NSError *error = nil;
+        BOOL moved = NO;
+        if(_shared) {
+            currentEntry.segment = 0;
+            currentEntry.offset = 0;
+            moved = (data && [data writeToURL:[self dataLocationForEntry:currentEntry] options:NSAtomicWrite error:&error]);
+        } else {
+            moved = (data && [_segments appendData:data segment:&segment offset:&offset error:&error]);
+        }
+        
+        if(!moved) {
+            RKLogWarning(@"Could not move cached data out of segment %u. %@", entry.segment, error);
+            success = NO;
+            return;
+        }
+        
+        [self changeIndexUsingBlock:^{
+            if(entry.contentHash)
+                [_index moveContentWithHash:entry.contentHash toSegment:segment offset:offset];
+            else
+                [_index moveEntryForKey:entry.key toSegment:segment offset:offset];
+        }];
+    });
+    
+    return success;
+}
+
+///Expunges any partial data which has not been modified recently.
+- (void)removeExpiredPartialData
+{
+    NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:_cacheLocation
+                                                      includingPropertiesForKeys:@[NSURLContentModificationDateKey]
+                                                                         options:NSDirectoryEnumerationSkipsHiddenFiles
+                                                                           error:NULL];
+    for (NSURL *location in contents) {
+        if(![location.pathExtension isEqualToString:kPartialDataExtension])
+            continue;
+        
+        NSString *sanitizedIdentifier = [[location URLByDeletingPathExtension] lastPathComponent];
+        with_locked_file([self fileGuardForSanitizedIdentifier:sanitizedIdentifier], ^{
+            NSDate *modificationDate = nil;
+            [location getResourceValue:&modificationDate forKey:NSURLContentModificationDateKey error:NULL];
+            if(!modificationDate || -[modificationDate timeIntervalSinceNow] > kPartialDataExpirationInterval) {
+                NSError *error = nil;
+                if(![[NSFileManager defaultManager] removeItemAtURL:location error:&error] && error.code != NSFileNoSuchFileError)
+                    RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
+                
+                [[NSFileManager defaultManager] removeItemAtURL:[[location URLByDeletingPathExtension] URLByAppendingPathExtension:kPartialValidatorExtension] error:NULL];
+            }
+        });
+    }
+}
+
+- (void)preformMaintenance
+{
+    //A pass still pausing for a busy cache when the next one is due is left to finish.
+    if(!OSAtomicCompareAndSwap32Barrier(0, 1, &_isPerformingMaintenance))
+        return;
+    
+    @try {
+        [self removeExpiredCache];
+        [self removeExcessCache];
+        [self removeExpiredPartialData];
+        [self compactSegments];
+    } @finally {
+        OSAtomicCompareAndSwap32Barrier(1, 0, &_isPerformingMaintenance);
+    }
+}
+
+#pragma mark - Internal
+
+///Performs a block that only reads the index, concurrently with any other such blocks.
+///
+///A shared cache first catches up with the changes made by other processes, if there are any.
+- (void)readIndexUsingBlock:(dispatch_block_t)block
+{
+    __block BOOL isStale = NO;
+    dispatch_sync(_accessControlQueue, ^{
+        isStale = [_index hasChangesFromOtherProcesses];
+        if(!isStale)
+            block();
+    });
+    
+    if(isStale) {
+        dispatch_barrier_sync(_accessControlQueue, ^{
+            RKFileSystemCacheIndex *index = _index;
+            [index lockExclusively:NO];
+            @try {
+                block();
+            } @finally {
+                [index unlock];
+            }
+        });
+    }
+}
+
+///Performs a block that changes the index, excluding every other block.
+///
+///A shared cache performs the block while holding the directory's exclusive lock,
+///after catching up with the changes made by other processes.
+- (void)changeIndexUsingBlock:(dispatch_block_t)block
+{
     dispatch_barrier_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
+        //The index may be replaced by the block.
+        RKFileSystemCacheIndex *index = _index;
+        [index lockExclusively:YES];
+        @try {
+            block();
+        } @finally {
+            [index unlock];
+        }
+    });
+}
+
+///Performs a block that changes the index asynchronously, excluding every other block.
+- (void)changeIndexAsynchronouslyUsingBlock:(dispatch_block_t)block
+{
+    dispatch_barrier_async(_accessControlQueue, ^{
+        RKFileSystemCacheIndex *index = _index;
+        [index lockExclusively:YES];
+        @try {
+            block();
+        } @finally {
+            [index unlock];
+        }
+    });
+}
+
+///Returns the sanitized identifier for a given identifier, migrating any item stored
+///under the MD5-derived identifier used by earlier versions the first time it is asked for.
+- (NSString *)sanitizedIdentifierForIdentifier:(NSString *)identifier
+{
+    NSString *sanitizedIdentifier = [_sanitizedIdentifiers objectForKey:identifier];
+    if(sanitizedIdentifier)
+        return sanitizedIdentifier;
+    
+    sanitizedIdentifier = RKStringGetFastHash(identifier);
+    
+    __block BOOL hasLegacyEntries = NO;
+    [self readIndexUsingBlock:^{
+        hasLegacyEntries = _index.hasLegacyEntries;
+    }];
+    
+    if(hasLegacyEntries)
+        [self migrateLegacyCacheForSanitizedIdentifier:RKStringGetMD5Hash(identifier) toSanitizedIdentifier:sanitizedIdentifier];
+    
+    [_sanitizedIdentifiers setObject:sanitizedIdentifier forKey:identifier];
+    
+    return sanitizedIdentifier;
+}
+
+///Moves the item and partial data stored under a legacy sanitized identifier to a new sanitized identifier.
+///
+///If an item is already stored under the new identifier, the legacy item is removed instead.
+- (void)migrateLegacyCacheForSanitizedIdentifier:(NSString *)legacyIdentifier toSanitizedIdentifier:(NSString *)sanitizedIdentifier
+{
+    //Guards are always taken in address order so that two migrations can never deadlock.
+    pthread_mutex_t *legacyGuard = [self fileGuardForSanitizedIdentifier:legacyIdentifier];
+    pthread_mutex_t *fileGuard = [self fileGuardForSanitizedIdentifier:sanitizedIdentifier];
+    pthread_mutex_t *firstGuard = MIN(legacyGuard, fileGuard);
+    pthread_mutex_t *secondGuard = MAX(legacyGuard, fileGuard);
+    
+    with_locked_file(firstGuard, ^{
+        if(secondGuard != firstGuard)
+            pthread_mutex_lock(secondGuard);
         
-        if([data writeToURL:dataLocation options:NSAtomicWrite error:error]) {
-            _cacheMetadata[sanitizedIdentifier] = @{ kRevisionKey: revision,
-                                                     kLastAccessedDateKey: [NSDate date],
-                                                     kDataSizeKey: @(data.length) };
+        @try {
+            __block RKFileSystemCacheEntry *legacyEntry = nil;
+            __block BOOL hasCurrentEntry = NO;
+            [self readIndexUsingBlock:^{
+                if([_index isLegacyEntryForKey:legacyIdentifier])
+                    legacyEntry = [[_index entryForKey:legacyIdentifier] copy];
+                
+                hasCurrentEntry = ([_index entryForKey:sanitizedIdentifier] != nil);
+            }];
             
-            NSUInteger newCacheSize = [_cacheMetadata[kCacheSize] unsignedIntegerValue] + data.length;
-            _cacheMetadata[kCacheSize] = @(newCacheSize);
+            if(legacyEntry) {
+                NSError *error = nil;
+                BOOL moved = !hasCurrentEntry;
+                if(moved && legacyEntry.segment == 0) {
+                    moved = [[NSFileManager defaultManager] moveItemAtURL:[_cacheLocation URLByAppendingPathComponent:legacyIdentifier]
+                                                                    toURL:[_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier]
+                                                                    error:&error];
+                    if(!moved)
+                        RKLogWarning(@"Could not migrate cached data for %@. %@", legacyIdentifier, error);
+                }
+                
+                if(moved) {
+                    legacyEntry.key = sanitizedIdentifier;
+                    [self changeIndexUsingBlock:^{
+                        [_index removeEntryForKey:legacyIdentifier];
+                        [_index setEntry:legacyEntry];
+                    }];
+                } else if(![self removeLockedCacheForSanitizedIdentifier:legacyIdentifier reason:kEvictionReasonReplacement error:&error]) {
+                    RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
+                }
+            }
             
-            [self synchronizeMetadata];
+            for (NSString *extension in @[ kPartialDataExtension, kPartialValidatorExtension ]) {
+                NSURL *legacyLocation = [[_cacheLocation URLByAppendingPathComponent:legacyIdentifier] URLByAppendingPathExtension:extension];
+                NSURL *location = [[_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier] URLByAppendingPathExtension:extension];
+                if(![[NSFileManager defaultManager] moveItemAtURL:legacyLocation toURL:location error:NULL])
+                    [[NSFileManager defaultManager] removeItemAtURL:legacyLocation error:NULL];
+            }
+        } @finally {
+            if(secondGuard != firstGuard)
+                pthread_mutex_unlock(secondGuard);
+        }
+    });
+}
+
+///Returns the index of the lock that serializes changes to the files of a given item.
+- (NSUInteger)fileGuardIndexForSanitizedIdentifier:(NSString *)sanitizedIdentifier
+{
+    return [sanitizedIdentifier hash] % kFileGuardCount;
+}
+
+///Returns the lock that serializes changes to the files of a given item.
+- (pthread_mutex_t *)fileGuardForSanitizedIdentifier:(NSString *)sanitizedIdentifier
+{
+    return &_fileGuards[[self fileGuardIndexForSanitizedIdentifier:sanitizedIdentifier]];
+}
+
+///Returns the index of the lock that serializes storing and releasing the content with a given hash.
+- (NSUInteger)contentGuardIndexForContentHash:(NSString *)contentHash
+{
+    return [contentHash hash] % kFileGuardCount;
+}
+
+///Returns the lock that serializes storing and releasing the content with a given hash.
+- (pthread_mutex_t *)contentGuardForContentHash:(NSString *)contentHash
+{
+    return &_contentGuards[[self contentGuardIndexForContentHash:contentHash]];
+}
+
+///Returns the location of the file an item's data is stored in when it is not packed into a segment.
+- (NSURL *)dataLocationForEntry:(RKFileSystemCacheEntry *)entry
+{
+    if(entry.contentHash)
+        return [[_cacheLocation URLByAppendingPathComponent:entry.contentHash] URLByAppendingPathExtension:kContentExtension];
+    else
+        return [_cacheLocation URLByAppendingPathComponent:entry.key];
+}
+
+///Reads the data of an item from its file or segment.
+- (NSData *)dataForEntry:(RKFileSystemCacheEntry *)entry inSegments:(RKFileSystemCacheSegmentStore *)segments error:(NSError **)outError
+{
+    if(entry.segment == 0) {
+        //Items are only ever replaced by atomic renames or unlinked, never modified in place,
+        //so a mapping keeps referencing the original file's contents until it is deallocated
+        //even if the item is replaced or removed in the meantime.
+        return [NSData dataWithContentsOfURL:[self dataLocationForEntry:entry] options:NSDataReadingMappedIfSafe error:outError];
+    } else {
+        return [segments dataInSegment:entry.segment offset:entry.offset length:(NSUInteger)entry.dataSize];
+    }
+}
+
+///Reads the data of an item, decompressing it if it is stored compressed.
+- (NSData *)contentsOfEntry:(RKFileSystemCacheEntry *)entry inSegments:(RKFileSystemCacheSegmentStore *)segments error:(NSError **)outError
+{
+    NSData *data = [self dataForEntry:entry inSegments:segments error:outError];
+    if(!data || !entry.compressed)
+        return data;
+    
+    return RKFileSystemCacheDecompressData(data, outError);
+}
+
+///Returns the data an item should be stored as, compressing it if the receiver compresses data
+///and it is worth compressing, and fills in the size, content hash and compression of its entry.
+- (NSData *)storedDataForData:(NSData *)data entry:(RKFileSystemCacheEntry *)entry
+{
+    NSData *compressedData = nil;
+    if(self.compressesData && data.length >= self.compressionThreshold && !RKFileSystemCacheDataIsCompressed(data))
+        compressedData = RKFileSystemCacheCompressData(data);
+    
+    NSData *storedData = compressedData ?: data;
+    entry.compressed = (compressedData != nil);
+    entry.dataSize = storedData.length;
+    entry.contentHash = RKDataGetFastHash(storedData);
+    
+    return storedData;
+}
+
+///Points an item at existing identical content if there is any, or stores its data otherwise.
+///
+/// \param  data        The data of the item. Required.
+/// \param  entry       The entry of the item. Its location is filled in.
+/// \param  outError    On return, an error describing why the data could not be stored.
+///
+/// \result YES if the item's data is stored; NO otherwise.
+///
+///This method assumes the content guard of the item's content hash is held.
+- (BOOL)storeData:(NSData *)data forEntry:(RKFileSystemCacheEntry *)entry error:(NSError **)outError
+{
+    __block RKFileSystemCacheEntry *existingEntry = nil;
+    __block RKFileSystemCacheSegmentStore *segments = nil;
+    [self readIndexUsingBlock:^{
+        if(entry.contentHash)
+            existingEntry = [[_index entryForContentHash:entry.contentHash] copy];
+        
+        segments = _segments;
+    }];
+    
+    if(existingEntry) {
+        if(existingEntry.compressed == entry.compressed && [[self dataForEntry:existingEntry inSegments:segments error:NULL] isEqualToData:data]) {
+            entry.segment = existingEntry.segment;
+            entry.offset = existingEntry.offset;
+            return YES;
+        }
+        
+        //The content hash isn't cryptographic, so content is compared before it is shared.
+        //An item that collides with, or can't be compared against, existing content is
+        //stored on its own.
+        entry.contentHash = nil;
+    }
+    
+    //Small items are appended to a segment, large items are written atomically
+    //to their own files. Either way, concurrent readers always see complete data.
+    //Segments are only coordinated within a process, so a shared cache never packs.
+    if(!_shared && data.length <= RKFileSystemCacheSegmentStoreMaximumPackedDataLength) {
+        uint32_t segment = 0;
+        unsigned long long offset = 0;
+        if(![segments appendData:data segment:&segment offset:&offset error:outError])
+            return NO;
+        
+        entry.segment = segment;
+        entry.offset = offset;
+    } else {
+        if(![data writeToURL:[self dataLocationForEntry:entry] options:NSAtomicWrite error:outError])
+            return NO;
+    }
+    
+    [_statisticsRecorder recordBytesWritten:data.length];
+    
+    return YES;
+}
+
+///Writes the data of an item again if another process removed its file after it was stored.
+///
+///Files are only removed by a shared cache while it holds the directory's lock, so calling this
+///while holding the lock, just before the index is pointed at the item, guarantees the item's data exists.
+- (BOOL)restoreData:(NSData *)data forEntry:(RKFileSystemCacheEntry *)entry error:(NSError **)outError
+{
+    if(!_shared || entry.segment != 0)
+        return YES;
+    
+    NSURL *dataLocation = [self dataLocationForEntry:entry];
+    if([dataLocation checkResourceIsReachableAndReturnError:NULL])
+        return YES;
+    
+    if(![data writeToURL:dataLocation options:NSAtomicWrite error:outError])
+        return NO;
+    
+    [_statisticsRecorder recordBytesWritten:data.length];
+    
+    return YES;
+}
+
+///Removes the file of the content with a given hash if no items reference it any longer.
+///
+///Packed content is left in its segment until the segment is compacted.
+- (void)releaseContentWithHash:(NSString *)contentHash
+{
+    with_locked_file([self contentGuardForContentHash:contentHash], ^{
+        NSURL *contentLocation = [[_cacheLocation URLByAppendingPathComponent:contentHash] URLByAppendingPathExtension:kContentExtension];
+        dispatch_block_t removeContent = ^{
+            NSError *error = nil;
+            if(![[NSFileManager defaultManager] removeItemAtURL:contentLocation error:&error] && error.code != NSFileNoSuchFileError)
+                RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
+        };
+        
+        //Another process may point an item at the content at any moment, so
+        //a shared cache only removes it while holding the directory's lock.
+        if(_shared) {
+            [self changeIndexUsingBlock:^{
+                if([_index referenceCountForContentHash:contentHash] == 0)
+                    removeContent();
+            }];
         } else {
-            success = NO;
+            __block NSUInteger referenceCount = 0;
+            [self readIndexUsingBlock:^{
+                referenceCount = [_index referenceCountForContentHash:contentHash];
+            }];
+            
+            if(referenceCount == 0)
+                removeContent();
+        }
+    });
+}
+
+///Removes the data and index entry of an item.
+///
+/// \param  sanitizedIdentifier The sanitized identifier of the item. Required.
+/// \param  reason              Why the item is being removed. Recorded if the item exists.
+/// \param  outError            On return, an error describing why the item could not be removed.
+///
+/// \result YES if the item was removed or did not exist; NO otherwise.
+///
+///This method assumes the item's file guard is held.
+- (BOOL)removeLockedCacheForSanitizedIdentifier:(NSString *)sanitizedIdentifier reason:(RKFileSystemCacheEvictionReason)reason error:(NSError **)outError
+{
+    __block RKFileSystemCacheEntry *entry = nil;
+    [self readIndexUsingBlock:^{
+        entry = [[_index entryForKey:sanitizedIdentifier] copy];
+    }];
+    
+    //Removing an item that was never stored, as happens after every miss, touches
+    //neither the file system nor the index. A file left behind by a write that
+    //never reached the index is replaced by the next write of the item.
+    if(!entry)
+        return YES;
+    
+    if(reason != kEvictionReasonReplacement)
+        [_statisticsRecorder recordEvictionCount:1 reason:reason];
+    
+    if(entry.contentHash) {
+        [self changeIndexUsingBlock:^{
+            [_index removeEntryForKey:sanitizedIdentifier];
+        }];
+        
+        [self releaseContentWithHash:entry.contentHash];
+        
+        return YES;
+    }
+    
+    //The data of packed items is left in its segment until the segment is compacted.
+    NSError *error = nil;
+    NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
+    if(entry.segment != 0 || [[NSFileManager defaultManager] removeItemAtURL:dataLocation error:&error] || error.code == NSFileNoSuchFileError) {
+        [self changeIndexUsingBlock:^{
+            [_index removeEntryForKey:sanitizedIdentifier];
+        }];
+        
+        return YES;
+    } else {
+        if(outError) *outError = error;
+        
+        return NO;
+    }
+}
+
+- (BOOL)removeCacheForSanitizedIdentifier:(NSString *)sanitizedIdentifier reason:(RKFileSystemCacheEvictionReason)reason error:(NSError **)outError
+{
+    NSParameterAssert(sanitizedIdentifier);
+    
+    __block BOOL success = YES;
+    __block NSError *error = nil;
+    with_locked_file([self fileGuardForSanitizedIdentifier:sanitizedIdentifier], ^{
+        success = [self removeLockedCacheForSanitizedIdentifier:sanitizedIdentifier reason:reason error:&error];
+    });
+    
+    if(outError) *outError = error;
+    
+    return success;
+}
+
+///Removes the items that must be evicted to make room for new items.
+///
+/// \param  entries     The entries to evict.
+/// \param  heldGuards  The indexes of the file guards held by the caller.
+///
+///Items whose file guards are held by another thread are being changed, and are skipped.
+- (void)evictEntries:(NSArray *)entries holdingFileGuards:(NSIndexSet *)heldGuards
+{
+    for (RKFileSystemCacheEntry *entry in entries) {
+        NSUInteger fileGuardIndex = [self fileGuardIndexForSanitizedIdentifier:entry.key];
+        BOOL isHeld = [heldGuards containsIndex:fileGuardIndex];
+        if(!isHeld && pthread_mutex_trylock(&_fileGuards[fileGuardIndex]) != 0)
+            continue;
+        
+        NSError *error = nil;
+        if(![self removeLockedCacheForSanitizedIdentifier:entry.key reason:kRKFileSystemCacheEvictionReasonSize error:&error])
+            RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(error);
+        
+        if(!isHeld)
+            pthread_mutex_unlock(&_fileGuards[fileGuardIndex]);
+    }
+}
+
+///Removes the data an item no longer needs after its entry has been replaced.
+///
+///This method assumes the item's file guard is held, and that no content guard is.
+- (void)releasePreviousEntry:(RKFileSystemCacheEntry *)previousEntry replacedByEntry:(RKFileSystemCacheEntry *)entry
+{
+    if(previousEntry.contentHash) {
+        if(![previousEntry.contentHash isEqualToString:entry.contentHash])
+            [self releaseContentWithHash:previousEntry.contentHash];
+    } else if(previousEntry.segment == 0 && (entry.contentHash || entry.segment != 0)) {
+        [[NSFileManager defaultManager] removeItemAtURL:[self dataLocationForEntry:previousEntry] error:NULL];
+    }
+}
+
+#pragma mark - <RKURLRequestPromiseCacheManager>
+
+- (NSString *)revisionForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+    
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    __block NSString *revision = nil;
+    [self readIndexUsingBlock:^{
+        revision = [_index entryForKey:sanitizedIdentifier].revision;
+    }];
+    
+    return revision;
+}
+
+- (void)noteRevalidationForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+    
+    [_statisticsRecorder recordRevalidation];
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)error
+{
+    return [self cacheData:data forIdentifier:identifier withRevision:revision expirationDate:nil error:error];
+}
+
+- (NSDate *)expirationDateForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+    
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    __block NSTimeInterval expirationTime = 0.0;
+    [self readIndexUsingBlock:^{
+        expirationTime = [_index entryForKey:sanitizedIdentifier].expirationTime;
+    }];
+    
+    return (expirationTime != 0.0)? [NSDate dateWithTimeIntervalSinceReferenceDate:expirationTime] : nil;
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate error:(NSError **)error
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    
+    [self noteForegroundOperation];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+    entry.key = sanitizedIdentifier;
+    entry.revision = revision;
+    entry.expirationTime = [expirationDate timeIntervalSinceReferenceDate];
+    NSData *storedData = [self storedDataForData:data entry:entry];
+    NSString *contentHash = entry.contentHash;
+    
+    BOOL byFrequency = (self.evictionPolicy == kRKFileSystemCacheEvictionPolicyFrequencyFiltered);
+    
+    __block BOOL success = YES;
+    __block BOOL declined = NO;
+    NSUInteger fileGuardIndex = [self fileGuardIndexForSanitizedIdentifier:sanitizedIdentifier];
+    with_locked_file(&_fileGuards[fileGuardIndex], ^{
+        __block NSArray *victims = nil;
+        [self changeIndexUsingBlock:^{
+            victims = [_index admitEntryWithKey:sanitizedIdentifier contentHash:contentHash dataSize:storedData.length maxCacheSize:[self budgetedMaxCacheSize] byFrequency:byFrequency];
+        }];
+        
+        //Declining to store an item is not an error, the item is simply fetched
+        //again the next time it is needed. Any older revision is stale, however.
+        if(!victims) {
+            [self removeLockedCacheForSanitizedIdentifier:sanitizedIdentifier reason:kEvictionReasonReplacement error:NULL];
+            declined = YES;
+            return;
         }
+        
+        [self evictEntries:victims holdingFileGuards:[NSIndexSet indexSetWithIndex:fileGuardIndex]];
+        
+        entry.lastAccessTime = [NSDate timeIntervalSinceReferenceDate];
+        
+        __block RKFileSystemCacheEntry *previousEntry = nil;
+        with_locked_file([self contentGuardForContentHash:contentHash], ^{
+            success = [self storeData:storedData forEntry:entry error:error];
+            if(!success)
+                return;
+            
+            [self changeIndexUsingBlock:^{
+                success = [self restoreData:storedData forEntry:entry error:error];
+                if(!success)
+                    return;
+                
+                previousEntry = [[_index entryForKey:sanitizedIdentifier] copy];
+                [_index setEntry:entry];
+            }];
+        });
+        
+        if(!success || !previousEntry)
+            return;
+        
+        //The content guard is released first, as the previous content may share it.
+        [self releasePreviousEntry:previousEntry replacedByEntry:entry];
     });
     
+    if(success)
+        [_statisticsRecorder recordWriteStored:!declined latency:CFAbsoluteTimeGetCurrent() - startTime];
+    
     return success;
 }
 
@@ -296,30 +1405,40 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 {
     NSParameterAssert(identifier);
     
-    __block NSError *error = nil;
-    __block NSData *data = nil;
-    dispatch_sync(_accessControlQueue, ^{
-        NSString *sanitizedIdentifier = RKStringGetMD5Hash(identifier);
-        NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier];
-        data = [NSData dataWithContentsOfURL:dataLocation options:0 error:&error];
-        
-        NSMutableDictionary *itemMetadata = [_cacheMetadata[sanitizedIdentifier] mutableCopy];
-        if(itemMetadata) {
-            NSDate *lastAccessed = itemMetadata[kLastAccessedDateKey];
-            itemMetadata[kLastAccessedDateKey] = [NSDate date];
-            _cacheMetadata[sanitizedIdentifier] = itemMetadata;
-            if(!lastAccessed || -[lastAccessed timeIntervalSinceNow] >= kExpirationInterval / 2.0) {
-                dispatch_barrier_async(_accessControlQueue, ^{
-                    [self synchronizeMetadata];
-                });
-            }
-        }
-    });
+    [self noteForegroundOperation];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    //An item may be moved out of its segment by maintenance while it is being read,
+    //so a read that fails is retried once with the item's current location.
+    NSError *error = nil;
+    NSData *data = nil;
+    for (NSUInteger attempt = 0; attempt < 2 && !data; attempt++) {
+        __block RKFileSystemCacheEntry *entry = nil;
+        __block RKFileSystemCacheSegmentStore *segments = nil;
+        [self readIndexUsingBlock:^{
+            entry = [[_index entryForKey:sanitizedIdentifier] copy];
+            segments = _segments;
+        }];
+        
+        error = nil;
+        if(!entry)
+            break;
+        
+        data = [self contentsOfEntry:entry inSegments:segments error:&error];
+    }
+    
+    [_statisticsRecorder recordReadOfLength:data.length hit:(data != nil) latency:CFAbsoluteTimeGetCurrent() - startTime];
     
     if(data) {
+        NSTimeInterval accessTime = [NSDate timeIntervalSinceReferenceDate];
+        [self changeIndexAsynchronouslyUsingBlock:^{
+            [_index touchEntryForKey:sanitizedIdentifier atTime:accessTime];
+        }];
+        
         return data;
     } else {
-        if(error.code == NSFileReadNoSuchFileError) {
+        if(!error || error.code == NSFileReadNoSuchFileError) {
             return nil;
         } else {
             if(outError) *outError = error;
@@ -332,24 +1451,680 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
 {
     NSParameterAssert(identifier);
     
-    return [self removeCacheForSanitizedIdentifier:RKStringGetMD5Hash(identifier) error:outError];
+    return [self removeCacheForSanitizedIdentifier:[self sanitizedIdentifierForIdentifier:identifier] reason:kRKFileSystemCacheEvictionReasonManual error:outError];
 }
 
 - (BOOL)removeAllCache:(NSError **)outError
 {
+    for (NSUInteger index = 0; index < kFileGuardCount; index++)
+        pthread_mutex_lock(&_fileGuards[index]);
+    
+    for (NSUInteger index = 0; index < kFileGuardCount; index++)
+        pthread_mutex_lock(&_contentGuards[index]);
+    
     __block BOOL success = YES;
     __block NSError *error = nil;
-    dispatch_barrier_sync(_accessControlQueue, ^{
+    __block NSUInteger removedCount = 0;
+    [self changeIndexUsingBlock:^{
+        removedCount = _index.count;
+        
+        //The directory and index of a shared cache are in use by other processes, so
+        //they are emptied in place rather than being removed and created anew.
+        if(_shared) {
+            NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:_cacheLocation includingPropertiesForKeys:nil options:0 error:&error];
+            NSSet *indexFileNames = [RKFileSystemCacheIndex fileNames];
+            for (NSURL *location in contents) {
+                NSError *removeError = nil;
+                if(![indexFileNames containsObject:location.lastPathComponent] &&
+                   ![[NSFileManager defaultManager] removeItemAtURL:location error:&removeError] && removeError.code != NSFileNoSuchFileError) {
+                    success = NO;
+                    error = removeError;
+                }
+            }
+            
+            success = success && (contents != nil);
+            if(!success)
+                removedCount = 0;
+            
+            [_index removeAllEntries];
+            _segments = [[RKFileSystemCacheSegmentStore alloc] initWithDirectory:_cacheLocation];
+            
+            return;
+        }
+        
         if([[NSFileManager defaultManager] removeItemAtURL:_cacheLocation error:&error] || error.code == NSFileNoSuchFileError) {
-            NSNumber *maxCacheSize = _cacheMetadata[kMaxCacheSize] ?: @(kDefaultMaxCacheSize);
-            [_cacheMetadata removeAllObjects];
-            _cacheMetadata[kMaxCacheSize] = maxCacheSize;
-            [self synchronizeMetadata];
+            [self createCacheDirectory];
+            
+            unsigned long long maxCacheSize = _index.maxCacheSize;
+            _index = [[RKFileSystemCacheIndex alloc] initWithDirectory:_cacheLocation];
+            _segments = [[RKFileSystemCacheSegmentStore alloc] initWithDirectory:_cacheLocation];
+            if(maxCacheSize != 0)
+                _index.maxCacheSize = maxCacheSize;
             
             error = nil;
         } else {
+            removedCount = 0;
             success = NO;
         }
+    }];
+    
+    [_statisticsRecorder recordEvictionCount:removedCount reason:kRKFileSystemCacheEvictionReasonManual];
+    
+    for (NSUInteger index = kFileGuardCount; index > 0; index--)
+        pthread_mutex_unlock(&_contentGuards[index - 1]);
+    
+    for (NSUInteger index = kFileGuardCount; index > 0; index--)
+        pthread_mutex_unlock(&_fileGuards[index - 1]);
+    
+    if(outError) *outError = error;
+    
+    return success;
+}
+
+#pragma mark - Batch Operations
+
+- (NSDictionary *)cachedDataForIdentifiers:(NSArray *)identifiers error:(NSError **)outError
+{
+    NSParameterAssert(identifiers);
+    
+    [self noteForegroundOperation];
+    
+    NSMutableDictionary *identifiersBySanitizedIdentifier = [NSMutableDictionary dictionaryWithCapacity:identifiers.count];
+    for (NSString *identifier in identifiers)
+        identifiersBySanitizedIdentifier[[self sanitizedIdentifierForIdentifier:identifier]] = identifier;
+    
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity:identifiersBySanitizedIdentifier.count];
+    __block RKFileSystemCacheSegmentStore *segments = nil;
+    [self readIndexUsingBlock:^{
+        for (NSString *sanitizedIdentifier in identifiersBySanitizedIdentifier) {
+            RKFileSystemCacheEntry *entry = [_index entryForKey:sanitizedIdentifier];
+            if(entry)
+                [entries addObject:[entry copy]];
+        }
+        
+        segments = _segments;
+    }];
+    
+    //Items read again on their own are recorded by that read.
+    for (NSUInteger missCount = identifiersBySanitizedIdentifier.count - entries.count; missCount > 0; missCount--)
+        [_statisticsRecorder recordReadOfLength:0 hit:NO latency:-1.0];
+    
+    NSMutableDictionary *results = [NSMutableDictionary dictionaryWithCapacity:entries.count];
+    NSMutableArray *hitKeys = [NSMutableArray arrayWithCapacity:entries.count];
+    __block NSError *error = nil;
+    dispatch_apply(entries.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+        RKFileSystemCacheEntry *entry = entries[index];
+        NSString *identifier = identifiersBySanitizedIdentifier[entry.key];
+        
+        //An item may be moved out of its segment by maintenance while it is being
+        //read, in which case it is read again on its own from its current location.
+        NSError *readError = nil;
+        NSData *data = [self contentsOfEntry:entry inSegments:segments error:NULL];
+        if(data)
+            [_statisticsRecorder recordReadOfLength:data.length hit:YES latency:-1.0];
+        else
+            data = [self cachedDataForIdentifier:identifier error:&readError];
+        
+        @synchronized(results) {
+            if(data) {
+                results[identifier] = data;
+                [hitKeys addObject:entry.key];
+            } else if(readError && !error) {
+                error = readError;
+            }
+        }
+    });
+    
+    if(hitKeys.count > 0) {
+        NSTimeInterval accessTime = [NSDate timeIntervalSinceReferenceDate];
+        [self changeIndexAsynchronouslyUsingBlock:^{
+            [_index beginBatch];
+            for (NSString *key in hitKeys)
+                [_index touchEntryForKey:key atTime:accessTime];
+            [_index endBatch];
+        }];
+    }
+    
+    if(outError) *outError = error;
+    
+    return results;
+}
+
+- (BOOL)cacheDataForIdentifiers:(NSDictionary *)dataByIdentifier withRevisions:(NSDictionary *)revisionsByIdentifier error:(NSError **)outError
+{
+    NSParameterAssert(dataByIdentifier);
+    NSParameterAssert(revisionsByIdentifier);
+    
+    [self noteForegroundOperation];
+    
+    NSTimeInterval accessTime = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity:dataByIdentifier.count];
+    NSMutableArray *datas = [NSMutableArray arrayWithCapacity:dataByIdentifier.count];
+    [dataByIdentifier enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, NSData *data, BOOL *stop) {
+        NSString *revision = revisionsByIdentifier[identifier];
+        NSAssert(revision != nil, @"No revision given for identifier %@", identifier);
+        
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = [self sanitizedIdentifierForIdentifier:identifier];
+        entry.revision = revision;
+        entry.lastAccessTime = accessTime;
+        [entries addObject:entry];
+        [datas addObject:[self storedDataForData:data entry:entry]];
+    }];
+    
+    return [self storeEntries:entries withData:datas error:outError];
+}
+
+///Stores the data of a number of items at once.
+///
+/// \param  entries     The entries of the items, with their keys, revisions, access times and expiration
+///                     times, filled in by `-storedDataForData:entry:`. Their locations are filled in. Required.
+/// \param  datas       The stored data of the items, in the same order as `entries`. Required.
+/// \param  outError    On return, an error describing why the data of an item could not be stored.
+///
+/// \result YES if every item was stored or declined; NO otherwise.
+///
+///The items are written concurrently, and the index is updated with a single write.
+- (BOOL)storeEntries:(NSArray *)entries withData:(NSArray *)datas error:(NSError **)outError
+{
+    NSParameterAssert(entries);
+    NSParameterAssert(datas);
+    NSParameterAssert(entries.count == datas.count);
+    
+    NSMutableIndexSet *fileGuardIndexes = [NSMutableIndexSet indexSet];
+    for (RKFileSystemCacheEntry *entry in entries)
+        [fileGuardIndexes addIndex:[self fileGuardIndexForSanitizedIdentifier:entry.key]];
+    
+    BOOL byFrequency = (self.evictionPolicy == kRKFileSystemCacheEvictionPolicyFrequencyFiltered);
+    
+    __block BOOL success = YES;
+    __block NSError *error = nil;
+    with_locked_files(_fileGuards, fileGuardIndexes, ^{
+        //Every item is considered for admission against the cache as it stood before the
+        //batch. Any excess left by items admitted together is evicted once they are stored.
+        NSMutableIndexSet *admittedIndexes = [NSMutableIndexSet indexSet];
+        NSMutableArray *declinedKeys = [NSMutableArray array];
+        NSMutableDictionary *victimsByKey = [NSMutableDictionary dictionary];
+        [self changeIndexUsingBlock:^{
+            unsigned long long maxCacheSize = [self budgetedMaxCacheSize];
+            [entries enumerateObjectsUsingBlock:^(RKFileSystemCacheEntry *entry, NSUInteger index, BOOL *stop) {
+                NSArray *victims = [_index admitEntryWithKey:entry.key contentHash:entry.contentHash dataSize:entry.dataSize maxCacheSize:maxCacheSize byFrequency:byFrequency];
+                if(victims) {
+                    [admittedIndexes addIndex:index];
+                    for (RKFileSystemCacheEntry *victim in victims)
+                        victimsByKey[victim.key] = victim;
+                } else {
+                    [declinedKeys addObject:entry.key];
+                }
+            }];
+        }];
+        
+        for (NSString *key in declinedKeys) {
+            [self removeLockedCacheForSanitizedIdentifier:key reason:kEvictionReasonReplacement error:NULL];
+            [_statisticsRecorder recordWriteStored:NO latency:-1.0];
+        }
+        
+        [self evictEntries:[victimsByKey allValues] holdingFileGuards:fileGuardIndexes];
+        
+        NSArray *admittedEntries = [entries objectsAtIndexes:admittedIndexes];
+        NSArray *admittedDatas = [datas objectsAtIndexes:admittedIndexes];
+        
+        //Items with identical contents are stored by the same worker, so that the
+        //contents are stored once even though none of them is in the index yet.
+        NSMutableDictionary *indexesByContentHash = [NSMutableDictionary dictionary];
+        NSMutableIndexSet *contentGuardIndexes = [NSMutableIndexSet indexSet];
+        [admittedEntries enumerateObjectsUsingBlock:^(RKFileSystemCacheEntry *entry, NSUInteger index, BOOL *stop) {
+            NSMutableIndexSet *indexes = indexesByContentHash[entry.contentHash];
+            if(!indexes) {
+                indexes = [NSMutableIndexSet indexSet];
+                indexesByContentHash[entry.contentHash] = indexes;
+                [contentGuardIndexes addIndex:[self contentGuardIndexForContentHash:entry.contentHash]];
+            }
+            
+            [indexes addIndex:index];
+        }];
+        
+        //The content guards are held until the index points at the stored contents,
+        //so that no contents being shared can be released in the meantime.
+        NSMutableArray *previousEntries = [NSMutableArray array];
+        with_locked_files(_contentGuards, contentGuardIndexes, ^{
+            NSArray *contentGroups = [indexesByContentHash allValues];
+            NSMutableIndexSet *storedIndexes = [NSMutableIndexSet indexSet];
+            dispatch_apply(contentGroups.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t groupIndex) {
+                __block RKFileSystemCacheEntry *storedEntry = nil;
+                __block NSData *storedData = nil;
+                [contentGroups[groupIndex] enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+                    RKFileSystemCacheEntry *entry = admittedEntries[index];
+                    NSData *data = admittedDatas[index];
+                    NSError *storeError = nil;
+                    BOOL stored = NO;
+                    if(storedEntry.contentHash && storedEntry.compressed == entry.compressed && [data isEqualToData:storedData]) {
+                        entry.segment = storedEntry.segment;
+                        entry.offset = storedEntry.offset;
+                        stored = YES;
+                    } else {
+                        //Content that collides with content stored earlier in the batch is stored on its own.
+                        if(storedEntry)
+                            entry.contentHash = nil;
+                        
+                        stored = [self storeData:data forEntry:entry error:&storeError];
+                        if(stored && !storedEntry) {
+                            storedEntry = entry;
+                            storedData = data;
+                        }
+                    }
+                    
+                    @synchronized(storedIndexes) {
+                        if(stored) {
+                            [storedIndexes addIndex:index];
+                        } else {
+                            success = NO;
+                            if(!error)
+                                error = storeError;
+                        }
+                    }
+                }];
+            });
+            
+            //Every stored item is committed to the index, and its journal records are written, at once.
+            [self changeIndexUsingBlock:^{
+                [_index beginBatch];
+                [storedIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+                    RKFileSystemCacheEntry *entry = admittedEntries[index];
+                    NSError *restoreError = nil;
+                    if(![self restoreData:admittedDatas[index] forEntry:entry error:&restoreError]) {
+                        success = NO;
+                        if(!error)
+                            error = restoreError;
+                        
+                        return;
+                    }
+                    
+                    RKFileSystemCacheEntry *previousEntry = [[_index entryForKey:entry.key] copy];
+                    [previousEntries addObject:@[ previousEntry ?: [NSNull null], entry ]];
+                    [_index setEntry:entry];
+                    [_statisticsRecorder recordWriteStored:YES latency:-1.0];
+                }];
+                [_index endBatch];
+            }];
+        });
+        
+        for (NSArray *replacement in previousEntries) {
+            if(replacement[0] != [NSNull null])
+                [self releasePreviousEntry:replacement[0] replacedByEntry:replacement[1]];
+        }
+        
+        __block NSArray *excessEntries = nil;
+        [self readIndexUsingBlock:^{
+            excessEntries = [_index entriesToEvictForMaxCacheSize:[self budgetedMaxCacheSize]];
+        }];
+        [self evictEntries:excessEntries holdingFileGuards:fileGuardIndexes];
+    });
+    
+    if(outError) *outError = error;
+    
+    return success;
+}
+
+- (BOOL)removeCacheForIdentifiers:(NSArray *)identifiers error:(NSError **)outError
+{
+    NSParameterAssert(identifiers);
+    
+    NSMutableSet *sanitizedIdentifiers = [NSMutableSet setWithCapacity:identifiers.count];
+    NSMutableIndexSet *fileGuardIndexes = [NSMutableIndexSet indexSet];
+    for (NSString *identifier in identifiers) {
+        NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+        [sanitizedIdentifiers addObject:sanitizedIdentifier];
+        [fileGuardIndexes addIndex:[self fileGuardIndexForSanitizedIdentifier:sanitizedIdentifier]];
+    }
+    
+    __block BOOL success = YES;
+    __block NSError *error = nil;
+    with_locked_files(_fileGuards, fileGuardIndexes, ^{
+        NSArray *keys = [sanitizedIdentifiers allObjects];
+        NSMutableArray *entries = [NSMutableArray arrayWithCapacity:keys.count];
+        [self readIndexUsingBlock:^{
+            for (NSString *key in keys)
+                [entries addObject:[[_index entryForKey:key] copy] ?: [NSNull null]];
+        }];
+        
+        //The data of shared and packed items is released after their entries are removed,
+        //the files of every other item are removed concurrently before their entries are.
+        NSMutableArray *removedKeys = [NSMutableArray arrayWithCapacity:keys.count];
+        NSMutableSet *releasedContentHashes = [NSMutableSet set];
+        dispatch_apply(keys.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+            NSString *key = keys[index];
+            RKFileSystemCacheEntry *entry = (entries[index] != [NSNull null])? entries[index] : nil;
+            
+            NSError *removeError = nil;
+            BOOL removed = (entry.contentHash != nil || (entry && entry.segment != 0));
+            if(!removed) {
+                NSURL *dataLocation = [_cacheLocation URLByAppendingPathComponent:key];
+                removed = ([[NSFileManager defaultManager] removeItemAtURL:dataLocation error:&removeError] || removeError.code == NSFileNoSuchFileError);
+            }
+            
+            @synchronized(removedKeys) {
+                if(removed) {
+                    [removedKeys addObject:key];
+                    if(entry.contentHash)
+                        [releasedContentHashes addObject:entry.contentHash];
+                } else {
+                    success = NO;
+                    if(!error)
+                        error = removeError;
+                }
+            }
+        });
+        
+        [self changeIndexUsingBlock:^{
+            NSUInteger removedCount = 0;
+            [_index beginBatch];
+            for (NSString *key in removedKeys) {
+                if([_index entryForKey:key])
+                    removedCount++;
+                
+                [_index removeEntryForKey:key];
+            }
+            [_index endBatch];
+            
+            [_statisticsRecorder recordEvictionCount:removedCount reason:kRKFileSystemCacheEvictionReasonManual];
+        }];
+        
+        for (NSString *contentHash in releasedContentHashes)
+            [self releaseContentWithHash:contentHash];
+    });
+    
+    if(outError) *outError = error;
+    
+    return success;
+}
+
+#pragma mark - Archives
+
+- (BOOL)exportCacheForIdentifiers:(NSArray *)identifiers toArchiveAtURL:(NSURL *)archiveLocation error:(NSError **)outError
+{
+    NSParameterAssert(archiveLocation);
+    
+    __block NSArray *keys = nil;
+    if(identifiers) {
+        NSMutableArray *sanitizedIdentifiers = [NSMutableArray arrayWithCapacity:identifiers.count];
+        for (NSString *identifier in identifiers)
+            [sanitizedIdentifiers addObject:[self sanitizedIdentifierForIdentifier:identifier]];
+        
+        keys = sanitizedIdentifiers;
+    } else {
+        [self readIndexUsingBlock:^{
+            keys = [[_index allEntries] valueForKey:@"key"];
+        }];
+    }
+    
+    //The archive is written next to its destination, and moved into place once it is complete.
+    NSURL *temporaryLocation = [archiveLocation URLByAppendingPathExtension:[[NSProcessInfo processInfo] globallyUniqueString]];
+    int descriptor = open([temporaryLocation fileSystemRepresentation], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(descriptor == -1) {
+        if(outError) *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        return NO;
+    }
+    
+    RKFileSystemCacheArchiveHeader header = {
+        .magic = kArchiveMagic,
+        .version = kArchiveVersion,
+        .entryCount = 0,
+    };
+    BOOL success = write_fully(descriptor, &header, sizeof(header));
+    for (NSString *key in keys) {
+        if(!success)
+            break;
+        
+        __block RKFileSystemCacheEntry *entry = nil;
+        __block RKFileSystemCacheSegmentStore *segments = nil;
+        [self readIndexUsingBlock:^{
+            entry = [[_index entryForKey:key] copy];
+            segments = _segments;
+        }];
+        
+        //Items that have been removed in the meantime are skipped.
+        NSData *data = entry? [self contentsOfEntry:entry inSegments:segments error:NULL] : nil;
+        if(!data)
+            continue;
+        
+        NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *revisionData = [entry.revision dataUsingEncoding:NSUTF8StringEncoding];
+        RKFileSystemCacheArchiveRecordHeader record = {
+            .expirationTime = entry.expirationTime,
+            .dataLength = data.length,
+            .revisionLength = (uint32_t)revisionData.length,
+            .keyLength = (uint16_t)keyData.length,
+        };
+        success = (write_fully(descriptor, &record, sizeof(record)) &&
+                   write_fully(descriptor, keyData.bytes, keyData.length) &&
+                   write_fully(descriptor, revisionData.bytes, revisionData.length) &&
+                   write_fully(descriptor, data.bytes, data.length));
+        header.entryCount++;
+    }
+    
+    //The header is written again with the number of records once every record is in place.
+    if(success)
+        success = (pwrite(descriptor, &header, sizeof(header), 0) == sizeof(header));
+    
+    if(success)
+        success = (fsync(descriptor) == 0);
+    
+    int errorCode = errno;
+    close(descriptor);
+    
+    if(success && rename([temporaryLocation fileSystemRepresentation], [archiveLocation fileSystemRepresentation]) != 0) {
+        errorCode = errno;
+        success = NO;
+    }
+    
+    if(!success) {
+        unlink([temporaryLocation fileSystemRepresentation]);
+        if(outError) *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errorCode userInfo:nil];
+    }
+    
+    return success;
+}
+
+- (BOOL)importCacheFromArchiveAtURL:(NSURL *)archiveLocation error:(NSError **)outError
+{
+    NSParameterAssert(archiveLocation);
+    
+    //The data of every item references the mapped archive directly, so it is never copied before it is stored.
+    NS_VALID_UNTIL_END_OF_SCOPE NSData *archive = [NSData dataWithContentsOfURL:archiveLocation options:NSDataReadingMappedIfSafe error:outError];
+    if(!archive)
+        return NO;
+    
+    NSError *malformedArchiveError = [NSError errorWithDomain:NSCocoaErrorDomain
+                                                         code:NSFileReadCorruptFileError
+                                                     userInfo:@{NSURLErrorKey: archiveLocation}];
+    
+    RKFileSystemCacheArchiveHeader header;
+    if(archive.length < sizeof(header)) {
+        if(outError) *outError = malformedArchiveError;
+        return NO;
+    }
+    
+    memcpy(&header, archive.bytes, sizeof(header));
+    if(header.magic != kArchiveMagic || header.version != kArchiveVersion) {
+        if(outError) *outError = malformedArchiveError;
+        return NO;
+    }
+    
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    const uint8_t *bytes = archive.bytes;
+    NSUInteger position = sizeof(header);
+    NSMutableDictionary *entriesByKey = [NSMutableDictionary dictionary];
+    NSMutableDictionary *datasByKey = [NSMutableDictionary dictionary];
+    for (uint64_t index = 0; index < header.entryCount; index++) {
+        RKFileSystemCacheArchiveRecordHeader record;
+        if(archive.length - position < sizeof(record)) {
+            if(outError) *outError = malformedArchiveError;
+            return NO;
+        }
+        
+        memcpy(&record, bytes + position, sizeof(record));
+        position += sizeof(record);
+        
+        unsigned long long recordLength = (unsigned long long)record.keyLength + record.revisionLength + record.dataLength;
+        if(archive.length - position < recordLength) {
+            if(outError) *outError = malformedArchiveError;
+            return NO;
+        }
+        
+        NSString *key = [[NSString alloc] initWithBytes:bytes + position length:record.keyLength encoding:NSUTF8StringEncoding];
+        position += record.keyLength;
+        NSString *revision = [[NSString alloc] initWithBytes:bytes + position length:record.revisionLength encoding:NSUTF8StringEncoding];
+        position += record.revisionLength;
+        NSData *data = [NSData dataWithBytesNoCopy:(void *)(bytes + position) length:(NSUInteger)record.dataLength freeWhenDone:NO];
+        position += (NSUInteger)record.dataLength;
+        
+        //Keys name files in the cache's directory, so nothing but a plain file name is accepted.
+        if(key.length == 0 || [key hasPrefix:@"."] || [key rangeOfString:@"/"].location != NSNotFound || !revision) {
+            if(outError) *outError = malformedArchiveError;
+            return NO;
+        }
+        
+        if(record.expirationTime != 0.0 && record.expirationTime <= now)
+            continue;
+        
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = key;
+        entry.revision = revision;
+        entry.lastAccessTime = now;
+        entry.expirationTime = record.expirationTime;
+        entriesByKey[key] = entry;
+        datasByKey[key] = [self storedDataForData:data entry:entry];
+    }
+    
+    [self readIndexUsingBlock:^{
+        for (NSString *key in [entriesByKey allKeys]) {
+            if([_index entryForKey:key])
+                [entriesByKey removeObjectForKey:key];
+        }
+    }];
+    
+    NSArray *keys = [entriesByKey allKeys];
+    return [self storeEntries:[entriesByKey objectsForKeys:keys notFoundMarker:[NSNull null]]
+                     withData:[datasByKey objectsForKeys:keys notFoundMarker:[NSNull null]]
+                        error:outError];
+}
+
+#pragma mark - <RKAsyncURLRequestPromiseCacheManager>
+
+- (void)loadRevisionForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerRevisionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        handler([self revisionForIdentifier:identifier]);
+    }];
+}
+
+- (void)loadCachedDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerDataHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        NSData *data = [self cachedDataForIdentifier:identifier error:&error];
+        handler(data, error);
+    }];
+}
+
+- (void)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [self cacheData:data forIdentifier:identifier withRevision:revision expirationDate:expirationDate error:&error];
+        handler(success, error);
+    }];
+}
+
+- (void)removeCacheForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [self removeCacheForIdentifier:identifier error:&error];
+        handler(success, error);
+    }];
+}
+
+#pragma mark - Partial Data
+
+- (BOOL)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator error:(NSError **)error
+{
+    NSParameterAssert(data);
+    NSParameterAssert(identifier);
+    NSParameterAssert(validator);
+    
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    __block BOOL success = YES;
+    with_locked_file([self fileGuardForSanitizedIdentifier:sanitizedIdentifier], ^{
+        NSURL *dataLocation = [[_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier] URLByAppendingPathExtension:kPartialDataExtension];
+        NSURL *validatorLocation = [[dataLocation URLByDeletingPathExtension] URLByAppendingPathExtension:kPartialValidatorExtension];
+        
+        //The validator is written last so a partially written body is never paired with it.
+        [[NSFileManager defaultManager] removeItemAtURL:validatorLocation error:NULL];
+        success = ([data writeToURL:dataLocation options:NSAtomicWrite error:error] &&
+                   [validator writeToURL:validatorLocation atomically:YES encoding:NSUTF8StringEncoding error:error]);
+    });
+    
+    return success;
+}
+
+- (NSData *)partialDataForIdentifier:(NSString *)identifier validator:(NSString **)outValidator
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(outValidator);
+    
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    __block NSData *data = nil;
+    __block NSString *validator = nil;
+    with_locked_file([self fileGuardForSanitizedIdentifier:sanitizedIdentifier], ^{
+        NSURL *dataLocation = [[_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier] URLByAppendingPathExtension:kPartialDataExtension];
+        NSURL *validatorLocation = [[dataLocation URLByDeletingPathExtension] URLByAppendingPathExtension:kPartialValidatorExtension];
+        
+        validator = [NSString stringWithContentsOfURL:validatorLocation encoding:NSUTF8StringEncoding error:NULL];
+        if(validator)
+            data = [NSData dataWithContentsOfURL:dataLocation options:NSDataReadingMappedIfSafe error:NULL];
+    });
+    
+    *outValidator = data? validator : nil;
+    return data;
+}
+
+- (BOOL)removePartialDataForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    NSParameterAssert(identifier);
+    
+    NSString *sanitizedIdentifier = [self sanitizedIdentifierForIdentifier:identifier];
+    
+    __block BOOL success = YES;
+    __block NSError *error = nil;
+    with_locked_file([self fileGuardForSanitizedIdentifier:sanitizedIdentifier], ^{
+        NSURL *dataLocation = [[_cacheLocation URLByAppendingPathComponent:sanitizedIdentifier] URLByAppendingPathExtension:kPartialDataExtension];
+        NSURL *validatorLocation = [[dataLocation URLByDeletingPathExtension] URLByAppendingPathExtension:kPartialValidatorExtension];
+        
+        for (NSURL *location in @[ validatorLocation, dataLocation ]) {
+            if(![[NSFileManager defaultManager] removeItemAtURL:location error:&error] && error.code != NSFileNoSuchFileError) {
+                success = NO;
+                break;
+            }
+            
+            error = nil;
+        }
     });
     
     if(outError) *outError = error;
@@ -357,4 +2132,42 @@ void RKFileSystemCacheManagerEmitCacheRemovalErrorWarning(NSError *error)
     return success;
 }
 
+- (void)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(data);
+    NSParameterAssert(identifier);
+    NSParameterAssert(validator);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [self cachePartialData:data forIdentifier:identifier withValidator:validator error:&error];
+        handler(success, error);
+    }];
+}
+
+- (void)loadPartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerPartialDataHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSString *validator = nil;
+        NSData *partialData = [self partialDataForIdentifier:identifier validator:&validator];
+        handler(partialData, validator);
+    }];
+}
+
+- (void)removePartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    
+    [_ioQueue addOperationWithBlock:^{
+        NSError *error = nil;
+        BOOL success = [self removePartialDataForIdentifier:identifier error:&error];
+        if(handler)
+            handler(success, error);
+    }];
+}
+
 @end
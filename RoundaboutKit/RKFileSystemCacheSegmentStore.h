@@ -0,0 +1,77 @@
+//
+//  RKFileSystemCacheSegmentStore.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKFileSystemCacheSegmentStore_h
+#define RKFileSystemCacheSegmentStore_h 1
+
+#import <Foundation/Foundation.h>
+
+///The largest item that will be packed into a segment file. Larger items are stored in their own files.
+RK_EXTERN NSUInteger const RKFileSystemCacheSegmentStoreMaximumPackedDataLength;
+
+///The RKFileSystemCacheSegmentStore class packs the data of small cache items into large,
+///append-only segment files, so that storing tens of thousands of small items costs tens
+///of files rather than tens of thousands.
+///
+///Data is appended to a single active segment until it grows past a fixed size, at which
+///point a new segment becomes active. A segment is never modified once data has been
+///appended to it, so data returned by the store remains valid after the segment it came
+///from is removed. The store does not know which ranges of its segments are still in use,
+///reclaiming space from segments is the responsibility of its owner.
+///
+///All of the methods on this class are safe to call from any thread.
+@interface RKFileSystemCacheSegmentStore : NSObject
+
+///Initialize the receiver with the directory its segments are stored in.
+///
+/// \param  directory   The directory. Required.
+///
+/// \result A fully initialized segment store.
+///
+///This is the designated initializer.
+- (instancetype)initWithDirectory:(NSURL *)directory;
+
+#pragma mark - Properties
+
+///The directory the receiver's segments are stored in.
+@property (readonly) NSURL *directory;
+
+///The segment data is currently being appended to.
+@property (readonly) uint32_t activeSegment;
+
+#pragma mark - Data
+
+///Appends data to the active segment.
+///
+/// \param  data        The data to append. Required.
+/// \param  outSegment  On return, the segment the data was appended to. Required.
+/// \param  outOffset   On return, the offset of the data within its segment. Required.
+/// \param  outError    On return, an error describing why the data could not be appended.
+///
+/// \result YES if the data was appended; NO otherwise.
+- (BOOL)appendData:(NSData *)data segment:(uint32_t *)outSegment offset:(unsigned long long *)outOffset error:(NSError **)outError;
+
+///Returns the data in a range of a segment, or nil if the range cannot be read.
+///
+///Segments are memory-mapped where the file system allows it, and the returned data
+///references the mapping of its segment directly rather than copying from it.
+- (NSData *)dataInSegment:(uint32_t)segment offset:(unsigned long long)offset length:(NSUInteger)length;
+
+#pragma mark - Segments
+
+///Returns the size of every segment in the receiver's directory.
+///
+///NSNumber(uint32_t) => NSNumber(unsigned long long).
+- (NSDictionary *)segmentSizes;
+
+///Removes a segment. The active segment cannot be removed.
+- (void)removeSegment:(uint32_t)segment;
+
+@end
+
+#endif /* RKFileSystemCacheSegmentStore_h */
@@ -0,0 +1,256 @@
+//
+//  RKFileSystemCacheSegmentStore.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKFileSystemCacheSegmentStore.h"
+#import <fcntl.h>
+#import <pthread.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+NSUInteger const RKFileSystemCacheSegmentStoreMaximumPackedDataLength = (1024 * 32);
+
+///The size past which a new segment becomes active.
+static unsigned long long const kMaximumSegmentSize = (1024 * 1024 * 4);
+
+static NSString *const kSegmentFilePrefix = @"__Segment-";
+static NSString *const kSegmentFileExtension = @"pack";
+
+#pragma mark -
+
+///A range of a memory-mapped segment that references the segment's mapping instead of copying it.
+@interface RKFileSystemCacheSegmentSlice : NSData {
+    NSData *_segmentData;
+    NSRange _range;
+}
+
+- (instancetype)initWithSegmentData:(NSData *)segmentData range:(NSRange)range;
+
+@end
+
+@implementation RKFileSystemCacheSegmentSlice
+
+- (instancetype)initWithSegmentData:(NSData *)segmentData range:(NSRange)range
+{
+    if((self = [super init])) {
+        _segmentData = segmentData;
+        _range = range;
+    }
+    
+    return self;
+}
+
+- (const void *)bytes
+{
+    return (const uint8_t *)[_segmentData bytes] + _range.location;
+}
+
+- (NSUInteger)length
+{
+    return _range.length;
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKFileSystemCacheSegmentStore {
+    ///The lock that regulates access to the active segment and the mapped segments.
+    pthread_mutex_t _stateGuard;
+    
+    ///The descriptor of the active segment, opened for appending. -1 if it has not been opened.
+    int _activeDescriptor;
+    
+    ///The size of the active segment.
+    unsigned long long _activeSize;
+    
+    ///The most recent mappings of the receiver's segments.
+    ///
+    ///NSNumber(uint32_t) => NSData.
+    NSMutableDictionary *_mappedSegments;
+}
+
+- (void)dealloc
+{
+    if(_activeDescriptor != -1)
+        close(_activeDescriptor);
+    
+    pthread_mutex_destroy(&_stateGuard);
+}
+
+- (instancetype)initWithDirectory:(NSURL *)directory
+{
+    NSParameterAssert(directory);
+    
+    if((self = [super init])) {
+        _directory = directory;
+        _activeDescriptor = -1;
+        _mappedSegments = [NSMutableDictionary dictionary];
+        
+        int mutexInitStatus = pthread_mutex_init(&_stateGuard, NULL);
+        if(mutexInitStatus != noErr) {
+            [NSException raise:NSInternalInconsistencyException
+                        format:@"Could not create state guard for segment store. %d", mutexInitStatus];
+        }
+        
+        uint32_t newestSegment = 0;
+        for (NSNumber *segment in [self segmentSizes])
+            newestSegment = MAX(newestSegment, segment.unsignedIntValue);
+        
+        //The newest segment is reopened for appending if it has room to spare,
+        //the record it last had appended to it may have been cut short by a
+        //crash, but the index will never reference a record that was.
+        _activeSegment = MAX(newestSegment, 1);
+    }
+    
+    return self;
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+#pragma mark - Locations
+
+- (NSURL *)locationForSegment:(uint32_t)segment
+{
+    NSString *fileName = [NSString stringWithFormat:@"%@%08u.%@", kSegmentFilePrefix, segment, kSegmentFileExtension];
+    return [self.directory URLByAppendingPathComponent:fileName];
+}
+
+#pragma mark - Internal
+
+///Opens the active segment for appending, moving on to a new segment if the active one is full.
+///
+///This method assumes it is being called with `_stateGuard` held.
+- (BOOL)openActiveSegmentForDataOfLength:(NSUInteger)length error:(NSError **)outError
+{
+    if(_activeDescriptor != -1 && (_activeSize == 0 || _activeSize + length <= kMaximumSegmentSize))
+        return YES;
+    
+    if(_activeDescriptor != -1) {
+        close(_activeDescriptor);
+        _activeDescriptor = -1;
+        _activeSegment++;
+        _activeSize = 0;
+    }
+    
+    for (;;) {
+        _activeDescriptor = open([[self locationForSegment:_activeSegment] fileSystemRepresentation], O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if(_activeDescriptor == -1) {
+            if(outError) *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+            return NO;
+        }
+        
+        struct stat segmentInfo;
+        fstat(_activeDescriptor, &segmentInfo);
+        _activeSize = (unsigned long long)segmentInfo.st_size;
+        
+        if(_activeSize == 0 || _activeSize + length <= kMaximumSegmentSize)
+            return YES;
+        
+        close(_activeDescriptor);
+        _activeDescriptor = -1;
+        _activeSegment++;
+    }
+}
+
+#pragma mark - Data
+
+- (BOOL)appendData:(NSData *)data segment:(uint32_t *)outSegment offset:(unsigned long long *)outOffset error:(NSError **)outError
+{
+    NSParameterAssert(data);
+    NSParameterAssert(outSegment);
+    NSParameterAssert(outOffset);
+    
+    BOOL success = NO;
+    pthread_mutex_lock(&_stateGuard);
+    {
+        if([self openActiveSegmentForDataOfLength:data.length error:outError]) {
+            ssize_t amountWritten = write(_activeDescriptor, data.bytes, data.length);
+            if(amountWritten == (ssize_t)data.length) {
+                *outSegment = _activeSegment;
+                *outOffset = _activeSize;
+                _activeSize += data.length;
+                success = YES;
+            } else {
+                if(outError) *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:(amountWritten == -1? errno : EIO) userInfo:nil];
+                
+                //The segment is returned to its previous size so the next record starts at a known offset.
+                ftruncate(_activeDescriptor, (off_t)_activeSize);
+            }
+        }
+    }
+    pthread_mutex_unlock(&_stateGuard);
+    
+    return success;
+}
+
+- (NSData *)dataInSegment:(uint32_t)segment offset:(unsigned long long)offset length:(NSUInteger)length
+{
+    NSData *segmentData = nil;
+    pthread_mutex_lock(&_stateGuard);
+    {
+        segmentData = _mappedSegments[@(segment)];
+        if(!segmentData || offset + length > segmentData.length) {
+            //Segments are only ever appended to, so a mapping that is too short is
+            //replaced, the old mapping remains valid for anyone still referencing it.
+            segmentData = [NSData dataWithContentsOfURL:[self locationForSegment:segment] options:NSDataReadingMappedIfSafe error:NULL];
+            if(segmentData)
+                _mappedSegments[@(segment)] = segmentData;
+        }
+    }
+    pthread_mutex_unlock(&_stateGuard);
+    
+    if(!segmentData || offset + length > segmentData.length)
+        return nil;
+    
+    return [[RKFileSystemCacheSegmentSlice alloc] initWithSegmentData:segmentData range:NSMakeRange((NSUInteger)offset, length)];
+}
+
+#pragma mark - Segments
+
+- (NSDictionary *)segmentSizes
+{
+    NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directory
+                                                      includingPropertiesForKeys:@[NSURLFileSizeKey]
+                                                                         options:0
+                                                                           error:NULL];
+    
+    NSMutableDictionary *segmentSizes = [NSMutableDictionary dictionary];
+    for (NSURL *location in contents) {
+        NSString *fileName = [location lastPathComponent];
+        if(![fileName hasPrefix:kSegmentFilePrefix] || ![[fileName pathExtension] isEqualToString:kSegmentFileExtension])
+            continue;
+        
+        uint32_t segment = (uint32_t)[[[fileName stringByDeletingPathExtension] substringFromIndex:kSegmentFilePrefix.length] longLongValue];
+        if(segment == 0)
+            continue;
+        
+        NSNumber *fileSize = nil;
+        [location getResourceValue:&fileSize forKey:NSURLFileSizeKey error:NULL];
+        segmentSizes[@(segment)] = fileSize ?: @0;
+    }
+    
+    return segmentSizes;
+}
+
+- (void)removeSegment:(uint32_t)segment
+{
+    pthread_mutex_lock(&_stateGuard);
+    {
+        if(segment != _activeSegment) {
+            [_mappedSegments removeObjectForKey:@(segment)];
+            [[NSFileManager defaultManager] removeItemAtURL:[self locationForSegment:segment] error:NULL];
+        }
+    }
+    pthread_mutex_unlock(&_stateGuard);
+}
+
+@end
@@ -0,0 +1,153 @@
+//
+//  RKFileSystemCacheStatistics.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKFileSystemCacheStatistics_h
+#define RKFileSystemCacheStatistics_h 1
+
+#import <Foundation/Foundation.h>
+
+///The operations of a cache whose latencies are recorded.
+typedef NS_ENUM(NSInteger, RKFileSystemCacheOperation) {
+    ///Reading the cached data of an identifier.
+    kRKFileSystemCacheOperationGet = 0,
+    
+    ///Storing data for an identifier.
+    kRKFileSystemCacheOperationPut = 1,
+};
+
+///The reasons items are removed from a cache.
+typedef NS_ENUM(NSInteger, RKFileSystemCacheEvictionReason) {
+    ///The item was evicted to keep the cache within its maximum size.
+    kRKFileSystemCacheEvictionReasonSize = 0,
+    
+    ///The item's expiration date passed, or it went unused for the default expiration interval.
+    kRKFileSystemCacheEvictionReasonExpiration = 1,
+    
+    ///The item was removed explicitly.
+    kRKFileSystemCacheEvictionReasonManual = 2,
+};
+
+///The number of buckets in a latency histogram.
+///
+///Bucket zero counts operations that took less than a microsecond, and every
+///following bucket counts operations that took up to twice as long as the last.
+RK_EXTERN NSUInteger const RKFileSystemCacheLatencyHistogramBucketCount;
+
+///Returns the latency below which the operations counted by a given histogram bucket took.
+RK_EXTERN NSTimeInterval RKFileSystemCacheLatencyHistogramBucketUpperBound(NSUInteger bucket);
+
+#pragma mark -
+
+///The RKFileSystemCacheStatistics class describes the activity of a cache over a period of time.
+///
+///Statistics are immutable snapshots taken from an `RKFileSystemCacheStatisticsRecorder`.
+@interface RKFileSystemCacheStatistics : NSObject
+
+///The time the statistics began to be recorded, or were last reset.
+@property (readonly) NSDate *startDate;
+
+///The time the statistics were taken.
+@property (readonly) NSDate *endDate;
+
+#pragma mark - Reads
+
+///The number of reads that found cached data.
+@property (readonly) int64_t hitCount;
+
+///The number of reads that found no cached data.
+@property (readonly) int64_t missCount;
+
+///The fraction of reads that found cached data, or zero if there were none.
+@property (readonly) double hitRatio;
+
+///The number of times the revision of an item matched the revision of a response
+///from the network, so that the item was used instead of the response's body.
+@property (readonly) int64_t revalidationCount;
+
+///The number of bytes of cached data read.
+@property (readonly) int64_t bytesRead;
+
+///The number of bytes of cached data read per second over the statistics' period.
+@property (readonly) double bytesReadPerSecond;
+
+#pragma mark - Writes
+
+///The number of items stored.
+@property (readonly) int64_t writeCount;
+
+///The number of items the cache declined to store because they are used less often than what they would displace.
+@property (readonly) int64_t rejectedWriteCount;
+
+///The number of bytes written to the file system. Items whose content was already stored do not write anything.
+@property (readonly) int64_t bytesWritten;
+
+///The number of bytes written per second over the statistics' period.
+@property (readonly) double bytesWrittenPerSecond;
+
+#pragma mark - Evictions
+
+///Returns the number of items removed for a given reason.
+- (int64_t)evictionCountForReason:(RKFileSystemCacheEvictionReason)reason;
+
+#pragma mark - Latencies
+
+///Returns the number of operations of a given type counted by each bucket of its latency histogram.
+///
+/// \result An array of `RKFileSystemCacheLatencyHistogramBucketCount` NSNumbers.
+- (NSArray *)latencyHistogramForOperation:(RKFileSystemCacheOperation)operation;
+
+///Returns the latency below which a given fraction of the operations of a given type took,
+///rounded up to the upper bound of a histogram bucket. Zero if there were no such operations.
+///
+/// \param  percentile  The fraction of operations, from zero to one.
+/// \param  operation   The type of operation.
+- (NSTimeInterval)latencyAtPercentile:(double)percentile forOperation:(RKFileSystemCacheOperation)operation;
+
+@end
+
+#pragma mark -
+
+///The RKFileSystemCacheStatisticsRecorder class counts the activity of a cache.
+///
+///Every counter is updated with atomic operations, so recording never takes a lock and may
+///happen on any number of threads at once. Snapshots read each counter atomically, but do not
+///stop recording while they are taken, so counters updated together may be off by the
+///operations that were in flight at the time.
+@interface RKFileSystemCacheStatisticsRecorder : NSObject
+
+///Records a read of a cache.
+///
+/// \param  length      The number of bytes read, or zero if no cached data was found.
+/// \param  hit         Whether or not cached data was found.
+/// \param  latency     How long the read took, or a negative number if the latency should not be recorded.
+- (void)recordReadOfLength:(NSUInteger)length hit:(BOOL)hit latency:(NSTimeInterval)latency;
+
+///Records that the revision of an item matched the revision of a response from the network.
+- (void)recordRevalidation;
+
+///Records an attempt to store an item.
+///
+/// \param  stored      Whether or not the item was stored.
+/// \param  latency     How long the attempt took, or a negative number if the latency should not be recorded.
+- (void)recordWriteStored:(BOOL)stored latency:(NSTimeInterval)latency;
+
+///Records a number of bytes written to the file system.
+- (void)recordBytesWritten:(NSUInteger)length;
+
+///Records the removal of a number of items for a given reason.
+- (void)recordEvictionCount:(NSUInteger)count reason:(RKFileSystemCacheEvictionReason)reason;
+
+///Returns a snapshot of the counters of the receiver.
+- (RKFileSystemCacheStatistics *)statistics;
+
+///Resets every counter of the receiver to zero.
+- (void)reset;
+
+@end
+
+#endif /* RKFileSystemCacheStatistics_h */
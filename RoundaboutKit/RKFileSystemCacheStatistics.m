@@ -0,0 +1,304 @@
+//
+//  RKFileSystemCacheStatistics.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKFileSystemCacheStatistics.h"
+#import <libkern/OSAtomic.h>
+
+///The number of buckets in a latency histogram, as a constant expression.
+#define LATENCY_BUCKET_COUNT 32
+
+///The number of operations whose latencies are recorded.
+#define OPERATION_COUNT 2
+
+///The number of eviction reasons.
+#define EVICTION_REASON_COUNT 3
+
+NSUInteger const RKFileSystemCacheLatencyHistogramBucketCount = LATENCY_BUCKET_COUNT;
+
+NSTimeInterval RKFileSystemCacheLatencyHistogramBucketUpperBound(NSUInteger bucket)
+{
+    NSCParameterAssert(bucket < LATENCY_BUCKET_COUNT);
+    
+    return ldexp(1.0, (int)bucket) / USEC_PER_SEC;
+}
+
+///Returns the histogram bucket that counts a given latency.
+RK_INLINE NSUInteger latency_bucket(NSTimeInterval latency)
+{
+    double microseconds = latency * USEC_PER_SEC;
+    if(microseconds < 1.0)
+        return 0;
+    
+    int exponent;
+    frexp(microseconds, &exponent);
+    return MIN((NSUInteger)exponent, LATENCY_BUCKET_COUNT - 1);
+}
+
+///Atomically reads a statistics counter.
+RK_INLINE int64_t read_counter(volatile int64_t *counter)
+{
+    return OSAtomicAdd64Barrier(0, counter);
+}
+
+///Atomically resets a statistics counter to zero.
+RK_INLINE void reset_counter(volatile int64_t *counter)
+{
+    int64_t value;
+    do {
+        value = *counter;
+    } while (!OSAtomicCompareAndSwap64Barrier(value, 0, counter));
+}
+
+#pragma mark -
+
+@interface RKFileSystemCacheStatistics () {
+    int64_t _evictionCounts[EVICTION_REASON_COUNT];
+    int64_t _latencyCounts[OPERATION_COUNT][LATENCY_BUCKET_COUNT];
+}
+
+#pragma mark - readwrite
+
+@property (readwrite) NSDate *startDate;
+@property (readwrite) NSDate *endDate;
+@property (readwrite) int64_t hitCount;
+@property (readwrite) int64_t missCount;
+@property (readwrite) int64_t revalidationCount;
+@property (readwrite) int64_t bytesRead;
+@property (readwrite) int64_t writeCount;
+@property (readwrite) int64_t rejectedWriteCount;
+@property (readwrite) int64_t bytesWritten;
+
+@end
+
+@implementation RKFileSystemCacheStatistics
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p hits: %lld, misses: %lld, revalidations: %lld, read: %lld bytes, written: %lld bytes, evicted: %lld/%lld/%lld (size/expiration/manual)>",
+            NSStringFromClass([self class]), self,
+            _hitCount, _missCount, _revalidationCount, _bytesRead, _bytesWritten,
+            _evictionCounts[kRKFileSystemCacheEvictionReasonSize],
+            _evictionCounts[kRKFileSystemCacheEvictionReasonExpiration],
+            _evictionCounts[kRKFileSystemCacheEvictionReasonManual]];
+}
+
+#pragma mark - Reads
+
+- (double)hitRatio
+{
+    int64_t readCount = _hitCount + _missCount;
+    if(readCount == 0)
+        return 0.0;
+    
+    return (double)_hitCount / (double)readCount;
+}
+
+- (double)bytesReadPerSecond
+{
+    NSTimeInterval duration = [_endDate timeIntervalSinceDate:_startDate];
+    if(duration <= 0.0)
+        return 0.0;
+    
+    return _bytesRead / duration;
+}
+
+#pragma mark - Writes
+
+- (double)bytesWrittenPerSecond
+{
+    NSTimeInterval duration = [_endDate timeIntervalSinceDate:_startDate];
+    if(duration <= 0.0)
+        return 0.0;
+    
+    return _bytesWritten / duration;
+}
+
+#pragma mark - Evictions
+
+- (int64_t)evictionCountForReason:(RKFileSystemCacheEvictionReason)reason
+{
+    NSParameterAssert(reason >= 0 && reason < EVICTION_REASON_COUNT);
+    
+    return _evictionCounts[reason];
+}
+
+#pragma mark - Latencies
+
+- (NSArray *)latencyHistogramForOperation:(RKFileSystemCacheOperation)operation
+{
+    NSParameterAssert(operation >= 0 && operation < OPERATION_COUNT);
+    
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:LATENCY_BUCKET_COUNT];
+    for (NSUInteger bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+        [histogram addObject:@(_latencyCounts[operation][bucket])];
+    
+    return histogram;
+}
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile forOperation:(RKFileSystemCacheOperation)operation
+{
+    NSParameterAssert(percentile >= 0.0 && percentile <= 1.0);
+    NSParameterAssert(operation >= 0 && operation < OPERATION_COUNT);
+    
+    int64_t total = 0;
+    for (NSUInteger bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+        total += _latencyCounts[operation][bucket];
+    
+    if(total == 0)
+        return 0.0;
+    
+    int64_t threshold = MAX((int64_t)ceil(total * percentile), 1);
+    int64_t running = 0;
+    for (NSUInteger bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++) {
+        running += _latencyCounts[operation][bucket];
+        if(running >= threshold)
+            return RKFileSystemCacheLatencyHistogramBucketUpperBound(bucket);
+    }
+    
+    return RKFileSystemCacheLatencyHistogramBucketUpperBound(LATENCY_BUCKET_COUNT - 1);
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKFileSystemCacheStatisticsRecorder {
+    volatile int64_t _hitCount;
+    volatile int64_t _missCount;
+    volatile int64_t _revalidationCount;
+    volatile int64_t _bytesRead;
+    volatile int64_t _writeCount;
+    volatile int64_t _rejectedWriteCount;
+    volatile int64_t _bytesWritten;
+    volatile int64_t _evictionCounts[EVICTION_REASON_COUNT];
+    volatile int64_t _latencyCounts[OPERATION_COUNT][LATENCY_BUCKET_COUNT];
+    
+    ///The absolute time recording began, stored as its bit pattern so it can be swapped atomically.
+    volatile int64_t _startTime;
+}
+
+- (instancetype)init
+{
+    if((self = [super init])) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        memcpy((void *)&_startTime, &now, sizeof(now));
+    }
+    
+    return self;
+}
+
+#pragma mark - Recording
+
+- (void)recordLatency:(NSTimeInterval)latency ofOperation:(RKFileSystemCacheOperation)operation
+{
+    if(latency < 0.0)
+        return;
+    
+    OSAtomicIncrement64Barrier(&_latencyCounts[operation][latency_bucket(latency)]);
+}
+
+- (void)recordReadOfLength:(NSUInteger)length hit:(BOOL)hit latency:(NSTimeInterval)latency
+{
+    if(hit) {
+        OSAtomicIncrement64Barrier(&_hitCount);
+        OSAtomicAdd64Barrier(length, &_bytesRead);
+    } else {
+        OSAtomicIncrement64Barrier(&_missCount);
+    }
+    
+    [self recordLatency:latency ofOperation:kRKFileSystemCacheOperationGet];
+}
+
+- (void)recordRevalidation
+{
+    OSAtomicIncrement64Barrier(&_revalidationCount);
+}
+
+- (void)recordWriteStored:(BOOL)stored latency:(NSTimeInterval)latency
+{
+    if(stored)
+        OSAtomicIncrement64Barrier(&_writeCount);
+    else
+        OSAtomicIncrement64Barrier(&_rejectedWriteCount);
+    
+    [self recordLatency:latency ofOperation:kRKFileSystemCacheOperationPut];
+}
+
+- (void)recordBytesWritten:(NSUInteger)length
+{
+    OSAtomicAdd64Barrier(length, &_bytesWritten);
+}
+
+- (void)recordEvictionCount:(NSUInteger)count reason:(RKFileSystemCacheEvictionReason)reason
+{
+    NSParameterAssert(reason >= 0 && reason < EVICTION_REASON_COUNT);
+    
+    if(count > 0)
+        OSAtomicAdd64Barrier(count, &_evictionCounts[reason]);
+}
+
+#pragma mark - Snapshots
+
+- (RKFileSystemCacheStatistics *)statistics
+{
+    RKFileSystemCacheStatistics *statistics = [RKFileSystemCacheStatistics new];
+    
+    int64_t startTime = read_counter(&_startTime);
+    CFAbsoluteTime start;
+    memcpy(&start, &startTime, sizeof(start));
+    statistics.startDate = [NSDate dateWithTimeIntervalSinceReferenceDate:start];
+    statistics.endDate = [NSDate date];
+    
+    statistics.hitCount = read_counter(&_hitCount);
+    statistics.missCount = read_counter(&_missCount);
+    statistics.revalidationCount = read_counter(&_revalidationCount);
+    statistics.bytesRead = read_counter(&_bytesRead);
+    statistics.writeCount = read_counter(&_writeCount);
+    statistics.rejectedWriteCount = read_counter(&_rejectedWriteCount);
+    statistics.bytesWritten = read_counter(&_bytesWritten);
+    
+    for (NSUInteger reason = 0; reason < EVICTION_REASON_COUNT; reason++)
+        statistics->_evictionCounts[reason] = read_counter(&_evictionCounts[reason]);
+    
+    for (NSUInteger operation = 0; operation < OPERATION_COUNT; operation++) {
+        for (NSUInteger bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+            statistics->_latencyCounts[operation][bucket] = read_counter(&_latencyCounts[operation][bucket]);
+    }
+    
+    return statistics;
+}
+
+- (void)reset
+{
+    reset_counter(&_hitCount);
+    reset_counter(&_missCount);
+    reset_counter(&_revalidationCount);
+    reset_counter(&_bytesRead);
+    reset_counter(&_writeCount);
+    reset_counter(&_rejectedWriteCount);
+    reset_counter(&_bytesWritten);
+    
+    for (NSUInteger reason = 0; reason < EVICTION_REASON_COUNT; reason++)
+        reset_counter(&_evictionCounts[reason]);
+    
+    for (NSUInteger operation = 0; operation < OPERATION_COUNT; operation++) {
+        for (NSUInteger bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++)
+            reset_counter(&_latencyCounts[operation][bucket]);
+    }
+    
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    int64_t startTime;
+    memcpy(&startTime, &now, sizeof(now));
+    
+    int64_t oldStartTime;
+    do {
+        oldStartTime = _startTime;
+    } while (!OSAtomicCompareAndSwap64Barrier(oldStartTime, startTime, &_startTime));
+}
+
+@end
@@ -34,7 +34,7 @@ typedef void(^RKImageLoaderCompletionHandler)(BOOL wasSuccessful);
 
 #pragma mark - Properties
 
-///The cache manager for the image loader.
+///The cache manager for the image loader. Images are stored in a bucket of their own.
 @property (nonatomic, readonly) RKFileSystemCacheManager *cacheManager;
 
 ///The maximum image size that can be cached.
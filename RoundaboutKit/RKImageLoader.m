@@ -14,6 +14,9 @@
 
 #define xCGSizeGetArea(size) (size.width * size.height)
 
+///The name of the cache bucket images are stored in, so that they never displace other cached data.
+static NSString *const kImageCacheBucketName = @"Images";
+
 @interface RKImageLoader ()
 
 ///The map that contains the loaded images.
@@ -52,7 +55,7 @@
     if((self = [super init])) {
         self.imageMap = (__bridge_transfer NSMutableDictionary *)CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
         
-        self.cacheManager = [RKFileSystemCacheManager sharedCacheManager];
+        self.cacheManager = [RKFileSystemCacheManager cacheManagerForBucket:kImageCacheBucketName];
         self.inMemoryCache = [NSCache new];
         self.inMemoryCache.name = @"com.roundabout.roundaboutkit.imageloader.inMemoryCache";
         
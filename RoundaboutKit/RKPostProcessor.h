@@ -65,6 +65,18 @@ enum {
 ///are never shared between threads.
 - (id)processValue:(id)value error:(NSError **)outError withContext:(id)context;
 
+#pragma mark - Identity
+
+///Returns a string that identifies the processing the post-processor performs,
+///or nil if the values the post-processor produces should never be reused.
+///
+///`RKProcessedValueCache` only reuses a value for a chain of post-processors whose
+///processing identifiers are the same as those of the chain that produced it, including
+///across launches. The default implementation returns nil. Subclasses that opt in must
+///return an identifier that includes any configuration that affects their values, such
+///as the name of their class for post-processors that are stateless.
+- (NSString *)processingIdentifier;
+
 @end
 
 #pragma mark -
@@ -86,6 +98,9 @@ typedef RKPossibility *(^RKSimplePostProcessorBlock)(RKPossibility *maybeData, i
 ///The RKSimplePostProcessor class implements a simple, weakly typed, block-based
 ///implementation of RKPostProcessor. It is designed to provide source-level backwards
 ///compatibility with the old `RKURLRequestPromise` post- processor implementation.
+///
+///Simple post-processors have no processing identifier, so the values produced
+///by chains that contain them are never reused by `RKProcessedValueCache`.
 @interface RKSimplePostProcessor : RKPostProcessor
 
 ///Initialize the receiver with an implementation block.
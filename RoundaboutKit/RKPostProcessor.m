@@ -34,6 +34,13 @@ NSString *const RKPostProcessorSourceURLErrorUserInfoKey = @"RKPostProcessorSour
     return value;
 }
 
+#pragma mark - Identity
+
+- (NSString *)processingIdentifier
+{
+    return nil;
+}
+
 @end
 
 #pragma mark -
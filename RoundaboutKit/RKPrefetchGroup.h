@@ -0,0 +1,84 @@
+//
+//  RKPrefetchGroup.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKPrefetchGroup_h
+#define RKPrefetchGroup_h 1
+
+#import <Foundation/Foundation.h>
+#import "RKPromise.h"
+
+@class RKURLRequestPromise, RKConnectivityManager;
+
+///The RKPrefetchGroup class encapsulates a group of requests whose only
+///purpose is to warm the cache managers of their request promises.
+///
+///A prefetch group realizes its request promises a few at a time, at
+///low priority, and discards the values they produce. Requests whose cache
+///manager already has a revision for their cache identifier are skipped, unless
+///the cache manager reports through `-expirationDateForIdentifier:` that it has expired.
+///
+///A prefetch group cancels itself when the device loses its internet
+///connection, when a request scheduler reports congestion for one of the
+///group's hosts, and on iOS, when the application receives a memory warning.
+///
+///Prefetch groups are typically created through `-[RKRequestFactory prefetchPaths:]`.
+@interface RKPrefetchGroup : NSObject <RKCancelable>
+
+///Initialize the receiver with an array of request promises.
+///
+/// \param  requestPromises The request promises to realize. Each promise should have
+///                         a cache manager, and should not have any post-processors. Required.
+///
+/// \result A fully initialized prefetch group.
+///
+///The receiver changes the scheduling priority of each promise to `kRKRequestSchedulerPriorityLow`.
+///
+///This is the designated initializer.
+- (instancetype)initWithRequestPromises:(NSArray *)requestPromises;
+
+#pragma mark - Properties
+
+///The request promises of the receiver.
+@property (readonly) NSArray *requestPromises;
+
+///The connectivity manager used to detect the loss of an internet connection.
+///
+///Defaults to `+[RKConnectivityManager defaultInternetConnectivityManager]`.
+///This property must not be changed after the receiver has been started.
+@property (nonatomic, strong) RKConnectivityManager *connectivityManager;
+
+///The largest number of requests that may be in flight at once. Defaults to 2.
+@property NSUInteger maximumConcurrentRequests;
+
+///A block to invoke on the main queue once the receiver has finished or been canceled.
+///
+///If the receiver has already finished when this property is set, the block is invoked immediately.
+@property (copy) dispatch_block_t completionHandler;
+
+#pragma mark - Progress
+
+///Whether or not every request of the receiver has finished or been skipped.
+@property (readonly) BOOL isFinished;
+
+///The number of requests that completed successfully.
+@property (readonly) NSUInteger numberOfCompletedRequests;
+
+///The number of requests that were skipped because their cache was already fresh.
+@property (readonly) NSUInteger numberOfSkippedRequests;
+
+///The number of requests that failed.
+@property (readonly) NSUInteger numberOfFailedRequests;
+
+#pragma mark - Starting
+
+///Begins realizing the receiver's request promises. Calling this method more than once does nothing.
+- (void)start;
+
+@end
+
+#endif /* RKPrefetchGroup_h */
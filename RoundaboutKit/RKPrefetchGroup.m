@@ -0,0 +1,326 @@
+//
+//  RKPrefetchGroup.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKPrefetchGroup.h"
+#import "RKURLRequestPromise.h"
+#import "RKConnectivityManager.h"
+#import "RKRequestScheduler.h"
+#import "RKQueueManager.h"
+
+#if TARGET_OS_IPHONE
+#   import <UIKit/UIKit.h>
+#endif /* TARGET_OS_IPHONE */
+
+///Returns whether or not the cache of a given request promise is populated with
+///data that has not expired, and so does not need to be fetched again.
+RK_INLINE BOOL request_promise_has_fresh_cache(RKURLRequestPromise *requestPromise)
+{
+    id <RKURLRequestPromiseCacheManager> cacheManager = requestPromise.cacheManager;
+    NSString *identifier = requestPromise.cacheIdentifier;
+    if([cacheManager revisionForIdentifier:identifier] == nil)
+        return NO;
+    
+    if(![cacheManager respondsToSelector:@selector(expirationDateForIdentifier:)])
+        return YES;
+    
+    NSDate *expirationDate = [cacheManager expirationDateForIdentifier:identifier];
+    return (expirationDate == nil || [expirationDate timeIntervalSinceNow] > 0.0);
+}
+
+#pragma mark -
+
+@interface RKPrefetchGroup ()
+
+#pragma mark - readwrite
+
+@property (readwrite) NSArray *requestPromises;
+@property (readwrite) BOOL isFinished;
+@property (readwrite) NSUInteger numberOfCompletedRequests;
+@property (readwrite) NSUInteger numberOfSkippedRequests;
+@property (readwrite) NSUInteger numberOfFailedRequests;
+
+@end
+
+#pragma mark -
+
+@implementation RKPrefetchGroup {
+    ///The request promises that have not been started yet. Guarded by `@synchronized(self)`.
+    NSMutableArray *_queuedRequestPromises;
+    
+    ///The request promises that are in flight. Guarded by `@synchronized(self)`.
+    NSMutableArray *_activeRequestPromises;
+    
+    ///The hosts of the receiver's requests, lowercased.
+    NSSet *_hosts;
+    
+    ///Whether or not the receiver has been started. Guarded by `@synchronized(self)`.
+    BOOL _started;
+    
+    ///The block registered with the connectivity manager.
+    RKConnectivityManagerStatusChangedBlock _connectivityChangedBlock;
+    
+    ///The completion handler. Guarded by `@synchronized(self)`.
+    dispatch_block_t _completionHandler;
+}
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
+    if(_connectivityChangedBlock)
+        [_connectivityManager unregisterStatusChangedBlock:_connectivityChangedBlock];
+}
+
+- (instancetype)initWithRequestPromises:(NSArray *)requestPromises
+{
+    NSParameterAssert(requestPromises);
+    
+    if((self = [super init])) {
+        self.requestPromises = requestPromises;
+        self.maximumConcurrentRequests = 2;
+        self.connectivityManager = [RKConnectivityManager defaultInternetConnectivityManager];
+        
+        NSMutableSet *hosts = [NSMutableSet set];
+        for (RKURLRequestPromise *requestPromise in requestPromises) {
+            requestPromise.schedulingPriority = kRKRequestSchedulerPriorityLow;
+            
+            NSString *host = [requestPromise.request.URL.host lowercaseString];
+            if(host)
+                [hosts addObject:host];
+        }
+        _hosts = hosts;
+        
+        _queuedRequestPromises = [requestPromises mutableCopy];
+        _activeRequestPromises = [NSMutableArray new];
+    }
+    
+    return self;
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+#pragma mark - Identity
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %ld requests, finished => %@>", NSStringFromClass([self class]), self, (long)self.requestPromises.count, (self.isFinished? @"YES" : @"NO")];
+}
+
+#pragma mark - Properties
+
+- (void)setCompletionHandler:(dispatch_block_t)completionHandler
+{
+    BOOL invokeImmediately = NO;
+    @synchronized(self) {
+        _completionHandler = [completionHandler copy];
+        invokeImmediately = (self.isFinished && completionHandler != nil);
+    }
+    
+    if(invokeImmediately)
+        dispatch_async(dispatch_get_main_queue(), completionHandler);
+}
+
+- (dispatch_block_t)completionHandler
+{
+    @synchronized(self) {
+        return _completionHandler;
+    }
+}
+
+#pragma mark - Starting
+
+- (void)start
+{
+    @synchronized(self) {
+        if(_started || _canceled)
+            return;
+        
+        _started = YES;
+    }
+    
+    __weak RKPrefetchGroup *weakSelf = self;
+    _connectivityChangedBlock = ^(RKConnectivityManager *sender) {
+        if(!sender.isConnected)
+            [weakSelf cancel:nil];
+    };
+    [self.connectivityManager registerStatusChangedBlock:_connectivityChangedBlock];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(requestSchedulerWindowDidChange:)
+                                                 name:RKRequestSchedulerWindowDidChangeNotification
+                                               object:nil];
+#if TARGET_OS_IPHONE
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(applicationDidReceiveMemoryWarning:)
+                                                 name:UIApplicationDidReceiveMemoryWarningNotification
+                                               object:nil];
+#endif /* TARGET_OS_IPHONE */
+    
+    if(!self.connectivityManager.isConnected) {
+        [self cancel:nil];
+        return;
+    }
+    
+    [self startQueuedRequests];
+}
+
+///Starts as many queued request promises as the receiver's concurrency limit allows.
+- (void)startQueuedRequests
+{
+    for (;;) {
+        //Candidates take their places among the active request promises before their
+        //cache is examined, so that concurrent callers never exceed the concurrency limit.
+        NSMutableArray *candidates = [NSMutableArray array];
+        BOOL finished = NO;
+        @synchronized(self) {
+            if(_canceled)
+                return;
+            
+            while (_queuedRequestPromises.count > 0 && _activeRequestPromises.count < self.maximumConcurrentRequests) {
+                RKURLRequestPromise *requestPromise = _queuedRequestPromises[0];
+                [_queuedRequestPromises removeObjectAtIndex:0];
+                [_activeRequestPromises addObject:requestPromise];
+                [candidates addObject:requestPromise];
+            }
+            
+            finished = (_queuedRequestPromises.count == 0 && _activeRequestPromises.count == 0);
+        }
+        
+        if(finished) {
+            [self finish];
+            return;
+        }
+        
+        if(candidates.count == 0)
+            return;
+        
+        //Requests whose cache is already fresh do not need to be fetched again. Cache managers
+        //may have to go to disk for revisions, so they are looked up outside of the lock.
+        NSMutableArray *requestPromisesToStart = [NSMutableArray array];
+        NSMutableArray *skippedRequestPromises = [NSMutableArray array];
+        for (RKURLRequestPromise *requestPromise in candidates) {
+            if(request_promise_has_fresh_cache(requestPromise))
+                [skippedRequestPromises addObject:requestPromise];
+            else
+                [requestPromisesToStart addObject:requestPromise];
+        }
+        
+        @synchronized(self) {
+            for (RKURLRequestPromise *requestPromise in skippedRequestPromises) {
+                [_activeRequestPromises removeObjectIdenticalTo:requestPromise];
+                self.numberOfSkippedRequests++;
+            }
+            
+            if(_canceled)
+                return;
+        }
+        
+        for (RKURLRequestPromise *requestPromise in requestPromisesToStart) {
+            [requestPromise then:^(id data) {
+                [self requestPromise:requestPromise didFinishWithError:nil];
+            } otherwise:^(NSError *error) {
+                [self requestPromise:requestPromise didFinishWithError:error];
+            } onQueue:[RKQueueManager commonWorkQueue]];
+        }
+        
+        //Skipped requests free their places for more of the queue.
+        if(skippedRequestPromises.count == 0)
+            return;
+    }
+}
+
+///Invoked when one of the receiver's request promises has been realized.
+- (void)requestPromise:(RKURLRequestPromise *)requestPromise didFinishWithError:(NSError *)error
+{
+    @synchronized(self) {
+        [_activeRequestPromises removeObjectIdenticalTo:requestPromise];
+        
+        if(error)
+            self.numberOfFailedRequests++;
+        else
+            self.numberOfCompletedRequests++;
+    }
+    
+    [self startQueuedRequests];
+}
+
+///Marks the receiver as finished, invoking its completion handler.
+- (void)finish
+{
+    dispatch_block_t completionHandler = nil;
+    @synchronized(self) {
+        if(self.isFinished)
+            return;
+        
+        self.isFinished = YES;
+        completionHandler = _completionHandler;
+    }
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    
+    if(_connectivityChangedBlock) {
+        [self.connectivityManager unregisterStatusChangedBlock:_connectivityChangedBlock];
+        _connectivityChangedBlock = nil;
+    }
+    
+    if(completionHandler)
+        dispatch_async(dispatch_get_main_queue(), completionHandler);
+}
+
+#pragma mark - Notifications
+
+- (void)requestSchedulerWindowDidChange:(NSNotification *)notification
+{
+    NSDictionary *sample = notification.userInfo;
+    if([sample[RKRequestSchedulerSampleReasonKey] isEqualToString:@"increase"])
+        return;
+    
+    if([_hosts containsObject:[sample[RKRequestSchedulerSampleHostKey] lowercaseString]])
+        [self cancel:nil];
+}
+
+#if TARGET_OS_IPHONE
+
+- (void)applicationDidReceiveMemoryWarning:(NSNotification *)notification
+{
+    [self cancel:nil];
+}
+
+#endif /* TARGET_OS_IPHONE */
+
+#pragma mark - RKCancelable
+
+@synthesize canceled = _canceled;
+
+- (void)cancel:(id)sender
+{
+    NSArray *activeRequestPromises = nil;
+    @synchronized(self) {
+        if(_canceled || self.isFinished)
+            return;
+        
+        [self willChangeValueForKey:@"canceled"];
+        _canceled = YES;
+        [self didChangeValueForKey:@"canceled"];
+        
+        activeRequestPromises = [_activeRequestPromises copy];
+        [_activeRequestPromises removeAllObjects];
+        [_queuedRequestPromises removeAllObjects];
+    }
+    
+    for (RKURLRequestPromise *requestPromise in activeRequestPromises)
+        [requestPromise cancel:sender];
+    
+    [self finish];
+}
+
+@end
@@ -280,6 +280,23 @@ RK_INLINE id RKFilterOutNSNull(id value)
 ///__Important:__ This function will be deprecated in a future version.
 RK_EXTERN NSString *RKStringGetMD5Hash(NSString *string);
 
+///Returns a fast, non-cryptographic 128-bit hash of a given string.
+///
+/// \param  string  The string to calculate the hash for. May be nil.
+///
+/// \result The 32 character hexadecimal MurmurHash3 (x64, 128-bit) hash of the string's UTF8 representation.
+///
+///This function is several times faster than `RKStringGetMD5Hash`, and is suitable for
+///deriving file names and keys from identifiers. It must not be used where resistance
+///to deliberately constructed collisions is required.
+RK_EXTERN NSString *RKStringGetFastHash(NSString *string);
+
+///Returns a fast, non-cryptographic 128-bit hash of the contents of a given data object.
+///
+///The result is in the same format as `RKStringGetFastHash`, and is
+///equal to it for data containing the UTF8 representation of a string.
+RK_EXTERN NSString *RKDataGetFastHash(NSData *data);
+
 #pragma mark -
 
 ///A block used to convert a value into a string suitable for inclusion in URL Parameters.
@@ -300,6 +300,107 @@ NSString *RKStringGetMD5Hash(NSString *string)
     return sanitizedIdentifier;
 }
 
+RK_INLINE uint64_t RKRotateLeft64(uint64_t value, int8_t amount)
+{
+    return (value << amount) | (value >> (64 - amount));
+}
+
+RK_INLINE uint64_t RKMurmurHashFinalizationMix64(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+///MurmurHash3_x64_128 by Austin Appleby, placed in the public domain.
+static void RKMurmurHash3_x64_128(const uint8_t *bytes, size_t length, uint64_t outHash[2])
+{
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0, h2 = 0;
+    
+    size_t numberOfBlocks = length / 16;
+    for (size_t block = 0; block < numberOfBlocks; block++) {
+        uint64_t k1, k2;
+        memcpy(&k1, bytes + block * 16, sizeof(k1));
+        memcpy(&k2, bytes + block * 16 + 8, sizeof(k2));
+        
+        k1 *= c1; k1 = RKRotateLeft64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = RKRotateLeft64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        
+        k2 *= c2; k2 = RKRotateLeft64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = RKRotateLeft64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+    
+    const uint8_t *tail = bytes + numberOfBlocks * 16;
+    size_t tailLength = length & 15;
+    uint64_t k1 = 0, k2 = 0;
+    for (size_t index = tailLength; index > 8; index--)
+        k2 ^= (uint64_t)tail[index - 1] << ((index - 9) * 8);
+    
+    for (size_t index = MIN(tailLength, (size_t)8); index > 0; index--)
+        k1 ^= (uint64_t)tail[index - 1] << ((index - 1) * 8);
+    
+    if(tailLength > 8) {
+        k2 *= c2; k2 = RKRotateLeft64(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    
+    if(tailLength > 0) {
+        k1 *= c1; k1 = RKRotateLeft64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+    
+    h1 ^= length;
+    h2 ^= length;
+    
+    h1 += h2;
+    h2 += h1;
+    
+    h1 = RKMurmurHashFinalizationMix64(h1);
+    h2 = RKMurmurHashFinalizationMix64(h2);
+    
+    h1 += h2;
+    h2 += h1;
+    
+    outHash[0] = h1;
+    outHash[1] = h2;
+}
+
+///Returns the hexadecimal representation of the MurmurHash3 hash of a given buffer.
+static NSString *RKGetFastHashOfBytes(const uint8_t *bytes, size_t length)
+{
+    uint64_t hash[2];
+    RKMurmurHash3_x64_128(bytes, length, hash);
+    
+    static const char kHexDigits[] = "0123456789abcdef";
+    char hexadecimal[32];
+    for (NSUInteger word = 0; word < 2; word++) {
+        for (NSUInteger nibble = 0; nibble < 16; nibble++)
+            hexadecimal[word * 16 + nibble] = kHexDigits[(hash[word] >> (60 - nibble * 4)) & 0xF];
+    }
+    
+    return [[NSString alloc] initWithBytes:hexadecimal length:sizeof(hexadecimal) encoding:NSASCIIStringEncoding];
+}
+
+NSString *RKStringGetFastHash(NSString *string)
+{
+    if(!string)
+        return nil;
+    
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8) ?: [string UTF8String];
+    return RKGetFastHashOfBytes((const uint8_t *)bytes, strlen(bytes));
+}
+
+NSString *RKDataGetFastHash(NSData *data)
+{
+    if(!data)
+        return nil;
+    
+    return RKGetFastHashOfBytes(data.bytes, data.length);
+}
+
 #pragma mark -
 
 RKURLParameterStringifier kRKURLParameterStringifierDefault = ^NSString *(id value) {
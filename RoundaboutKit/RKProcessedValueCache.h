@@ -0,0 +1,96 @@
+//
+//  RKProcessedValueCache.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKProcessedValueCache_h
+#define RKProcessedValueCache_h 1
+
+#import <Foundation/Foundation.h>
+
+///The RKProcessedValueCache class encapsulates a cache of the values post-processors
+///have produced from cached data, so that data that has not changed since it was last
+///post-processed does not have to be post-processed again.
+///
+///Values are cached under the cache identifier and revision of the data they were
+///produced from, and the processing identifiers of the chain of post-processors that
+///produced them. A value is only returned for the revision it was cached with, so
+///a value is replaced as soon as the data it was produced from is.
+///
+///Values are kept in memory, and are evicted when the system is low on memory. Caches
+///initialized with a location also persist the values that conform to `<NSCoding>`,
+///so that they outlive the cache and the process. Persisting is only worthwhile for
+///values that are costlier to produce than to unarchive, such as model objects.
+///
+///Values are shared by every client of a cache, and must not be mutated.
+///
+///The methods of this class may be called from any thread.
+@interface RKProcessedValueCache : NSObject
+
+///Returns the shared processed value cache, creating it if it does not already exist.
+///
+///The shared processed value cache does not persist its values.
++ (instancetype)sharedProcessedValueCache;
+
+///Initialize the receiver with the directory it should persist its values in.
+///
+/// \param  location    The location of the directory, or nil to not persist any values.
+///                     The directory is created if it does not already exist.
+///
+/// \result A fully initialized processed value cache.
+///
+///This is the designated initializer.
+- (instancetype)initWithLocation:(NSURL *)location;
+
+#pragma mark - Properties
+
+///The directory the receiver persists its values in, or nil if it does not persist its values.
+@property (readonly) NSURL *location;
+
+///The maximum number of values the receiver keeps in memory, or zero for no limit. Defaults to zero.
+@property NSUInteger countLimit;
+
+#pragma mark - Identity
+
+///Returns a string that identifies the processing a chain of post-processors performs,
+///or nil if the values the chain produces should never be reused.
+///
+/// \param  postProcessors  An array of `RKPostProcessor` objects. Required.
+///
+///The result is nil if the chain is empty, or if any of its post-processors has no
+///processing identifier. See `-[RKPostProcessor processingIdentifier]`.
++ (NSString *)identifierForPostProcessors:(NSArray *)postProcessors;
+
+#pragma mark - Values
+
+///Returns the value a chain of post-processors produced from a revision of some cached data.
+///
+/// \param  identifier      The cache identifier of the data. Required.
+/// \param  revision        The revision of the data. Required.
+/// \param  postProcessors  The post-processors the value must have been produced by. Required.
+///
+/// \result The value, or nil if there is none.
+///
+///Values persisted for an older revision of the data are removed.
+- (id)valueForIdentifier:(NSString *)identifier revision:(NSString *)revision postProcessors:(NSArray *)postProcessors;
+
+///Caches the value a chain of post-processors produced from a revision of some cached data.
+///
+/// \param  value           The value. Nil values are not cached.
+/// \param  identifier      The cache identifier of the data. Required.
+/// \param  revision        The revision of the data. Required.
+/// \param  postProcessors  The post-processors that produced the value. Required.
+///
+///Any value previously cached for the same data and post-processors is replaced.
+///Nothing is cached if the post-processors have no processing identifier.
+- (void)setValue:(id)value forIdentifier:(NSString *)identifier revision:(NSString *)revision postProcessors:(NSArray *)postProcessors;
+
+///Removes every value from the receiver, including those it has persisted.
+- (void)removeAllValues;
+
+@end
+
+#endif /* RKProcessedValueCache_h */
@@ -0,0 +1,248 @@
+//
+//  RKProcessedValueCache.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKProcessedValueCache.h"
+#import "RKPostProcessor.h"
+
+static NSString *const kPersistedIdentifierKey = @"identifier";
+static NSString *const kPersistedRevisionKey = @"revision";
+static NSString *const kPersistedPostProcessorsKey = @"postProcessors";
+static NSString *const kPersistedValueKey = @"value";
+
+///The extension of the files values are persisted in.
+static NSString *const kPersistedValueExtension = @"processedvalue";
+
+///A value cached in memory, along with the revision of the data it was produced from.
+@interface RKProcessedValueCacheItem : NSObject
+
+///The revision of the data the value was produced from.
+@property (copy) NSString *revision;
+
+///The value.
+@property id value;
+
+@end
+
+@implementation RKProcessedValueCacheItem
+
+@end
+
+#pragma mark -
+
+@implementation RKProcessedValueCache {
+    ///The values kept in memory.
+    ///
+    ///NSString => RKProcessedValueCacheItem.
+    NSCache *_memoryCache;
+    
+    ///The queue values are persisted on, so that callers never wait on archiving.
+    dispatch_queue_t _fileSystemQueue;
+}
+
++ (instancetype)sharedProcessedValueCache
+{
+    static RKProcessedValueCache *sharedProcessedValueCache = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedProcessedValueCache = [self new];
+    });
+    
+    return sharedProcessedValueCache;
+}
+
+- (instancetype)initWithLocation:(NSURL *)location
+{
+    if((self = [super init])) {
+        _location = location;
+        
+        _memoryCache = [NSCache new];
+        _memoryCache.name = @"com.roundabout.rk.RKProcessedValueCache.memoryCache";
+        
+        if(location) {
+            _fileSystemQueue = dispatch_queue_create("com.roundabout.rk.RKProcessedValueCache.fileSystemQueue", DISPATCH_QUEUE_SERIAL);
+            
+            NSError *error = nil;
+            if(![[NSFileManager defaultManager] createDirectoryAtURL:location
+                                         withIntermediateDirectories:YES
+                                                          attributes:nil
+                                                               error:&error]) {
+                [NSException raise:NSInternalInconsistencyException format:@"Could not create processed value cache location %@. %@", location, error];
+            }
+        }
+    }
+    
+    return self;
+}
+
+- (id)init
+{
+    return [self initWithLocation:nil];
+}
+
+#pragma mark - Properties
+
+- (void)setCountLimit:(NSUInteger)countLimit
+{
+    _memoryCache.countLimit = countLimit;
+}
+
+- (NSUInteger)countLimit
+{
+    return _memoryCache.countLimit;
+}
+
+#pragma mark - Identity
+
++ (NSString *)identifierForPostProcessors:(NSArray *)postProcessors
+{
+    NSParameterAssert(postProcessors);
+    
+    if(postProcessors.count == 0)
+        return nil;
+    
+    NSMutableArray *processingIdentifiers = [NSMutableArray arrayWithCapacity:postProcessors.count];
+    for (RKPostProcessor *postProcessor in postProcessors) {
+        NSString *processingIdentifier = [postProcessor processingIdentifier];
+        if(!processingIdentifier)
+            return nil;
+        
+        [processingIdentifiers addObject:processingIdentifier];
+    }
+    
+    return [processingIdentifiers componentsJoinedByString:@" > "];
+}
+
+///Returns the key a value produced from some cached data by a chain of post-processors is cached under.
+RK_INLINE NSString *key_for_value(NSString *identifier, NSString *postProcessorsIdentifier)
+{
+    return [NSString stringWithFormat:@"%@\n%@", postProcessorsIdentifier, identifier];
+}
+
+///Returns the location a value cached under a given key is persisted at.
+- (NSURL *)persistedLocationForKey:(NSString *)key
+{
+    return [[_location URLByAppendingPathComponent:RKStringGetFastHash(key)] URLByAppendingPathExtension:kPersistedValueExtension];
+}
+
+#pragma mark - Values
+
+- (id)valueForIdentifier:(NSString *)identifier revision:(NSString *)revision postProcessors:(NSArray *)postProcessors
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    
+    NSString *postProcessorsIdentifier = [self.class identifierForPostProcessors:postProcessors];
+    if(!postProcessorsIdentifier)
+        return nil;
+    
+    NSString *key = key_for_value(identifier, postProcessorsIdentifier);
+    RKProcessedValueCacheItem *item = [_memoryCache objectForKey:key];
+    if(item)
+        return [item.revision isEqualToString:revision]? item.value : nil;
+    
+    if(!_location)
+        return nil;
+    
+    NSURL *persistedLocation = [self persistedLocationForKey:key];
+    NSData *persistedData = [NSData dataWithContentsOfURL:persistedLocation options:NSDataReadingMappedIfSafe error:NULL];
+    if(!persistedData)
+        return nil;
+    
+    NSDictionary *persistedItem = nil;
+    @try {
+        persistedItem = [NSKeyedUnarchiver unarchiveObjectWithData:persistedData];
+    } @catch (NSException *e) {
+        RKLogWarning(@"Could not unarchive processed value for %@. %@", identifier, e);
+    }
+    
+    //Different keys may share a hash, so the identifiers are checked as well.
+    if(![persistedItem isKindOfClass:[NSDictionary class]] ||
+       ![persistedItem[kPersistedIdentifierKey] isEqual:identifier] ||
+       ![persistedItem[kPersistedPostProcessorsKey] isEqual:postProcessorsIdentifier])
+        return nil;
+    
+    if(![persistedItem[kPersistedRevisionKey] isEqual:revision] || !persistedItem[kPersistedValueKey]) {
+        dispatch_async(_fileSystemQueue, ^{
+            [[NSFileManager defaultManager] removeItemAtURL:persistedLocation error:NULL];
+        });
+        return nil;
+    }
+    
+    item = [RKProcessedValueCacheItem new];
+    item.revision = revision;
+    item.value = persistedItem[kPersistedValueKey];
+    [_memoryCache setObject:item forKey:key];
+    
+    return item.value;
+}
+
+- (void)setValue:(id)value forIdentifier:(NSString *)identifier revision:(NSString *)revision postProcessors:(NSArray *)postProcessors
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    
+    if(!value)
+        return;
+    
+    NSString *postProcessorsIdentifier = [self.class identifierForPostProcessors:postProcessors];
+    if(!postProcessorsIdentifier)
+        return;
+    
+    NSString *key = key_for_value(identifier, postProcessorsIdentifier);
+    RKProcessedValueCacheItem *item = [RKProcessedValueCacheItem new];
+    item.revision = revision;
+    item.value = value;
+    [_memoryCache setObject:item forKey:key];
+    
+    if(!_location)
+        return;
+    
+    NSURL *persistedLocation = [self persistedLocationForKey:key];
+    dispatch_async(_fileSystemQueue, ^{
+        if(![value conformsToProtocol:@protocol(NSCoding)]) {
+            //An older value may still be persisted under the key.
+            [[NSFileManager defaultManager] removeItemAtURL:persistedLocation error:NULL];
+            return;
+        }
+        
+        NSData *persistedData = nil;
+        @try {
+            persistedData = [NSKeyedArchiver archivedDataWithRootObject:@{ kPersistedIdentifierKey: identifier,
+                                                                            kPersistedRevisionKey: revision,
+                                                                            kPersistedPostProcessorsKey: postProcessorsIdentifier,
+                                                                            kPersistedValueKey: value }];
+        } @catch (NSException *e) {
+            RKLogWarning(@"Could not archive processed value for %@. %@", identifier, e);
+        }
+        
+        NSError *error = nil;
+        if(!persistedData) {
+            [[NSFileManager defaultManager] removeItemAtURL:persistedLocation error:NULL];
+        } else if(![persistedData writeToURL:persistedLocation options:NSDataWritingAtomic error:&error]) {
+            RKLogWarning(@"Could not persist processed value for %@. %@", identifier, error);
+        }
+    });
+}
+
+- (void)removeAllValues
+{
+    [_memoryCache removeAllObjects];
+    
+    if(!_location)
+        return;
+    
+    dispatch_sync(_fileSystemQueue, ^{
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        for (NSURL *persistedLocation in [fileManager contentsOfDirectoryAtURL:_location includingPropertiesForKeys:nil options:0 error:NULL]) {
+            if([persistedLocation.pathExtension isEqualToString:kPersistedValueExtension])
+                [fileManager removeItemAtURL:persistedLocation error:NULL];
+        }
+    });
+}
+
+@end
@@ -150,6 +150,17 @@ typedef void(^RKPromiseRejectedNotificationBlock)(NSError *error);
 ///Returns the post-processors of the promise.
 @property (nonatomic, copy) NSArray *postProcessors;
 
+///Runs the post-processors of the promise on the value it is being accepted with.
+///
+/// \param  value       The value the promise is being accepted with. May be nil.
+/// \param  outError    On return, the error of the first post-processor that failed, if any.
+///
+/// \result The value produced by the last post-processor.
+///
+///This method is invoked by `-[self accept:]` on the thread the promise is accepted from.
+///Subclasses may override it to produce their values without running their post-processors.
+- (id)postProcessAcceptedValue:(id)value error:(NSError **)outError;
+
 #pragma mark - Realizing
 
 ///Provided as a simple way for subclasses of RKPromise to conform to the
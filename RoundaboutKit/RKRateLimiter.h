@@ -0,0 +1,117 @@
+//
+//  RKRateLimiter.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKRateLimiter_h
+#define RKRateLimiter_h 1
+
+#import <Foundation/Foundation.h>
+
+@class RKRateLimiterTicket;
+
+///The RKRateLimiter class implements client-side token bucket rate limiting.
+///
+///A rate limiter consists of a default bucket and any number of additional buckets
+///associated with path patterns. Each bucket holds up to `burst` tokens and is refilled
+///at `rate` tokens per second. Every request takes a single token from the first bucket
+///whose pattern matches its URL's path, or the default bucket if no pattern matches.
+///Requests that arrive when their bucket is empty are queued in the order in which they
+///arrived, and are released as tokens become available. Requests are never failed by
+///a rate limiter.
+///
+///Rate limiters can be attached to an `RKRequestFactory` through its `rateLimiter`
+///property, or registered for a base URL through `+[RKRateLimiter setRateLimiter:forBaseURL:]`,
+///in which case they apply to every `RKURLRequestPromise` whose URL begins with that base URL.
+///
+///All of the methods on this class are safe to call from any thread.
+@interface RKRateLimiter : NSObject
+
+#pragma mark - Registration
+
+///Associates a rate limiter with every request whose URL begins with a given base URL.
+///
+/// \param  rateLimiter The rate limiter. Pass nil to remove the existing association.
+/// \param  baseURL     The base URL. Required.
+///
++ (void)setRateLimiter:(RKRateLimiter *)rateLimiter forBaseURL:(NSURL *)baseURL;
+
+///Returns the rate limiter registered for the longest base URL that a given URL begins with.
+///
+/// \param  url The URL to find a rate limiter for. Optional.
+///
+/// \result A rate limiter, or nil if none has been registered.
++ (RKRateLimiter *)rateLimiterForURL:(NSURL *)url;
+
+#pragma mark - Lifecycle
+
+///Initialize the receiver with the parameters of its default bucket.
+///
+/// \param  rate    The number of tokens added to the bucket each second. Must be greater than zero.
+/// \param  burst   The largest number of tokens the bucket can hold. Must be greater than zero.
+///
+/// \result A fully initialized rate limiter whose buckets start out full.
+///
+///This is the designated initializer.
+- (instancetype)initWithRate:(double)rate burst:(NSUInteger)burst;
+
+///Cannot initialize a rate limiter without a rate. Use `-[self initWithRate:burst:]`.
+- (id)init UNAVAILABLE_ATTRIBUTE;
+
+#pragma mark - Buckets
+
+///Adds a bucket for requests whose URL path matches a given pattern.
+///
+/// \param  rate        The number of tokens added to the bucket each second. Must be greater than zero.
+/// \param  burst       The largest number of tokens the bucket can hold. Must be greater than zero.
+/// \param  pathPattern A shell-style wildcard pattern, such as `/v1/search/*`. Required.
+///
+///Patterns are matched in the order in which they are added. Calling this
+///method with an existing pattern replaces the parameters of its bucket.
+- (void)setRate:(double)rate burst:(NSUInteger)burst forPathPattern:(NSString *)pathPattern;
+
+#pragma mark - Admission
+
+///Enqueues a block that starts a request, invoking it once the request's bucket has a token.
+///
+/// \param  request The request that will be started. Required.
+/// \param  block   The block to invoke when the request may start. Required. The block may be
+///                 invoked synchronously if a token is available, otherwise it is invoked on
+///                 a background queue.
+///
+/// \result A ticket that can be passed to `-[self cancelTicket:]`.
+- (RKRateLimiterTicket *)enqueueRequest:(NSURLRequest *)request withBlock:(dispatch_block_t)block RK_REQUIRE_RESULT_USED;
+
+///Removes a ticket from the receiver's queue. If the ticket's block has not been invoked yet, it never will be.
+///
+/// \param  ticket  The ticket to cancel. Optional.
+///
+- (void)cancelTicket:(RKRateLimiterTicket *)ticket;
+
+#pragma mark - Statistics
+
+///The number of requests currently waiting for a token across all buckets.
+@property (readonly) NSUInteger queueDepth;
+
+///The number of requests that had to wait for a token.
+@property (readonly) NSUInteger numberOfDelayedRequests;
+
+///The average amount of time requests that had to wait for a token waited.
+@property (readonly) NSTimeInterval averageWaitTime;
+
+///The longest amount of time a request has waited for a token.
+@property (readonly) NSTimeInterval maximumWaitTime;
+
+///Returns a dictionary describing each of the receiver's buckets.
+///
+///The keys are the path patterns of the buckets, with the default bucket using
+///the key `*`. The values are dictionaries with the keys `rate`, `burst`, `tokens`,
+///and `queueDepth`.
+- (NSDictionary *)bucketStatistics;
+
+@end
+
+#endif /* RKRateLimiter_h */
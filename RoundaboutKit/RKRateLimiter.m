@@ -0,0 +1,384 @@
+//
+//  RKRateLimiter.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKRateLimiter.h"
+#import <fnmatch.h>
+
+///The pattern used to identify the default bucket in statistics.
+static NSString *const kDefaultBucketPattern = @"*";
+
+#pragma mark -
+
+@interface RKRateLimiterTicket : NSObject
+
+///The block that starts the ticket's request.
+@property (copy) dispatch_block_t block;
+
+///The time at which the ticket was enqueued.
+@property CFAbsoluteTime enqueueTime;
+
+///Whether or not the ticket has been admitted or canceled.
+@property BOOL isFinished;
+
+@end
+
+@implementation RKRateLimiterTicket
+
+@end
+
+#pragma mark -
+
+///A single token bucket and the tickets waiting on it.
+@interface RKRateLimiterBucket : NSObject
+
+///The pattern of the bucket.
+@property (copy) NSString *pathPattern;
+
+///The number of tokens added to the bucket each second.
+@property double rate;
+
+///The largest number of tokens the bucket can hold.
+@property NSUInteger burst;
+
+///The number of tokens currently in the bucket.
+@property double tokens;
+
+///The time the bucket was last refilled.
+@property CFAbsoluteTime lastRefillTime;
+
+///The tickets waiting for a token, oldest first.
+@property (readonly) NSMutableArray *queue;
+
+@end
+
+@implementation RKRateLimiterBucket
+
+- (instancetype)initWithPathPattern:(NSString *)pathPattern rate:(double)rate burst:(NSUInteger)burst
+{
+    if((self = [super init])) {
+        self.pathPattern = pathPattern;
+        self.rate = rate;
+        self.burst = burst;
+        self.tokens = burst;
+        self.lastRefillTime = CFAbsoluteTimeGetCurrent();
+        _queue = [NSMutableArray new];
+    }
+    
+    return self;
+}
+
+- (void)refillAtTime:(CFAbsoluteTime)now
+{
+    self.tokens = MIN(self.tokens + (now - self.lastRefillTime) * self.rate, (double)self.burst);
+    self.lastRefillTime = now;
+}
+
+- (BOOL)matchesPath:(NSString *)path
+{
+    return (fnmatch([self.pathPattern UTF8String], [path UTF8String], 0) == 0);
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKRateLimiter {
+    ///The queue that regulates access to the buckets and statistics.
+    dispatch_queue_t _stateQueue;
+    
+    ///The bucket used when no path pattern matches.
+    RKRateLimiterBucket *_defaultBucket;
+    
+    ///The buckets associated with path patterns, in the order they were added.
+    NSMutableArray *_patternBuckets;
+    
+    ///The time at which a drain has been scheduled. Zero if none is scheduled.
+    CFAbsoluteTime _scheduledDrainTime;
+    
+    ///The total amount of time delayed requests have waited.
+    NSTimeInterval _totalWaitTime;
+}
+
+#pragma mark - Registration
+
+///Returns the registered rate limiters. Access must be synchronized on the returned object.
+///
+///NSString => RKRateLimiter.
++ (NSMutableDictionary *)registeredRateLimiters
+{
+    static NSMutableDictionary *registeredRateLimiters = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registeredRateLimiters = [NSMutableDictionary new];
+    });
+    
+    return registeredRateLimiters;
+}
+
++ (void)setRateLimiter:(RKRateLimiter *)rateLimiter forBaseURL:(NSURL *)baseURL
+{
+    NSParameterAssert(baseURL);
+    
+    NSMutableDictionary *registeredRateLimiters = [self registeredRateLimiters];
+    @synchronized(registeredRateLimiters) {
+        if(rateLimiter)
+            registeredRateLimiters[[baseURL absoluteString]] = rateLimiter;
+        else
+            [registeredRateLimiters removeObjectForKey:[baseURL absoluteString]];
+    }
+}
+
++ (RKRateLimiter *)rateLimiterForURL:(NSURL *)url
+{
+    if(!url)
+        return nil;
+    
+    NSString *urlString = [url absoluteString];
+    NSMutableDictionary *registeredRateLimiters = [self registeredRateLimiters];
+    @synchronized(registeredRateLimiters) {
+        NSString *longestMatch = nil;
+        for (NSString *baseURLString in registeredRateLimiters) {
+            if([urlString hasPrefix:baseURLString] && baseURLString.length > longestMatch.length)
+                longestMatch = baseURLString;
+        }
+        
+        return longestMatch? registeredRateLimiters[longestMatch] : nil;
+    }
+}
+
+#pragma mark - Lifecycle
+
+- (instancetype)initWithRate:(double)rate burst:(NSUInteger)burst
+{
+    NSParameterAssert(rate > 0.0);
+    NSParameterAssert(burst > 0);
+    
+    if((self = [super init])) {
+        _stateQueue = dispatch_queue_create("com.roundabout.rk.RKRateLimiter.stateQueue", DISPATCH_QUEUE_SERIAL);
+        _defaultBucket = [[RKRateLimiterBucket alloc] initWithPathPattern:kDefaultBucketPattern rate:rate burst:burst];
+        _patternBuckets = [NSMutableArray new];
+    }
+    
+    return self;
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+#pragma mark - Buckets
+
+- (void)setRate:(double)rate burst:(NSUInteger)burst forPathPattern:(NSString *)pathPattern
+{
+    NSParameterAssert(rate > 0.0);
+    NSParameterAssert(burst > 0);
+    NSParameterAssert(pathPattern);
+    
+    dispatch_sync(_stateQueue, ^{
+        for (RKRateLimiterBucket *bucket in _patternBuckets) {
+            if([bucket.pathPattern isEqualToString:pathPattern]) {
+                [bucket refillAtTime:CFAbsoluteTimeGetCurrent()];
+                bucket.rate = rate;
+                bucket.burst = burst;
+                bucket.tokens = MIN(bucket.tokens, (double)burst);
+                return;
+            }
+        }
+        
+        [_patternBuckets addObject:[[RKRateLimiterBucket alloc] initWithPathPattern:pathPattern rate:rate burst:burst]];
+    });
+}
+
+#pragma mark - Internal
+
+///Returns the bucket for a given request.
+///
+///This method assumes it is being called from within `_stateQueue`.
+- (RKRateLimiterBucket *)bucketForRequest:(NSURLRequest *)request
+{
+    NSString *path = request.URL.path.length > 0? request.URL.path : @"/";
+    for (RKRateLimiterBucket *bucket in _patternBuckets) {
+        if([bucket matchesPath:path])
+            return bucket;
+    }
+    
+    return _defaultBucket;
+}
+
+///Admits as many queued tickets as the buckets have tokens for, returning the blocks
+///that must be invoked, and schedules a future drain if any tickets remain queued.
+///
+///This method assumes it is being called from within `_stateQueue`.
+- (NSArray *)drainBuckets
+{
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSMutableArray *blocks = [NSMutableArray array];
+    NSTimeInterval nextDrainDelay = INFINITY;
+    
+    for (RKRateLimiterBucket *bucket in [_patternBuckets arrayByAddingObject:_defaultBucket]) {
+        [bucket refillAtTime:now];
+        
+        while (bucket.queue.count > 0 && bucket.tokens >= 1.0) {
+            RKRateLimiterTicket *ticket = bucket.queue[0];
+            [bucket.queue removeObjectAtIndex:0];
+            
+            bucket.tokens -= 1.0;
+            ticket.isFinished = YES;
+            [blocks addObject:ticket.block];
+            ticket.block = nil;
+            
+            NSTimeInterval waitTime = now - ticket.enqueueTime;
+            if(waitTime > 0.0) {
+                _numberOfDelayedRequests++;
+                _totalWaitTime += waitTime;
+                _maximumWaitTime = MAX(_maximumWaitTime, waitTime);
+            }
+        }
+        
+        if(bucket.queue.count > 0)
+            nextDrainDelay = MIN(nextDrainDelay, (1.0 - bucket.tokens) / bucket.rate);
+    }
+    
+    if(nextDrainDelay != INFINITY) {
+        CFAbsoluteTime drainTime = now + nextDrainDelay;
+        if(_scheduledDrainTime == 0.0 || drainTime < _scheduledDrainTime) {
+            _scheduledDrainTime = drainTime;
+            
+            __weak RKRateLimiter *weakSelf = self;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(nextDrainDelay * NSEC_PER_SEC)),
+                           dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                [weakSelf scheduledDrain];
+            });
+        }
+    }
+    
+    return blocks;
+}
+
+///Invoked when a scheduled drain fires.
+- (void)scheduledDrain
+{
+    __block NSArray *blocksToInvoke = nil;
+    dispatch_sync(_stateQueue, ^{
+        _scheduledDrainTime = 0.0;
+        blocksToInvoke = [self drainBuckets];
+    });
+    
+    for (dispatch_block_t block in blocksToInvoke)
+        block();
+}
+
+#pragma mark - Admission
+
+- (RKRateLimiterTicket *)enqueueRequest:(NSURLRequest *)request withBlock:(dispatch_block_t)block
+{
+    NSParameterAssert(request);
+    NSParameterAssert(block);
+    
+    RKRateLimiterTicket *ticket = [RKRateLimiterTicket new];
+    ticket.block = block;
+    ticket.enqueueTime = CFAbsoluteTimeGetCurrent();
+    
+    __block NSArray *blocksToInvoke = nil;
+    dispatch_sync(_stateQueue, ^{
+        RKRateLimiterBucket *bucket = [self bucketForRequest:request];
+        [bucket.queue addObject:ticket];
+        blocksToInvoke = [self drainBuckets];
+    });
+    
+    for (dispatch_block_t block in blocksToInvoke)
+        block();
+    
+    return ticket;
+}
+
+- (void)cancelTicket:(RKRateLimiterTicket *)ticket
+{
+    if(!ticket)
+        return;
+    
+    dispatch_sync(_stateQueue, ^{
+        if(ticket.isFinished)
+            return;
+        
+        ticket.isFinished = YES;
+        ticket.block = nil;
+        
+        for (RKRateLimiterBucket *bucket in [_patternBuckets arrayByAddingObject:_defaultBucket])
+            [bucket.queue removeObjectIdenticalTo:ticket];
+    });
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)queueDepth
+{
+    __block NSUInteger queueDepth = 0;
+    dispatch_sync(_stateQueue, ^{
+        for (RKRateLimiterBucket *bucket in [_patternBuckets arrayByAddingObject:_defaultBucket])
+            queueDepth += bucket.queue.count;
+    });
+    
+    return queueDepth;
+}
+
+@synthesize numberOfDelayedRequests = _numberOfDelayedRequests;
+
+- (NSUInteger)numberOfDelayedRequests
+{
+    __block NSUInteger numberOfDelayedRequests = 0;
+    dispatch_sync(_stateQueue, ^{
+        numberOfDelayedRequests = _numberOfDelayedRequests;
+    });
+    
+    return numberOfDelayedRequests;
+}
+
+- (NSTimeInterval)averageWaitTime
+{
+    __block NSTimeInterval averageWaitTime = 0.0;
+    dispatch_sync(_stateQueue, ^{
+        if(_numberOfDelayedRequests > 0)
+            averageWaitTime = _totalWaitTime / _numberOfDelayedRequests;
+    });
+    
+    return averageWaitTime;
+}
+
+@synthesize maximumWaitTime = _maximumWaitTime;
+
+- (NSTimeInterval)maximumWaitTime
+{
+    __block NSTimeInterval maximumWaitTime = 0.0;
+    dispatch_sync(_stateQueue, ^{
+        maximumWaitTime = _maximumWaitTime;
+    });
+    
+    return maximumWaitTime;
+}
+
+- (NSDictionary *)bucketStatistics
+{
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionary];
+    dispatch_sync(_stateQueue, ^{
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        for (RKRateLimiterBucket *bucket in [_patternBuckets arrayByAddingObject:_defaultBucket]) {
+            [bucket refillAtTime:now];
+            statistics[bucket.pathPattern] = @{@"rate": @(bucket.rate),
+                                               @"burst": @(bucket.burst),
+                                               @"tokens": @(bucket.tokens),
+                                               @"queueDepth": @(bucket.queue.count)};
+        }
+    });
+    
+    return statistics;
+}
+
+@end
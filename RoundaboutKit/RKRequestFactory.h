@@ -10,7 +10,7 @@
 #import "RKPostProcessor.h"
 
 @protocol RKURLRequestPromiseCacheManager, RKURLRequestAuthenticationHandler;
-@class RKURLRequestPromise;
+@class RKURLRequestPromise, RKRateLimiter, RKPrefetchGroup;
 
 ///The different possible types of POST/PUT body types.
 typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
@@ -22,8 +22,27 @@ typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
     
     ///The body is a JSON object.
     kRKRequestFactoryBodyTypeJSON = 2,
+    
+    ///The body is a file URL whose contents are streamed to the server.
+    kRKRequestFactoryBodyTypeFile = 3,
+    
+    ///The body is an `RKRequestFactoryBodyChunkGenerator` block whose
+    ///chunks are streamed to the server as they are produced.
+    kRKRequestFactoryBodyTypeChunkGenerator = 4,
+    
+    ///The body is an NSArray or NSEnumerator of JSON objects that are serialized
+    ///one at a time and streamed to the server as a single JSON array.
+    kRKRequestFactoryBodyTypeStreamingJSONArray = 5,
 };
 
+///A block that produces the body of a request one chunk at a time.
+///
+///The block is invoked repeatedly on the connection's thread until it returns nil, which
+///marks the end of the body. The block is only invoked when the connection needs more of
+///the body to send, so it is never invoked for a request that is not sent, and the memory
+///used by a streamed body is roughly constant. The block should not block for long.
+typedef NSData *(^RKRequestFactoryBodyChunkGenerator)(void);
+
 ///The RKRequestFactory class encapsulates the common logic necessary to create RKURLRequestPromises.
 ///
 ///A factory is capable of dispensing properly formed route URLs, NSURLRequests, and RKURLRequestPromises.
@@ -32,6 +51,14 @@ typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
 ///and one used for POST, and PUT requests (the write manager). This is done with the belief that
 ///caching behaviour will likely vary in clients between reading and writing requests.
 ///
+///Bodies of the types `kRKRequestFactoryBodyTypeFile`, `kRKRequestFactoryBodyTypeChunkGenerator`,
+///and `kRKRequestFactoryBodyTypeStreamingJSONArray` are provided to requests through
+///`-[NSURLRequest HTTPBodyStream]`, and are never loaded into memory in their entirety.
+///Streamed bodies other than files are sent with chunked transfer encoding. File bodies are
+///reopened if the connection has to resend its request, such as when it is redirected or
+///challenged for authentication. Chunk generators and streaming JSON arrays can only be
+///consumed once, so requests whose bodies they produce fail if they have to be resent.
+///
 ///RKRequestFactory is not intended to be subclassed.
 @interface RKRequestFactory : NSObject
 
@@ -76,6 +103,11 @@ typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
 ///The authentication handler to use for requests.
 @property (strong, RK_NONATOMIC_IOSONLY) id <RKURLRequestAuthenticationHandler> authenticationHandler;
 
+///The rate limiter requests dispensed by the receiver must take a token from before they start.
+///
+///Defaults to nil, in which case requests use the rate limiter registered for their URL, if any.
+@property (strong, RK_NONATOMIC_IOSONLY) RKRateLimiter *rateLimiter;
+
 ///The stringifier to use when serializing dictionaries into URL parameter strings.
 ///
 ///Defaults to `kRKURLParameterStringifierDefault`. This property may not be nil.
@@ -205,6 +237,41 @@ typedef NS_ENUM(NSUInteger, RKRequestFactoryBodyType) {
                                               body:(id)body
                                           bodyType:(RKRequestFactoryBodyType)bodyType RK_REQUIRE_RESULT_USED;
 
+#pragma mark - Prefetching
+
+///Begins fetching a given array of paths into the receiver's read cache manager.
+///
+/// \param  paths   An array of paths, interpreted relative to the receiver's base URL. Required.
+///
+/// \result A started prefetch group that may be used to cancel the fetches.
+///
+///The requests of the returned group are GET requests with the receiver's additional
+///headers and authentication handler, but without its post-processors. They are sent
+///at background priority, and paths whose cache is already populated are skipped.
+///If the receiver has no read cache manager, the returned group does nothing.
+///
+/// \seealso(RKPrefetchGroup)
+- (RKPrefetchGroup *)prefetchPaths:(NSArray *)paths;
+
+///Begins fetching a given array of URLs into the receiver's read cache manager.
+///
+/// \param  URLs    An array of absolute URLs. Required.
+///
+/// \result A started prefetch group that may be used to cancel the fetches.
+///
+/// \seealso(-[self prefetchPaths:])
+- (RKPrefetchGroup *)prefetchURLs:(NSArray *)URLs;
+
+///Returns a prefetch group for a given array of URLs that has not been started yet.
+///
+/// \param  URLs    An array of absolute URLs. Required.
+///
+/// \result A prefetch group whose requests are configured as described by `-[self prefetchPaths:]`.
+///
+///This method is useful for configuring the group, such as its connectivity manager,
+///maximum number of concurrent requests and completion handler, before starting it.
+- (RKPrefetchGroup *)prefetchGroupWithURLs:(NSArray *)URLs RK_REQUIRE_RESULT_USED;
+
 @end
 
 #pragma mark -
@@ -8,6 +8,241 @@
 
 #import "RKRequestFactory.h"
 #import "RKURLRequestPromise.h"
+#import "RKPrefetchGroup.h"
+
+///The approximate size of the chunks produced when streaming a JSON array.
+static NSUInteger const kStreamingJSONChunkSize = (32 * 1024);
+
+///A block that produces the body of a request one chunk at a time, and can fail.
+///
+///Returns nil once the body has been produced, or nil with an error if it cannot be.
+typedef NSData *(^RKStreamedBodyChunkProducer)(NSError **outError);
+
+///The RKStreamedBodyInputStream class implements an input stream whose contents
+///are pulled from a chunk producer as they are read.
+///
+///Nothing is produced until the stream's reader first asks for bytes, so a request that is
+///never sent never runs its producer, and the producer runs on the reader's own thread.
+///NSURLConnection reads body streams on demand, so the stream never has to signal events.
+@interface RKStreamedBodyInputStream : NSInputStream
+
+///Initialize the receiver with the producer of its contents.
+- (instancetype)initWithChunkProducer:(RKStreamedBodyChunkProducer)producer;
+
+@end
+
+@implementation RKStreamedBodyInputStream {
+    ///The producer of the receiver's contents. Released once the body has been produced.
+    RKStreamedBodyChunkProducer _producer;
+    
+    ///The chunk currently being read, and how much of it has been read.
+    NSData *_chunk;
+    NSUInteger _chunkOffset;
+    
+    NSStreamStatus _streamStatus;
+    NSError *_streamError;
+    
+    __weak id <NSStreamDelegate> _delegate;
+}
+
+- (instancetype)initWithChunkProducer:(RKStreamedBodyChunkProducer)producer
+{
+    NSParameterAssert(producer);
+    
+    if((self = [super init])) {
+        _producer = [producer copy];
+        _streamStatus = NSStreamStatusNotOpen;
+    }
+    
+    return self;
+}
+
+#pragma mark - NSStream
+
+- (void)open
+{
+    if(_streamStatus == NSStreamStatusNotOpen)
+        _streamStatus = NSStreamStatusOpen;
+}
+
+- (void)close
+{
+    _streamStatus = NSStreamStatusClosed;
+    _producer = nil;
+    _chunk = nil;
+}
+
+- (NSStreamStatus)streamStatus
+{
+    return _streamStatus;
+}
+
+- (NSError *)streamError
+{
+    return _streamError;
+}
+
+- (id <NSStreamDelegate>)delegate
+{
+    return _delegate;
+}
+
+- (void)setDelegate:(id <NSStreamDelegate>)delegate
+{
+    _delegate = delegate;
+}
+
+- (id)propertyForKey:(NSString *)key
+{
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSString *)key
+{
+    return NO;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode
+{
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)runLoop forMode:(NSString *)mode
+{
+}
+
+#pragma mark - NSInputStream
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)length
+{
+    if(_streamStatus != NSStreamStatusOpen)
+        return (_streamStatus == NSStreamStatusError)? -1 : 0;
+    
+    _streamStatus = NSStreamStatusReading;
+    
+    NSUInteger totalRead = 0;
+    while (totalRead < length) {
+        if(_chunkOffset >= _chunk.length) {
+            //Return what has been read rather than waiting on the producer.
+            if(totalRead > 0)
+                break;
+            
+            NSError *error = nil;
+            @autoreleasepool {
+                _chunk = _producer(&error);
+            }
+            _chunkOffset = 0;
+            
+            if(!_chunk) {
+                _producer = nil;
+                if(error) {
+                    _streamError = error;
+                    _streamStatus = NSStreamStatusError;
+                    return -1;
+                }
+                
+                _streamStatus = NSStreamStatusAtEnd;
+                return totalRead;
+            }
+            
+            continue;
+        }
+        
+        NSUInteger chunkLength = MIN(_chunk.length - _chunkOffset, length - totalRead);
+        [_chunk getBytes:buffer + totalRead range:NSMakeRange(_chunkOffset, chunkLength)];
+        _chunkOffset += chunkLength;
+        totalRead += chunkLength;
+    }
+    
+    _streamStatus = NSStreamStatusOpen;
+    return totalRead;
+}
+
+- (BOOL)getBuffer:(uint8_t **)buffer length:(NSUInteger *)length
+{
+    return NO;
+}
+
+- (BOOL)hasBytesAvailable
+{
+    return (_streamStatus == NSStreamStatusOpen);
+}
+
+#pragma mark - CFReadStream Bridging
+
+//CFNetwork schedules body streams through these private methods, which NSInputStream
+//subclasses must implement. The receiver never signals events, so they do nothing.
+
+- (void)_scheduleInCFRunLoop:(CFRunLoopRef)runLoop forMode:(CFStringRef)mode
+{
+}
+
+- (void)_unscheduleFromCFRunLoop:(CFRunLoopRef)runLoop forMode:(CFStringRef)mode
+{
+}
+
+- (BOOL)_setCFClientFlags:(CFOptionFlags)flags callback:(CFReadStreamClientCallBack)callback context:(CFStreamClientContext *)context
+{
+    return NO;
+}
+
+@end
+
+#pragma mark -
+
+///Returns a chunk producer that serializes the elements of a given enumerator as a JSON array.
+///
+///Each element is serialized by wrapping it in a single element array, and
+///stripping the brackets, so elements may be any valid JSON value. An element
+///that cannot be serialized fails the stream with the serialization error.
+static RKStreamedBodyChunkProducer RKStreamingJSONArrayChunkProducer(NSEnumerator *elements)
+{
+    __block BOOL startedArray = NO;
+    __block BOOL finishedArray = NO;
+    __block BOOL needsSeparator = NO;
+    return ^NSData *(NSError **outError) {
+        if(finishedArray)
+            return nil;
+        
+        NSMutableData *chunk = [NSMutableData dataWithCapacity:kStreamingJSONChunkSize];
+        if(!startedArray) {
+            [chunk appendBytes:"[" length:1];
+            startedArray = YES;
+        }
+        
+        while (chunk.length < kStreamingJSONChunkSize) {
+            id element = [elements nextObject];
+            if(!element) {
+                [chunk appendBytes:"]" length:1];
+                finishedArray = YES;
+                break;
+            }
+            
+            NSData *wrappedElement = nil;
+            if([NSJSONSerialization isValidJSONObject:@[ element ]])
+                wrappedElement = [NSJSONSerialization dataWithJSONObject:@[ element ] options:0 error:outError];
+            
+            if(!wrappedElement) {
+                if(outError && !*outError)
+                    *outError = [NSError errorWithDomain:NSCocoaErrorDomain
+                                                    code:NSPropertyListWriteInvalidError
+                                                userInfo:@{NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not convert %@ to JSON.", element]}];
+                
+                finishedArray = YES;
+                return nil;
+            }
+            
+            if(needsSeparator)
+                [chunk appendBytes:"," length:1];
+            
+            [chunk appendBytes:((const uint8_t *)wrappedElement.bytes + 1) length:wrappedElement.length - 2];
+            needsSeparator = YES;
+        }
+        
+        return chunk;
+    };
+}
+
+#pragma mark -
 
 @interface RKRequestFactory () {
     NSOperationQueue *_legacyRequestQueue;
@@ -67,15 +302,20 @@
 
 #pragma mark - Dispensing NSURLRequests
 
-- (NSMutableURLRequest *)baseRequestWithPath:(NSString *)path parameters:(NSDictionary *)parameters
+- (NSMutableURLRequest *)baseRequestWithURL:(NSURL *)URL
 {
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[self URLWithPath:path parameters:parameters]];
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL];
     for (id key in [self.additionalHeaders allKeys]) {
         [request addValue:[self.additionalHeaders objectForKey:key]  forHTTPHeaderField:key];
     }
     return request;
 }
 
+- (NSMutableURLRequest *)baseRequestWithPath:(NSString *)path parameters:(NSDictionary *)parameters
+{
+    return [self baseRequestWithURL:[self URLWithPath:path parameters:parameters]];
+}
+
 - (NSURLRequest *)GETRequestWithPath:(NSString *)path parameters:(NSDictionary *)parameters
 {
     NSMutableURLRequest *request = [self baseRequestWithPath:path parameters:parameters];
@@ -119,6 +359,54 @@
             return JSONData;
         }
             
+        case kRKRequestFactoryBodyTypeFile:
+        case kRKRequestFactoryBodyTypeChunkGenerator:
+        case kRKRequestFactoryBodyTypeStreamingJSONArray: {
+            [NSException raise:NSInternalInconsistencyException format:@"Streamed bodies cannot be converted to data."];
+            return nil;
+        }
+            
+    }
+}
+
+- (void)setBody:(id)body bodyType:(RKRequestFactoryBodyType)bodyType forRequest:(NSMutableURLRequest *)request
+{
+    if(!body)
+        return;
+    
+    switch (bodyType) {
+        case kRKRequestFactoryBodyTypeFile: {
+            NSAssert([body isKindOfClass:[NSURL class]] && [body isFileURL], @"File bodies must be file URLs");
+            
+            //A file that cannot be read fails the request's connection with the file's error
+            //when the connection opens the stream, so it is reported through the request promise.
+            NSNumber *fileSize = nil;
+            if([body getResourceValue:&fileSize forKey:NSURLFileSizeKey error:NULL] && fileSize)
+                [request setValue:[fileSize stringValue] forHTTPHeaderField:@"Content-Length"];
+            
+            [request setHTTPBodyStream:[NSInputStream inputStreamWithURL:body]];
+            [NSURLProtocol setProperty:[body path] forKey:RKURLRequestPromiseBodyFilePathPropertyKey inRequest:request];
+            break;
+        }
+            
+        case kRKRequestFactoryBodyTypeChunkGenerator: {
+            RKRequestFactoryBodyChunkGenerator generator = body;
+            [request setHTTPBodyStream:[[RKStreamedBodyInputStream alloc] initWithChunkProducer:^NSData *(NSError **outError) {
+                return generator();
+            }]];
+            break;
+        }
+            
+        case kRKRequestFactoryBodyTypeStreamingJSONArray: {
+            NSEnumerator *elements = [body isKindOfClass:[NSEnumerator class]]? body : [body objectEnumerator];
+            [request setHTTPBodyStream:[[RKStreamedBodyInputStream alloc] initWithChunkProducer:RKStreamingJSONArrayChunkProducer(elements)]];
+            break;
+        }
+            
+        default: {
+            [request setHTTPBody:[self bodyForPayload:body bodyType:bodyType]];
+            break;
+        }
     }
 }
 
@@ -126,7 +414,7 @@
 {
     NSMutableURLRequest *request = [self baseRequestWithPath:path parameters:parameters];
     [request setHTTPMethod:@"POST"];
-    [request setHTTPBody:[self bodyForPayload:body bodyType:bodyType]];
+    [self setBody:body bodyType:bodyType forRequest:request];
     return request;
 }
 
@@ -134,7 +422,7 @@
 {
     NSMutableURLRequest *request = [self baseRequestWithPath:path parameters:parameters];
     [request setHTTPMethod:@"PUT"];
-    [request setHTTPBody:[self bodyForPayload:body bodyType:bodyType]];
+    [self setBody:body bodyType:bodyType forRequest:request];
     return request;
 }
 
@@ -157,6 +445,8 @@
                                                                           cacheManager:cacheManager];
     [requestPromise addPostProcessors:self.postProcessors];
     requestPromise.authenticationHandler = self.authenticationHandler;
+    if(self.rateLimiter)
+        requestPromise.rateLimiter = self.rateLimiter;
     return requestPromise;
 }
 
@@ -190,6 +480,52 @@
     return [self requestPromiseWithRequest:[self PUTRequestWithPath:path parameters:parameters body:body bodyType:bodyType]];
 }
 
+#pragma mark - Prefetching
+
+- (RKPrefetchGroup *)prefetchPaths:(NSArray *)paths
+{
+    NSParameterAssert(paths);
+    
+    NSMutableArray *URLs = [NSMutableArray arrayWithCapacity:paths.count];
+    for (NSString *path in paths)
+        [URLs addObject:[self URLWithPath:path parameters:nil]];
+    
+    return [self prefetchURLs:URLs];
+}
+
+- (RKPrefetchGroup *)prefetchURLs:(NSArray *)URLs
+{
+    RKPrefetchGroup *prefetchGroup = [self prefetchGroupWithURLs:URLs];
+    [prefetchGroup start];
+    return prefetchGroup;
+}
+
+- (RKPrefetchGroup *)prefetchGroupWithURLs:(NSArray *)URLs
+{
+    NSParameterAssert(URLs);
+    
+    NSMutableArray *requestPromises = [NSMutableArray arrayWithCapacity:URLs.count];
+    if(self.readCacheManager) {
+        for (NSURL *URL in URLs) {
+            NSMutableURLRequest *request = [self baseRequestWithURL:URL];
+            [request setHTTPMethod:@"GET"];
+            [request setNetworkServiceType:NSURLNetworkServiceTypeBackground];
+            
+            //Responses without an ETag or Expires header are only cached by promises that use their cache offline.
+            RKURLRequestPromise *requestPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                               offlineBehavior:kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable
+                                                                                  cacheManager:self.readCacheManager];
+            requestPromise.authenticationHandler = self.authenticationHandler;
+            if(self.rateLimiter)
+                requestPromise.rateLimiter = self.rateLimiter;
+            
+            [requestPromises addObject:requestPromise];
+        }
+    }
+    
+    return [[RKPrefetchGroup alloc] initWithRequestPromises:requestPromises];
+}
+
 @end
 
 #pragma mark -
@@ -0,0 +1,179 @@
+//
+//  RKRequestScheduler.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKRequestScheduler_h
+#define RKRequestScheduler_h 1
+
+#import <Foundation/Foundation.h>
+
+///The name of the notification posted when a request scheduler changes the concurrency window of a host.
+///
+///The object of the notification is the scheduler. The user info dictionary
+///contains the same keys as the samples returned by `-[RKRequestScheduler windowHistoryForHost:]`.
+RK_EXTERN NSString *const RKRequestSchedulerWindowDidChangeNotification;
+
+///The corresponding value is the host whose window was sampled. NSString.
+RK_EXTERN NSString *const RKRequestSchedulerSampleHostKey;
+
+///The corresponding value is the date the window was sampled. NSDate.
+RK_EXTERN NSString *const RKRequestSchedulerSampleDateKey;
+
+///The corresponding value is the size of the window after the change. NSNumber (double).
+RK_EXTERN NSString *const RKRequestSchedulerSampleWindowKey;
+
+///The corresponding value is the latency of the request that caused the change. NSNumber (NSTimeInterval).
+RK_EXTERN NSString *const RKRequestSchedulerSampleLatencyKey;
+
+///The corresponding value is a short description of why the window changed. NSString.
+///One of `@"increase"`, `@"timeout"`, `@"throttled"`, `@"unavailable"`, or `@"latency"`.
+RK_EXTERN NSString *const RKRequestSchedulerSampleReasonKey;
+
+@class RKRequestSchedulerTicket;
+
+///The different priorities a request can be scheduled with.
+typedef NS_ENUM(NSUInteger, RKRequestSchedulerPriority) {
+    ///The request is started in the order it was enqueued.
+    kRKRequestSchedulerPriorityNormal = 0,
+    
+    ///The request is only started once no normal priority requests are waiting
+    ///for its host, and may only occupy half of its host's window.
+    kRKRequestSchedulerPriorityLow = 1,
+};
+
+///The RKRequestScheduler class regulates the number of requests that may be
+///in flight to a single host at any given time.
+///
+///Each host is given a concurrency window that is adjusted using an additive-increase,
+///multiplicative-decrease scheme. While responses arrive without incident and their
+///latency stays close to the best latency observed for the host, the window grows by
+///roughly one request for each window's worth of completed requests. When a request
+///times out, is answered with a 429 or 503 status code, or takes substantially longer
+///than the host's baseline latency, the window is multiplied by `self.decreaseFactor`.
+///Only one decrease is applied for each congestion event, requests that were started
+///before the most recent decrease do not shrink the window again.
+///
+///Requests that arrive while a host's window is full are queued in the order in
+///which they were enqueued, and are started as the host's in-flight requests complete.
+///
+///`RKURLRequestPromise` routes all of its connections through a scheduler. All of the
+///methods on this class are safe to call from any thread.
+@interface RKRequestScheduler : NSObject
+
+///Returns the shared request scheduler, creating it if it does not already exist.
++ (instancetype)sharedRequestScheduler;
+
+#pragma mark - Properties
+
+///The window a host is given when it is first seen. Defaults to 4.
+@property NSUInteger initialWindow;
+
+///The smallest window a host may be shrunk to. Defaults to 1.
+@property NSUInteger minimumWindow;
+
+///The largest window a host may be grown to. Defaults to 32.
+@property NSUInteger maximumWindow;
+
+///The factor a host's window is multiplied by when congestion is detected. Defaults to 0.5.
+@property double decreaseFactor;
+
+///How many times a host's baseline latency a request may take before
+///it is considered a sign of congestion. Defaults to 3.0.
+@property double latencyInflationThreshold;
+
+///The number of window samples retained for each host. Defaults to 128.
+@property NSUInteger historyLimit;
+
+#pragma mark - Scheduling
+
+///Enqueues a block that starts a request, invoking it once the request's host has room in its window.
+///
+/// \param  request The request that will be started. Required.
+/// \param  block   The block to invoke when the request may start. Required. The block may be
+///                 invoked synchronously if the host has room, and is otherwise invoked on the
+///                 thread that completes the request that frees up room.
+///
+/// \result A ticket that must be passed to `-[self completeTicket:withResponse:error:]` when
+///         the request finishes, or to `-[self cancelTicket:]` if it is abandoned.
+- (RKRequestSchedulerTicket *)enqueueRequest:(NSURLRequest *)request withBlock:(dispatch_block_t)block RK_REQUIRE_RESULT_USED;
+
+///Enqueues a block that starts a request with a given priority, invoking it once the request's host has room in its window.
+///
+/// \param  request     The request that will be started. Required.
+/// \param  priority    The priority of the request.
+/// \param  block       The block to invoke when the request may start. Required.
+///
+/// \result A ticket that must be passed to `-[self completeTicket:withResponse:error:]` when
+///         the request finishes, or to `-[self cancelTicket:]` if it is abandoned.
+///
+/// \seealso(-[self enqueueRequest:withBlock:])
+- (RKRequestSchedulerTicket *)enqueueRequest:(NSURLRequest *)request priority:(RKRequestSchedulerPriority)priority withBlock:(dispatch_block_t)block RK_REQUIRE_RESULT_USED;
+
+///Informs the receiver that the connection of the request associated with a ticket has been started.
+///
+/// \param  ticket  The ticket of the request. Optional.
+///
+///A request's latency is measured from the time this method is called, so that time spent
+///waiting for the client's own queues after the ticket's block was invoked is not mistaken
+///for congestion. If this method is never called, the time the block was invoked is used instead.
+- (void)ticketDidStartConnection:(RKRequestSchedulerTicket *)ticket;
+
+///Informs the receiver that the request associated with a ticket has received its response.
+///
+/// \param  ticket  The ticket of the request. Optional.
+///
+///The time between a ticket's connection being started and this method being called is
+///used as the request's latency, so that large response bodies are not mistaken for
+///congestion. If this method is never called, the time of completion is used instead.
+- (void)ticketDidReceiveResponse:(RKRequestSchedulerTicket *)ticket;
+
+///Informs the receiver that the request associated with a ticket has finished.
+///
+/// \param  ticket      The ticket of the request. Optional.
+/// \param  response    The response received for the request, if any.
+/// \param  error       The error the request failed with, if any.
+///
+///The response and error are used to adjust the window of the ticket's host.
+///Completing a ticket more than once, or completing a canceled ticket, does nothing.
+- (void)completeTicket:(RKRequestSchedulerTicket *)ticket withResponse:(NSURLResponse *)response error:(NSError *)error;
+
+///Informs the receiver that the request associated with a ticket has been abandoned.
+///
+/// \param  ticket  The ticket of the request. Optional.
+///
+///If the ticket's block has not been invoked yet, it never will be. The window
+///of the ticket's host is not adjusted for canceled tickets.
+- (void)cancelTicket:(RKRequestSchedulerTicket *)ticket;
+
+#pragma mark - Introspection
+
+///Returns the current concurrency window for a given host.
+///
+///Hosts that have not been seen by the receiver report `self.initialWindow`.
+- (double)windowForHost:(NSString *)host;
+
+///Returns the number of requests currently in flight to a given host.
+- (NSUInteger)numberOfActiveRequestsForHost:(NSString *)host;
+
+///Returns the number of requests waiting for room in a given host's window.
+- (NSUInteger)numberOfPendingRequestsForHost:(NSString *)host;
+
+///Returns the recorded changes to a given host's window, oldest first.
+///
+///Each sample is a dictionary containing the `RKRequestSchedulerSample*Key` keys.
+///At most `self.historyLimit` samples are retained per host.
+- (NSArray *)windowHistoryForHost:(NSString *)host;
+
+///Returns a dictionary describing every host known to the receiver.
+///
+///The keys of the dictionary are host names, the values are dictionaries
+///with the keys `window`, `active`, `pending`, and `baselineLatency`.
+- (NSDictionary *)snapshot;
+
+@end
+
+#endif /* RKRequestScheduler_h */
@@ -0,0 +1,458 @@
+//
+//  RKRequestScheduler.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKRequestScheduler.h"
+
+NSString *const RKRequestSchedulerWindowDidChangeNotification = @"RKRequestSchedulerWindowDidChangeNotification";
+NSString *const RKRequestSchedulerSampleHostKey = @"host";
+NSString *const RKRequestSchedulerSampleDateKey = @"date";
+NSString *const RKRequestSchedulerSampleWindowKey = @"window";
+NSString *const RKRequestSchedulerSampleLatencyKey = @"latency";
+NSString *const RKRequestSchedulerSampleReasonKey = @"reason";
+
+///The host used for requests whose URL does not have one.
+static NSString *const kUnknownHost = @"<none>";
+
+///The weight given to new latency samples when the baseline is drifting upwards.
+static double const kBaselineDriftWeight = 0.05;
+
+///The amount of time a request must exceed its host's baseline latency by before it is
+///considered inflated. Prevents jitter on very fast hosts from being mistaken for congestion.
+static NSTimeInterval const kMinimumLatencyInflation = 0.05;
+
+#pragma mark -
+
+@interface RKRequestSchedulerTicket : NSObject
+
+///The host the ticket's request is being sent to.
+@property (copy) NSString *host;
+
+///The block that starts the ticket's request.
+@property (copy) dispatch_block_t block;
+
+///The priority of the ticket's request.
+@property RKRequestSchedulerPriority priority;
+
+///The time at which the ticket's block was invoked. Zero if it has not been.
+@property CFAbsoluteTime dispatchTime;
+
+///The time at which the ticket's connection was started. Zero if it has not been reported.
+@property CFAbsoluteTime startTime;
+
+///The time at which the ticket's request received its response. Zero if it has not.
+@property CFAbsoluteTime responseTime;
+
+///Whether or not the ticket has been completed or canceled.
+@property BOOL isFinished;
+
+@end
+
+@implementation RKRequestSchedulerTicket
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%p %@, started => %@>", NSStringFromClass([self class]), self, self.host, (self.dispatchTime > 0.0? @"YES" : @"NO")];
+}
+
+@end
+
+#pragma mark -
+
+///Encapsulates the congestion state of a single host.
+@interface RKRequestSchedulerHostState : NSObject
+
+///The current concurrency window.
+@property double window;
+
+///The number of requests currently in flight.
+@property NSUInteger active;
+
+///The number of low priority requests currently in flight.
+@property NSUInteger activeLowPriority;
+
+///The tickets waiting for room in the window.
+@property (readonly) NSMutableArray *pending;
+
+///The lowest smoothed latency observed for the host. Zero if nothing has been observed.
+@property NSTimeInterval baselineLatency;
+
+///The time of the last multiplicative decrease.
+@property CFAbsoluteTime lastDecreaseTime;
+
+///The recorded window samples.
+@property (readonly) NSMutableArray *history;
+
+@end
+
+@implementation RKRequestSchedulerHostState
+
+- (instancetype)init
+{
+    if((self = [super init])) {
+        _pending = [NSMutableArray new];
+        _history = [NSMutableArray new];
+    }
+    
+    return self;
+}
+
+@end
+
+#pragma mark -
+
+@implementation RKRequestScheduler {
+    ///The queue that regulates access to `_hosts`.
+    dispatch_queue_t _stateQueue;
+    
+    ///The state of each host known to the scheduler.
+    ///
+    ///NSString => RKRequestSchedulerHostState.
+    NSMutableDictionary *_hosts;
+}
+
++ (instancetype)sharedRequestScheduler
+{
+    static RKRequestScheduler *sharedRequestScheduler = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedRequestScheduler = [self new];
+    });
+    
+    return sharedRequestScheduler;
+}
+
+- (instancetype)init
+{
+    if((self = [super init])) {
+        _stateQueue = dispatch_queue_create("com.roundabout.rk.RKRequestScheduler.stateQueue", DISPATCH_QUEUE_SERIAL);
+        _hosts = [NSMutableDictionary new];
+        
+        self.initialWindow = 4;
+        self.minimumWindow = 1;
+        self.maximumWindow = 32;
+        self.decreaseFactor = 0.5;
+        self.latencyInflationThreshold = 3.0;
+        self.historyLimit = 128;
+    }
+    
+    return self;
+}
+
+#pragma mark - Internal
+
+///Returns the host key for a given request.
+static NSString *RKRequestSchedulerGetHost(NSURLRequest *request)
+{
+    return [request.URL.host lowercaseString] ?: kUnknownHost;
+}
+
+///Returns the state for a given host, creating it if it does not exist.
+///
+///This method assumes it is being called from within `_stateQueue`.
+- (RKRequestSchedulerHostState *)stateForHost:(NSString *)host
+{
+    RKRequestSchedulerHostState *state = _hosts[host];
+    if(!state) {
+        state = [RKRequestSchedulerHostState new];
+        state.window = MAX(self.initialWindow, self.minimumWindow);
+        _hosts[host] = state;
+    }
+    
+    return state;
+}
+
+///Moves as many pending tickets into flight as a host's window allows,
+///returning the blocks that must be invoked to start them.
+///
+///This method assumes it is being called from within `_stateQueue`.
+- (NSArray *)drainPendingTicketsForState:(RKRequestSchedulerHostState *)state
+{
+    NSMutableArray *blocks = [NSMutableArray array];
+    NSUInteger lowPriorityLimit = MAX((NSUInteger)floor(state.window) / 2, 1UL);
+    while (state.pending.count > 0 && state.active < (NSUInteger)floor(state.window)) {
+        RKRequestSchedulerTicket *ticket = state.pending[0];
+        
+        //Low priority tickets are always at the end of the queue,
+        //so once one cannot start, none of the remaining ones can.
+        if(ticket.priority == kRKRequestSchedulerPriorityLow) {
+            if(state.activeLowPriority >= lowPriorityLimit)
+                break;
+            
+            state.activeLowPriority++;
+        }
+        
+        [state.pending removeObjectAtIndex:0];
+        
+        state.active++;
+        ticket.dispatchTime = CFAbsoluteTimeGetCurrent();
+        [blocks addObject:ticket.block];
+        ticket.block = nil;
+    }
+    
+    return blocks;
+}
+
+///Records a window sample for a host, returning it.
+///
+///This method assumes it is being called from within `_stateQueue`.
+- (NSDictionary *)recordSampleForHost:(NSString *)host state:(RKRequestSchedulerHostState *)state latency:(NSTimeInterval)latency reason:(NSString *)reason
+{
+    NSDictionary *sample = @{RKRequestSchedulerSampleHostKey: host,
+                             RKRequestSchedulerSampleDateKey: [NSDate date],
+                             RKRequestSchedulerSampleWindowKey: @(state.window),
+                             RKRequestSchedulerSampleLatencyKey: @(latency),
+                             RKRequestSchedulerSampleReasonKey: reason};
+    [state.history addObject:sample];
+    
+    NSUInteger historyLimit = self.historyLimit;
+    if(state.history.count > historyLimit)
+        [state.history removeObjectsInRange:NSMakeRange(0, state.history.count - historyLimit)];
+    
+    return sample;
+}
+
+///Returns the reason a given outcome indicates congestion, or nil if it does not.
+- (NSString *)congestionReasonForResponse:(NSURLResponse *)response error:(NSError *)error latency:(NSTimeInterval)latency baseline:(NSTimeInterval)baseline
+{
+    if([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorTimedOut)
+        return @"timeout";
+    
+    if([response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSInteger statusCode = [(NSHTTPURLResponse *)response statusCode];
+        if(statusCode == 429)
+            return @"throttled";
+        else if(statusCode == 503)
+            return @"unavailable";
+    }
+    
+    if(!error && baseline > 0.0 &&
+       latency > baseline * self.latencyInflationThreshold &&
+       latency - baseline > kMinimumLatencyInflation)
+        return @"latency";
+    
+    return nil;
+}
+
+///Invokes an array of blocks in order.
+static void RKRequestSchedulerInvokeBlocks(NSArray *blocks)
+{
+    for (dispatch_block_t block in blocks)
+        block();
+}
+
+#pragma mark - Scheduling
+
+- (RKRequestSchedulerTicket *)enqueueRequest:(NSURLRequest *)request withBlock:(dispatch_block_t)block
+{
+    return [self enqueueRequest:request priority:kRKRequestSchedulerPriorityNormal withBlock:block];
+}
+
+- (RKRequestSchedulerTicket *)enqueueRequest:(NSURLRequest *)request priority:(RKRequestSchedulerPriority)priority withBlock:(dispatch_block_t)block
+{
+    NSParameterAssert(request);
+    NSParameterAssert(block);
+    
+    RKRequestSchedulerTicket *ticket = [RKRequestSchedulerTicket new];
+    ticket.host = RKRequestSchedulerGetHost(request);
+    ticket.block = block;
+    ticket.priority = priority;
+    
+    __block NSArray *blocksToInvoke = nil;
+    dispatch_sync(_stateQueue, ^{
+        RKRequestSchedulerHostState *state = [self stateForHost:ticket.host];
+        if(priority == kRKRequestSchedulerPriorityNormal) {
+            NSUInteger firstLowPriorityIndex = [state.pending indexOfObjectPassingTest:^BOOL(RKRequestSchedulerTicket *pendingTicket, NSUInteger index, BOOL *stop) {
+                return (pendingTicket.priority == kRKRequestSchedulerPriorityLow);
+            }];
+            if(firstLowPriorityIndex != NSNotFound)
+                [state.pending insertObject:ticket atIndex:firstLowPriorityIndex];
+            else
+                [state.pending addObject:ticket];
+        } else {
+            [state.pending addObject:ticket];
+        }
+        blocksToInvoke = [self drainPendingTicketsForState:state];
+    });
+    
+    RKRequestSchedulerInvokeBlocks(blocksToInvoke);
+    
+    return ticket;
+}
+
+- (void)completeTicket:(RKRequestSchedulerTicket *)ticket withResponse:(NSURLResponse *)response error:(NSError *)error
+{
+    if(!ticket)
+        return;
+    
+    __block NSArray *blocksToInvoke = nil;
+    __block NSDictionary *sample = nil;
+    dispatch_sync(_stateQueue, ^{
+        if(ticket.isFinished || ticket.dispatchTime == 0.0)
+            return;
+        
+        ticket.isFinished = YES;
+        
+        RKRequestSchedulerHostState *state = [self stateForHost:ticket.host];
+        state.active--;
+        if(ticket.priority == kRKRequestSchedulerPriorityLow)
+            state.activeLowPriority--;
+        
+        //Tickets whose connection start was never reported are timed from when their block was invoked.
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        CFAbsoluteTime startTime = ticket.startTime ?: ticket.dispatchTime;
+        NSTimeInterval latency = (ticket.responseTime ?: now) - startTime;
+        NSString *congestionReason = [self congestionReasonForResponse:response error:error latency:latency baseline:state.baselineLatency];
+        if(congestionReason) {
+            //Requests that were already in flight when the window last shrank
+            //are reporting the same congestion event, they are not counted twice.
+            if(startTime > state.lastDecreaseTime) {
+                state.window = MAX(state.window * self.decreaseFactor, (double)self.minimumWindow);
+                state.lastDecreaseTime = now;
+                sample = [self recordSampleForHost:ticket.host state:state latency:latency reason:congestionReason];
+            }
+        } else if(!error) {
+            if(state.baselineLatency == 0.0 || latency < state.baselineLatency)
+                state.baselineLatency = latency;
+            else
+                state.baselineLatency += (latency - state.baselineLatency) * kBaselineDriftWeight;
+            
+            double oldWindow = state.window;
+            state.window = MIN(state.window + (1.0 / state.window), (double)self.maximumWindow);
+            if(floor(state.window) > floor(oldWindow))
+                sample = [self recordSampleForHost:ticket.host state:state latency:latency reason:@"increase"];
+        }
+        
+        blocksToInvoke = [self drainPendingTicketsForState:state];
+    });
+    
+    if(sample) {
+        [[NSNotificationCenter defaultCenter] postNotificationName:RKRequestSchedulerWindowDidChangeNotification
+                                                            object:self
+                                                          userInfo:sample];
+    }
+    
+    RKRequestSchedulerInvokeBlocks(blocksToInvoke);
+}
+
+- (void)ticketDidStartConnection:(RKRequestSchedulerTicket *)ticket
+{
+    if(!ticket)
+        return;
+    
+    dispatch_sync(_stateQueue, ^{
+        if(ticket.startTime == 0.0)
+            ticket.startTime = CFAbsoluteTimeGetCurrent();
+    });
+}
+
+- (void)ticketDidReceiveResponse:(RKRequestSchedulerTicket *)ticket
+{
+    if(!ticket)
+        return;
+    
+    dispatch_sync(_stateQueue, ^{
+        if(ticket.responseTime == 0.0)
+            ticket.responseTime = CFAbsoluteTimeGetCurrent();
+    });
+}
+
+- (void)cancelTicket:(RKRequestSchedulerTicket *)ticket
+{
+    if(!ticket)
+        return;
+    
+    __block NSArray *blocksToInvoke = nil;
+    dispatch_sync(_stateQueue, ^{
+        if(ticket.isFinished)
+            return;
+        
+        ticket.isFinished = YES;
+        
+        RKRequestSchedulerHostState *state = [self stateForHost:ticket.host];
+        if(ticket.dispatchTime == 0.0) {
+            [state.pending removeObjectIdenticalTo:ticket];
+            ticket.block = nil;
+        } else {
+            state.active--;
+            if(ticket.priority == kRKRequestSchedulerPriorityLow)
+                state.activeLowPriority--;
+            
+            blocksToInvoke = [self drainPendingTicketsForState:state];
+        }
+    });
+    
+    RKRequestSchedulerInvokeBlocks(blocksToInvoke);
+}
+
+#pragma mark - Introspection
+
+- (double)windowForHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    __block double window = 0.0;
+    dispatch_sync(_stateQueue, ^{
+        RKRequestSchedulerHostState *state = _hosts[[host lowercaseString]];
+        window = state? state.window : MAX(self.initialWindow, self.minimumWindow);
+    });
+    
+    return window;
+}
+
+- (NSUInteger)numberOfActiveRequestsForHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    __block NSUInteger active = 0;
+    dispatch_sync(_stateQueue, ^{
+        active = [_hosts[[host lowercaseString]] active];
+    });
+    
+    return active;
+}
+
+- (NSUInteger)numberOfPendingRequestsForHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    __block NSUInteger pending = 0;
+    dispatch_sync(_stateQueue, ^{
+        pending = [[_hosts[[host lowercaseString]] pending] count];
+    });
+    
+    return pending;
+}
+
+- (NSArray *)windowHistoryForHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    __block NSArray *history = nil;
+    dispatch_sync(_stateQueue, ^{
+        history = [[_hosts[[host lowercaseString]] history] copy];
+    });
+    
+    return history ?: @[];
+}
+
+- (NSDictionary *)snapshot
+{
+    NSMutableDictionary *snapshot = [NSMutableDictionary dictionary];
+    dispatch_sync(_stateQueue, ^{
+        [_hosts enumerateKeysAndObjectsUsingBlock:^(NSString *host, RKRequestSchedulerHostState *state, BOOL *stop) {
+            snapshot[host] = @{@"window": @(state.window),
+                               @"active": @(state.active),
+                               @"pending": @(state.pending.count),
+                               @"baselineLatency": @(state.baselineLatency)};
+        }];
+    });
+    
+    return snapshot;
+}
+
+@end
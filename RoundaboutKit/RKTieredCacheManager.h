@@ -0,0 +1,122 @@
+//
+//  RKTieredCacheManager.h
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#ifndef RKTieredCacheManager_h
+#define RKTieredCacheManager_h 1
+
+#import "RKURLRequestPromise.h"
+
+///How an RKTieredCacheManager treats its memory tier when data is cached.
+typedef NS_ENUM(NSInteger, RKTieredCacheManagerWritePolicy) {
+    ///Data is stored in both the memory tier and the backing cache manager.
+    kRKTieredCacheManagerWritePolicyWriteThrough = 0,
+    
+    ///Data is only stored in the backing cache manager, and any copy
+    ///in the memory tier is discarded. Data enters the memory tier
+    ///when it is read, according to the promotion policy.
+    kRKTieredCacheManagerWritePolicyWriteAround = 1,
+};
+
+///When an RKTieredCacheManager copies data read from its backing cache manager into its memory tier.
+typedef NS_ENUM(NSInteger, RKTieredCacheManagerPromotionPolicy) {
+    ///Data is promoted the first time it is read from the backing cache manager.
+    kRKTieredCacheManagerPromotionPolicyAlways = 0,
+    
+    ///Data is promoted the second time it is read from the backing
+    ///cache manager in close succession, so items that are only ever
+    ///read once do not displace items in the memory tier.
+    kRKTieredCacheManagerPromotionPolicyOnSecondRead = 1,
+    
+    ///Data is never promoted.
+    kRKTieredCacheManagerPromotionPolicyNever = 2,
+};
+
+///The RKTieredCacheManager class places a byte-budgeted memory tier in front of another
+///cache manager, so that frequently read items are served without any file system IO.
+///
+///The memory tier is read concurrently from any number of threads. Items are evicted
+///from it using the CLOCK algorithm: each item carries a reference bit that is set when
+///it is read, and items whose bit is clear are evicted first. This approximates least
+///recently used eviction without requiring reads to reorder anything.
+///
+///Items larger than `maximumMemoryItemSize` are never kept in the memory tier.
+///Items stored with an expiration date are not served by the memory tier once it has
+///passed, and the date is passed on to the backing cache manager when it accepts one.
+///Items promoted from the backing cache manager keep the expiration date it reports
+///through `-expirationDateForIdentifier:`, if it implements that method.
+///
+///The asynchronous methods of `<RKAsyncURLRequestPromiseCacheManager>` invoke their handlers
+///immediately on the calling thread when the memory tier can answer them, so memory tier hits
+///never wait behind file system IO. Everything else is forwarded to the asynchronous methods
+///of the backing cache manager, through an `RKAsyncCacheManagerAdapter` if it has none.
+///
+///The optional partial data and statistics methods of both protocols are
+///forwarded directly to the backing cache manager when it implements them.
+@interface RKTieredCacheManager : NSObject <RKAsyncURLRequestPromiseCacheManager>
+
+///Returns the shared tiered cache manager, creating it if it does not already exist.
+///
+///The shared tiered cache manager is backed by the shared `RKFileSystemCacheManager`.
++ (instancetype)sharedCacheManager;
+
+///Initialize the receiver with the cache manager it should be backed by.
+///
+/// \param  backingCacheManager The cache manager to read from on a memory tier miss,
+///                             and to persist data to. Required.
+/// \param  memoryBudget        The number of bytes the memory tier may occupy.
+///
+/// \result A fully initialized tiered cache manager.
+///
+///This is the designated initializer.
+- (instancetype)initWithBackingCacheManager:(id <RKURLRequestPromiseCacheManager>)backingCacheManager
+                               memoryBudget:(NSUInteger)memoryBudget;
+
+#pragma mark - Properties
+
+///The cache manager behind the receiver's memory tier.
+@property (readonly) id <RKURLRequestPromiseCacheManager> backingCacheManager;
+
+///The number of bytes the memory tier may occupy. Lowering
+///the value of this property evicts items immediately.
+@property (nonatomic) NSUInteger memoryBudget;
+
+///The size of the largest item that may be kept in the memory tier.
+///Defaults to one eighth of the memory budget it was initialized with.
+@property NSUInteger maximumMemoryItemSize;
+
+///The number of bytes currently occupied by the memory tier.
+@property (readonly) NSUInteger memorySize;
+
+///How the memory tier is treated when data is cached. Defaults to write through.
+@property RKTieredCacheManagerWritePolicy writePolicy;
+
+///When data read from the backing cache manager is copied into the memory tier. Defaults to always.
+@property RKTieredCacheManagerPromotionPolicy promotionPolicy;
+
+#pragma mark - Statistics
+
+///The number of reads served by the memory tier.
+@property (readonly) int64_t memoryHitCount;
+
+///The number of reads served by the backing cache manager.
+@property (readonly) int64_t backingHitCount;
+
+///The number of reads that found no data in either tier.
+@property (readonly) int64_t missCount;
+
+///Resets the receiver's hit and miss counts to zero.
+- (void)resetStatistics;
+
+#pragma mark - Memory Tier
+
+///Discards every item in the memory tier, leaving the backing cache manager untouched.
+- (void)removeAllMemoryCache;
+
+@end
+
+#endif /* RKTieredCacheManager_h */
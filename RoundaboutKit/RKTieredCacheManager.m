@@ -0,0 +1,593 @@
+//
+//  RKTieredCacheManager.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import "RKTieredCacheManager.h"
+#import <libkern/OSAtomic.h>
+#import "RKFileSystemCacheManager.h"
+#import "RKAsyncCacheManagerAdapter.h"
+
+///The memory budget of the shared tiered cache manager.
+static NSUInteger const kDefaultMemoryBudget = (1024 * 1024 * 4) /* 4 MB */;
+
+///The number of identifiers remembered while waiting for their second read.
+static NSUInteger const kPromotionCandidateLimit = 256;
+
+///Atomically resets a statistics counter to zero.
+RK_INLINE void reset_counter(volatile int64_t *counter)
+{
+    int64_t value;
+    do {
+        value = *counter;
+    } while (!OSAtomicCompareAndSwap64Barrier(value, 0, counter));
+}
+
+#pragma mark -
+
+///An item stored in the memory tier of a tiered cache manager.
+@interface RKTieredCacheItem : NSObject {
+@package
+    ///The identifier the item is stored under.
+    NSString *_identifier;
+    
+    ///The revision of the item.
+    NSString *_revision;
+    
+    ///The data of the item.
+    NSData *_data;
+    
+    ///The time after which the item is no longer served, relative to the reference date. Zero if it never expires.
+    NSTimeInterval _expirationTime;
+    
+    ///Set when the item is read, cleared when the clock hand passes over it.
+    volatile int32_t _referenced;
+    
+    ///Whether or not the item is still stored in the memory tier. Items that have
+    ///been replaced or removed stay in the clock until the hand passes over them.
+    BOOL _resident;
+}
+
+@end
+
+@implementation RKTieredCacheItem
+
+@end
+
+#pragma mark -
+
+@implementation RKTieredCacheManager {
+    ///The backing cache manager, or an adapter for it if it has no asynchronous methods.
+    id <RKAsyncURLRequestPromiseCacheManager> _asyncBackingCacheManager;
+    
+    ///The concurrent queue that regulates access to the memory tier. Lookups are
+    ///performed concurrently, and changes are performed with barriers.
+    dispatch_queue_t _memoryQueue;
+    
+    ///The items of the memory tier.
+    ///
+    ///NSString => RKTieredCacheItem.
+    NSMutableDictionary *_items;
+    
+    ///The number of bytes the memory tier may occupy.
+    NSUInteger _memoryBudget;
+    
+    ///The number of bytes occupied by the resident items of the memory tier.
+    NSUInteger _memorySize;
+    
+    ///Every item in the memory tier in the order they were inserted, along with any
+    ///items that are no longer resident that the clock hand has not yet passed over.
+    NSMutableArray *_clock;
+    
+    ///The position of the clock hand within `_clock`.
+    NSUInteger _clockHand;
+    
+    ///The number of items in `_clock` that are no longer resident.
+    NSUInteger _departedItemCount;
+    
+    ///Incremented whenever an item is changed through the receiver, so that a
+    ///promotion never overwrites an item that was changed while it was being read.
+    uint64_t _generation;
+    
+    ///The identifiers that have been read from the backing cache manager once.
+    NSCache *_promotionCandidates;
+    
+    volatile int64_t _memoryHitCount;
+    volatile int64_t _backingHitCount;
+    volatile int64_t _missCount;
+}
+
+#pragma mark - Lifecycle
+
++ (instancetype)sharedCacheManager
+{
+    static RKTieredCacheManager *sharedCacheManager = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedCacheManager = [[self alloc] initWithBackingCacheManager:[RKFileSystemCacheManager sharedCacheManager]
+                                                          memoryBudget:kDefaultMemoryBudget];
+    });
+    
+    return sharedCacheManager;
+}
+
+- (instancetype)initWithBackingCacheManager:(id <RKURLRequestPromiseCacheManager>)backingCacheManager
+                               memoryBudget:(NSUInteger)memoryBudget
+{
+    NSParameterAssert(backingCacheManager);
+    
+    if((self = [super init])) {
+        _backingCacheManager = backingCacheManager;
+        _asyncBackingCacheManager = RKAsyncCacheManagerForCacheManager(backingCacheManager);
+        _memoryBudget = memoryBudget;
+        _maximumMemoryItemSize = memoryBudget / 8;
+        
+        _memoryQueue = dispatch_queue_create("com.roundabout.RoundaboutKit.RKTieredCacheManager.memoryQueue", DISPATCH_QUEUE_CONCURRENT);
+        _items = [NSMutableDictionary dictionary];
+        _clock = [NSMutableArray array];
+        
+        _promotionCandidates = [NSCache new];
+        _promotionCandidates.countLimit = kPromotionCandidateLimit;
+    }
+    
+    return self;
+}
+
+- (id)init
+{
+    [self doesNotRecognizeSelector:_cmd];
+    return nil;
+}
+
+#pragma mark - Properties
+
+- (void)setMemoryBudget:(NSUInteger)memoryBudget
+{
+    dispatch_barrier_sync(_memoryQueue, ^{
+        _memoryBudget = memoryBudget;
+        [self evictItemsToFitBudget];
+    });
+}
+
+- (NSUInteger)memoryBudget
+{
+    __block NSUInteger memoryBudget = 0;
+    dispatch_sync(_memoryQueue, ^{
+        memoryBudget = _memoryBudget;
+    });
+    
+    return memoryBudget;
+}
+
+- (NSUInteger)memorySize
+{
+    __block NSUInteger memorySize = 0;
+    dispatch_sync(_memoryQueue, ^{
+        memorySize = _memorySize;
+    });
+    
+    return memorySize;
+}
+
+#pragma mark - Statistics
+
+- (int64_t)memoryHitCount
+{
+    return OSAtomicAdd64Barrier(0, &_memoryHitCount);
+}
+
+- (int64_t)backingHitCount
+{
+    return OSAtomicAdd64Barrier(0, &_backingHitCount);
+}
+
+- (int64_t)missCount
+{
+    return OSAtomicAdd64Barrier(0, &_missCount);
+}
+
+- (void)resetStatistics
+{
+    reset_counter(&_memoryHitCount);
+    reset_counter(&_backingHitCount);
+    reset_counter(&_missCount);
+}
+
+#pragma mark - Memory Tier
+
+///Returns the item for a given identifier, without marking it as referenced.
+- (RKTieredCacheItem *)residentItemForIdentifier:(NSString *)identifier
+{
+    __block RKTieredCacheItem *item = nil;
+    dispatch_sync(_memoryQueue, ^{
+        item = _items[identifier];
+    });
+    
+    return item;
+}
+
+///Returns the item for a given identifier, marking it as referenced.
+- (RKTieredCacheItem *)memoryItemForIdentifier:(NSString *)identifier
+{
+    RKTieredCacheItem *item = [self residentItemForIdentifier:identifier];
+    
+    //Expired items are left for the clock hand to evict.
+    if(item && item->_expirationTime != 0.0 && item->_expirationTime < [NSDate timeIntervalSinceReferenceDate])
+        return nil;
+    
+    if(item && !item->_referenced)
+        OSAtomicCompareAndSwap32Barrier(0, 1, &item->_referenced);
+    
+    return item;
+}
+
+///Marks an item as no longer resident.
+///
+///This method assumes it has been surrounded by a queue barrier.
+- (void)departItem:(RKTieredCacheItem *)item
+{
+    item->_resident = NO;
+    _memorySize -= item->_data.length;
+    _departedItemCount++;
+    [_items removeObjectForKey:item->_identifier];
+}
+
+///Advances the clock hand, evicting unreferenced items, until the memory tier fits within its budget.
+///
+///This method assumes it has been surrounded by a queue barrier.
+- (void)evictItemsToFitBudget
+{
+    while (_memorySize > _memoryBudget && _clock.count > 0) {
+        if(_clockHand >= _clock.count)
+            _clockHand = 0;
+        
+        RKTieredCacheItem *item = _clock[_clockHand];
+        if(item->_resident && item->_referenced) {
+            item->_referenced = 0;
+            _clockHand++;
+            continue;
+        }
+        
+        if(item->_resident)
+            [self departItem:item];
+        
+        [_clock removeObjectAtIndex:_clockHand];
+        _departedItemCount--;
+    }
+    
+    //Departed items are normally removed as the clock hand passes over them, but
+    //the hand only moves when the memory tier is full, so they are occasionally
+    //removed all at once to keep the clock from growing without bound.
+    if(_departedItemCount > 0 && _departedItemCount >= _clock.count / 2) {
+        NSIndexSet *departedIndexes = [_clock indexesOfObjectsPassingTest:^BOOL(RKTieredCacheItem *item, NSUInteger index, BOOL *stop) {
+            return !item->_resident;
+        }];
+        
+        NSUInteger departedBeforeHand = [departedIndexes countOfIndexesInRange:NSMakeRange(0, MIN(_clockHand, _clock.count))];
+        [_clock removeObjectsAtIndexes:departedIndexes];
+        _clockHand -= departedBeforeHand;
+        _departedItemCount = 0;
+    }
+}
+
+///Stores an item in the memory tier, replacing any existing item.
+///
+///This method assumes it has been surrounded by a queue barrier.
+- (void)insertMemoryItemWithIdentifier:(NSString *)identifier revision:(NSString *)revision data:(NSData *)data expirationDate:(NSDate *)expirationDate
+{
+    RKTieredCacheItem *existingItem = _items[identifier];
+    if(existingItem)
+        [self departItem:existingItem];
+    
+    if(!data || data.length > self.maximumMemoryItemSize || data.length > _memoryBudget)
+        return;
+    
+    RKTieredCacheItem *item = [RKTieredCacheItem new];
+    item->_identifier = [identifier copy];
+    item->_revision = [revision copy];
+    item->_data = [data copy];
+    item->_expirationTime = [expirationDate timeIntervalSinceReferenceDate];
+    item->_resident = YES;
+    
+    //New items are placed just behind the clock hand, so that they are
+    //the last items the hand considers on its next revolution.
+    [_clock insertObject:item atIndex:MIN(_clockHand, _clock.count)];
+    _clockHand = MIN(_clockHand + 1, _clock.count);
+    _items[item->_identifier] = item;
+    _memorySize += data.length;
+    
+    [self evictItemsToFitBudget];
+}
+
+///Discards the item for a given identifier from the memory tier.
+- (void)removeMemoryItemForIdentifier:(NSString *)identifier
+{
+    dispatch_barrier_sync(_memoryQueue, ^{
+        _generation++;
+        
+        RKTieredCacheItem *item = _items[identifier];
+        if(item)
+            [self departItem:item];
+    });
+}
+
+- (void)removeAllMemoryCache
+{
+    dispatch_barrier_sync(_memoryQueue, ^{
+        _generation++;
+        
+        [_items removeAllObjects];
+        [_clock removeAllObjects];
+        _clockHand = 0;
+        _departedItemCount = 0;
+        _memorySize = 0;
+    });
+}
+
+///Returns the current generation of the memory tier, to be passed to
+///`-promoteData:forIdentifier:revision:readAtGeneration:` once a read finishes.
+- (uint64_t)currentGeneration
+{
+    __block uint64_t generation = 0;
+    dispatch_sync(_memoryQueue, ^{
+        generation = _generation;
+    });
+    
+    return generation;
+}
+
+///Stores data that was just cached in the backing cache manager in the memory tier, if the write policy allows it.
+- (void)storeCachedData:(NSData *)data forIdentifier:(NSString *)identifier revision:(NSString *)revision expirationDate:(NSDate *)expirationDate success:(BOOL)success
+{
+    //The memory tier is updated even when the backing cache manager fails,
+    //so that it never serves data the backing cache manager has replaced.
+    BOOL shouldStore = (success && self.writePolicy == kRKTieredCacheManagerWritePolicyWriteThrough);
+    dispatch_barrier_sync(_memoryQueue, ^{
+        _generation++;
+        
+        [self insertMemoryItemWithIdentifier:identifier revision:revision data:shouldStore? data : nil expirationDate:expirationDate];
+    });
+}
+
+///Copies data read from the backing cache manager into the memory tier if the promotion policy allows it.
+- (void)promoteData:(NSData *)data forIdentifier:(NSString *)identifier revision:(NSString *)revision readAtGeneration:(uint64_t)generation
+{
+    if(!revision || data.length > self.maximumMemoryItemSize)
+        return;
+    
+    switch (self.promotionPolicy) {
+        case kRKTieredCacheManagerPromotionPolicyAlways:
+            break;
+        
+        case kRKTieredCacheManagerPromotionPolicyOnSecondRead:
+            if(![_promotionCandidates objectForKey:identifier]) {
+                [_promotionCandidates setObject:identifier forKey:identifier];
+                return;
+            }
+            
+            [_promotionCandidates removeObjectForKey:identifier];
+            break;
+        
+        case kRKTieredCacheManagerPromotionPolicyNever:
+            return;
+    }
+    
+    //Promoted items must not outlive the backing cache manager's copy of them.
+    NSDate *expirationDate = nil;
+    if([_backingCacheManager respondsToSelector:@selector(expirationDateForIdentifier:)]) {
+        expirationDate = [_backingCacheManager expirationDateForIdentifier:identifier];
+        if(expirationDate && [expirationDate timeIntervalSinceNow] <= 0.0)
+            return;
+    }
+    
+    dispatch_barrier_async(_memoryQueue, ^{
+        if(_generation == generation && !_items[identifier])
+            [self insertMemoryItemWithIdentifier:identifier revision:revision data:data expirationDate:expirationDate];
+    });
+}
+
+#pragma mark - <RKURLRequestPromiseCacheManager>
+
+- (NSString *)revisionForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+    
+    RKTieredCacheItem *item = [self residentItemForIdentifier:identifier];
+    return item? item->_revision : [_backingCacheManager revisionForIdentifier:identifier];
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision error:(NSError **)error
+{
+    return [self cacheData:data forIdentifier:identifier withRevision:revision expirationDate:nil error:error];
+}
+
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate error:(NSError **)error
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    
+    BOOL success = NO;
+    if([_backingCacheManager respondsToSelector:@selector(cacheData:forIdentifier:withRevision:expirationDate:error:)])
+        success = [_backingCacheManager cacheData:data forIdentifier:identifier withRevision:revision expirationDate:expirationDate error:error];
+    else
+        success = [_backingCacheManager cacheData:data forIdentifier:identifier withRevision:revision error:error];
+    
+    [self storeCachedData:data forIdentifier:identifier revision:revision expirationDate:expirationDate success:success];
+    
+    return success;
+}
+
+- (NSDate *)expirationDateForIdentifier:(NSString *)identifier
+{
+    NSParameterAssert(identifier);
+    
+    RKTieredCacheItem *item = [self residentItemForIdentifier:identifier];
+    if(item)
+        return (item->_expirationTime != 0.0)? [NSDate dateWithTimeIntervalSinceReferenceDate:item->_expirationTime] : nil;
+    
+    if([_backingCacheManager respondsToSelector:@selector(expirationDateForIdentifier:)])
+        return [_backingCacheManager expirationDateForIdentifier:identifier];
+    
+    return nil;
+}
+
+- (NSData *)cachedDataForIdentifier:(NSString *)identifier error:(NSError **)error
+{
+    NSParameterAssert(identifier);
+    
+    RKTieredCacheItem *item = [self memoryItemForIdentifier:identifier];
+    if(item) {
+        OSAtomicIncrement64Barrier(&_memoryHitCount);
+        return item->_data;
+    }
+    
+    uint64_t generation = [self currentGeneration];
+    NSString *revision = [_backingCacheManager revisionForIdentifier:identifier];
+    NSData *data = [_backingCacheManager cachedDataForIdentifier:identifier error:error];
+    if(data) {
+        OSAtomicIncrement64Barrier(&_backingHitCount);
+        [self promoteData:data forIdentifier:identifier revision:revision readAtGeneration:generation];
+    } else {
+        OSAtomicIncrement64Barrier(&_missCount);
+    }
+    
+    return data;
+}
+
+- (BOOL)removeCacheForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    NSParameterAssert(identifier);
+    
+    [self removeMemoryItemForIdentifier:identifier];
+    return [_backingCacheManager removeCacheForIdentifier:identifier error:outError];
+}
+
+- (BOOL)removeAllCache:(NSError **)outError
+{
+    [self removeAllMemoryCache];
+    return [_backingCacheManager removeAllCache:outError];
+}
+
+#pragma mark - <RKAsyncURLRequestPromiseCacheManager>
+
+- (void)loadRevisionForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerRevisionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    RKTieredCacheItem *item = [self residentItemForIdentifier:identifier];
+    if(item) {
+        handler(item->_revision);
+        return;
+    }
+    
+    [_asyncBackingCacheManager loadRevisionForIdentifier:identifier completionHandler:handler];
+}
+
+- (void)loadCachedDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerDataHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    RKTieredCacheItem *item = [self memoryItemForIdentifier:identifier];
+    if(item) {
+        OSAtomicIncrement64Barrier(&_memoryHitCount);
+        handler(item->_data, nil);
+        return;
+    }
+    
+    uint64_t generation = [self currentGeneration];
+    [_asyncBackingCacheManager loadRevisionForIdentifier:identifier completionHandler:^(NSString *revision) {
+        [_asyncBackingCacheManager loadCachedDataForIdentifier:identifier completionHandler:^(NSData *data, NSError *error) {
+            if(data) {
+                OSAtomicIncrement64Barrier(&_backingHitCount);
+                [self promoteData:data forIdentifier:identifier revision:revision readAtGeneration:generation];
+            } else {
+                OSAtomicIncrement64Barrier(&_missCount);
+            }
+            
+            handler(data, error);
+        }];
+    }];
+}
+
+- (void)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(revision);
+    NSParameterAssert(handler);
+    
+    [_asyncBackingCacheManager cacheData:data forIdentifier:identifier withRevision:revision expirationDate:expirationDate completionHandler:^(BOOL success, NSError *error) {
+        [self storeCachedData:data forIdentifier:identifier revision:revision expirationDate:expirationDate success:success];
+        handler(success, error);
+    }];
+}
+
+- (void)removeCacheForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    NSParameterAssert(identifier);
+    NSParameterAssert(handler);
+    
+    [self removeMemoryItemForIdentifier:identifier];
+    [_asyncBackingCacheManager removeCacheForIdentifier:identifier completionHandler:handler];
+}
+
+#pragma mark - Partial Data
+
+- (BOOL)respondsToSelector:(SEL)selector
+{
+    if(selector == @selector(cachePartialData:forIdentifier:withValidator:error:) ||
+       selector == @selector(partialDataForIdentifier:validator:) ||
+       selector == @selector(removePartialDataForIdentifier:error:) ||
+       selector == @selector(noteRevalidationForIdentifier:))
+        return [_backingCacheManager respondsToSelector:selector];
+    
+    if(selector == @selector(cachePartialData:forIdentifier:withValidator:completionHandler:) ||
+       selector == @selector(loadPartialDataForIdentifier:completionHandler:) ||
+       selector == @selector(removePartialDataForIdentifier:completionHandler:))
+        return [_asyncBackingCacheManager respondsToSelector:selector];
+    
+    return [super respondsToSelector:selector];
+}
+
+- (BOOL)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator error:(NSError **)error
+{
+    return [_backingCacheManager cachePartialData:data forIdentifier:identifier withValidator:validator error:error];
+}
+
+- (NSData *)partialDataForIdentifier:(NSString *)identifier validator:(NSString **)outValidator
+{
+    return [_backingCacheManager partialDataForIdentifier:identifier validator:outValidator];
+}
+
+- (BOOL)removePartialDataForIdentifier:(NSString *)identifier error:(NSError **)outError
+{
+    return [_backingCacheManager removePartialDataForIdentifier:identifier error:outError];
+}
+
+- (void)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    [_asyncBackingCacheManager cachePartialData:data forIdentifier:identifier withValidator:validator completionHandler:handler];
+}
+
+- (void)loadPartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerPartialDataHandler)handler
+{
+    [_asyncBackingCacheManager loadPartialDataForIdentifier:identifier completionHandler:handler];
+}
+
+- (void)removePartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler
+{
+    [_asyncBackingCacheManager removePartialDataForIdentifier:identifier completionHandler:handler];
+}
+
+#pragma mark - Statistics
+
+- (void)noteRevalidationForIdentifier:(NSString *)identifier
+{
+    [_backingCacheManager noteRevalidationForIdentifier:identifier];
+}
+
+@end
@@ -11,6 +11,8 @@
 
 #import "RKPromise.h"
 #import "RKPostProcessor.h"
+#import "RKRequestScheduler.h"
+#import "RKProcessedValueCache.h"
 
 @class RKPossibility;
 
@@ -20,6 +22,10 @@ RK_EXTERN NSString *const RKURLRequestPromiseErrorDomain;
 ///The corresponding value is the cache identifier used by the original RKURLRequestPromise.
 RK_EXTERN NSString *const RKURLRequestPromiseCacheIdentifierErrorUserInfoKey;
 
+///The `NSURLProtocol` property of a request that holds the path of the file its body stream
+///reads from. RKURLRequestPromise reopens the file if its connection has to resend its body.
+RK_EXTERN NSString *const RKURLRequestPromiseBodyFilePathPropertyKey;
+
 ///The error codes that will be used in the `RKURLRequestPromiseErrorDomain`.
 NS_ENUM(NSInteger, RKURLRequestPromiseErrors) {
     ///The cache cannot be loaded.
@@ -80,6 +86,11 @@ NS_ENUM(NSInteger, RKURLRequestPromiseErrors) {
 ///
 ///This method should return nil and leave the `out error`
 ///empty to indicate there is no available value.
+///
+///The returned data is handed to the promise's post-processors without being copied,
+///so cache managers are encouraged to return memory-mapped data. A cache manager that
+///does so must guarantee the mapped bytes remain valid for the lifetime of the returned
+///object, even if the item is subsequently replaced or removed.
 - (NSData *)cachedDataForIdentifier:(NSString *)identifier error:(NSError **)error;
 
 ///Deletes all cache manager state related to a given identifier.
@@ -106,6 +117,196 @@ NS_ENUM(NSInteger, RKURLRequestPromiseErrors) {
 ///of writing this documentation.
 - (BOOL)removeAllCache:(NSError **)outError;
 
+#pragma mark - Partial Data
+
+@optional
+
+///Persist the partially loaded body of a request so that it may later be resumed.
+///
+/// \param  data        The bytes loaded so far, starting from the beginning of the body. Required.
+/// \param  identifier  The identifier of the request. Required.
+/// \param  validator   The strong ETag or Last-Modified date of the body. Required.
+/// \param  error       out NSError.
+///
+/// \result Whether or not the partial data could be persisted.
+///
+///Any partial data previously persisted for the identifier is replaced.
+///
+///This method will be called from multiple threads, and may safely block.
+- (BOOL)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator error:(NSError **)error;
+
+///Returns the partial data persisted for a given identifier.
+///
+/// \param  identifier      The identifier of the request. Required.
+/// \param  outValidator    On return, the validator the partial data was persisted with. Required.
+///
+/// \result The partial data, or nil if there is none.
+///
+///This method will be called from multiple threads, and may safely block.
+- (NSData *)partialDataForIdentifier:(NSString *)identifier validator:(NSString **)outValidator;
+
+///Deletes the partial data persisted for a given identifier.
+///
+/// \param  identifier  The identifier of the request. Required.
+/// \param  outError    out NSError.
+///
+/// \result Whether or not the partial data could be deleted. Deleting
+///         partial data that does not exist is considered a success.
+///
+///This method is called by `RKURLRequestPromise` once a complete body has
+///been loaded, or when the server indicates a persisted body can't be resumed.
+- (BOOL)removePartialDataForIdentifier:(NSString *)identifier error:(NSError **)outError;
+
+#pragma mark - Expiration
+
+///Persist a given data object with a specified identifier, revision, and expiration date.
+///
+/// \param  data            The data to persist. May be nil.
+/// \param  identifier      The identifier to use to cache the data. Required.
+/// \param  revision        The revision to associate with the data-identifier. Required.
+/// \param  expirationDate  The date after which the data is no longer worth keeping, as given
+///                         by the "Cache-Control" or "Expires" header of its response. Optional.
+/// \param  error           out NSError.
+///
+/// \result Whether or not the data could be persisted.
+///
+///When implemented, this method is called by `RKURLRequestPromise`
+///instead of `-[self cacheData:forIdentifier:withRevision:error:]`.
+///
+///This method will be called from multiple threads, and may safely block.
+- (BOOL)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate error:(NSError **)error;
+
+///Returns the expiration date the cached data for a given identifier was persisted with.
+///
+/// \param  identifier  The identifier whose expiration date should be looked up. Required.
+///
+/// \result The expiration date of the cached data, or nil if it has none or there is no cached data.
+///
+///This method is used by cache managers layered in front of the receiver, such as
+///`RKTieredCacheManager`, to keep the data they copy from it no longer than it would.
+///
+///This method will be called from multiple threads, and may safely block.
+- (NSDate *)expirationDateForIdentifier:(NSString *)identifier;
+
+#pragma mark - Statistics
+
+///Informs the receiver that the cached data for a given identifier was revalidated, because
+///the revision of a response from the network matched the revision it was stored with.
+///
+/// \param  identifier  The identifier of the revalidated data. Required.
+///
+///This method will be called from multiple threads, and should not block.
+- (void)noteRevalidationForIdentifier:(NSString *)identifier;
+
+@end
+
+#pragma mark -
+
+///A block invoked when an asynchronous cache manager has finished reading cached data.
+///
+/// \param  data    The cached data, or nil if there is none or it could not be read.
+/// \param  error   An error describing why the data could not be read. Nil if there is simply no data.
+typedef void(^RKURLRequestPromiseCacheManagerDataHandler)(NSData *data, NSError *error);
+
+///A block invoked when an asynchronous cache manager has finished changing its contents.
+///
+/// \param  success Whether or not the change was made.
+/// \param  error   An error describing why the change could not be made.
+typedef void(^RKURLRequestPromiseCacheManagerCompletionHandler)(BOOL success, NSError *error);
+
+///A block invoked when an asynchronous cache manager has finished reading partial data.
+///
+/// \param  partialData The partial data, or nil if there is none.
+/// \param  validator   The validator the partial data was persisted with, or nil if there is no partial data.
+typedef void(^RKURLRequestPromiseCacheManagerPartialDataHandler)(NSData *partialData, NSString *validator);
+
+///A block invoked when an asynchronous cache manager has finished looking up a revision.
+///
+/// \param  revision    The revision of the cached data, or nil if there is none.
+typedef void(^RKURLRequestPromiseCacheManagerRevisionHandler)(NSString *revision);
+
+///The RKAsyncURLRequestPromiseCacheManager protocol outlines asynchronous counterparts to
+///the methods of `<RKURLRequestPromiseCacheManager>` that may perform file system IO.
+///
+///RKURLRequestPromise loads and stores cached data through this protocol so that a slow
+///disk never stalls the work queue its connections deliver their callbacks on. Cache
+///managers that only conform to `<RKURLRequestPromiseCacheManager>` are used through
+///an `RKAsyncCacheManagerAdapter`.
+///
+///Handlers may be invoked on any thread, and must be invoked exactly once.
+@protocol RKAsyncURLRequestPromiseCacheManager <RKURLRequestPromiseCacheManager>
+
+///Asynchronously looks up the revision of the cached data for a given identifier.
+///
+/// \param  identifier  The identifier to look up the revision for. Required.
+/// \param  handler     The block to invoke with the revision. Required.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> revisionForIdentifier:])
+- (void)loadRevisionForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerRevisionHandler)handler;
+
+///Asynchronously reads the cached data for a given identifier.
+///
+/// \param  identifier  The identifier to read the cached data for. Required.
+/// \param  handler     The block to invoke with the cached data. Required.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> cachedDataForIdentifier:error:])
+- (void)loadCachedDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerDataHandler)handler;
+
+///Asynchronously persists a given data object with a specified identifier, revision, and expiration date.
+///
+/// \param  data            The data to persist. May be nil.
+/// \param  identifier      The identifier to use to cache the data. Required.
+/// \param  revision        The revision to associate with the data-identifier. Required.
+/// \param  expirationDate  The date after which the data is no longer worth keeping. Optional.
+/// \param  handler         The block to invoke once the data has been persisted. Required.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> cacheData:forIdentifier:withRevision:expirationDate:error:])
+- (void)cacheData:(NSData *)data forIdentifier:(NSString *)identifier withRevision:(NSString *)revision expirationDate:(NSDate *)expirationDate completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler;
+
+///Asynchronously deletes all cache manager state related to a given identifier.
+///
+/// \param  identifier  The identifier to delete. Required.
+/// \param  handler     The block to invoke once the state has been deleted. Required.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> removeCacheForIdentifier:error:])
+- (void)removeCacheForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler;
+
+#pragma mark - Partial Data
+
+@optional
+
+///Asynchronously persists the partially loaded body of a request so that it may later be resumed.
+///
+/// \param  data        The bytes loaded so far, starting from the beginning of the body. Required.
+/// \param  identifier  The identifier of the request. Required.
+/// \param  validator   The strong ETag or Last-Modified date of the body. Required.
+/// \param  handler     The block to invoke once the partial data has been persisted. Required.
+///
+///This method must be implemented if the receiver responds to `-cachePartialData:forIdentifier:withValidator:error:`.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> cachePartialData:forIdentifier:withValidator:error:])
+- (void)cachePartialData:(NSData *)data forIdentifier:(NSString *)identifier withValidator:(NSString *)validator completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler;
+
+///Asynchronously reads the partial data persisted for a given identifier.
+///
+/// \param  identifier  The identifier of the request. Required.
+/// \param  handler     The block to invoke with the partial data. Required.
+///
+///This method must be implemented if the receiver responds to `-partialDataForIdentifier:validator:`.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> partialDataForIdentifier:validator:])
+- (void)loadPartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerPartialDataHandler)handler;
+
+///Asynchronously deletes the partial data persisted for a given identifier.
+///
+/// \param  identifier  The identifier of the request. Required.
+/// \param  handler     The block to invoke once the partial data has been deleted. Optional.
+///
+///This method must be implemented if the receiver responds to `-removePartialDataForIdentifier:error:`.
+///
+/// \seealso(-[<RKURLRequestPromiseCacheManager> removePartialDataForIdentifier:error:])
+- (void)removePartialDataForIdentifier:(NSString *)identifier completionHandler:(RKURLRequestPromiseCacheManagerCompletionHandler)handler;
+
 @end
 
 ///How an instance of RKURLRequestPromise should behave
@@ -138,8 +339,8 @@ typedef NS_ENUM(NSInteger, RKURLRequestPromiseOfflineBehavior) {
 
 #pragma mark -
 
-@class RKConnectivityManager;
-    
+@class RKConnectivityManager, RKRateLimiter;
+
 ///The RKURLRequestPromise class encapsulates a network request. It connects
 ///with the `RKConnectivityManager` class, comfortably operates with the
 ///`RKPostProcessor` mechanism from its parent class `RKPromise`, and contains
@@ -155,11 +356,17 @@ typedef NS_ENUM(NSInteger, RKURLRequestPromiseOfflineBehavior) {
 ///
 ///RKURLRequestPromise will check headers of responses for an ETag, and if that
 ///is not found, it will check for a Creation header. If one of said fields are
-///found, its value will be used as the revision for the cache manager. Currently
-///RKURLRequestPromise does not honor the "Cache-Control" header. __Important:__
+///found, its value will be used as the revision for the cache manager. __Important:__
 ///the contents of the "Creation" header are treated as an opaque value, any change
 ///will result in a full request to the server.
 ///
+///Responses without an ETag are stored with an expiration date derived from the
+///"max-age" directive of their "Cache-Control" header, or from their "Expires"
+///header, when cache managers implement the optional method that accepts one.
+///Responses with an ETag can always be revalidated, so they are stored without one.
+///Responses whose "Cache-Control" header contains "no-store" are never cached, and
+///responses without an ETag whose header contains "no-cache" are stored already expired.
+///
 ///When server headers do not contain cache identification information, there are
 ///multiple behaviors that can occur depending on the value of `self.offlineBehavior`.
 ///
@@ -175,6 +382,27 @@ typedef NS_ENUM(NSInteger, RKURLRequestPromiseOfflineBehavior) {
 ///change the connectivity manager used after a request promise has been
 ///created by mutating the `self.connectivityManager`.
 ///
+///#Scheduling:
+///
+///Connections are started through an `RKRequestScheduler`, which limits how many
+///requests may be in flight to a single host and adapts that limit to the latency
+///and error rates observed for the host. A request promise that has been realized
+///may wait in its scheduler before its connection is started.
+///
+///Before a request promise is handed to its scheduler, it must first take a token
+///from its `RKRateLimiter`, if it has one. Requests that exceed the rate limiter's
+///quota wait until a token becomes available instead of failing.
+///
+///#Resuming:
+///
+///When a GET request fails after part of its body has been loaded, and the response
+///carried a strong ETag or a Last-Modified date, the loaded bytes are persisted through
+///the cache manager, provided it implements the optional partial data methods of
+///`<RKURLRequestPromiseCacheManager>`. Subsequent requests for the same cache identifier
+///ask the server for the remainder of the body with the `Range` and `If-Range` headers,
+///and a `206 Partial Content` response is stitched onto the persisted bytes before the
+///complete body is cached and reported.
+///
 ///#Realization:
 ///
 ///The RKURLRequestPromise class is lazy. It will not perform any work until
@@ -221,6 +449,27 @@ typedef NS_ENUM(NSInteger, RKURLRequestPromiseOfflineBehavior) {
 ///Assigning nil to this property will raise an exception.
 @property (nonatomic, strong) RKConnectivityManager *connectivityManager;
 
+///The scheduler that regulates how many requests may be in flight to the receiver's host.
+///
+///Defaults to `+[RKRequestScheduler sharedRequestScheduler]`. Assigning nil
+///to this property causes the receiver to start its connection immediately.
+///This property must not be changed after the receiver has been realized.
+@property (nonatomic, strong) RKRequestScheduler *requestScheduler;
+
+///The priority the receiver's connection is scheduled with.
+///
+///Defaults to `kRKRequestSchedulerPriorityNormal`. This property
+///must not be changed after the receiver has been realized.
+@property (nonatomic) RKRequestSchedulerPriority schedulingPriority;
+
+///The rate limiter the receiver must take a token from before its connection is scheduled.
+///
+///Defaults to the rate limiter registered for the receiver's URL through
+///`+[RKRateLimiter setRateLimiter:forBaseURL:]`, if any. `RKRequestFactory`
+///assigns its own rate limiter to the promises it creates. This property
+///must not be changed after the receiver has been realized.
+@property (nonatomic, strong) RKRateLimiter *rateLimiter;
+
 ///The URL request.
 @property (readonly, RK_NONATOMIC_IOSONLY) NSURLRequest *request;
 
@@ -242,6 +491,18 @@ typedef NS_ENUM(NSInteger, RKURLRequestPromiseOfflineBehavior) {
 ///The cache manager of the request.
 @property (readonly, RK_NONATOMIC_IOSONLY) id <RKURLRequestPromiseCacheManager> cacheManager;
 
+///The cache the values produced by the receiver's post-processors are kept in. Defaults to nil.
+///
+///When the receiver is realized with cached data, whether because it is offline or because
+///the server reports the data is unchanged, the value its post-processors produced from the
+///same revision of the data is reused, and its post-processors are not run. Values produced
+///from data without an ETag or Expires header are never reused, nor are values produced by
+///post-processors without a processing identifier. `-[self cachedData]` does not use this cache.
+///
+///Reused values are shared between every request that uses the same cache, so they must not be
+///mutated. This property must not be changed after the receiver has been realized.
+@property (strong, RK_NONATOMIC_IOSONLY) RKProcessedValueCache *processedValueCache;
+
 #pragma mark -
 
 ///How the request promise should behave if its connectivity manager reports being offline.
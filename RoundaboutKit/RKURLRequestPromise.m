@@ -9,6 +9,9 @@
 #import "RKURLRequestPromise.h"
 #import "RKConnectivityManager.h"
 #import "RKActivityManager.h"
+#import "RKRequestScheduler.h"
+#import "RKRateLimiter.h"
+#import "RKAsyncCacheManagerAdapter.h"
 
 #if TARGET_OS_IPHONE
 #   import <UIKit/UIKit.h>
@@ -18,11 +21,24 @@
 
 NSString *const RKURLRequestPromiseErrorDomain = @"RKURLRequestPromiseErrorDomain";
 NSString *const RKURLRequestPromiseCacheIdentifierErrorUserInfoKey = @"RKURLRequestPromiseCacheIdentifierErrorUserInfoKey";
+NSString *const RKURLRequestPromiseBodyFilePathPropertyKey = @"RKURLRequestPromiseBodyFilePathPropertyKey";
 
 static NSString *const kETagHeaderKey = @"Etag";
 static NSString *const kExpiresHeaderKey = @"Expires";
+static NSString *const kCacheControlHeaderKey = @"Cache-Control";
+static NSString *const kMaxAgeDirective = @"max-age=";
+static NSString *const kNoStoreDirective = @"no-store";
+static NSString *const kNoCacheDirective = @"no-cache";
+static NSString *const kPrivateDirective = @"private";
 static NSString *const kDefaultRevision = @"-1";
 
+static NSString *const kLastModifiedHeaderKey = @"Last-Modified";
+static NSString *const kAcceptRangesHeaderKey = @"Accept-Ranges";
+static NSString *const kContentRangeHeaderKey = @"Content-Range";
+static NSString *const kContentLengthHeaderKey = @"Content-Length";
+static NSString *const kRangeHeaderKey = @"Range";
+static NSString *const kIfRangeHeaderKey = @"If-Range";
+
 @interface RKURLRequestPromise () <NSURLConnectionDelegate>
 
 #pragma mark - Internal Properties
@@ -46,6 +62,10 @@ static NSString *const kDefaultRevision = @"-1";
 #pragma mark -
 
 @implementation RKURLRequestPromise {
+    ///The asynchronous counterpart of `cacheManager`, through which all cache
+    ///loads and stores are performed so the work queue never waits on disk IO.
+    id <RKAsyncURLRequestPromiseCacheManager> _asyncCacheManager;
+    
     ///Whether or not the request started when its
     ///connection manager reported being offline.
     BOOL _isInOfflineMode;
@@ -63,6 +83,34 @@ static NSString *const kDefaultRevision = @"-1";
     NSLock *_loadedDataLock;
     
     
+    ///The ticket issued by the request scheduler for the connection. Guarded by `@synchronized(self)`.
+    RKRequestSchedulerTicket *_schedulerTicket;
+    
+    ///The ticket issued by the rate limiter for the request. Guarded by `@synchronized(self)`.
+    RKRateLimiterTicket *_rateLimiterTicket;
+    
+    ///Whether or not the rate limiter's ticket has been given up. Guarded by `@synchronized(self)`.
+    BOOL _hasScheduledConnection;
+    
+    
+    ///The persisted partial body the current connection is resuming. Only accessed from the work queue.
+    NSData *_resumedData;
+    
+    ///Whether or not the cache manager has partial data for the receiver. Only accessed from the work queue.
+    BOOL _hasPartialData;
+    
+    ///Whether or not the server has refused to resume the receiver's body. Only accessed from the work queue.
+    BOOL _isRangeRejected;
+    
+    
+    ///The revision of the data being accepted, if the value post-processed
+    ///from it may be reused. Only accessed from the work queue.
+    NSString *_acceptedRevision;
+    
+    ///The reused value to accept in place of post-processing the data being accepted. Only accessed from the work queue.
+    id _acceptedProcessedValue;
+    
+    
     ///The legacy post processor block. Used by the RKDeprecated category.
     RKSimplePostProcessorBlock _legacyPostProcessor;
     
@@ -125,6 +173,7 @@ static BOOL gActivityLoggingEnabled = NO;
         self.cacheIdentifier = [request.URL absoluteString];
         
         self.cacheManager = cacheManager;
+        _asyncCacheManager = cacheManager? RKAsyncCacheManagerForCacheManager(cacheManager) : nil;
         
         switch (offlineBehavior) {
             case kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable:
@@ -133,13 +182,15 @@ static BOOL gActivityLoggingEnabled = NO;
                 else
                     self.offlineBehavior = kRKURLRequestPromiseOfflineBehaviorFail;
                 break;
-                
+            
             case kRKURLRequestPromiseOfflineBehaviorFail:
                 self.offlineBehavior = kRKURLRequestPromiseOfflineBehaviorFail;
                 break;
         }
         
         self.connectivityManager = [RKConnectivityManager defaultInternetConnectivityManager];
+        self.requestScheduler = [RKRequestScheduler sharedRequestScheduler];
+        self.rateLimiter = [RKRateLimiter rateLimiterForURL:request.URL];
         
         _loadedDataLock = [NSLock new];
         _loadedDataLock.name = @"com.roundabout.rk.RKURLRequestPromise.loadedDataLock";
@@ -187,10 +238,21 @@ static BOOL gActivityLoggingEnabled = NO;
             [workQueue addOperationWithBlock:^{
                 [self loadCacheAndReportError:YES];
             }];
+        } else if(self.rateLimiter) {
+            RKRateLimiterTicket *ticket = [self.rateLimiter enqueueRequest:self.request withBlock:^{
+                [workQueue addOperationWithBlock:^{
+                    [self scheduleConnection];
+                }];
+            }];
+            
+            //The limiter may have issued its token inline, and a concurrent work
+            //queue may have already scheduled the connection and given up the ticket.
+            @synchronized(self) {
+                if(!_hasScheduledConnection)
+                    _rateLimiterTicket = ticket;
+            }
         } else {
-            self.connection = [[NSURLConnection alloc] initWithRequest:self.request delegate:self startImmediately:NO];
-            [self.connection setDelegateQueue:workQueue];
-            [self.connection start];
+            [self scheduleConnection];
         }
         
         if(gActivityLoggingEnabled) {
@@ -204,86 +266,393 @@ static BOOL gActivityLoggingEnabled = NO;
     }];
 }
 
+///Hands the receiver's request to its request scheduler.
+///
+///This method is invoked on the work queue once the rate
+///limiter has issued a token for the receiver's request.
+- (void)scheduleConnection
+{
+    //The rate limiter's ticket is only given up once the scheduler's ticket or the connection
+    //is in place, so that a concurrent cancel always finds something to cancel.
+    if(self.requestScheduler) {
+        NSOperationQueue *workQueue = self.workQueue;
+        @synchronized(self) {
+            _rateLimiterTicket = nil;
+            _hasScheduledConnection = YES;
+            if(_canceled)
+                return;
+            
+            _schedulerTicket = [self.requestScheduler enqueueRequest:self.request priority:self.schedulingPriority withBlock:^{
+                [workQueue addOperationWithBlock:^{
+                    [self startConnection];
+                }];
+            }];
+        }
+    } else {
+        [self startConnection];
+        
+        @synchronized(self) {
+            _rateLimiterTicket = nil;
+            _hasScheduledConnection = YES;
+        }
+    }
+}
+
+///Creates and starts the underlying connection of the receiver.
+///
+///This method is invoked on the work queue once the request
+///scheduler has made room for the receiver's request.
+- (void)startConnection
+{
+    if(self.canceled)
+        return;
+    
+    _resumedData = nil;
+    if(!_isRangeRejected && [self.request.HTTPMethod isEqualToString:@"GET"] && self.cacheIdentifier != nil &&
+       [_asyncCacheManager respondsToSelector:@selector(loadPartialDataForIdentifier:completionHandler:)]) {
+        //Partial data is read off of the work queue, which also delivers every connection's callbacks.
+        NSOperationQueue *workQueue = self.workQueue;
+        [_asyncCacheManager loadPartialDataForIdentifier:self.cacheIdentifier completionHandler:^(NSData *partialData, NSString *validator) {
+            [workQueue addOperationWithBlock:^{
+                _hasPartialData = (partialData != nil);
+                [self startConnectionResumingPartialData:partialData validator:validator];
+            }];
+        }];
+    } else {
+        [self startConnectionResumingPartialData:nil validator:nil];
+    }
+}
+
+///Creates and starts the underlying connection of the receiver, resuming a given partial body if possible.
+///
+/// \param  partialData The partial body persisted for the receiver, if any.
+/// \param  validator   The validator the partial body was persisted with, if any.
+- (void)startConnectionResumingPartialData:(NSData *)partialData validator:(NSString *)validator
+{
+    NSURLRequest *request = self.request;
+    if(partialData.length > 0 && validator != nil) {
+        NSMutableURLRequest *resumingRequest = [request mutableCopy];
+        [resumingRequest setValue:[NSString stringWithFormat:@"bytes=%lu-", (unsigned long)partialData.length] forHTTPHeaderField:kRangeHeaderKey];
+        [resumingRequest setValue:validator forHTTPHeaderField:kIfRangeHeaderKey];
+        request = resumingRequest;
+        
+        _resumedData = partialData;
+    }
+    
+    NSURLConnection *connection = [[NSURLConnection alloc] initWithRequest:request delegate:self startImmediately:NO];
+    [connection setDelegateQueue:self.workQueue];
+    RKRequestSchedulerTicket *ticket = nil;
+    @synchronized(self) {
+        if(_canceled)
+            return;
+        
+        self.connection = connection;
+        ticket = _schedulerTicket;
+    }
+    
+    //Latency is measured from here so that the work queue's backlog is not mistaken for congestion.
+    [self.requestScheduler ticketDidStartConnection:ticket];
+    [connection start];
+}
+
+///Informs the request scheduler that the receiver's connection has
+///finished, relinquishing the receiver's place in its host's window.
+- (void)completeSchedulerTicketWithResponse:(NSURLResponse *)response error:(NSError *)error
+{
+    RKRequestSchedulerTicket *ticket = nil;
+    @synchronized(self) {
+        ticket = _schedulerTicket;
+        _schedulerTicket = nil;
+    }
+    
+    [self.requestScheduler completeTicket:ticket withResponse:response error:error];
+}
+
+#pragma mark - Resuming
+
+///Returns the validator that may be used to resume the body of a given response, if any.
+///
+///Weak ETags cannot be used with `If-Range`, so the Last-Modified date is used instead.
+- (NSString *)resumeValidatorForResponse:(NSHTTPURLResponse *)response
+{
+    NSString *acceptRanges = response.allHeaderFields[kAcceptRangesHeaderKey];
+    if(acceptRanges && [acceptRanges caseInsensitiveCompare:@"none"] == NSOrderedSame)
+        return nil;
+    
+    NSString *eTag = response.allHeaderFields[kETagHeaderKey];
+    if(eTag && ![eTag hasPrefix:@"W/"])
+        return eTag;
+    
+    return response.allHeaderFields[kLastModifiedHeaderKey];
+}
+
+///Returns whether or not a given partial content response starts at a given offset.
+- (BOOL)partialResponse:(NSHTTPURLResponse *)response startsAtOffset:(NSUInteger)offset
+{
+    //Content-Range: bytes <first>-<last>/<length>
+    NSScanner *scanner = [NSScanner scannerWithString:response.allHeaderFields[kContentRangeHeaderKey] ?: @""];
+    long long firstBytePosition = 0;
+    return ([scanner scanString:@"bytes" intoString:NULL] &&
+            [scanner scanLongLong:&firstBytePosition] &&
+            firstBytePosition == (long long)offset);
+}
+
+///Returns a response that describes the complete body a partial content response was stitched into.
+- (NSHTTPURLResponse *)completeResponseForPartialResponse:(NSHTTPURLResponse *)response totalLength:(NSUInteger)totalLength
+{
+    NSMutableDictionary *headerFields = [response.allHeaderFields mutableCopy];
+    [headerFields removeObjectForKey:kContentRangeHeaderKey];
+    headerFields[kContentLengthHeaderKey] = [NSString stringWithFormat:@"%lu", (unsigned long)totalLength];
+    
+    return [[NSHTTPURLResponse alloc] initWithURL:response.URL
+                                       statusCode:200
+                                      HTTPVersion:@"HTTP/1.1"
+                                     headerFields:headerFields];
+}
+
+///Persists the body loaded so far by the receiver's connection so that it may be resumed later.
+- (void)persistPartialData
+{
+    if(self.canceled || self.cacheIdentifier == nil ||
+       ![self.request.HTTPMethod isEqualToString:@"GET"] ||
+       ![_asyncCacheManager respondsToSelector:@selector(cachePartialData:forIdentifier:withValidator:completionHandler:)])
+        return;
+    
+    NSHTTPURLResponse *response = self.response;
+    if(response.statusCode != 200)
+        return;
+    
+    NSString *validator = [self resumeValidatorForResponse:response];
+    if(!validator)
+        return;
+    
+    [_loadedDataLock lock];
+    NSData *loadedData = [_loadedData copy];
+    [_loadedDataLock unlock];
+    
+    if(loadedData.length == 0)
+        return;
+    
+    NSString *cacheIdentifier = self.cacheIdentifier;
+    NSDictionary *properties = gActivityLoggingEnabled? @{@"request": self.requestIdentifier, @"URL":self.request.URL} : nil;
+    [_asyncCacheManager cachePartialData:loadedData forIdentifier:cacheIdentifier withValidator:validator completionHandler:^(BOOL success, NSError *error) {
+        if(!success)
+            RKLogWarning(@"Could not persist partial data for %@. %@", cacheIdentifier, error);
+        else if(properties)
+            RKLogNetworkWithProperties(properties, @"Persisted %lu bytes of partial data for %@", (unsigned long)loadedData.length, cacheIdentifier);
+    }];
+}
+
+///Deletes any partial data persisted for the receiver without waiting for it to be deleted.
+- (void)removePartialData
+{
+    if(!_hasPartialData || ![_asyncCacheManager respondsToSelector:@selector(removePartialDataForIdentifier:completionHandler:)])
+        return;
+    
+    _hasPartialData = NO;
+    
+    NSString *cacheIdentifier = self.cacheIdentifier;
+    [_asyncCacheManager removePartialDataForIdentifier:cacheIdentifier completionHandler:^(BOOL success, NSError *error) {
+        if(!success)
+            RKLogWarning(@"Could not remove partial data for %@. %@", cacheIdentifier, error);
+    }];
+}
+
 #pragma mark - RKCancelable
 
 @synthesize canceled = _canceled;
 
 - (void)cancel:(id)sender
 {
-    if(!self.canceled && _connection) {
-        [self.connection cancel];
-        [_loadedDataLock lock];
-        _loadedData = nil;
-        [_loadedDataLock unlock];
+    //The connection and tickets are examined and the receiver is marked as canceled under
+    //the same lock that -scheduleConnection and -startConnection hand them over under.
+    RKRequestSchedulerTicket *ticket = nil;
+    RKRateLimiterTicket *rateLimiterTicket = nil;
+    NSURLConnection *connection = nil;
+    @synchronized(self) {
+        if(_canceled || !(_connection || _schedulerTicket || _rateLimiterTicket))
+            return;
         
-        if(gActivityLoggingEnabled) {
-            NSDictionary *properties = @{@"request":self.requestIdentifier, @"URL":self.request.URL};
-            RKLogNetworkWithProperties(properties, @"Canceled request");
-        }
+        ticket = _schedulerTicket;
+        _schedulerTicket = nil;
         
-        [[RKActivityManager sharedActivityManager] decrementActivityCount];
+        rateLimiterTicket = _rateLimiterTicket;
+        _rateLimiterTicket = nil;
+        
+        connection = _connection;
         
         [self willChangeValueForKey:@"canceled"];
         _canceled = YES;
         [self didChangeValueForKey:@"canceled"];
     }
+    
+    [self.rateLimiter cancelTicket:rateLimiterTicket];
+    [self.requestScheduler cancelTicket:ticket];
+    [connection cancel];
+    [_loadedDataLock lock];
+    _loadedData = nil;
+    [_loadedDataLock unlock];
+    
+    if(gActivityLoggingEnabled) {
+        NSDictionary *properties = @{@"request":self.requestIdentifier, @"URL":self.request.URL};
+        RKLogNetworkWithProperties(properties, @"Canceled request");
+    }
+    
+    [[RKActivityManager sharedActivityManager] decrementActivityCount];
 }
 
 #pragma mark - Cache Support
 
-- (BOOL)loadCacheAndReportError:(BOOL)reportError
+///Returns the formatter used to parse the dates of "Expires" headers.
++ (NSDateFormatter *)HTTPDateFormatter
+{
+    static NSDateFormatter *HTTPDateFormatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        HTTPDateFormatter = [NSDateFormatter new];
+        HTTPDateFormatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"];
+        HTTPDateFormatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        HTTPDateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    
+    return HTTPDateFormatter;
+}
+
+///Returns the date after which the receiver's cached response is no longer worth keeping,
+///or nil if its response does not say, or can be revalidated through its ETag.
+///
+/// \param  outMayStore On return, whether or not the response may be cached at all. Required.
+- (NSDate *)cacheExpirationDateMayStore:(BOOL *)outMayStore
+{
+    NSParameterAssert(outMayStore);
+    
+    *outMayStore = YES;
+    
+    NSDictionary *headers = self.response.allHeaderFields;
+    NSDate *maxAgeDate = nil;
+    BOOL mustRevalidate = NO;
+    for (NSString *directive in [headers[kCacheControlHeaderKey] componentsSeparatedByString:@","]) {
+        NSString *trimmedDirective = [[directive stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if([trimmedDirective isEqualToString:kNoStoreDirective]) {
+            *outMayStore = NO;
+            return nil;
+        } else if([trimmedDirective isEqualToString:kNoCacheDirective]) {
+            mustRevalidate = YES;
+        } else if([trimmedDirective hasPrefix:kPrivateDirective]) {
+            //The cache only ever serves the user the response was meant for.
+        } else if([trimmedDirective hasPrefix:kMaxAgeDirective]) {
+            maxAgeDate = [NSDate dateWithTimeIntervalSinceNow:[[trimmedDirective substringFromIndex:kMaxAgeDirective.length] doubleValue]];
+        }
+    }
+    
+    if(headers[kETagHeaderKey])
+        return nil;
+    
+    //Responses that must be revalidated but cannot be are stale as soon as they are stored.
+    if(mustRevalidate)
+        return [NSDate date];
+    
+    if(maxAgeDate)
+        return maxAgeDate;
+    
+    NSString *expires = headers[kExpiresHeaderKey];
+    if(!expires)
+        return nil;
+    
+    //Malformed dates, such as the "0" some servers send, mean the response has already expired.
+    NSDateFormatter *formatter = [self.class HTTPDateFormatter];
+    @synchronized(formatter) {
+        return [formatter dateFromString:expires] ?: [NSDate date];
+    }
+}
+
+- (void)loadCacheAndReportError:(BOOL)reportError
 {
     if(!self.cacheManager || self.cacheIdentifier == nil)
-        return NO;
+        return;
     
     if(self.canceled) {
         if(!_isInOfflineMode)
             [[RKActivityManager sharedActivityManager] decrementActivityCount];
         
-        return YES;
+        return;
     }
     
-    NSError *error = nil;
-    NSData *data = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:&error];
-    if(data) {
-        self.isCacheLoaded = YES;
-        
-        if (gActivityLoggingEnabled) {
-            NSString *cachedData = [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] ?: @"";
-            NSDictionary *properties = @{@"request":self.requestIdentifier, @"URL":self.request.URL, @"cached data":cachedData};
-            RKLogNetworkWithProperties(properties, @"Loaded cached data for %@", self.cacheIdentifier);
-        }
+    if(!self.processedValueCache) {
+        [self loadCachedDataWithRevision:nil reportError:reportError];
+        return;
+    }
+    
+    //The revision is looked up before the data is loaded, so that a value is never
+    //reused for, or cached under, a revision newer than the data it came from.
+    [_asyncCacheManager loadRevisionForIdentifier:self.cacheIdentifier completionHandler:^(NSString *revision) {
+        [self loadCachedDataWithRevision:([self canReuseProcessedValuesForRevision:revision]? revision : nil)
+                             reportError:reportError];
+    }];
+}
 
-        [self acceptWithData:data];
-    } else {
-        NSError *removeError = nil;
-        BOOL removedCache = [self.cacheManager removeCacheForIdentifier:self.cacheIdentifier error:&removeError];
-        
-        if(reportError) {
-            NSDictionary *userInfo = nil;
-            if(removedCache) {
-                userInfo = @{
-                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", self.cacheIdentifier],
-                    RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
-                };
-            } else {
-                userInfo = @{
-                    NSUnderlyingErrorKey: error,
-                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", self.cacheIdentifier],
-                    RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
-                    @"RKURLRequestPromiseCacheRemovalErrorUserInfoKey": removeError,
-                };
-            }
-            NSError *highLevelError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
-                                                          code:kRKURLRequestPromiseErrorCannotLoadCache
-                                                      userInfo:userInfo];
-            [self rejectWithError:highLevelError];
+///Loads the cached data of the receiver, and accepts it on the work queue.
+///
+/// \param  revision    The revision the cached data was known to have before it was loaded,
+///                     or nil if values post-processed from it should not be reused.
+/// \param  reportError Whether or not to reject the receiver if the data cannot be loaded.
+- (void)loadCachedDataWithRevision:(NSString *)revision reportError:(BOOL)reportError
+{
+    NSOperationQueue *workQueue = self.workQueue;
+    NSString *cacheIdentifier = self.cacheIdentifier;
+    RKProcessedValueCache *processedValueCache = self.processedValueCache;
+    NSArray *postProcessors = self.postProcessors;
+    
+    [_asyncCacheManager loadCachedDataForIdentifier:cacheIdentifier completionHandler:^(NSData *data, NSError *error) {
+        if(data) {
+            id processedValue = nil;
+            if(revision)
+                processedValue = [processedValueCache valueForIdentifier:cacheIdentifier revision:revision postProcessors:postProcessors];
             
-            return NO;
+            [workQueue addOperationWithBlock:^{
+                self.isCacheLoaded = YES;
+                
+                if (gActivityLoggingEnabled) {
+                    //The data itself is logged by -acceptWithData:, decoding it here as well would
+                    //fault in every page of a memory-mapped cache entry a second time.
+                    NSDictionary *properties = @{@"request":self.requestIdentifier, @"URL":self.request.URL, @"cached data length":@(data.length)};
+                    RKLogNetworkWithProperties(properties, @"Loaded cached data for %@", cacheIdentifier);
+                }
+                
+                _acceptedRevision = revision;
+                _acceptedProcessedValue = processedValue;
+                [self acceptWithData:data];
+            }];
+            
+            return;
         }
-    }
-    
-    return YES;
+        
+        [_asyncCacheManager removeCacheForIdentifier:cacheIdentifier completionHandler:^(BOOL removedCache, NSError *removeError) {
+            if(!reportError)
+                return;
+            
+            [workQueue addOperationWithBlock:^{
+                NSDictionary *userInfo = nil;
+                if(removedCache) {
+                    userInfo = @{
+                        NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", cacheIdentifier],
+                        RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: cacheIdentifier,
+                    };
+                } else {
+                    userInfo = @{
+                        NSUnderlyingErrorKey: error,
+                        NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", cacheIdentifier],
+                        RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: cacheIdentifier,
+                        @"RKURLRequestPromiseCacheRemovalErrorUserInfoKey": removeError,
+                    };
+                }
+                NSError *highLevelError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
+                                                              code:kRKURLRequestPromiseErrorCannotLoadCache
+                                                          userInfo:userInfo];
+                [self rejectWithError:highLevelError];
+            }];
+        }];
+    }];
 }
 
 - (RKPromise *)cachedData
@@ -294,16 +663,15 @@ static BOOL gActivityLoggingEnabled = NO;
     RKPromise *cachedDataPromise = [RKPromise new];
     [cachedDataPromise addPostProcessors:self.postProcessors];
     
-    [self.workQueue addOperationWithBlock:^{
-        NSError *error = nil;
-        NSData *data = [self.cacheManager cachedDataForIdentifier:self.cacheIdentifier error:&error];
+    NSString *cacheIdentifier = self.cacheIdentifier;
+    [_asyncCacheManager loadCachedDataForIdentifier:cacheIdentifier completionHandler:^(NSData *data, NSError *error) {
         if(data) {
             [cachedDataPromise accept:data];
         } else if(error) {
             NSDictionary *userInfo = @{
                 NSUnderlyingErrorKey: error,
-                NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", self.cacheIdentifier],
-                RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
+                NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not load cached data for identifier %@.", cacheIdentifier],
+                RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: cacheIdentifier,
             };
             NSError *highLevelError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
                                                           code:kRKURLRequestPromiseErrorCannotLoadCache
@@ -315,6 +683,38 @@ static BOOL gActivityLoggingEnabled = NO;
     return cachedDataPromise;
 }
 
+#pragma mark - Processed Values
+
+///Returns whether or not values post-processed from cached data of a given revision may be reused.
+- (BOOL)canReuseProcessedValuesForRevision:(NSString *)revision
+{
+    //Data loaded without a cache marker is stored under the default revision every
+    //time it is loaded, so the revision says nothing about whether it has changed.
+    return (self.processedValueCache != nil && revision != nil && ![revision isEqualToString:kDefaultRevision]);
+}
+
+- (id)postProcessAcceptedValue:(id)value error:(NSError **)outError
+{
+    id reusedValue = _acceptedProcessedValue;
+    NSString *revision = _acceptedRevision;
+    _acceptedProcessedValue = nil;
+    _acceptedRevision = nil;
+    
+    if(reusedValue) {
+        if(outError) *outError = nil;
+        return reusedValue;
+    }
+    
+    NSError *error = nil;
+    id processedValue = [super postProcessAcceptedValue:value error:&error];
+    if(!error && revision)
+        [self.processedValueCache setValue:processedValue forIdentifier:self.cacheIdentifier revision:revision postProcessors:self.postProcessors];
+    
+    if(outError) *outError = error;
+    
+    return processedValue;
+}
+
 #pragma mark - Invoking Callbacks
 
 - (void)acceptWithData:(NSData *)data
@@ -348,6 +748,8 @@ static BOOL gActivityLoggingEnabled = NO;
 
 - (void)connection:(NSURLConnection *)connection didFailWithError:(NSError *)error
 {
+    [self persistPartialData];
+    
     switch (error.code) {
         case NSURLErrorCannotFindHost:
         case NSURLErrorCannotConnectToHost:
@@ -357,25 +759,59 @@ static BOOL gActivityLoggingEnabled = NO;
         case NSURLErrorRedirectToNonExistentLocation:
         case NSURLErrorBadServerResponse: {
             if(self.isCacheLoaded) {
+                [self completeSchedulerTicketWithResponse:self.response error:error];
+                
                 //Return early, for we have loaded our cache.
                 return;
             }
             
             break;
         }
-            
+        
         default: {
             break;
         }
     }
     
+    [self completeSchedulerTicketWithResponse:self.response error:error];
+    
     [self rejectWithError:error];
 }
 
 - (void)connection:(NSURLConnection *)connection didReceiveResponse:(NSHTTPURLResponse *)response
 {
+    if(_resumedData) {
+        NSData *resumedData = _resumedData;
+        _resumedData = nil;
+        
+        if(response.statusCode == 206 && [self partialResponse:response startsAtOffset:resumedData.length]) {
+            [_loadedDataLock lock];
+            [_loadedData setData:resumedData];
+            [_loadedDataLock unlock];
+            
+            long long expectedContentLength = response.expectedContentLength;
+            NSUInteger totalLength = resumedData.length + (expectedContentLength > 0? (NSUInteger)expectedContentLength : 0);
+            response = [self completeResponseForPartialResponse:response totalLength:totalLength];
+        } else {
+            [self removePartialData];
+            
+            //The server could not satisfy the range, so the whole body is requested again. The
+            //partial data may outlive a failed removal, so the range is never sent again.
+            if(response.statusCode == 416) {
+                _isRangeRejected = YES;
+                [connection cancel];
+                [self startConnection];
+                return;
+            }
+        }
+    }
+    
     self.response = response;
     
+    @synchronized(self) {
+        [self.requestScheduler ticketDidReceiveResponse:_schedulerTicket];
+    }
+    
     if(gActivityLoggingEnabled) {
         NSDictionary *properties = @{@"request": self.requestIdentifier, @"URL":self.request.URL, @"headers": (response.allHeaderFields ?: @{})};
         RKLogNetworkWithProperties(properties, @"%@Response %@ %@",  (_isInOfflineMode? @"(offline) " : @""), self.request.HTTPMethod, self.request.URL);
@@ -387,7 +823,11 @@ static BOOL gActivityLoggingEnabled = NO;
     NSString *cacheMarker = response.allHeaderFields[kETagHeaderKey] ?: response.allHeaderFields[kExpiresHeaderKey];
     NSString *storedCacheMarker = [self.cacheManager revisionForIdentifier:self.cacheIdentifier];
     if(cacheMarker && storedCacheMarker && [cacheMarker caseInsensitiveCompare:storedCacheMarker] == NSOrderedSame) {
+        if([self.cacheManager respondsToSelector:@selector(noteRevalidationForIdentifier:)])
+            [self.cacheManager noteRevalidationForIdentifier:self.cacheIdentifier];
+        
         [self.connection cancel];
+        [self completeSchedulerTicketWithResponse:response error:nil];
         @synchronized(self) {
             _loadedData = nil;
         }
@@ -417,35 +857,56 @@ static BOOL gActivityLoggingEnabled = NO;
     _loadedData = nil;
     [_loadedDataLock unlock];
     
-    if(self.cacheManager) {
-        NSString *cacheMarker = self.response.allHeaderFields[kETagHeaderKey] ?: self.response.allHeaderFields[kExpiresHeaderKey];
-        if(!cacheMarker && self.offlineBehavior == kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable)
-            cacheMarker = kDefaultRevision;
-        
-        if(cacheMarker) {
-            NSError *error = nil;
-            if(![self.cacheManager cacheData:loadedData
-                               forIdentifier:self.cacheIdentifier
-                                withRevision:cacheMarker
-                                       error:&error]) {
+    [self completeSchedulerTicketWithResponse:self.response error:nil];
+    [self removePartialData];
+    
+    NSString *cacheMarker = self.response.allHeaderFields[kETagHeaderKey] ?: self.response.allHeaderFields[kExpiresHeaderKey];
+    if(!cacheMarker && self.offlineBehavior == kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable)
+        cacheMarker = kDefaultRevision;
+    
+    BOOL mayStore = NO;
+    NSDate *expirationDate = [self cacheExpirationDateMayStore:&mayStore];
+    if(self.cacheManager && cacheMarker && mayStore) {
+        NSOperationQueue *workQueue = self.workQueue;
+        NSString *cacheIdentifier = self.cacheIdentifier;
+        [_asyncCacheManager cacheData:loadedData forIdentifier:cacheIdentifier withRevision:cacheMarker expirationDate:expirationDate completionHandler:^(BOOL success, NSError *error) {
+            [workQueue addOperationWithBlock:^{
+                if(success) {
+                    if([self canReuseProcessedValuesForRevision:cacheMarker])
+                        _acceptedRevision = cacheMarker;
+                    
+                    [self acceptWithData:loadedData];
+                    return;
+                }
+                
                 NSDictionary *userInfo = @{
                     NSUnderlyingErrorKey: error,
-                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not write data to cache for identifier %@.", self.cacheIdentifier],
-                    RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: self.cacheIdentifier,
+                    NSLocalizedDescriptionKey: [NSString stringWithFormat:@"Could not write data to cache for identifier %@.", cacheIdentifier],
+                    RKURLRequestPromiseCacheIdentifierErrorUserInfoKey: cacheIdentifier,
                 };
                 NSError *highLevelError = [NSError errorWithDomain:RKURLRequestPromiseErrorDomain
                                                               code:kRKURLRequestPromiseErrorCannotWriteCache
                                                           userInfo:userInfo];
                 [self rejectWithError:highLevelError];
-            }
-        }
+            }];
+        }];
+    } else {
+        [self acceptWithData:loadedData];
     }
     
-    [self acceptWithData:loadedData];
-    
     _connection = nil;
 }
 
+- (NSInputStream *)connection:(NSURLConnection *)connection needNewBodyStream:(NSURLRequest *)request
+{
+    NSString *bodyFilePath = [NSURLProtocol propertyForKey:RKURLRequestPromiseBodyFilePathPropertyKey inRequest:self.request];
+    if(bodyFilePath)
+        return [NSInputStream inputStreamWithFileAtPath:bodyFilePath];
+    
+    //Bodies produced by chunk generators cannot be rewound, so the connection fails.
+    return nil;
+}
+
 #pragma mark -
 
 - (BOOL)connection:(NSURLConnection *)connection canAuthenticateAgainstProtectionSpace:(NSURLProtectionSpace *)protectionSpace
@@ -34,8 +34,15 @@
 #import "RKDefaults.h"
 #import "RKJson.h"
 #import "RKConnectivityManager.h"
+#import "RKRequestScheduler.h"
+#import "RKRateLimiter.h"
+#import "RKPrefetchGroup.h"
 #import "RKURLRequestPromise.h"
 #import "RKFileSystemCacheManager.h"
+#import "RKFileSystemCacheStatistics.h"
+#import "RKTieredCacheManager.h"
+#import "RKAsyncCacheManagerAdapter.h"
+#import "RKProcessedValueCache.h"
 #import "RKRequestFactory.h"
 #import "RKPossibility.h"
 #import "RKActivityManager.h"
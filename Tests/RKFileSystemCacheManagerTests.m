@@ -8,6 +8,7 @@
 
 #import <XCTest/XCTest.h>
 #import "RKFileSystemCacheManager.h"
+#import "RKFileSystemCacheIndex.h"
 
 static NSString *const kTestDataString = @"this is some lovely data you've got here";
 
@@ -17,6 +18,13 @@ static NSString *const kRevision = @"1";
 static NSString *const kNonExistentCacheIdentiifer = @"SmarchFifth";
 
 
+@interface RKFileSystemCacheManager (Maintenance)
+
++ (NSMutableDictionary *)buckets;
+- (void)preformMaintenance;
+
+@end
+
 @interface RKFileSystemCacheManagerTests : XCTestCase
 
 @property RKFileSystemCacheManager *cacheManager;
@@ -32,6 +40,12 @@ static NSString *const kNonExistentCacheIdentiifer = @"SmarchFifth";
     self.cacheManager = [RKFileSystemCacheManager sharedCacheManager];
 }
 
+- (NSURL *)temporaryCacheLocation
+{
+    NSString *name = [NSString stringWithFormat:@"RKFileSystemCacheManagerTests-%@", [[NSProcessInfo processInfo] globallyUniqueString]];
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name] isDirectory:YES];
+}
+
 #pragma mark -
 
 /* These tests must be run in the order in which they appear or they will not pass. */
@@ -98,4 +112,739 @@ static NSString *const kNonExistentCacheIdentiifer = @"SmarchFifth";
     XCTAssertNil(error, @"unexpected error");
 }
 
+#pragma mark - Journal
+
+- (void)testJournalReplay
+{
+    NSURL *location = [self temporaryCacheLocation];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:kNonExistentCacheIdentiifer withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:kNonExistentCacheIdentiifer error:NULL], @"could not remove cache");
+    cacheManager.maxCacheSize = 1024;
+    cacheManager = nil;
+    
+    RKFileSystemCacheManager *reopenedCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertEqualObjects([reopenedCacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"put was not replayed");
+    XCTAssertNil([reopenedCacheManager revisionForIdentifier:kNonExistentCacheIdentiifer], @"remove was not replayed");
+    XCTAssertEqual(reopenedCacheManager.cacheSize, testData.length, @"unexpected cache size");
+    XCTAssertEqual(reopenedCacheManager.maxCacheSize, 1024UL, @"max cache size was not replayed");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testJournalDiscardsIncompleteRecord
+{
+    NSURL *location = [self temporaryCacheLocation];
+    [[NSFileManager defaultManager] createDirectoryAtURL:location withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+    entry.key = @"complete";
+    entry.revision = kRevision;
+    entry.dataSize = 10;
+    [index setEntry:entry];
+    index = nil;
+    
+    NSFileHandle *journal = [NSFileHandle fileHandleForWritingToURL:[location URLByAppendingPathComponent:@"__Index.journal"] error:NULL];
+    [journal seekToEndOfFile];
+    [journal writeData:[NSData dataWithBytes:"\x01\x00\x10\x00" length:4]];
+    [journal closeFile];
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.count, 1UL, @"unexpected number of entries");
+    XCTAssertEqualObjects([reopenedIndex entryForKey:@"complete"].revision, kRevision, @"complete record was lost");
+    XCTAssertEqual(reopenedIndex.totalSize, 10ULL, @"unexpected total size");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testJournalCompaction
+{
+    NSURL *location = [self temporaryCacheLocation];
+    [[NSFileManager defaultManager] createDirectoryAtURL:location withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    for (NSUInteger counter = 0; counter < 600; counter++) {
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = [NSString stringWithFormat:@"%lu", (unsigned long)(counter % 10)];
+        entry.revision = [NSString stringWithFormat:@"%lu", (unsigned long)counter];
+        entry.dataSize = 1;
+        [index setEntry:entry];
+    }
+    
+    XCTAssertEqual(index.totalSize, 10ULL, @"overwritten entries were counted twice");
+    
+    NSNumber *journalSize = nil;
+    [[location URLByAppendingPathComponent:@"__Index.journal"] getResourceValue:&journalSize forKey:NSURLFileSizeKey error:NULL];
+    XCTAssertLessThan(journalSize.unsignedIntegerValue, 4096UL, @"journal was not compacted");
+    index = nil;
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.count, 10UL, @"unexpected number of entries");
+    XCTAssertEqualObjects([reopenedIndex entryForKey:@"9"].revision, @"599", @"unexpected revision");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testMigratingLegacyMetadata
+{
+    NSURL *location = [self temporaryCacheLocation];
+    [[NSFileManager defaultManager] createDirectoryAtURL:location withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    NSURL *legacyMetadataLocation = [location URLByAppendingPathComponent:@"__Metadata.plist"];
+    NSDictionary *legacyMetadata = @{@"__maxCacheSize": @2048,
+                                     @"__cacheSize": @5,
+                                     @"legacy": @{@"revision": kRevision, @"lastAccessDate": [NSDate date], @"dataSize": @5}};
+    [legacyMetadata writeToURL:legacyMetadataLocation atomically:YES];
+    
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(index.count, 1UL, @"unexpected number of entries");
+    XCTAssertEqualObjects([index entryForKey:@"legacy"].revision, kRevision, @"unexpected revision");
+    XCTAssertEqual(index.maxCacheSize, 2048ULL, @"unexpected max cache size");
+    XCTAssertFalse([legacyMetadataLocation checkResourceIsReachableAndReturnError:NULL], @"legacy metadata was not removed");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testMigratingLegacyCacheKeys
+{
+    NSURL *location = [self temporaryCacheLocation];
+    [[NSFileManager defaultManager] createDirectoryAtURL:location withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *legacyIdentifier = RKStringGetMD5Hash(kCacheIdentifier);
+    [testData writeToURL:[location URLByAppendingPathComponent:legacyIdentifier] atomically:YES];
+    
+    NSDictionary *legacyMetadata = @{legacyIdentifier: @{@"revision": kRevision, @"lastAccessDate": [NSDate date], @"dataSize": @(testData.length)}};
+    [legacyMetadata writeToURL:[location URLByAppendingPathComponent:@"__Metadata.plist"] atomically:YES];
+    
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"unexpected revision");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], testData, @"unexpected data");
+    XCTAssertFalse([[location URLByAppendingPathComponent:legacyIdentifier] checkResourceIsReachableAndReturnError:NULL], @"legacy file was not moved");
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertFalse(reopenedIndex.hasLegacyEntries, @"legacy entry was not migrated");
+    XCTAssertNotNil([reopenedIndex entryForKey:RKStringGetFastHash(kCacheIdentifier)], @"migrated entry was not persisted");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testMappedSnapshot
+{
+    NSURL *location = [self temporaryCacheLocation];
+    [[NSFileManager defaultManager] createDirectoryAtURL:location withIntermediateDirectories:YES attributes:nil error:NULL];
+    
+    NSURL *snapshotLocation = [location URLByAppendingPathComponent:@"__Index.snapshot"];
+    NSDictionary *propertyListSnapshot = @{@"version": @2,
+                                           @"maxCacheSize": @4096,
+                                           @"entries": @{@"snapshotted": @[ kRevision, @(0.0), @5 ],
+                                                         @"legacy": @[ kRevision, @(0.0), @7 ]},
+                                           @"legacyKeys": @[ @"legacy" ]};
+    [[NSPropertyListSerialization dataWithPropertyList:propertyListSnapshot format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL] writeToURL:snapshotLocation atomically:YES];
+    
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(index.count, 2UL, @"property list snapshot was not migrated");
+    NSData *snapshotData = [NSData dataWithContentsOfURL:snapshotLocation];
+    XCTAssertNil([NSPropertyListSerialization propertyListWithData:snapshotData options:NSPropertyListImmutable format:NULL error:NULL], @"property list snapshot was not rewritten");
+    
+    RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+    entry.key = @"journaled";
+    entry.revision = @"2";
+    entry.dataSize = 11;
+    [index setEntry:entry];
+    [index removeEntryForKey:@"snapshotted"];
+    index = nil;
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqualObjects([reopenedIndex entryForKey:@"journaled"].revision, @"2", @"journaled entry was not found");
+    XCTAssertNil([reopenedIndex entryForKey:@"snapshotted"], @"removed entry was found");
+    XCTAssertEqual([reopenedIndex entryForKey:@"legacy"].dataSize, 7ULL, @"snapshotted entry was not found");
+    XCTAssertNil([reopenedIndex entryForKey:kNonExistentCacheIdentiifer], @"unexpected entry");
+    XCTAssertTrue([reopenedIndex isLegacyEntryForKey:@"legacy"], @"legacy status was lost");
+    XCTAssertTrue(reopenedIndex.hasLegacyEntries, @"legacy status was lost");
+    XCTAssertEqual(reopenedIndex.maxCacheSize, 4096ULL, @"unexpected max cache size");
+    
+    [reopenedIndex loadEntriesIfNeeded];
+    XCTAssertEqual(reopenedIndex.count, 2UL, @"unexpected number of entries");
+    XCTAssertEqual(reopenedIndex.totalSize, 18ULL, @"unexpected total size");
+    XCTAssertTrue([reopenedIndex isLegacyEntryForKey:@"legacy"], @"legacy status was lost when loading");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testMissesSkipIndex
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    for (NSUInteger count = 0; count < 2048; count++) {
+        RKFileSystemCacheEntry *entry = [RKFileSystemCacheEntry new];
+        entry.key = [NSString stringWithFormat:@"%ld", (long)count];
+        entry.revision = kRevision;
+        [index setEntry:entry];
+    }
+    XCTAssertTrue([index compact:NULL], @"could not compact index");
+    index = nil;
+    
+    //Every key must still be found through the filter built from the mapped snapshot.
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    for (NSUInteger count = 0; count < 2048; count++)
+        XCTAssertNotNil([reopenedIndex entryForKey:[NSString stringWithFormat:@"%ld", (long)count]], @"stored entry was filtered out");
+    XCTAssertNil([reopenedIndex entryForKey:kNonExistentCacheIdentiifer], @"unexpected entry");
+    reopenedIndex = nil;
+    
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:@"0"], kRevision, @"stored entry was not found");
+    NSURL *journalLocation = [location URLByAppendingPathComponent:@"__Index.journal"];
+    NSNumber *journalLength = nil;
+    [journalLocation getResourceValue:&journalLength forKey:NSURLFileSizeKey error:NULL];
+    
+    XCTAssertNil([cacheManager cachedDataForIdentifier:kNonExistentCacheIdentiifer error:NULL], @"unexpected data");
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:kNonExistentCacheIdentiifer error:NULL], @"could not remove nonexistent cache");
+    
+    NSNumber *newJournalLength = nil;
+    [journalLocation removeCachedResourceValueForKey:NSURLFileSizeKey];
+    [journalLocation getResourceValue:&newJournalLength forKey:NSURLFileSizeKey error:NULL];
+    XCTAssertEqualObjects(newJournalLength, journalLength, @"removing nonexistent cache changed the index");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Deduplication
+
+- (void)testIdenticalContentIsStoredOnce
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [self dataOfLength:(1024 * 64) filledWithByte:'d'];
+    
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:@"first" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:@"second" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertEqual(cacheManager.cacheSize, testData.length, @"identical content was counted twice");
+    
+    NSArray *(^contentFiles)(void) = ^{
+        NSArray *contents = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:location includingPropertiesForKeys:nil options:0 error:NULL];
+        return [contents filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"pathExtension == 'content'"]];
+    };
+    XCTAssertEqual(contentFiles().count, 1UL, @"identical content was written twice");
+    
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:@"first" error:NULL], @"could not remove cache");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:@"second" error:NULL], testData, @"shared content was removed while still referenced");
+    
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:@"second" error:NULL], @"could not remove cache");
+    XCTAssertEqual(contentFiles().count, 0UL, @"unreferenced content was not removed");
+    XCTAssertEqual(cacheManager.cacheSize, 0UL, @"unexpected cache size");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testIdenticalPackedContentIsCountedOnce
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    for (NSUInteger index = 0; index < 10; index++)
+        [cacheManager cacheData:testData forIdentifier:[NSString stringWithFormat:@"%ld", (long)index] withRevision:kRevision error:NULL];
+    
+    XCTAssertEqual(cacheManager.cacheSize, testData.length, @"identical content was counted more than once");
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.totalSize, (unsigned long long)testData.length, @"shared content was not persisted");
+    XCTAssertEqual([reopenedIndex referenceCountForContentHash:RKDataGetFastHash(testData)], 10UL, @"unexpected reference count");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Mapped Data
+
+- (void)testCachedDataOutlivesReplacementAndRemoval
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache");
+    NSData *cachedData = [cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL];
+    
+    XCTAssertTrue([cacheManager cacheData:[@"replacement" dataUsingEncoding:NSUTF8StringEncoding] forIdentifier:kCacheIdentifier withRevision:@"2" error:NULL], @"could not replace cache");
+    XCTAssertEqualObjects(cachedData, testData, @"replacement changed previously returned data");
+    
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:kCacheIdentifier error:NULL], @"could not remove cache");
+    XCTAssertEqualObjects(cachedData, testData, @"removal changed previously returned data");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Segments
+
+- (NSData *)dataOfLength:(NSUInteger)length filledWithByte:(uint8_t)byte
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    memset(data.mutableBytes, byte, length);
+    return data;
+}
+
+- (void)testSmallItemsArePacked
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *smallData = [self dataOfLength:1024 filledWithByte:'s'];
+    NSData *largeData = [self dataOfLength:1024 * 128 filledWithByte:'l'];
+    
+    XCTAssertTrue([cacheManager cacheData:smallData forIdentifier:@"small" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:largeData forIdentifier:@"large" withRevision:kRevision error:NULL], @"could not store cache");
+    
+    NSURL *smallLocation = [[location URLByAppendingPathComponent:RKDataGetFastHash(smallData)] URLByAppendingPathExtension:@"content"];
+    NSURL *largeLocation = [[location URLByAppendingPathComponent:RKDataGetFastHash(largeData)] URLByAppendingPathExtension:@"content"];
+    XCTAssertFalse([smallLocation checkResourceIsReachableAndReturnError:NULL], @"small item was not packed");
+    XCTAssertTrue([largeLocation checkResourceIsReachableAndReturnError:NULL], @"large item was packed");
+    cacheManager = nil;
+    
+    RKFileSystemCacheManager *reopenedCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertEqualObjects([reopenedCacheManager cachedDataForIdentifier:@"small" error:NULL], smallData, @"unexpected packed data");
+    XCTAssertEqualObjects([reopenedCacheManager cachedDataForIdentifier:@"large" error:NULL], largeData, @"unexpected data");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testSegmentCompaction
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    cacheManager.maxCacheSize = 1024 * 1024 * 64;
+    
+    //Enough items to fill the first four megabyte segment and spill into a second.
+    NSUInteger const numberOfItems = 150;
+    NSUInteger const itemLength = 1024 * 30;
+    for (NSUInteger index = 0; index < numberOfItems; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+        XCTAssertTrue([cacheManager cacheData:[self dataOfLength:itemLength filledWithByte:(uint8_t)index] forIdentifier:identifier withRevision:kRevision error:NULL], @"could not store cache");
+    }
+    
+    //Replacements are a byte shorter so that they never share content with an original item.
+    for (NSUInteger index = 0; index < 140; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+        XCTAssertTrue([cacheManager cacheData:[self dataOfLength:itemLength - 1 filledWithByte:(uint8_t)index] forIdentifier:identifier withRevision:@"2" error:NULL], @"could not replace cache");
+    }
+    
+    NSURL *firstSegmentLocation = [location URLByAppendingPathComponent:@"__Segment-00000001.pack"];
+    XCTAssertTrue([firstSegmentLocation checkResourceIsReachableAndReturnError:NULL], @"missing first segment");
+    
+    [cacheManager preformMaintenance];
+    
+    XCTAssertFalse([firstSegmentLocation checkResourceIsReachableAndReturnError:NULL], @"first segment was not compacted");
+    for (NSUInteger index = 0; index < numberOfItems; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+        NSUInteger expectedLength = (index < 140? itemLength - 1 : itemLength);
+        XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:identifier error:NULL], [self dataOfLength:expectedLength filledWithByte:(uint8_t)index], @"unexpected data after compaction");
+    }
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Eviction
+
+- (void)testWritesStayWithinMaxCacheSize
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    cacheManager.maxCacheSize = 1024 * 10;
+    
+    for (NSUInteger index = 0; index < 5; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+        XCTAssertTrue([cacheManager cacheData:[self dataOfLength:1024 * 4 filledWithByte:(uint8_t)index] forIdentifier:identifier withRevision:kRevision error:NULL], @"could not store cache");
+        XCTAssertLessThanOrEqual(cacheManager.cacheSize, cacheManager.maxCacheSize, @"cache grew past its maximum size");
+    }
+    
+    XCTAssertNil([cacheManager revisionForIdentifier:@"0"], @"least recently used item was not evicted");
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:@"4"], kRevision, @"most recently stored item was evicted");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testAdmissionProtectsFrequentlyUsedItems
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    cacheManager.maxCacheSize = 1024 * 10;
+    
+    XCTAssertTrue([cacheManager cacheData:[self dataOfLength:1024 * 4 filledWithByte:'a'] forIdentifier:@"a" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:[self dataOfLength:1024 * 4 filledWithByte:'b'] forIdentifier:@"b" withRevision:kRevision error:NULL], @"could not store cache");
+    for (NSUInteger counter = 0; counter < 5; counter++) {
+        XCTAssertNotNil([cacheManager cachedDataForIdentifier:@"a" error:NULL], @"could not retrieve data");
+        XCTAssertNotNil([cacheManager cachedDataForIdentifier:@"b" error:NULL], @"could not retrieve data");
+    }
+    
+    XCTAssertTrue([cacheManager cacheData:[self dataOfLength:1024 * 8 filledWithByte:'c'] forIdentifier:@"c" withRevision:kRevision error:NULL], @"declining to store an item is not an error");
+    
+    XCTAssertNil([cacheManager revisionForIdentifier:@"c"], @"one-off item displaced frequently used items");
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:@"a"], kRevision, @"frequently used item was evicted");
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:@"b"], kRevision, @"frequently used item was evicted");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Expiration
+
+- (void)testExpiredItemsAreRemoved
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    NSDate *freshExpirationDate = [NSDate dateWithTimeIntervalSinceNow:RK_TIME_HOUR];
+    
+    for (NSUInteger index = 0; index < 100; index++) {
+        NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:-(NSTimeInterval)(index + 1)];
+        [cacheManager cacheData:testData forIdentifier:[NSString stringWithFormat:@"expired%ld", (long)index] withRevision:kRevision expirationDate:expirationDate error:NULL];
+    }
+    [cacheManager cacheData:testData forIdentifier:@"fresh" withRevision:kRevision expirationDate:freshExpirationDate error:NULL];
+    [cacheManager cacheData:testData forIdentifier:@"unbounded" withRevision:kRevision error:NULL];
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqualWithAccuracy([reopenedIndex entryForKey:RKStringGetFastHash(@"fresh")].expirationTime, [freshExpirationDate timeIntervalSinceReferenceDate], 0.001, @"expiration time was not persisted");
+    XCTAssertEqual([reopenedIndex entriesExpiringBefore:[NSDate timeIntervalSinceReferenceDate]].count, 100UL, @"unexpected expired entries");
+    
+    [cacheManager preformMaintenance];
+    XCTAssertNil([cacheManager revisionForIdentifier:@"expired0"], @"expired item was not removed");
+    XCTAssertNotNil([cacheManager revisionForIdentifier:@"fresh"], @"unexpired item was removed");
+    XCTAssertNotNil([cacheManager revisionForIdentifier:@"unbounded"], @"recently used item was removed");
+    XCTAssertEqual(cacheManager.cacheSize, testData.length, @"unexpected cache size");
+    
+    cacheManager.defaultExpirationInterval = 0.0;
+    [cacheManager preformMaintenance];
+    XCTAssertNil([cacheManager revisionForIdentifier:@"unbounded"], @"item without an expiration date outlived the default expiration interval");
+    XCTAssertNotNil([cacheManager revisionForIdentifier:@"fresh"], @"unexpired item was removed");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+- (void)testMaintenanceYieldsToClients
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:-RK_TIME_MINUTE];
+    
+    for (NSUInteger index = 0; index < 200; index++)
+        [cacheManager cacheData:testData forIdentifier:[NSString stringWithFormat:@"expired%ld", (long)index] withRevision:kRevision expirationDate:expirationDate error:NULL];
+    [cacheManager cacheData:testData forIdentifier:@"fresh" withRevision:kRevision error:NULL];
+    
+    //The cache was written to since maintenance last looked, so it must pause before its first slice.
+    NSDate *startDate = [NSDate date];
+    [cacheManager preformMaintenance];
+    XCTAssertGreaterThanOrEqual(-[startDate timeIntervalSinceNow], 0.05, @"maintenance did not yield to a busy cache");
+    
+    for (NSUInteger index = 0; index < 200; index++)
+        XCTAssertNil([cacheManager revisionForIdentifier:[NSString stringWithFormat:@"expired%ld", (long)index]], @"expired item was not removed");
+    XCTAssertNotNil([cacheManager revisionForIdentifier:@"fresh"], @"unexpired item was removed");
+    XCTAssertEqual([cacheManager.statistics evictionCountForReason:kRKFileSystemCacheEvictionReasonExpiration], 200LL, @"unexpected eviction count");
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.count, 1UL, @"removals were not persisted");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Batch Operations
+
+- (void)testBatchOperations
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    
+    NSMutableDictionary *dataByIdentifier = [NSMutableDictionary dictionary];
+    NSMutableDictionary *revisionsByIdentifier = [NSMutableDictionary dictionary];
+    for (NSUInteger index = 0; index < 32; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%ld", (long)index];
+        dataByIdentifier[identifier] = [self dataOfLength:(index % 2 == 0)? 64 : (1024 * 64) filledWithByte:(uint8_t)(index / 4)];
+        revisionsByIdentifier[identifier] = identifier;
+    }
+    
+    NSError *error = nil;
+    XCTAssertTrue([cacheManager cacheDataForIdentifiers:dataByIdentifier withRevisions:revisionsByIdentifier error:&error], @"could not store cache. %@", error);
+    
+    NSArray *identifiers = [[dataByIdentifier allKeys] arrayByAddingObject:kNonExistentCacheIdentiifer];
+    NSDictionary *cachedData = [cacheManager cachedDataForIdentifiers:identifiers error:&error];
+    XCTAssertEqualObjects(cachedData, dataByIdentifier, @"unexpected data");
+    XCTAssertNil(error, @"unexpected error");
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.count, dataByIdentifier.count, @"batch was not persisted");
+    XCTAssertEqualObjects([reopenedIndex entryForKey:RKStringGetFastHash(@"7")].revision, @"7", @"unexpected revision");
+    
+    NSArray *removedIdentifiers = @[ @"0", @"1", @"2", @"3", kNonExistentCacheIdentiifer ];
+    XCTAssertTrue([cacheManager removeCacheForIdentifiers:removedIdentifiers error:&error], @"could not remove cache. %@", error);
+    XCTAssertEqual([cacheManager cachedDataForIdentifiers:removedIdentifiers error:NULL].count, 0UL, @"removed data was returned");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:@"4" error:NULL], dataByIdentifier[@"4"], @"unrelated data was removed");
+    
+    reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertEqual(reopenedIndex.count, dataByIdentifier.count - 4, @"batch removal was not persisted");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Compression
+
+- (void)testCompression
+{
+    NSURL *location = [self temporaryCacheLocation];
+    NSMutableData *jsonData = [NSMutableData data];
+    while (jsonData.length < 1024 * 64)
+        [jsonData appendData:[@"{\"id\": 42, \"name\": \"lovely data\", \"tags\": [\"one\", \"two\"]}," dataUsingEncoding:NSUTF8StringEncoding]];
+    NSMutableData *imageData = [NSMutableData dataWithBytes:"\x89PNG\r\n\x1A\n" length:8];
+    [imageData appendData:[self dataOfLength:(1024 * 64) filledWithByte:7]];
+    NSData *smallData = [self dataOfLength:64 filledWithByte:3];
+    
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    cacheManager.compressesData = YES;
+    XCTAssertTrue([cacheManager cacheData:jsonData forIdentifier:@"json" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertLessThan(cacheManager.cacheSize, jsonData.length / 4, @"compressible data was not compressed");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:@"json" error:NULL], jsonData, @"unexpected data");
+    
+    NSUInteger cacheSize = cacheManager.cacheSize;
+    XCTAssertTrue([cacheManager cacheData:imageData forIdentifier:@"image" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:smallData forIdentifier:@"small" withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertEqual(cacheManager.cacheSize, cacheSize + imageData.length + smallData.length, @"compressed or tiny data was compressed");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:@"image" error:NULL], imageData, @"unexpected data");
+    cacheManager = nil;
+    
+    RKFileSystemCacheIndex *index = [[RKFileSystemCacheIndex alloc] initWithDirectory:location];
+    XCTAssertTrue([index entryForKey:RKStringGetFastHash(@"json")].compressed, @"compression was not journaled");
+    XCTAssertFalse([index entryForKey:RKStringGetFastHash(@"image")].compressed, @"unexpected compression");
+    XCTAssertTrue([index compact:NULL], @"could not compact index");
+    index = nil;
+    
+    RKFileSystemCacheManager *reopenedCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    XCTAssertEqualObjects([reopenedCacheManager cachedDataForIdentifier:@"json" error:NULL], jsonData, @"compression was not persisted in the snapshot");
+    XCTAssertEqualObjects([reopenedCacheManager cachedDataForIdentifier:@"small" error:NULL], smallData, @"unexpected data");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Archives
+
+- (void)testArchives
+{
+    NSURL *location = [self temporaryCacheLocation];
+    NSURL *seededLocation = [self temporaryCacheLocation];
+    NSURL *archiveLocation = [[self temporaryCacheLocation] URLByAppendingPathExtension:@"archive"];
+    NSData *smallData = [self dataOfLength:64 filledWithByte:1];
+    NSData *largeData = [self dataOfLength:(1024 * 64) filledWithByte:2];
+    NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:RK_TIME_HOUR];
+    
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    [cacheManager cacheData:smallData forIdentifier:@"small" withRevision:@"1" error:NULL];
+    [cacheManager cacheData:largeData forIdentifier:@"large" withRevision:@"2" expirationDate:expirationDate error:NULL];
+    [cacheManager cacheData:smallData forIdentifier:@"existing" withRevision:@"3" error:NULL];
+    [cacheManager cacheData:smallData forIdentifier:@"expired" withRevision:@"4" expirationDate:[NSDate dateWithTimeIntervalSinceNow:-RK_TIME_HOUR] error:NULL];
+    [cacheManager cacheData:smallData forIdentifier:@"unexported" withRevision:@"5" error:NULL];
+    
+    NSError *error = nil;
+    NSArray *identifiers = @[ @"small", @"large", @"existing", @"expired", kNonExistentCacheIdentiifer ];
+    XCTAssertTrue([cacheManager exportCacheForIdentifiers:identifiers toArchiveAtURL:archiveLocation error:&error], @"could not export cache. %@", error);
+    
+    RKFileSystemCacheManager *seededCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:seededLocation];
+    [seededCacheManager cacheData:largeData forIdentifier:@"existing" withRevision:@"newer" error:NULL];
+    XCTAssertTrue([seededCacheManager importCacheFromArchiveAtURL:archiveLocation error:&error], @"could not import cache. %@", error);
+    
+    XCTAssertEqualObjects([seededCacheManager cachedDataForIdentifier:@"small" error:NULL], smallData, @"unexpected data");
+    XCTAssertEqualObjects([seededCacheManager revisionForIdentifier:@"small"], @"1", @"unexpected revision");
+    XCTAssertEqualObjects([seededCacheManager cachedDataForIdentifier:@"large" error:NULL], largeData, @"unexpected data");
+    XCTAssertEqualObjects([seededCacheManager revisionForIdentifier:@"existing"], @"newer", @"import replaced existing item");
+    XCTAssertNil([seededCacheManager revisionForIdentifier:@"expired"], @"expired item was imported");
+    XCTAssertNil([seededCacheManager revisionForIdentifier:@"unexported"], @"unexported item was imported");
+    
+    RKFileSystemCacheIndex *reopenedIndex = [[RKFileSystemCacheIndex alloc] initWithDirectory:seededLocation];
+    XCTAssertEqual(reopenedIndex.count, 3UL, @"import was not persisted");
+    XCTAssertEqualWithAccuracy([reopenedIndex entryForKey:RKStringGetFastHash(@"large")].expirationTime, [expirationDate timeIntervalSinceReferenceDate], 0.001, @"expiration time was not imported");
+    
+    [[NSData dataWithBytes:"RKCA" length:4] writeToURL:archiveLocation atomically:YES];
+    error = nil;
+    XCTAssertFalse([seededCacheManager importCacheFromArchiveAtURL:archiveLocation error:&error], @"malformed archive was imported");
+    XCTAssertEqual(error.code, (NSInteger)NSFileReadCorruptFileError, @"unexpected error");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+    [[NSFileManager defaultManager] removeItemAtURL:seededLocation error:NULL];
+    [[NSFileManager defaultManager] removeItemAtURL:archiveLocation error:NULL];
+}
+
+#pragma mark - Asynchronous Access
+
+- (void)testAsynchronousAccess
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    
+    __block BOOL stored = NO;
+    [cacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision expirationDate:nil completionHandler:^(BOOL success, NSError *error) {
+        stored = success;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    XCTAssertTrue(stored, @"could not store cache");
+    
+    __block NSData *loadedData = nil;
+    [cacheManager loadCachedDataForIdentifier:kCacheIdentifier completionHandler:^(NSData *data, NSError *error) {
+        loadedData = data;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    XCTAssertEqualObjects(loadedData, testData, @"unexpected data");
+    
+    __block BOOL removed = NO;
+    [cacheManager removeCacheForIdentifier:kCacheIdentifier completionHandler:^(BOOL success, NSError *error) {
+        removed = success;
+        dispatch_semaphore_signal(semaphore);
+    }];
+    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    XCTAssertTrue(removed, @"could not remove cache");
+    XCTAssertNil([cacheManager revisionForIdentifier:kCacheIdentifier], @"cache was not removed");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Concurrency
+
+- (void)testConcurrentAccess
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    
+    dispatch_apply(64, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        NSString *identifier = [NSString stringWithFormat:@"%zu", iteration % 8];
+        NSString *revision = [NSString stringWithFormat:@"%zu", iteration];
+        NSData *data = [revision dataUsingEncoding:NSUTF8StringEncoding];
+        XCTAssertTrue([cacheManager cacheData:data forIdentifier:identifier withRevision:revision error:NULL], @"could not store cache");
+        
+        NSError *error = nil;
+        XCTAssertNotNil([cacheManager cachedDataForIdentifier:identifier error:&error], @"could not retrieve data");
+        XCTAssertNil(error, @"unexpected error");
+    });
+    
+    for (NSUInteger index = 0; index < 8; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%lu", (unsigned long)index];
+        NSString *revision = [cacheManager revisionForIdentifier:identifier];
+        NSData *data = [cacheManager cachedDataForIdentifier:identifier error:NULL];
+        XCTAssertEqualObjects([[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding], revision, @"revision does not describe the stored data");
+    }
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Sharing
+
+- (void)testSharedCache
+{
+    NSURL *location = [self temporaryCacheLocation];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    //Each cache manager opens the directory's lock on its own, just as separate processes would.
+    RKFileSystemCacheManager *firstCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location shared:YES];
+    RKFileSystemCacheManager *secondCacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location shared:YES];
+    
+    XCTAssertTrue([firstCacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertEqualObjects([secondCacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"change was not shared");
+    XCTAssertEqualObjects([secondCacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], testData, @"data was not shared");
+    
+    XCTAssertTrue([secondCacheManager cacheData:testData forIdentifier:kNonExistentCacheIdentiifer withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([secondCacheManager removeCacheForIdentifier:kCacheIdentifier error:NULL], @"could not remove cache");
+    XCTAssertNil([firstCacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"removal was not shared");
+    XCTAssertEqualObjects([firstCacheManager cachedDataForIdentifier:kNonExistentCacheIdentiifer error:NULL], testData, @"identical content was not kept");
+    
+    XCTAssertTrue([firstCacheManager removeAllCache:NULL], @"could not remove all cache");
+    XCTAssertNil([secondCacheManager revisionForIdentifier:kNonExistentCacheIdentiifer], @"removing all cache was not shared");
+    XCTAssertTrue([secondCacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache after removing all cache");
+    XCTAssertEqualObjects([firstCacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], testData, @"data was not shared after removing all cache");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Statistics
+
+- (void)testStatistics
+{
+    NSURL *location = [self temporaryCacheLocation];
+    RKFileSystemCacheManager *cacheManager = [[RKFileSystemCacheManager alloc] initWithLocation:location];
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertTrue([cacheManager cacheData:testData forIdentifier:@"expired" withRevision:kRevision expirationDate:[NSDate dateWithTimeIntervalSinceNow:-1.0] error:NULL], @"could not store cache");
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"missing data");
+    XCTAssertNil([cacheManager cachedDataForIdentifier:kNonExistentCacheIdentiifer error:NULL], @"unexpected data");
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"unexpected revision");
+    [cacheManager noteRevalidationForIdentifier:kCacheIdentifier];
+    
+    [cacheManager preformMaintenance];
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:kCacheIdentifier error:NULL], @"could not remove cache");
+    XCTAssertTrue([cacheManager removeCacheForIdentifier:kNonExistentCacheIdentiifer error:NULL], @"could not remove nonexistent cache");
+    
+    RKFileSystemCacheStatistics *statistics = cacheManager.statistics;
+    XCTAssertEqual(statistics.hitCount, 1LL, @"unexpected hit count");
+    XCTAssertEqual(statistics.missCount, 1LL, @"unexpected miss count");
+    XCTAssertEqualWithAccuracy(statistics.hitRatio, 0.5, 0.001, @"unexpected hit ratio");
+    XCTAssertEqual(statistics.revalidationCount, 1LL, @"unexpected revalidation count");
+    XCTAssertEqual(statistics.bytesRead, (int64_t)testData.length, @"unexpected bytes read");
+    XCTAssertEqual(statistics.writeCount, 2LL, @"unexpected write count");
+    XCTAssertEqual(statistics.bytesWritten, (int64_t)testData.length, @"identical content was counted twice");
+    XCTAssertEqual([statistics evictionCountForReason:kRKFileSystemCacheEvictionReasonExpiration], 1LL, @"unexpected expiration count");
+    XCTAssertEqual([statistics evictionCountForReason:kRKFileSystemCacheEvictionReasonManual], 1LL, @"unexpected manual removal count");
+    XCTAssertEqual([statistics evictionCountForReason:kRKFileSystemCacheEvictionReasonSize], 0LL, @"unexpected size eviction count");
+    
+    NSArray *getHistogram = [statistics latencyHistogramForOperation:kRKFileSystemCacheOperationGet];
+    XCTAssertEqual(getHistogram.count, RKFileSystemCacheLatencyHistogramBucketCount, @"unexpected bucket count");
+    XCTAssertEqual([[getHistogram valueForKeyPath:@"@sum.self"] longLongValue], 2LL, @"unexpected number of recorded reads");
+    XCTAssertTrue([statistics latencyAtPercentile:0.99 forOperation:kRKFileSystemCacheOperationPut] > 0.0, @"missing write latency");
+    
+    [cacheManager resetStatistics];
+    statistics = cacheManager.statistics;
+    XCTAssertEqual(statistics.hitCount + statistics.missCount + statistics.writeCount, 0LL, @"statistics were not reset");
+    XCTAssertEqual([statistics latencyAtPercentile:0.5 forOperation:kRKFileSystemCacheOperationGet], 0.0, @"latencies were not reset");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:location error:NULL];
+}
+
+#pragma mark - Buckets
+
+- (void)testBuckets
+{
+    NSString *bucketName = [NSString stringWithFormat:@"RKFileSystemCacheManagerTests-%@", [[NSProcessInfo processInfo] globallyUniqueString]];
+    RKFileSystemCacheManager *bucket = [RKFileSystemCacheManager cacheManagerForBucket:bucketName];
+    XCTAssertEqual([RKFileSystemCacheManager cacheManagerForBucket:bucketName], bucket, @"bucket was created twice");
+    XCTAssertEqualObjects(bucket.bucketName, bucketName, @"unexpected bucket name");
+    XCTAssertNotEqualObjects(bucket.location, [RKFileSystemCacheManager sharedCacheManager].location, @"bucket shares the shared cache manager's directory");
+    XCTAssertTrue(bucket.maintenanceInterval > 0.0, @"bucket is not maintained");
+    
+    XCTAssertThrows([RKFileSystemCacheManager cacheManagerForBucket:@".."], @"bucket outside of the buckets directory was allowed");
+    XCTAssertThrows([RKFileSystemCacheManager cacheManagerForBucket:@"."], @"bucket in the buckets directory itself was allowed");
+    XCTAssertThrows([RKFileSystemCacheManager cacheManagerForBucket:@"Some/Bucket"], @"bucket in a nested directory was allowed");
+    
+    NSData *testData = [kTestDataString dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertTrue([bucket cacheData:testData forIdentifier:bucketName withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertNil([[RKFileSystemCacheManager sharedCacheManager] revisionForIdentifier:bucketName], @"bucket item was stored in the shared cache manager");
+    
+    //Halving the total budget halves the budget of every bucket.
+    bucket.maxCacheSize = 1024 * 64;
+    bucket.evictionPolicy = kRKFileSystemCacheEvictionPolicyLeastRecentlyUsed;
+    NSUInteger totalMaxCacheSize = [RKFileSystemCacheManager sharedCacheManager].maxCacheSize;
+    for (RKFileSystemCacheManager *cacheManager in [[RKFileSystemCacheManager buckets] allValues])
+        totalMaxCacheSize += cacheManager.maxCacheSize;
+    [RKFileSystemCacheManager setMaxTotalCacheSize:totalMaxCacheSize / 2];
+    
+    for (NSUInteger index = 0; index < 8; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"%ld", (long)index];
+        XCTAssertTrue([bucket cacheData:[self dataOfLength:1024 * 8 filledWithByte:(uint8_t)index] forIdentifier:identifier withRevision:kRevision error:NULL], @"could not store cache");
+    }
+    XCTAssertTrue(bucket.cacheSize <= 1024 * 32, @"bucket exceeded its share of the total budget");
+    XCTAssertNotNil([bucket revisionForIdentifier:@"7"], @"most recent item was not stored");
+    
+    [RKFileSystemCacheManager setMaxTotalCacheSize:0];
+    XCTAssertTrue([bucket removeAllCache:NULL], @"could not remove bucket cache");
+}
+
 @end
@@ -93,6 +93,21 @@
     XCTAssertEqualObjects(hashedString, @"6f8db599de986fab7a21625b7916589c", @"Unexpected hash result");
 }
 
+- (void)testStringGetFastHash
+{
+    XCTAssertNil(RKStringGetFastHash(nil), @"Unexpected hash result");
+    XCTAssertEqualObjects(RKStringGetFastHash(@"hello"), @"cbd8a7b341bd9b025b1e906a48ae1d19", @"Unexpected hash result");
+    XCTAssertEqualObjects(RKStringGetFastHash(@"test string"), @"9bd57e5fffc46c6309479b946d9df251", @"Unexpected hash result");
+    XCTAssertEqualObjects(RKStringGetFastHash(@"h\u00e9llo w\u00f6rld"), @"6b757453f10a333b4432d052f7788963", @"Unexpected hash result");
+}
+
+- (void)testDataGetFastHash
+{
+    XCTAssertNil(RKDataGetFastHash(nil), @"Unexpected hash result");
+    XCTAssertEqualObjects(RKDataGetFastHash([@"hello" dataUsingEncoding:NSUTF8StringEncoding]), @"cbd8a7b341bd9b025b1e906a48ae1d19", @"Unexpected hash result");
+    XCTAssertEqualObjects(RKDataGetFastHash([@"h\u00e9llo w\u00f6rld" dataUsingEncoding:NSUTF8StringEncoding]), @"6b757453f10a333b4432d052f7788963", @"Unexpected hash result");
+}
+
 - (void)testStringEscapeForInclusionInURL
 {
     NSString *escapedString = RKStringEscapeForInclusionInURL(@"This is a lovely string :/?#[]@!$&'()*+,;=", NSUTF8StringEncoding);
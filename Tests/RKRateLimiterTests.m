@@ -0,0 +1,124 @@
+//
+//  RKRateLimiterTests.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+@interface RKRateLimiterTests : XCTestCase
+
+@property (nonatomic) NSURLRequest *request;
+@property (nonatomic) NSURLRequest *searchRequest;
+
+@end
+
+@implementation RKRateLimiterTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    self.request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://example.com/v1/items"]];
+    self.searchRequest = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://example.com/v1/search/items"]];
+}
+
+- (void)tearDown
+{
+    self.request = nil;
+    self.searchRequest = nil;
+    
+    [super tearDown];
+}
+
+#pragma mark -
+
+- (void)testBurstIsAdmittedImmediately
+{
+    RKRateLimiter *rateLimiter = [[RKRateLimiter alloc] initWithRate:1.0 burst:2];
+    
+    __block NSUInteger numberOfStartedRequests = 0;
+    RKRateLimiterTicket *ticket1 = [rateLimiter enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    RKRateLimiterTicket *ticket2 = [rateLimiter enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    RKRateLimiterTicket *ticket3 = [rateLimiter enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    
+    XCTAssertEqual(numberOfStartedRequests, 2UL, @"burst was not honored");
+    XCTAssertEqual(rateLimiter.queueDepth, 1UL, @"unexpected queue depth");
+    
+    [rateLimiter cancelTicket:ticket1];
+    [rateLimiter cancelTicket:ticket2];
+    [rateLimiter cancelTicket:ticket3];
+}
+
+- (void)testQueuedRequestIsAdmittedWhenTokenIsAvailable
+{
+    RKRateLimiter *rateLimiter = [[RKRateLimiter alloc] initWithRate:20.0 burst:1];
+    
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+    RKRateLimiterTicket *ticket1 = [rateLimiter enqueueRequest:self.request withBlock:^{}];
+    RKRateLimiterTicket *ticket2 = [rateLimiter enqueueRequest:self.request withBlock:^{ dispatch_semaphore_signal(semaphore); }];
+    
+    long result = dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 2 * NSEC_PER_SEC));
+    XCTAssertEqual(result, 0L, @"queued request was never admitted");
+    XCTAssertEqual(rateLimiter.queueDepth, 0UL, @"unexpected queue depth");
+    XCTAssertEqual(rateLimiter.numberOfDelayedRequests, 1UL, @"delay was not recorded");
+    XCTAssertGreaterThan(rateLimiter.averageWaitTime, 0.0, @"wait time was not recorded");
+    
+    [rateLimiter cancelTicket:ticket1];
+    [rateLimiter cancelTicket:ticket2];
+}
+
+- (void)testCanceledTicketIsNeverAdmitted
+{
+    RKRateLimiter *rateLimiter = [[RKRateLimiter alloc] initWithRate:20.0 burst:1];
+    
+    __block BOOL secondStarted = NO;
+    RKRateLimiterTicket *ticket1 = [rateLimiter enqueueRequest:self.request withBlock:^{}];
+    RKRateLimiterTicket *ticket2 = [rateLimiter enqueueRequest:self.request withBlock:^{ secondStarted = YES; }];
+    
+    [rateLimiter cancelTicket:ticket2];
+    XCTAssertEqual(rateLimiter.queueDepth, 0UL, @"canceled ticket is still queued");
+    
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.2]];
+    XCTAssertFalse(secondStarted, @"canceled ticket was admitted");
+    
+    [rateLimiter cancelTicket:ticket1];
+}
+
+- (void)testPathPatternsUseSeparateBuckets
+{
+    RKRateLimiter *rateLimiter = [[RKRateLimiter alloc] initWithRate:1.0 burst:1];
+    [rateLimiter setRate:1.0 burst:1 forPathPattern:@"/v1/search/*"];
+    
+    __block NSUInteger numberOfStartedRequests = 0;
+    RKRateLimiterTicket *ticket1 = [rateLimiter enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    RKRateLimiterTicket *ticket2 = [rateLimiter enqueueRequest:self.searchRequest withBlock:^{ numberOfStartedRequests++; }];
+    RKRateLimiterTicket *ticket3 = [rateLimiter enqueueRequest:self.searchRequest withBlock:^{ numberOfStartedRequests++; }];
+    
+    XCTAssertEqual(numberOfStartedRequests, 2UL, @"path pattern did not use a separate bucket");
+    XCTAssertEqualObjects([rateLimiter bucketStatistics][@"/v1/search/*"][@"queueDepth"], @1, @"unexpected bucket queue depth");
+    
+    [rateLimiter cancelTicket:ticket1];
+    [rateLimiter cancelTicket:ticket2];
+    [rateLimiter cancelTicket:ticket3];
+}
+
+- (void)testRegisteredRateLimiterIsFoundByBaseURL
+{
+    RKRateLimiter *rateLimiter = [[RKRateLimiter alloc] initWithRate:1.0 burst:1];
+    NSURL *baseURL = [NSURL URLWithString:@"http://example.com/v1/"];
+    [RKRateLimiter setRateLimiter:rateLimiter forBaseURL:baseURL];
+    
+    XCTAssertEqual([RKRateLimiter rateLimiterForURL:self.request.URL], rateLimiter, @"registered rate limiter was not found");
+    XCTAssertNil([RKRateLimiter rateLimiterForURL:[NSURL URLWithString:@"http://example.org/v1/items"]], @"unrelated URL matched");
+    
+    RKURLRequestPromise *requestPromise = [[RKURLRequestPromise alloc] initWithRequest:self.request offlineBehavior:kRKURLRequestPromiseOfflineBehaviorFail cacheManager:nil];
+    XCTAssertEqual(requestPromise.rateLimiter, rateLimiter, @"request promise did not pick up registered rate limiter");
+    
+    [RKRateLimiter setRateLimiter:nil forBaseURL:baseURL];
+    XCTAssertNil([RKRateLimiter rateLimiterForURL:self.request.URL], @"rate limiter was not unregistered");
+}
+
+@end
@@ -7,10 +7,189 @@
 //
 
 #import <XCTest/XCTest.h>
+#import <netinet/in.h>
+#import <libkern/OSAtomic.h>
 #import "RKMockURLRequestPromiseCacheManager.h"
+#import "RKTestURLProtocol.h"
 
 static NSString *const kBaseURLString = @"http://example.com";
 
+///A connectivity manager whose connectivity is decided by the test using it,
+///instead of by the state of the machine running the test.
+@interface RKStubConnectivityManager : RKConnectivityManager
+
+@property (nonatomic) BOOL connected;
+
+@end
+
+@implementation RKStubConnectivityManager
+
+- (id)init
+{
+    const struct sockaddr_in loopbackAddress = {
+        .sin_len = sizeof(loopbackAddress),
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if((self = [super initWithAddress:(const struct sockaddr *)&loopbackAddress])) {
+        self.connected = YES;
+    }
+    
+    return self;
+}
+
+- (BOOL)isConnected
+{
+    return self.connected;
+}
+
+@end
+
+#pragma mark -
+
+static NSString *const kStreamedBodyBaseURLString = @"http://streamed-body.test";
+
+///A URL protocol that answers every request to `kStreamedBodyBaseURLString` with an
+///empty response, after reading and remembering the body stream of the request.
+@interface RKStreamedBodyCapturingURLProtocol : NSURLProtocol
+
+///Invoked on the connection's thread when a request is started, before its body is read.
++ (void)setWillReadBodyHandler:(dispatch_block_t)handler;
+
+///The last request started, and the body that was read from it.
++ (NSURLRequest *)capturedRequest;
++ (NSData *)capturedBody;
+
+///Forgets the captured request, body, and handler.
++ (void)reset;
+
+@end
+
+@implementation RKStreamedBodyCapturingURLProtocol
+
+static dispatch_block_t gWillReadBodyHandler = nil;
+static NSURLRequest *gCapturedRequest = nil;
+static NSData *gCapturedBody = nil;
+
++ (void)setWillReadBodyHandler:(dispatch_block_t)handler
+{
+    @synchronized(self) {
+        gWillReadBodyHandler = [handler copy];
+    }
+}
+
++ (NSURLRequest *)capturedRequest
+{
+    @synchronized(self) {
+        return gCapturedRequest;
+    }
+}
+
++ (NSData *)capturedBody
+{
+    @synchronized(self) {
+        return gCapturedBody;
+    }
+}
+
++ (void)reset
+{
+    @synchronized(self) {
+        gWillReadBodyHandler = nil;
+        gCapturedRequest = nil;
+        gCapturedBody = nil;
+    }
+}
+
+#pragma mark - Primitive Methods
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    return [request.URL.host isEqualToString:[NSURL URLWithString:kStreamedBodyBaseURLString].host];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (void)startLoading
+{
+    dispatch_block_t willReadBodyHandler = nil;
+    @synchronized([self class]) {
+        willReadBodyHandler = gWillReadBodyHandler;
+    }
+    if(willReadBodyHandler)
+        willReadBodyHandler();
+    
+    NSMutableData *body = [NSMutableData data];
+    NSInputStream *bodyStream = self.request.HTTPBodyStream;
+    uint8_t buffer[4096];
+    [bodyStream open];
+    NSInteger length = 0;
+    while ((length = [bodyStream read:buffer maxLength:sizeof(buffer)]) > 0)
+        [body appendBytes:buffer length:length];
+    [bodyStream close];
+    
+    @synchronized([self class]) {
+        gCapturedRequest = self.request;
+        gCapturedBody = body;
+    }
+    
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL
+                                                              statusCode:200
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{@"Content-Length": @"0"}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading
+{
+}
+
+@end
+
+#pragma mark -
+
+///An enumerator over an array that counts how many times it has been asked for an object.
+@interface RKCountingEnumerator : NSEnumerator
+
+- (instancetype)initWithArray:(NSArray *)array;
+
+@property (readonly) NSUInteger numberOfObjectsRead;
+
+@end
+
+@implementation RKCountingEnumerator {
+    NSArray *_array;
+    volatile int32_t _numberOfObjectsRead;
+}
+
+- (instancetype)initWithArray:(NSArray *)array
+{
+    if((self = [super init])) {
+        _array = [array copy];
+    }
+    
+    return self;
+}
+
+- (NSUInteger)numberOfObjectsRead
+{
+    return (NSUInteger)OSAtomicAdd32Barrier(0, &_numberOfObjectsRead);
+}
+
+- (id)nextObject
+{
+    NSUInteger index = (NSUInteger)(OSAtomicIncrement32Barrier(&_numberOfObjectsRead) - 1);
+    return (index < _array.count)? _array[index] : nil;
+}
+
+@end
+
+#pragma mark -
+
 @interface RKRequestFactoryTests : XCTestCase
 
 @property (nonatomic) RKSingleValuePostProcessor *postProcessor;
@@ -194,6 +373,219 @@ static NSString *const kBaseURLString = @"http://example.com";
     XCTAssertNil(request.HTTPBodyStream, @"unexpected HTTP body stream");
 }
 
+#pragma mark - Streamed Bodies
+
+- (NSData *)dataFromStream:(NSInputStream *)stream
+{
+    NSMutableData *data = [NSMutableData data];
+    uint8_t buffer[4096];
+    
+    [stream open];
+    NSInteger length = 0;
+    while ((length = [stream read:buffer maxLength:sizeof(buffer)]) > 0)
+        [data appendBytes:buffer length:length];
+    [stream close];
+    
+    return data;
+}
+
+- (void)testPostURLRequestWithFile
+{
+    NSData *contents = [@"testy test test" dataUsingEncoding:NSUTF8StringEncoding];
+    NSURL *fileLocation = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"RKRequestFactoryTests-body"]];
+    XCTAssertTrue([contents writeToURL:fileLocation atomically:YES], @"could not write body file");
+    
+    NSURLRequest *request = [self.requestFactory POSTRequestWithPath:@"/test"
+                                                          parameters:nil
+                                                                body:fileLocation
+                                                            bodyType:kRKRequestFactoryBodyTypeFile];
+    
+    XCTAssertNil(request.HTTPBody, @"unexpected HTTP body");
+    XCTAssertNotNil(request.HTTPBodyStream, @"missing HTTP body stream");
+    XCTAssertEqualObjects([request valueForHTTPHeaderField:@"Content-Length"], @"15", @"unexpected content length");
+    XCTAssertEqualObjects([self dataFromStream:request.HTTPBodyStream], contents, @"unexpected HTTP body stream contents");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:fileLocation error:NULL];
+}
+
+- (void)testPostURLRequestWithChunkGenerator
+{
+    NSArray *chunks = @[ [@"testy " dataUsingEncoding:NSUTF8StringEncoding],
+                         [@"test " dataUsingEncoding:NSUTF8StringEncoding],
+                         [@"test" dataUsingEncoding:NSUTF8StringEncoding] ];
+    NSEnumerator *chunkEnumerator = [chunks objectEnumerator];
+    RKRequestFactoryBodyChunkGenerator generator = ^NSData *{
+        return [chunkEnumerator nextObject];
+    };
+    
+    NSURLRequest *request = [self.requestFactory POSTRequestWithPath:@"/test"
+                                                          parameters:nil
+                                                                body:generator
+                                                            bodyType:kRKRequestFactoryBodyTypeChunkGenerator];
+    
+    XCTAssertNil(request.HTTPBody, @"unexpected HTTP body");
+    XCTAssertEqualObjects([self dataFromStream:request.HTTPBodyStream], [@"testy test test" dataUsingEncoding:NSUTF8StringEncoding], @"unexpected HTTP body stream contents");
+}
+
+- (void)testChunkGeneratorIsOnlyInvokedWhenRead
+{
+    __block NSUInteger numberOfInvocations = 0;
+    RKRequestFactoryBodyChunkGenerator generator = ^NSData *{
+        numberOfInvocations++;
+        return (numberOfInvocations == 1)? [@"testy test test" dataUsingEncoding:NSUTF8StringEncoding] : nil;
+    };
+    
+    NSURLRequest *request = [self.requestFactory POSTRequestWithPath:@"/test"
+                                                          parameters:nil
+                                                                body:generator
+                                                            bodyType:kRKRequestFactoryBodyTypeChunkGenerator];
+    XCTAssertEqual(numberOfInvocations, 0UL, @"generator invoked before the body was read");
+    
+    XCTAssertEqualObjects([self dataFromStream:request.HTTPBodyStream], [@"testy test test" dataUsingEncoding:NSUTF8StringEncoding], @"unexpected HTTP body stream contents");
+    XCTAssertEqual(numberOfInvocations, 2UL, @"unexpected number of generator invocations");
+}
+
+///Sends a request promise through `RKStreamedBodyCapturingURLProtocol`, and returns whether it succeeded.
+- (BOOL)sendStreamedBodyRequestPromise:(RKURLRequestPromise *)requestPromise
+{
+    [NSURLProtocol registerClass:[RKStreamedBodyCapturingURLProtocol class]];
+    requestPromise.connectivityManager = [RKStubConnectivityManager new];
+    
+    NSError *error = nil;
+    id result = [requestPromise waitForRealization:&error];
+    
+    [NSURLProtocol unregisterClass:[RKStreamedBodyCapturingURLProtocol class]];
+    
+    return (result != nil);
+}
+
+- (void)testChunkGeneratorIsStreamedThroughConnection
+{
+    RKRequestFactory *requestFactory = [[RKRequestFactory alloc] initWithBaseURL:[NSURL URLWithString:kStreamedBodyBaseURLString]
+                                                                readCacheManager:nil
+                                                               writeCacheManager:nil
+                                                                  postProcessors:nil];
+    
+    NSArray *chunks = @[ [@"testy " dataUsingEncoding:NSUTF8StringEncoding],
+                         [@"test " dataUsingEncoding:NSUTF8StringEncoding],
+                         [@"test" dataUsingEncoding:NSUTF8StringEncoding] ];
+    NSEnumerator *chunkEnumerator = [chunks objectEnumerator];
+    __block int32_t numberOfInvocations = 0;
+    RKRequestFactoryBodyChunkGenerator generator = ^NSData *{
+        OSAtomicIncrement32Barrier(&numberOfInvocations);
+        return [chunkEnumerator nextObject];
+    };
+    
+    __block int32_t numberOfInvocationsBeforeRead = -1;
+    [RKStreamedBodyCapturingURLProtocol reset];
+    [RKStreamedBodyCapturingURLProtocol setWillReadBodyHandler:^{
+        numberOfInvocationsBeforeRead = OSAtomicAdd32Barrier(0, &numberOfInvocations);
+    }];
+    
+    RKURLRequestPromise *requestPromise = [requestFactory POSTRequestPromiseWithPath:@"/chunks"
+                                                                          parameters:nil
+                                                                                body:generator
+                                                                            bodyType:kRKRequestFactoryBodyTypeChunkGenerator];
+    XCTAssertEqual(OSAtomicAdd32Barrier(0, &numberOfInvocations), 0, @"generator invoked before the request was sent");
+    
+    XCTAssertTrue([self sendStreamedBodyRequestPromise:requestPromise], @"request failed");
+    XCTAssertEqual(numberOfInvocationsBeforeRead, 0, @"generator invoked before the connection read the body");
+    XCTAssertEqual(OSAtomicAdd32Barrier(0, &numberOfInvocations), 4, @"unexpected number of generator invocations");
+    
+    NSURLRequest *capturedRequest = [RKStreamedBodyCapturingURLProtocol capturedRequest];
+    XCTAssertEqualObjects(capturedRequest.HTTPMethod, @"POST", @"unexpected HTTP method");
+    XCTAssertNil([capturedRequest valueForHTTPHeaderField:@"Content-Length"], @"streamed body has a content length");
+    XCTAssertEqualObjects([RKStreamedBodyCapturingURLProtocol capturedBody], [@"testy test test" dataUsingEncoding:NSUTF8StringEncoding], @"unexpected body received");
+    
+    [RKStreamedBodyCapturingURLProtocol reset];
+}
+
+- (void)testStreamingJSONArrayIsStreamedThroughConnection
+{
+    RKRequestFactory *requestFactory = [[RKRequestFactory alloc] initWithBaseURL:[NSURL URLWithString:kStreamedBodyBaseURLString]
+                                                                readCacheManager:nil
+                                                               writeCacheManager:nil
+                                                                  postProcessors:nil];
+    
+    NSMutableArray *elements = [NSMutableArray array];
+    for (NSInteger index = 0; index < 5000; index++)
+        [elements addObject:@{@"index": @(index), @"name": @"element"}];
+    RKCountingEnumerator *elementEnumerator = [[RKCountingEnumerator alloc] initWithArray:elements];
+    
+    __block NSUInteger numberOfElementsReadBeforeBodyRead = NSNotFound;
+    [RKStreamedBodyCapturingURLProtocol reset];
+    [RKStreamedBodyCapturingURLProtocol setWillReadBodyHandler:^{
+        numberOfElementsReadBeforeBodyRead = elementEnumerator.numberOfObjectsRead;
+    }];
+    
+    RKURLRequestPromise *requestPromise = [requestFactory PUTRequestPromiseWithPath:@"/elements"
+                                                                         parameters:nil
+                                                                               body:elementEnumerator
+                                                                           bodyType:kRKRequestFactoryBodyTypeStreamingJSONArray];
+    XCTAssertEqual(elementEnumerator.numberOfObjectsRead, 0UL, @"elements serialized before the request was sent");
+    
+    XCTAssertTrue([self sendStreamedBodyRequestPromise:requestPromise], @"request failed");
+    XCTAssertEqual(numberOfElementsReadBeforeBodyRead, 0UL, @"elements serialized before the connection read the body");
+    XCTAssertEqual(elementEnumerator.numberOfObjectsRead, elements.count + 1, @"unexpected number of elements read");
+    
+    NSURLRequest *capturedRequest = [RKStreamedBodyCapturingURLProtocol capturedRequest];
+    XCTAssertEqualObjects(capturedRequest.HTTPMethod, @"PUT", @"unexpected HTTP method");
+    XCTAssertNil([capturedRequest valueForHTTPHeaderField:@"Content-Length"], @"streamed body has a content length");
+    
+    NSData *capturedBody = [RKStreamedBodyCapturingURLProtocol capturedBody];
+    XCTAssertEqualObjects([NSJSONSerialization JSONObjectWithData:capturedBody options:0 error:NULL], elements, @"unexpected body received");
+    
+    [RKStreamedBodyCapturingURLProtocol reset];
+}
+
+- (void)testPostURLRequestWithMissingFile
+{
+    NSURL *fileLocation = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"RKRequestFactoryTests-missing-body"]];
+    [[NSFileManager defaultManager] removeItemAtURL:fileLocation error:NULL];
+    
+    NSURLRequest *request = nil;
+    XCTAssertNoThrow(request = [self.requestFactory POSTRequestWithPath:@"/test"
+                                                             parameters:nil
+                                                                   body:fileLocation
+                                                               bodyType:kRKRequestFactoryBodyTypeFile], @"missing file raised");
+    XCTAssertNil([request valueForHTTPHeaderField:@"Content-Length"], @"unexpected content length");
+    XCTAssertEqualObjects([NSURLProtocol propertyForKey:RKURLRequestPromiseBodyFilePathPropertyKey inRequest:request], fileLocation.path, @"missing body file path");
+    
+    NSInputStream *stream = request.HTTPBodyStream;
+    [stream open];
+    XCTAssertEqual(stream.streamStatus, NSStreamStatusError, @"missing file did not fail the stream");
+    XCTAssertNotNil(stream.streamError, @"missing stream error");
+    [stream close];
+}
+
+- (void)testPutURLRequestWithStreamingJSONArray
+{
+    NSMutableArray *elements = [NSMutableArray array];
+    for (NSInteger index = 0; index < 5000; index++)
+        [elements addObject:@{@"index": @(index), @"name": @"element"}];
+    [elements addObject:@"scalar"];
+    
+    NSURLRequest *request = [self.requestFactory PUTRequestWithPath:@"/test"
+                                                         parameters:nil
+                                                               body:elements
+                                                           bodyType:kRKRequestFactoryBodyTypeStreamingJSONArray];
+    
+    XCTAssertNil(request.HTTPBody, @"unexpected HTTP body");
+    
+    NSData *streamedData = [self dataFromStream:request.HTTPBodyStream];
+    XCTAssertEqualObjects([NSJSONSerialization JSONObjectWithData:streamedData options:0 error:NULL], elements, @"unexpected HTTP body stream contents");
+}
+
+- (void)testPutURLRequestWithEmptyStreamingJSONArray
+{
+    NSURLRequest *request = [self.requestFactory PUTRequestWithPath:@"/test"
+                                                         parameters:nil
+                                                               body:@[]
+                                                           bodyType:kRKRequestFactoryBodyTypeStreamingJSONArray];
+    
+    XCTAssertEqualObjects([self dataFromStream:request.HTTPBodyStream], [@"[]" dataUsingEncoding:NSUTF8StringEncoding], @"unexpected HTTP body stream contents");
+}
+
 #pragma mark - Request Promises
 
 - (void)testReadRequestPromise
@@ -223,4 +615,91 @@ static NSString *const kBaseURLString = @"http://example.com";
     XCTAssertEqualObjects(requestPromise.postProcessors, @[ self.postProcessor ], @"unexpected post processors");
 }
 
+#pragma mark - Prefetching
+
+- (void)testPrefetchRequestPromises
+{
+    NSURL *URL = [self.requestFactory URLWithPath:@"/test" parameters:nil];
+    RKPrefetchGroup *prefetchGroup = [self.requestFactory prefetchGroupWithURLs:@[ URL ]];
+    XCTAssertFalse(prefetchGroup.isFinished, @"prefetch group was started");
+    
+    XCTAssertEqual(prefetchGroup.requestPromises.count, 1UL, @"unexpected number of request promises");
+    
+    RKURLRequestPromise *requestPromise = prefetchGroup.requestPromises.firstObject;
+    XCTAssertEqualObjects([requestPromise.request.URL absoluteString], @"http://example.com/test", @"unexpected URL");
+    XCTAssertEqualObjects(requestPromise.request.HTTPMethod, @"GET", @"unexpected HTTP method");
+    XCTAssertEqual(requestPromise.request.networkServiceType, NSURLNetworkServiceTypeBackground, @"unexpected network service type");
+    XCTAssertEqual(requestPromise.schedulingPriority, kRKRequestSchedulerPriorityLow, @"unexpected scheduling priority");
+    XCTAssertEqualObjects(requestPromise.cacheManager, self.mockReadCacheManager, @"unexpected cache manager");
+    XCTAssertEqual(requestPromise.offlineBehavior, kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable, @"unexpected offline behavior");
+    XCTAssertEqual(requestPromise.postProcessors.count, 0UL, @"unexpected post processors");
+}
+
+///Realizes a prefetch group with a single request promise for a given URL,
+///backed by a cache manager with a given item for that URL.
+- (RKPrefetchGroup *)realizedPrefetchGroupForURL:(NSURL *)URL withCachedItem:(NSDictionary *)item
+{
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:@{ [URL absoluteString]: item }];
+    RKURLRequestPromise *requestPromise = [[RKURLRequestPromise alloc] initWithRequest:[NSURLRequest requestWithURL:URL]
+                                                                       offlineBehavior:kRKURLRequestPromiseOfflineBehaviorFail
+                                                                          cacheManager:cacheManager];
+    
+    RKPrefetchGroup *prefetchGroup = [[RKPrefetchGroup alloc] initWithRequestPromises:@[ requestPromise ]];
+    prefetchGroup.connectivityManager = [RKStubConnectivityManager new];
+    
+    __block BOOL finished = NO;
+    prefetchGroup.completionHandler = ^{
+        finished = YES;
+    };
+    [prefetchGroup start];
+    
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:2.0];
+    while (!finished && [timeout timeIntervalSinceNow] > 0.0)
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    
+    XCTAssertTrue(finished, @"prefetch group never finished");
+    XCTAssertFalse(prefetchGroup.canceled, @"prefetch group was canceled");
+    
+    return prefetchGroup;
+}
+
+- (void)testPrefetchSkipsFreshCache
+{
+    NSURL *URL = [self.requestFactory URLWithPath:@"/cached" parameters:nil];
+    RKPrefetchGroup *unexpiringGroup = [self realizedPrefetchGroupForURL:URL withCachedItem:@{
+        kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeArbitraryValue",
+        kRKMockURLRequestPromiseCacheManagerItemDataKey: [NSData data],
+    }];
+    XCTAssertEqual(unexpiringGroup.numberOfSkippedRequests, 1UL, @"populated cache was not skipped");
+    XCTAssertEqual(unexpiringGroup.numberOfCompletedRequests, 0UL, @"unexpected request");
+    
+    RKPrefetchGroup *unexpiredGroup = [self realizedPrefetchGroupForURL:URL withCachedItem:@{
+        kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeArbitraryValue",
+        kRKMockURLRequestPromiseCacheManagerItemDataKey: [NSData data],
+        kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey: [NSDate dateWithTimeIntervalSinceNow:60.0],
+    }];
+    XCTAssertEqual(unexpiredGroup.numberOfSkippedRequests, 1UL, @"unexpired cache was not skipped");
+    XCTAssertEqual(unexpiredGroup.numberOfCompletedRequests, 0UL, @"unexpected request");
+}
+
+- (void)testPrefetchRefreshesExpiredCache
+{
+    [RKTestURLProtocol setup];
+    
+    NSURL *URL = [self.requestFactory URLWithPath:@"/expired" parameters:nil];
+    [[RKTestURLProtocol stubGetRequestToURL:URL withHeaders:nil] andReturnString:@"Fresh"
+                                                                      withHeaders:@{@"Content-Type": @"text/plain"}
+                                                                    andStatusCode:200];
+    
+    RKPrefetchGroup *prefetchGroup = [self realizedPrefetchGroupForURL:URL withCachedItem:@{
+        kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeArbitraryValue",
+        kRKMockURLRequestPromiseCacheManagerItemDataKey: [NSData data],
+        kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey: [NSDate dateWithTimeIntervalSinceNow:-60.0],
+    }];
+    XCTAssertEqual(prefetchGroup.numberOfSkippedRequests, 0UL, @"expired cache was skipped");
+    XCTAssertEqual(prefetchGroup.numberOfCompletedRequests, 1UL, @"expired cache was not refreshed");
+    
+    [RKTestURLProtocol teardown];
+}
+
 @end
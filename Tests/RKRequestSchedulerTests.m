@@ -0,0 +1,134 @@
+//
+//  RKRequestSchedulerTests.m
+//  RoundaboutKit
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//  Copyright (c) 2026 Roundabout Software, LLC. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+static NSString *const kTestHost = @"example.com";
+
+@interface RKRequestSchedulerTests : XCTestCase
+
+@property (nonatomic) RKRequestScheduler *scheduler;
+@property (nonatomic) NSURLRequest *request;
+
+@end
+
+@implementation RKRequestSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+    
+    self.scheduler = [RKRequestScheduler new];
+    self.scheduler.initialWindow = 2;
+    self.request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://example.com/test"]];
+}
+
+- (void)tearDown
+{
+    self.scheduler = nil;
+    self.request = nil;
+    
+    [super tearDown];
+}
+
+#pragma mark -
+
+- (NSHTTPURLResponse *)responseWithStatusCode:(NSInteger)statusCode
+{
+    return [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:@{}];
+}
+
+- (void)testWindowLimitsConcurrency
+{
+    __block NSUInteger numberOfStartedRequests = 0;
+    RKRequestSchedulerTicket *ticket1 = [self.scheduler enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    RKRequestSchedulerTicket *ticket2 = [self.scheduler enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    RKRequestSchedulerTicket *ticket3 = [self.scheduler enqueueRequest:self.request withBlock:^{ numberOfStartedRequests++; }];
+    
+    XCTAssertEqual(numberOfStartedRequests, 2UL, @"window was not honored");
+    XCTAssertEqual([self.scheduler numberOfPendingRequestsForHost:kTestHost], 1UL, @"unexpected pending count");
+    
+    [self.scheduler completeTicket:ticket1 withResponse:[self responseWithStatusCode:200] error:nil];
+    XCTAssertEqual(numberOfStartedRequests, 3UL, @"pending request was not started");
+    
+    [self.scheduler completeTicket:ticket2 withResponse:[self responseWithStatusCode:200] error:nil];
+    [self.scheduler completeTicket:ticket3 withResponse:[self responseWithStatusCode:200] error:nil];
+    XCTAssertEqual([self.scheduler numberOfActiveRequestsForHost:kTestHost], 0UL, @"unexpected active count");
+}
+
+- (void)testWindowGrowsAdditively
+{
+    for (NSUInteger index = 0; index < 8; index++) {
+        RKRequestSchedulerTicket *ticket = [self.scheduler enqueueRequest:self.request withBlock:^{}];
+        [self.scheduler completeTicket:ticket withResponse:[self responseWithStatusCode:200] error:nil];
+    }
+    
+    double window = [self.scheduler windowForHost:kTestHost];
+    XCTAssertGreaterThan(window, 2.0, @"window did not grow");
+    XCTAssertLessThan(window, 10.0, @"window grew faster than additively");
+}
+
+- (void)testWindowShrinksOnThrottling
+{
+    RKRequestSchedulerTicket *ticket = [self.scheduler enqueueRequest:self.request withBlock:^{}];
+    [self.scheduler completeTicket:ticket withResponse:[self responseWithStatusCode:503] error:nil];
+    
+    XCTAssertEqualWithAccuracy([self.scheduler windowForHost:kTestHost], 1.0, 0.001, @"window did not shrink");
+    
+    NSArray *history = [self.scheduler windowHistoryForHost:kTestHost];
+    XCTAssertEqual(history.count, 1UL, @"missing history sample");
+    XCTAssertEqualObjects([history.lastObject objectForKey:RKRequestSchedulerSampleReasonKey], @"unavailable", @"unexpected reason");
+}
+
+- (void)testLatencyIsMeasuredFromConnectionStart
+{
+    RKRequestSchedulerTicket *ticket = [self.scheduler enqueueRequest:self.request withBlock:^{}];
+    
+    //Time spent between the block being invoked and the connection starting is the client's own.
+    [NSThread sleepForTimeInterval:0.25];
+    
+    [self.scheduler ticketDidStartConnection:ticket];
+    [self.scheduler ticketDidReceiveResponse:ticket];
+    [self.scheduler completeTicket:ticket withResponse:[self responseWithStatusCode:200] error:nil];
+    
+    NSTimeInterval baselineLatency = [self.scheduler.snapshot[kTestHost][@"baselineLatency"] doubleValue];
+    XCTAssertLessThan(baselineLatency, 0.1, @"time before the connection started was counted as latency");
+}
+
+- (void)testCanceledPendingTicketNeverStarts
+{
+    self.scheduler.initialWindow = 1;
+    
+    __block BOOL secondStarted = NO;
+    RKRequestSchedulerTicket *ticket1 = [self.scheduler enqueueRequest:self.request withBlock:^{}];
+    RKRequestSchedulerTicket *ticket2 = [self.scheduler enqueueRequest:self.request withBlock:^{ secondStarted = YES; }];
+    
+    [self.scheduler cancelTicket:ticket2];
+    [self.scheduler completeTicket:ticket1 withResponse:[self responseWithStatusCode:200] error:nil];
+    
+    XCTAssertFalse(secondStarted, @"canceled ticket was started");
+    XCTAssertEqual([self.scheduler numberOfPendingRequestsForHost:kTestHost], 0UL, @"unexpected pending count");
+}
+
+- (void)testLowPriorityRequestsYieldToNormalPriority
+{
+    self.scheduler.initialWindow = 1;
+    
+    NSMutableArray *startOrder = [NSMutableArray array];
+    RKRequestSchedulerTicket *ticket1 = [self.scheduler enqueueRequest:self.request withBlock:^{ [startOrder addObject:@1]; }];
+    RKRequestSchedulerTicket *ticket2 = [self.scheduler enqueueRequest:self.request priority:kRKRequestSchedulerPriorityLow withBlock:^{ [startOrder addObject:@2]; }];
+    RKRequestSchedulerTicket *ticket3 = [self.scheduler enqueueRequest:self.request withBlock:^{ [startOrder addObject:@3]; }];
+    
+    [self.scheduler completeTicket:ticket1 withResponse:[self responseWithStatusCode:200] error:nil];
+    [self.scheduler completeTicket:ticket3 withResponse:[self responseWithStatusCode:200] error:nil];
+    [self.scheduler completeTicket:ticket2 withResponse:[self responseWithStatusCode:200] error:nil];
+    
+    XCTAssertEqualObjects(startOrder, (@[ @1, @3, @2 ]), @"low priority request did not yield");
+}
+
+@end
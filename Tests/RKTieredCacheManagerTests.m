@@ -0,0 +1,155 @@
+//
+//  RKTieredCacheManagerTests.m
+//  RoundaboutKitTests
+//
+//  Created by Kevin MacWhinnie on 10/18/26.
+//
+//
+
+#import <XCTest/XCTest.h>
+#import "RKMockURLRequestPromiseCacheManager.h"
+
+static NSString *const kCacheIdentifier = @"MyLovelyArbitraryValue";
+static NSString *const kRevision = @"1";
+
+@interface RKTieredCacheManagerTests : XCTestCase
+
+@end
+
+@implementation RKTieredCacheManagerTests
+
+- (NSData *)dataOfLength:(NSUInteger)length
+{
+    return [NSMutableData dataWithLength:length];
+}
+
+- (void)testReadsArePromotedToMemory
+{
+    NSDictionary *items = @{kCacheIdentifier: @{kRKMockURLRequestPromiseCacheManagerItemRevisionKey: kRevision,
+                                                kRKMockURLRequestPromiseCacheManagerItemDataKey: [self dataOfLength:16]}};
+    RKMockURLRequestPromiseCacheManager *backingCacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKTieredCacheManager *cacheManager = [[RKTieredCacheManager alloc] initWithBackingCacheManager:backingCacheManager memoryBudget:1024];
+    
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"missing data");
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"missing data");
+    XCTAssertNil([cacheManager cachedDataForIdentifier:@"SmarchFifth" error:NULL], @"unexpected data");
+    
+    XCTAssertEqual(cacheManager.backingHitCount, 1LL, @"unexpected backing hits");
+    XCTAssertEqual(cacheManager.memoryHitCount, 1LL, @"unexpected memory hits");
+    XCTAssertEqual(cacheManager.missCount, 1LL, @"unexpected misses");
+    XCTAssertEqualObjects([cacheManager revisionForIdentifier:kCacheIdentifier], kRevision, @"unexpected revision");
+    
+    [cacheManager resetStatistics];
+    XCTAssertEqual(cacheManager.memoryHitCount, 0LL, @"statistics were not reset");
+}
+
+- (void)testPromotedItemsKeepTheirExpirationDate
+{
+    NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:0.5];
+    NSDictionary *items = @{kCacheIdentifier: @{kRKMockURLRequestPromiseCacheManagerItemRevisionKey: kRevision,
+                                                kRKMockURLRequestPromiseCacheManagerItemDataKey: [self dataOfLength:16],
+                                                kRKMockURLRequestPromiseCacheManagerItemExpirationDateKey: expirationDate}};
+    RKMockURLRequestPromiseCacheManager *backingCacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKTieredCacheManager *cacheManager = [[RKTieredCacheManager alloc] initWithBackingCacheManager:backingCacheManager memoryBudget:1024];
+    cacheManager.promotionPolicy = kRKTieredCacheManagerPromotionPolicyAlways;
+    
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"missing data");
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"missing data");
+    XCTAssertEqual(cacheManager.memoryHitCount, 1LL, @"read was not promoted");
+    XCTAssertEqualObjects([cacheManager expirationDateForIdentifier:kCacheIdentifier], expirationDate, @"promotion lost the expiration date");
+    
+    [NSThread sleepForTimeInterval:1.0];
+    
+    [cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL];
+    XCTAssertEqual(cacheManager.memoryHitCount, 1LL, @"memory tier served an expired item");
+    XCTAssertEqual(cacheManager.backingHitCount, 2LL, @"unexpected backing hits");
+}
+
+- (void)testAsyncMemoryHitsAreAnsweredInline
+{
+    NSDictionary *items = @{kCacheIdentifier: @{kRKMockURLRequestPromiseCacheManagerItemRevisionKey: kRevision,
+                                                kRKMockURLRequestPromiseCacheManagerItemDataKey: [self dataOfLength:16]}};
+    RKMockURLRequestPromiseCacheManager *backingCacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKTieredCacheManager *cacheManager = [[RKTieredCacheManager alloc] initWithBackingCacheManager:backingCacheManager memoryBudget:1024];
+    XCTAssertEqualObjects(RKAsyncCacheManagerForCacheManager(cacheManager), cacheManager, @"tiered cache manager was wrapped in an adapter");
+    
+    __block NSData *missData = nil;
+    [cacheManager loadCachedDataForIdentifier:kCacheIdentifier completionHandler:^(NSData *data, NSError *error) {
+        missData = data;
+    }];
+    
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (!missData && [timeout timeIntervalSinceNow] > 0.0)
+        [NSThread sleepForTimeInterval:0.01];
+    
+    XCTAssertNotNil(missData, @"missing data");
+    XCTAssertEqual(cacheManager.backingHitCount, 1LL, @"unexpected backing hits");
+    XCTAssertEqual(cacheManager.memorySize, 16UL, @"read was not promoted");
+    
+    __block NSData *hitData = nil;
+    __block NSString *hitRevision = nil;
+    [cacheManager loadCachedDataForIdentifier:kCacheIdentifier completionHandler:^(NSData *data, NSError *error) {
+        hitData = data;
+    }];
+    [cacheManager loadRevisionForIdentifier:kCacheIdentifier completionHandler:^(NSString *revision) {
+        hitRevision = revision;
+    }];
+    XCTAssertNotNil(hitData, @"memory hit was not answered inline");
+    XCTAssertEqualObjects(hitRevision, kRevision, @"memory hit was not answered inline");
+    XCTAssertEqual(cacheManager.memoryHitCount, 1LL, @"unexpected memory hits");
+    
+    __block BOOL finishedCaching = NO;
+    [cacheManager cacheData:[self dataOfLength:32] forIdentifier:kCacheIdentifier withRevision:@"2" expirationDate:nil completionHandler:^(BOOL success, NSError *error) {
+        finishedCaching = success;
+    }];
+    
+    timeout = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (!finishedCaching && [timeout timeIntervalSinceNow] > 0.0)
+        [NSThread sleepForTimeInterval:0.01];
+    
+    XCTAssertTrue(finishedCaching, @"could not store cache");
+    XCTAssertEqual(cacheManager.memorySize, 32UL, @"write through did not store in memory");
+    XCTAssertEqualObjects([backingCacheManager revisionForIdentifier:kCacheIdentifier], @"2", @"write did not reach backing cache manager");
+}
+
+- (void)testWritePolicies
+{
+    RKMockURLRequestPromiseCacheManager *backingCacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:nil];
+    RKTieredCacheManager *cacheManager = [[RKTieredCacheManager alloc] initWithBackingCacheManager:backingCacheManager memoryBudget:1024];
+    
+    XCTAssertTrue([cacheManager cacheData:[self dataOfLength:16] forIdentifier:kCacheIdentifier withRevision:kRevision error:NULL], @"could not store cache");
+    XCTAssertEqual(cacheManager.memorySize, 16UL, @"write through did not store in memory");
+    XCTAssertNotNil([backingCacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], @"write through did not store in backing cache manager");
+    
+    cacheManager.writePolicy = kRKTieredCacheManagerWritePolicyWriteAround;
+    XCTAssertTrue([cacheManager cacheData:[self dataOfLength:32] forIdentifier:kCacheIdentifier withRevision:@"2" error:NULL], @"could not store cache");
+    XCTAssertEqual(cacheManager.memorySize, 0UL, @"write around left stale data in memory");
+    XCTAssertEqual([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL].length, 32UL, @"unexpected data");
+    XCTAssertEqual(cacheManager.backingHitCount, 1LL, @"unexpected backing hits");
+}
+
+- (void)testMemoryBudgetIsEnforced
+{
+    RKMockURLRequestPromiseCacheManager *backingCacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:nil];
+    RKTieredCacheManager *cacheManager = [[RKTieredCacheManager alloc] initWithBackingCacheManager:backingCacheManager memoryBudget:1024];
+    
+    [cacheManager cacheData:[self dataOfLength:100] forIdentifier:@"hot" withRevision:kRevision error:NULL];
+    for (NSUInteger index = 0; index < 16; index++) {
+        [cacheManager cachedDataForIdentifier:@"hot" error:NULL];
+        [cacheManager cacheData:[self dataOfLength:100] forIdentifier:[NSString stringWithFormat:@"%ld", (long)index] withRevision:kRevision error:NULL];
+        XCTAssertLessThanOrEqual(cacheManager.memorySize, 1024UL, @"memory budget exceeded");
+    }
+    
+    [cacheManager resetStatistics];
+    [cacheManager cachedDataForIdentifier:@"hot" error:NULL];
+    XCTAssertEqual(cacheManager.memoryHitCount, 1LL, @"referenced item was evicted");
+    
+    NSUInteger memorySize = cacheManager.memorySize;
+    [cacheManager cacheData:[self dataOfLength:512] forIdentifier:@"large" withRevision:kRevision error:NULL];
+    XCTAssertEqual(cacheManager.memorySize, memorySize, @"item larger than maximum item size was kept in memory");
+    
+    cacheManager.memoryBudget = 0;
+    XCTAssertEqual(cacheManager.memorySize, 0UL, @"lowering the budget did not evict");
+}
+
+@end
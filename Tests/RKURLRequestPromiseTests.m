@@ -123,6 +123,7 @@
     XCTAssertFalse(cacheManager.cacheDataForIdentifierWithRevisionErrorWasCalled, @"cacheDataForIdentifierWithRevisionError was not called");
     XCTAssertTrue(cacheManager.cachedDataForIdentifierErrorWasCalled, @"cachedDataForIdentifierError was not called");
     XCTAssertFalse(cacheManager.removeCacheForIdentifierErrorWasCalled, @"removeCacheForIdentifierErrorWasCalled was called");
+    XCTAssertTrue(cacheManager.noteRevalidationForIdentifierWasCalled, @"Revalidation was not noted");
     
     NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
     XCTAssertEqualObjects(resultString, PLAIN_TEXT_STRING, @"Wrong result was given");
@@ -156,11 +157,43 @@
     XCTAssertTrue(cacheManager.cacheDataForIdentifierWithRevisionErrorWasCalled, @"cacheDataForIdentifierWithRevisionError was not called");
     XCTAssertFalse(cacheManager.cachedDataForIdentifierErrorWasCalled, @"cachedDataForIdentifierError was not called");
     XCTAssertFalse(cacheManager.removeCacheForIdentifierErrorWasCalled, @"removeCacheForIdentifierErrorWasCalled was called");
+    XCTAssertFalse(cacheManager.noteRevalidationForIdentifierWasCalled, @"Changed data was noted as revalidated");
     
     NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
     XCTAssertEqualObjects(resultString, PLAIN_TEXT_STRING, @"Wrong result was given");
 }
 
+- (void)testCacheControlDirectives
+{
+    NSURL *noStoreURL = [NSURL URLWithString:@"http://test/no-store"];
+    [[RKTestURLProtocol stubGetRequestToURL:noStoreURL withHeaders:nil] andReturnString:PLAIN_TEXT_STRING
+                                                                          withHeaders:@{@"Etag": @"\"v1\"", @"Cache-Control": @"private, no-store"}
+                                                                        andStatusCode:200];
+    
+    NSURL *noCacheURL = [NSURL URLWithString:@"http://test/no-cache"];
+    [[RKTestURLProtocol stubGetRequestToURL:noCacheURL withHeaders:nil] andReturnString:PLAIN_TEXT_STRING
+                                                                          withHeaders:@{@"Cache-Control": @"no-cache, max-age=604800"}
+                                                                        andStatusCode:200];
+    
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:nil];
+    for (NSURL *URL in @[ noStoreURL, noCacheURL ]) {
+        RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:[NSURLRequest requestWithURL:URL]
+                                                                        offlineBehavior:kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable
+                                                                           cacheManager:cacheManager];
+        testPromise.connectivityManager = self.connectivityManager;
+        
+        NSError *error = nil;
+        XCTAssertNotNil([testPromise waitForRealization:&error], @"RKAwait unexpectedly failed");
+    }
+    
+    XCTAssertNil([cacheManager cachedDataForIdentifier:[noStoreURL absoluteString] error:NULL], @"no-store response was cached");
+    
+    NSDate *expirationDate = [cacheManager expirationDateForIdentifier:[noCacheURL absoluteString]];
+    XCTAssertNotNil([cacheManager cachedDataForIdentifier:[noCacheURL absoluteString] error:NULL], @"no-cache response was not cached");
+    XCTAssertNotNil(expirationDate, @"no-cache response was stored without an expiration date");
+    XCTAssertLessThanOrEqual([expirationDate timeIntervalSinceNow], 0.0, @"no-cache response outlives its revalidation");
+}
+
 - (void)testCacheManagerAssumptionsAboutFailure
 {
     NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
@@ -245,6 +278,161 @@
     XCTAssertNil(error, @"unexpected error");
 }
 
+- (void)testProcessedValueReuse
+{
+    NSString *const kCacheIdentifier = PLAIN_TEXT_URL_STRING;
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemRevisionKey: @"SomeArbitraryValue",
+            kRKMockURLRequestPromiseCacheManagerItemDataKey: [@"{\"greeting\": \"hello, world!\"}" dataUsingEncoding:NSUTF8StringEncoding],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    RKProcessedValueCache *processedValueCache = [RKProcessedValueCache new];
+    
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger attempt = 0; attempt < 2; attempt++) {
+        NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+        RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request
+                                                                        offlineBehavior:kRKURLRequestPromiseOfflineBehaviorUseCacheIfAvailable
+                                                                           cacheManager:cacheManager];
+        testPromise.cacheIdentifier = kCacheIdentifier;
+        testPromise.connectivityManager = [[RKConnectivityManager alloc] initWithHostName:PLAIN_TEXT_URL_STRING];
+        testPromise.processedValueCache = processedValueCache;
+        [testPromise addPostProcessor:[RKJSONPostProcessor sharedPostProcessor]];
+        
+        NSError *error = nil;
+        NSDictionary *result = [testPromise waitForRealization:&error];
+        XCTAssertEqualObjects(result, @{@"greeting": @"hello, world!"}, @"Unexpected value");
+        XCTAssertNil(error, @"Unexpected error");
+        
+        if(result)
+            [results addObject:result];
+    }
+    
+    XCTAssertEqual(results.count, 2UL, @"Missing results");
+    XCTAssertTrue(results.firstObject == results.lastObject, @"Unchanged data was post-processed again");
+    
+    RKSimplePostProcessor *simplePostProcessor = [[RKSimplePostProcessor alloc] initWithBlock:^RKPossibility *(RKPossibility *maybeData, id context) {
+        return maybeData;
+    }];
+    XCTAssertNil([RKProcessedValueCache identifierForPostProcessors:@[ simplePostProcessor ]], @"Values of simple post-processors should never be reused");
+    XCTAssertNil([RKProcessedValueCache identifierForPostProcessors:@[ [RKPostProcessor new] ]], @"Values of post-processors that do not opt in should never be reused");
+}
+
+- (void)testResumingPartialData
+{
+    NSURL *URL = [NSURL URLWithString:@"http://test/resumable"];
+    NSString *const kCacheIdentifier = [URL absoluteString];
+    
+    RKTestURLRequestStub *stub = [RKTestURLProtocol stubGetRequestToURL:URL
+                                                        withHeaders:@{@"Range": @"bytes=7-", @"If-Range": @"\"v1\""}];
+    [stub andReturnString:@"world!"
+              withHeaders:@{@"Etag": @"\"v1\"", @"Content-Range": @"bytes 7-12/13"}
+            andStatusCode:206];
+    
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemPartialDataKey: [@"hello, " dataUsingEncoding:NSUTF8StringEncoding],
+            kRKMockURLRequestPromiseCacheManagerItemValidatorKey: @"\"v1\"",
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:[NSURLRequest requestWithURL:URL]
+                                                                    offlineBehavior:kRKURLRequestPromiseOfflineBehaviorFail
+                                                                       cacheManager:cacheManager];
+    testPromise.connectivityManager = self.connectivityManager;
+    
+    NSError *error = nil;
+    NSData *result = [testPromise waitForRealization:&error];
+    XCTAssertNotNil(result, @"RKAwait unexpectedly failed");
+    
+    NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(resultString, PLAIN_TEXT_STRING, @"Partial data was not stitched");
+    XCTAssertEqual(testPromise.response.statusCode, 200L, @"Stitched response was not reported as complete");
+    
+    //Partial data is removed without the promise waiting for it.
+    NSString *validator = nil;
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while ([cacheManager partialDataForIdentifier:kCacheIdentifier validator:&validator] && [timeout timeIntervalSinceNow] > 0.0)
+        [NSThread sleepForTimeInterval:0.01];
+    
+    XCTAssertTrue(cacheManager.removePartialDataForIdentifierErrorWasCalled, @"Partial data was not removed");
+    XCTAssertNil([cacheManager partialDataForIdentifier:kCacheIdentifier validator:&validator], @"Partial data was not removed");
+    XCTAssertEqualObjects([cacheManager cachedDataForIdentifier:kCacheIdentifier error:NULL], result, @"Complete body was not cached");
+}
+
+- (void)testUnsatisfiableRangeIsOnlyRetriedOnce
+{
+    NSURL *URL = [NSURL URLWithString:@"http://test/unresumable"];
+    NSString *const kCacheIdentifier = [URL absoluteString];
+    
+    RKTestURLRequestStub *rangeStub = [RKTestURLProtocol stubGetRequestToURL:URL
+                                                             withHeaders:@{@"Range": @"bytes=7-", @"If-Range": @"\"v1\""}];
+    [rangeStub andReturnString:@""
+                   withHeaders:@{@"Content-Range": @"bytes */13"}
+                 andStatusCode:416];
+    
+    RKTestURLRequestStub *stub = [RKTestURLProtocol stubGetRequestToURL:URL withHeaders:nil];
+    [stub andReturnString:PLAIN_TEXT_STRING
+              withHeaders:@{@"Etag": @"\"v2\""}
+            andStatusCode:200];
+    
+    //The partial data cannot be removed, so it is still there when the request is started again.
+    NSDictionary *items = @{
+        kCacheIdentifier: @{
+            kRKMockURLRequestPromiseCacheManagerItemPartialDataKey: [@"hello, " dataUsingEncoding:NSUTF8StringEncoding],
+            kRKMockURLRequestPromiseCacheManagerItemValidatorKey: @"\"v1\"",
+            kRKMockURLRequestPromiseCacheManagerItemPartialDataRemovalErrorKey: [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteNoPermissionError userInfo:nil],
+        },
+    };
+    RKMockURLRequestPromiseCacheManager *cacheManager = [[RKMockURLRequestPromiseCacheManager alloc] initWithItems:items];
+    
+    RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:[NSURLRequest requestWithURL:URL]
+                                                                    offlineBehavior:kRKURLRequestPromiseOfflineBehaviorFail
+                                                                       cacheManager:cacheManager];
+    testPromise.connectivityManager = self.connectivityManager;
+    
+    NSError *error = nil;
+    NSData *result = [testPromise waitForRealization:&error];
+    XCTAssertNotNil(result, @"RKAwait unexpectedly failed");
+    
+    NSString *resultString = [[NSString alloc] initWithData:result encoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects(resultString, PLAIN_TEXT_STRING, @"Whole body was not requested again");
+    
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (!cacheManager.removePartialDataForIdentifierErrorWasCalled && [timeout timeIntervalSinceNow] > 0.0)
+        [NSThread sleepForTimeInterval:0.01];
+    
+    XCTAssertTrue(cacheManager.removePartialDataForIdentifierErrorWasCalled, @"Partial data removal was not attempted");
+}
+
+- (void)testCancelingCompletedRateLimitedRequest
+{
+    NSOperationQueue *requestQueue = [NSOperationQueue new];
+    requestQueue.maxConcurrentOperationCount = 4;
+    
+    for (NSUInteger attempt = 0; attempt < 16; attempt++) {
+        NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:PLAIN_TEXT_URL_STRING]];
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+        RKURLRequestPromise *testPromise = [[RKURLRequestPromise alloc] initWithRequest:request requestQueue:requestQueue];
+#pragma clang diagnostic pop
+        testPromise.connectivityManager = self.connectivityManager;
+        testPromise.rateLimiter = [[RKRateLimiter alloc] initWithRate:100.0 burst:100];
+        
+        NSError *error = nil;
+        XCTAssertNotNil([testPromise waitForRealization:&error], @"RKAwait unexpectedly failed");
+        
+        //The limiter issues its token inline, so the connection may be scheduled before
+        //-fire stores the ticket. A completed request must have nothing left to cancel.
+        [testPromise cancel:nil];
+        XCTAssertFalse(testPromise.canceled, @"Completed request was canceled through a stale rate limiter ticket");
+    }
+}
+
 #pragma mark -
 
 - (void)testStateConsistencyGuards